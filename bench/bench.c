@@ -1,5 +1,18 @@
 /*
  * json-asm: Benchmark tool
+ *
+ * Times each phase of the work on each corpus, once per SIMD tier asked
+ * for, and reports the median and best time of every phase together with
+ * hardware counters per input byte where the system provides them:
+ *
+ *   scan       structural index of the input (stage one of a two-stage parse)
+ *   build      tree construction: a two-stage parse less its scan
+ *   parse      the default parse
+ *   stringify  minified output of the parsed document
+ *
+ * Record corpora (NDJSON) are streamed record by record, so they have no
+ * build or stringify phase. Results can be written as JSON and compared with
+ * an earlier run; regressions beyond a tolerance fail the run.
  */
 
 #define _POSIX_C_SOURCE 199309L
@@ -9,11 +22,15 @@
 #include <string.h>
 #include <time.h>
 #include <getopt.h>
-#include "json_asm.h"
+#include "../src/internal.h"
+#include "bench.h"
 
-/* Default iterations */
-#define DEFAULT_ITERATIONS 1000
-#define WARMUP_ITERATIONS 10
+#define MAX_ITERATIONS      1000
+#define MIN_ITERATIONS      5
+#define DEFAULT_WARMUP      5
+#define PHASE_BUDGET_NS     200000000ULL    /* Auto iterations: ~0.2 s a phase */
+#define DEFAULT_TOLERANCE   5.0             /* Percent slower that fails --baseline */
+#define DEFAULT_CORPUS_DIR  "data/corpus"
 
 /* Get high-resolution time in nanoseconds */
 static uint64_t get_time_ns(void) {
@@ -22,45 +39,6 @@ static uint64_t get_time_ns(void) {
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
-/* Load file into memory */
-static char *load_file(const char *path, size_t *size) {
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        fprintf(stderr, "Error: Cannot open file: %s\n", path);
-        return NULL;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long len = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (len <= 0) {
-        fclose(f);
-        fprintf(stderr, "Error: Empty or invalid file: %s\n", path);
-        return NULL;
-    }
-
-    char *buf = malloc((size_t)len + 1);
-    if (!buf) {
-        fclose(f);
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        return NULL;
-    }
-
-    size_t read = fread(buf, 1, (size_t)len, f);
-    fclose(f);
-
-    if (read != (size_t)len) {
-        free(buf);
-        fprintf(stderr, "Error: Read error\n");
-        return NULL;
-    }
-
-    buf[len] = '\0';
-    *size = (size_t)len;
-    return buf;
-}
-
 /* Format size with units */
 static void format_size(size_t bytes, char *buf, size_t buf_size) {
     if (bytes >= 1024 * 1024) {
@@ -85,106 +63,362 @@ static void format_throughput(double bytes_per_sec, char *buf, size_t buf_size)
     }
 }
 
-/* Benchmark result */
-typedef struct {
-    uint64_t min_ns;
-    uint64_t max_ns;
-    uint64_t total_ns;
-    uint64_t iterations;
-} bench_result;
+/* ============================================================================
+ * Phases
+ * ============================================================================ */
+
+typedef struct bench_input {
+    const bench_corpus *corpus;
+    json_val *root;                     /* Parsed once, for stringify */
+    struct structural_index index;      /* Reused by scan, like two-stage parses */
+} bench_input;
+
+/* One timed step; what it returns is released by the phase's dispose,
+ * outside the timing */
+typedef struct bench_phase {
+    const char *name;
+    void *(*run)(bench_input *in);
+    void (*dispose)(void *result);
+} bench_phase;
+
+static void *run_scan(bench_input *in) {
+    if (!structural_index_build(&in->index, in->corpus->json, in->corpus->len)) return NULL;
+    return &in->index;
+}
+
+static void *run_parse(bench_input *in) {
+    return json_parse(in->corpus->json, in->corpus->len);
+}
 
-static void bench_result_init(bench_result *r) {
-    r->min_ns = UINT64_MAX;
-    r->max_ns = 0;
-    r->total_ns = 0;
-    r->iterations = 0;
+static void *run_parse_two_stage(bench_input *in) {
+    json_parse_options opts = { .flags = JSON_PARSE_TWO_STAGE };
+    return json_parse_opts(in->corpus->json, in->corpus->len, &opts);
 }
 
-static void bench_result_add(bench_result *r, uint64_t ns) {
-    if (ns < r->min_ns) r->min_ns = ns;
-    if (ns > r->max_ns) r->max_ns = ns;
-    r->total_ns += ns;
-    r->iterations++;
+static void *run_stringify(bench_input *in) {
+    return json_stringify(in->root);
 }
 
-static double bench_result_avg_ns(const bench_result *r) {
-    return (double)r->total_ns / (double)r->iterations;
+/* All records; a stream reuses one document for them */
+static void *run_stream(bench_input *in) {
+    json_stream *stream = json_stream_new(in->corpus->json, in->corpus->len, NULL);
+    if (!stream) return NULL;
+    while (json_stream_next(stream)) {}
+    bool ok = json_get_error().code == JSON_OK;
+    json_stream_free(stream);
+    return ok ? in : NULL;
 }
 
-/* Benchmark parsing */
-static void bench_parse(const char *json, size_t len, int iterations, bench_result *result) {
-    bench_result_init(result);
+static void dispose_none(void *result) {
+    (void)result;
+}
+
+static void dispose_doc(void *result) {
+    json_doc_free(result);
+}
 
-    /* Warmup */
-    for (int i = 0; i < WARMUP_ITERATIONS; i++) {
-        json_doc *doc = json_parse(json, len);
-        if (doc) json_doc_free(doc);
+static const bench_phase g_phase_scan      = { "scan", run_scan, dispose_none };
+static const bench_phase g_phase_two_stage = { "two_stage", run_parse_two_stage, dispose_doc };
+static const bench_phase g_phase_parse     = { "parse", run_parse, dispose_doc };
+static const bench_phase g_phase_stringify = { "stringify", run_stringify, free };
+static const bench_phase g_phase_stream    = { "parse", run_stream, dispose_none };
+
+/* ============================================================================
+ * Measurement
+ * ============================================================================ */
+
+typedef struct bench_result {
+    const char *corpus;
+    bool synthetic;
+    size_t bytes;
+    const char *tier;
+    const char *phase;
+    uint64_t iterations;
+    uint64_t min_ns;
+    uint64_t median_ns;
+    bool has_counters;
+    double per_byte[COUNTER_COUNT];     /* Counter events per input byte */
+} bench_result;
+
+typedef struct bench_config {
+    int iterations;                     /* 0 = from PHASE_BUDGET_NS */
+    int warmup;
+} bench_config;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Time a phase; false if it fails on this input */
+static bool measure(const bench_config *cfg, const bench_phase *phase, bench_input *in,
+                    bench_result *out) {
+    uint64_t first = 0;
+    for (int i = 0; i < (cfg->warmup > 0 ? cfg->warmup : 1); i++) {
+        uint64_t start = get_time_ns();
+        void *result = phase->run(in);
+        first = get_time_ns() - start;
+        if (!result) return false;
+        phase->dispose(result);
+    }
+
+    uint64_t iterations = (uint64_t)cfg->iterations;
+    if (iterations == 0) {
+        iterations = first ? PHASE_BUDGET_NS / first : MAX_ITERATIONS;
+        if (iterations < MIN_ITERATIONS) iterations = MIN_ITERATIONS;
+        if (iterations > MAX_ITERATIONS) iterations = MAX_ITERATIONS;
     }
 
-    /* Benchmark */
-    for (int i = 0; i < iterations; i++) {
+    uint64_t *samples = malloc(iterations * sizeof(*samples));
+    if (!samples) return false;
+
+    uint64_t totals[COUNTER_COUNT] = {0};
+    bool counted = counters_available();
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint64_t values[COUNTER_COUNT];
+        counters_start();
         uint64_t start = get_time_ns();
-        json_doc *doc = json_parse(json, len);
+        void *result = phase->run(in);
         uint64_t end = get_time_ns();
+        if (!counters_stop(values)) counted = false;
 
-        if (doc) {
-            json_doc_free(doc);
-            bench_result_add(result, end - start);
-        }
+        phase->dispose(result);
+        samples[i] = end - start;
+        for (int c = 0; c < COUNTER_COUNT; c++) totals[c] += values[c];
     }
-}
 
-/* Benchmark stringification */
-static void bench_stringify(const char *json, size_t len, int iterations, bench_result *result) {
-    bench_result_init(result);
+    qsort(samples, iterations, sizeof(*samples), compare_u64);
+    out->phase = phase->name;
+    out->iterations = iterations;
+    out->min_ns = samples[0];
+    out->median_ns = samples[iterations / 2];
+    out->has_counters = counted;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out->per_byte[c] = (double)totals[c] / ((double)iterations * (double)in->corpus->len);
+    }
+    free(samples);
+    return true;
+}
 
-    json_doc *doc = json_parse(json, len);
-    if (!doc) {
-        fprintf(stderr, "Error: Failed to parse JSON for stringify benchmark\n");
-        return;
+/* ============================================================================
+ * Results
+ * ============================================================================ */
+
+typedef struct result_list {
+    bench_result *items;
+    size_t count;
+    size_t cap;
+} result_list;
+
+static bool results_add(result_list *list, const bench_result *r) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        bench_result *items = realloc(list->items, cap * sizeof(*items));
+        if (!items) return false;
+        list->items = items;
+        list->cap = cap;
     }
+    list->items[list->count++] = *r;
+    return true;
+}
 
-    json_val *root = json_doc_root(doc);
+static void print_header(const bench_corpus *corpus, const char *tier) {
+    char size_str[32];
+    format_size(corpus->len, size_str, sizeof(size_str));
+    printf("\n%s (%s%s), tier %s\n", corpus->name, size_str,
+           corpus->synthetic ? ", generated" : "", tier);
+    printf("  %-10s  %12s  %12s  %12s", "Phase", "Median", "Min", "Throughput");
+    if (counters_available()) {
+        printf("  %7s  %7s  %9s  %9s", "cyc/B", "ins/B", "brmiss/kB", "cmiss/kB");
+    }
+    printf("\n");
+}
 
-    /* Warmup */
-    for (int i = 0; i < WARMUP_ITERATIONS; i++) {
-        char *s = json_stringify(root);
-        if (s) free(s);
+static void print_result(const bench_result *r) {
+    char throughput_str[32];
+    format_throughput((double)r->bytes / ((double)r->median_ns / 1e9), throughput_str,
+                      sizeof(throughput_str));
+    printf("  %-10s  %9.1f us  %9.1f us  %12s", r->phase, (double)r->median_ns / 1000.0,
+           (double)r->min_ns / 1000.0, throughput_str);
+    if (r->has_counters) {
+        printf("  %7.2f  %7.2f  %9.2f  %9.2f", r->per_byte[COUNTER_CYCLES],
+               r->per_byte[COUNTER_INSTRUCTIONS], r->per_byte[COUNTER_BRANCH_MISSES] * 1024,
+               r->per_byte[COUNTER_CACHE_MISSES] * 1024);
     }
+    printf("\n");
+}
 
-    /* Benchmark */
-    for (int i = 0; i < iterations; i++) {
-        uint64_t start = get_time_ns();
-        char *s = json_stringify(root);
-        uint64_t end = get_time_ns();
+/* The results as a JSON document, built with the library itself */
+static char *results_to_json(const result_list *list, int iterations) {
+    json_doc *doc = json_doc_new();
+    if (!doc) return NULL;
 
-        if (s) {
-            free(s);
-            bench_result_add(result, end - start);
+    json_val *root = json_new_obj(doc);
+    json_doc_set_root(doc, root);
+    json_obj_set(doc, root, "version", json_new_str(doc, json_version()));
+#if defined(__x86_64__)
+    json_obj_set(doc, root, "arch", json_new_str(doc, "x86-64"));
+#elif defined(__aarch64__)
+    json_obj_set(doc, root, "arch", json_new_str(doc, "arm64"));
+#endif
+    json_obj_set(doc, root, "cpu_features", json_new_int(doc, json_get_cpu_features()));
+    json_obj_set(doc, root, "iterations", json_new_int(doc, iterations));
+    json_val *results = json_obj_set(doc, root, "results", json_new_arr(doc));
+
+    for (size_t i = 0; i < list->count; i++) {
+        const bench_result *r = &list->items[i];
+        double seconds = (double)r->median_ns / 1e9;
+
+        json_val *obj = json_arr_push(doc, results, json_new_obj(doc));
+        json_obj_set(doc, obj, "corpus", json_new_str(doc, r->corpus));
+        json_obj_set(doc, obj, "generated", json_new_bool(doc, r->synthetic));
+        json_obj_set(doc, obj, "bytes", json_new_int(doc, (int64_t)r->bytes));
+        json_obj_set(doc, obj, "tier", json_new_str(doc, r->tier));
+        json_obj_set(doc, obj, "phase", json_new_str(doc, r->phase));
+        json_obj_set(doc, obj, "iterations", json_new_int(doc, (int64_t)r->iterations));
+        json_obj_set(doc, obj, "median_ns", json_new_int(doc, (int64_t)r->median_ns));
+        json_obj_set(doc, obj, "min_ns", json_new_int(doc, (int64_t)r->min_ns));
+        json_obj_set(doc, obj, "mb_per_s", json_new_real(doc, (double)r->bytes / seconds / 1e6));
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            char key[64];
+            snprintf(key, sizeof(key), "%s_per_byte", counter_name(c));
+            json_obj_set(doc, obj, key, r->has_counters ? json_new_real(doc, r->per_byte[c])
+                                                        : json_new_null(doc));
         }
     }
 
+    json_stringify_options opts = { .flags = JSON_STRINGIFY_PRETTY, .indent = 2 };
+    char *str = json_stringify_opts(root, &opts);
+    json_doc_free(doc);
+    return str;
+}
+
+/* Compare medians with a --format json file from an earlier run; returns the
+ * number of results slower than the tolerance allows, or -1 if the baseline
+ * cannot be read */
+static int compare_baseline(const result_list *list, const char *path, double tolerance) {
+    json_doc *doc = json_parse_file(path);
+    if (!doc) {
+        fprintf(stderr, "Error: Cannot read baseline %s: %s\n", path, json_get_error().message);
+        return -1;
+    }
+
+    int regressions = 0;
+    json_val *results = json_obj_get(json_doc_root(doc), "results");
+    for (size_t i = 0; i < list->count; i++) {
+        const bench_result *r = &list->items[i];
+        json_arr_foreach(results, base) {
+            const char *corpus = json_get_str(json_obj_get(base, "corpus"));
+            const char *tier = json_get_str(json_obj_get(base, "tier"));
+            const char *phase = json_get_str(json_obj_get(base, "phase"));
+            if (!corpus || !tier || !phase || strcmp(corpus, r->corpus) != 0 ||
+                strcmp(tier, r->tier) != 0 || strcmp(phase, r->phase) != 0) {
+                continue;
+            }
+
+            double before = (double)json_get_int(json_obj_get(base, "median_ns"));
+            double change = before > 0 ? ((double)r->median_ns / before - 1.0) * 100.0 : 0.0;
+            if (change > tolerance) {
+                fprintf(stderr, "Regression: %s %s %s: %.1f us -> %.1f us (+%.1f%%)\n",
+                        r->corpus, r->tier, r->phase, before / 1000.0,
+                        (double)r->median_ns / 1000.0, change);
+                regressions++;
+            }
+            break;
+        }
+    }
     json_doc_free(doc);
+    return regressions;
 }
 
-/* Print benchmark results */
-static void print_results(const char *name, size_t size, const bench_result *result) {
-    if (result->iterations == 0) {
-        printf("  %-15s  (no valid iterations)\n", name);
-        return;
+/* ============================================================================
+ * Driver
+ * ============================================================================ */
+
+/* Run every phase of one corpus at the current tier */
+static bool bench_corpus_run(const bench_config *cfg, const bench_corpus *corpus,
+                             const char *tier, bool text, result_list *list) {
+    bench_input in = { .corpus = corpus };
+    bench_result base = {
+        .corpus = corpus->name,
+        .synthetic = corpus->synthetic,
+        .bytes = corpus->len,
+        .tier = tier
+    };
+    if (text) print_header(corpus, tier);
+
+    json_doc *doc = NULL;
+    if (!corpus->records) {
+        doc = json_parse(corpus->json, corpus->len);
+        if (!doc) {
+            json_error_info err = json_get_error();
+            fprintf(stderr, "Error: Failed to parse %s: %s (line %zu)\n", corpus->name,
+                    err.message, err.line);
+            return false;
+        }
+        in.root = json_doc_root(doc);
     }
 
-    double avg_ns = bench_result_avg_ns(result);
-    double avg_sec = avg_ns / 1e9;
-    double throughput = (double)size / avg_sec;
+    bench_result scan = base, two_stage = base, r = base;
+    bool ok = measure(cfg, &g_phase_scan, &in, &scan);
+    if (ok && corpus->records) {
+        ok = measure(cfg, &g_phase_stream, &in, &r) && results_add(list, &scan) &&
+             results_add(list, &r);
+        if (ok && text) {
+            print_result(&scan);
+            print_result(&r);
+        }
+    } else if (ok) {
+        ok = measure(cfg, &g_phase_two_stage, &in, &two_stage);
+
+        /* Build is what the two-stage parse spends after its scan */
+        bench_result build = two_stage;
+        build.phase = "build";
+        build.median_ns = two_stage.median_ns > scan.median_ns ? two_stage.median_ns - scan.median_ns : 0;
+        build.min_ns = two_stage.min_ns > scan.min_ns ? two_stage.min_ns - scan.min_ns : 0;
+        for (int c = 0; c < COUNTER_COUNT; c++) build.per_byte[c] -= scan.per_byte[c];
+        build.has_counters = two_stage.has_counters && scan.has_counters;
+
+        ok = ok && results_add(list, &scan) && results_add(list, &build);
+        if (ok && text) {
+            print_result(&scan);
+            print_result(&build);
+        }
+        ok = ok && measure(cfg, &g_phase_parse, &in, &r) && results_add(list, &r);
+        if (ok && text) print_result(&r);
+        ok = ok && measure(cfg, &g_phase_stringify, &in, &r) && results_add(list, &r);
+        if (ok && text) print_result(&r);
+    }
 
-    char size_str[32];
-    char throughput_str[32];
-    format_size(size, size_str, sizeof(size_str));
-    format_throughput(throughput, throughput_str, sizeof(throughput_str));
+    if (!ok) fprintf(stderr, "Error: Benchmark of %s failed\n", corpus->name);
+    structural_index_free(&in.index);
+    json_doc_free(doc);
+    return ok;
+}
 
-    printf("  %-15s  %10s  %12.2f us  %12s\n",
-           name, size_str, avg_ns / 1000.0, throughput_str);
+/* Parse a comma-separated tier list ("all" for every supported tier) */
+static size_t parse_tiers(const char *list, json_simd_tier *tiers, size_t max) {
+    size_t count = 0;
+    if (strcmp(list, "all") == 0) {
+        for (int t = JSON_SIMD_SCALAR; t <= JSON_SIMD_SVE2 && count < max; t++) {
+            if (json_set_simd_tier((json_simd_tier)t)) tiers[count++] = (json_simd_tier)t;
+        }
+        json_set_simd_tier(JSON_SIMD_AUTO);
+        return count;
+    }
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (char *name = strtok(buf, ","); name && count < max; name = strtok(NULL, ",")) {
+        int t = JSON_SIMD_SCALAR;
+        while (t <= JSON_SIMD_SVE2 && strcmp(json_simd_tier_name((json_simd_tier)t), name) != 0) t++;
+        if (t > JSON_SIMD_SVE2) {
+            fprintf(stderr, "Error: Unknown tier: %s\n", name);
+            return 0;
+        }
+        tiers[count++] = (json_simd_tier)t;
+    }
+    return count;
 }
 
 /* Print usage */
@@ -192,11 +426,19 @@ static void usage(const char *prog) {
     printf("Usage: %s [options]\n", prog);
     printf("\n");
     printf("Options:\n");
-    printf("  -f, --file <path>    JSON file to benchmark\n");
-    printf("  -n, --iterations <n> Number of iterations (default: %d)\n", DEFAULT_ITERATIONS);
-    printf("  -h, --help           Show this help\n");
+    printf("  -f, --file <path>      JSON or NDJSON file to benchmark\n");
+    printf("  -a, --all              Run the standard corpora\n");
+    printf("  -d, --corpus <dir>     Directory of corpus files (default: %s)\n", DEFAULT_CORPUS_DIR);
+    printf("  -n, --iterations <n>   Iterations per phase (default: about 0.2 s worth)\n");
+    printf("  -w, --warmup <n>       Warmup runs per phase (default: %d)\n", DEFAULT_WARMUP);
+    printf("  -t, --features <list>  SIMD tiers to run, comma-separated, or \"all\"\n");
+    printf("      --format <fmt>     Output: text (default) or json\n");
+    printf("      --baseline <path>  Fail if slower than this json output\n");
+    printf("      --tolerance <pct>  Slowdown allowed by --baseline (default: %.0f)\n", DEFAULT_TOLERANCE);
+    printf("  -h, --help             Show this help\n");
     printf("\n");
-    printf("If no file is specified, uses built-in test data.\n");
+    printf("If no file is specified, uses built-in test data. Corpus files missing from\n");
+    printf("the corpus directory (see make bench-data) are replaced by generated ones.\n");
 }
 
 /* Built-in test JSON */
@@ -215,26 +457,67 @@ static const char *builtin_json =
     "  \"tags\": [\"json\", \"test\", \"benchmark\", \"performance\"]"
     "}";
 
+enum { OPT_FORMAT = 256, OPT_BASELINE, OPT_TOLERANCE };
+
 int main(int argc, char **argv) {
     const char *file_path = NULL;
-    int iterations = DEFAULT_ITERATIONS;
+    const char *corpus_dir = DEFAULT_CORPUS_DIR;
+    const char *features = NULL;
+    const char *baseline = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+    bool all = false;
+    bool text = true;
+    bench_config cfg = { .iterations = 0, .warmup = DEFAULT_WARMUP };
 
     static struct option long_options[] = {
         {"file", required_argument, 0, 'f'},
+        {"all", no_argument, 0, 'a'},
+        {"corpus", required_argument, 0, 'd'},
         {"iterations", required_argument, 0, 'n'},
+        {"warmup", required_argument, 0, 'w'},
+        {"features", required_argument, 0, 't'},
+        {"format", required_argument, 0, OPT_FORMAT},
+        {"baseline", required_argument, 0, OPT_BASELINE},
+        {"tolerance", required_argument, 0, OPT_TOLERANCE},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "f:n:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "f:ad:n:w:t:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'f':
                 file_path = optarg;
                 break;
+            case 'a':
+                all = true;
+                break;
+            case 'd':
+                corpus_dir = optarg;
+                break;
             case 'n':
-                iterations = atoi(optarg);
-                if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+                cfg.iterations = atoi(optarg);
+                if (cfg.iterations < 0) cfg.iterations = 0;
+                break;
+            case 'w':
+                cfg.warmup = atoi(optarg);
+                break;
+            case 't':
+                features = optarg;
+                break;
+            case OPT_FORMAT:
+                if (strcmp(optarg, "json") == 0) {
+                    text = false;
+                } else if (strcmp(optarg, "text") != 0) {
+                    fprintf(stderr, "Error: Unknown format: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_BASELINE:
+                baseline = optarg;
+                break;
+            case OPT_TOLERANCE:
+                tolerance = atof(optarg);
                 break;
             case 'h':
                 usage(argv[0]);
@@ -248,79 +531,91 @@ int main(int argc, char **argv) {
     /* Initialize library */
     json_init();
 
-    printf("json-asm benchmark v%s\n", json_version());
-    printf("==================================\n\n");
+    json_simd_tier tiers[JSON_SIMD_SVE2 + 1];
+    size_t tier_count = 1;
+    tiers[0] = JSON_SIMD_AUTO;
+    if (features) {
+        tier_count = parse_tiers(features, tiers, sizeof(tiers) / sizeof(tiers[0]));
+        if (tier_count == 0) return 1;
+    }
+
+    bool counters = counters_open();
 
-    /* Print CPU features */
-    uint32_t features = json_get_cpu_features();
-    printf("CPU Features: 0x%08x\n", features);
+    if (text) {
+        printf("json-asm benchmark v%s\n", json_version());
+        printf("==================================\n\n");
 
+        uint32_t cpu = json_get_cpu_features();
+        printf("CPU Features: 0x%08x\n", cpu);
 #if defined(__x86_64__)
-    printf("Architecture: x86-64\n");
-    if (features & JSON_CPU_AVX512BW) printf("  Using: AVX-512\n");
-    else if (features & JSON_CPU_AVX2) printf("  Using: AVX2\n");
-    else if (features & JSON_CPU_SSE42) printf("  Using: SSE4.2\n");
+        printf("Architecture: x86-64\n");
 #elif defined(__aarch64__)
-    printf("Architecture: ARM64\n");
-    if (features & JSON_CPU_SVE2) printf("  Using: SVE2\n");
-    else if (features & JSON_CPU_SVE) printf("  Using: SVE\n");
-    else if (features & JSON_CPU_NEON) printf("  Using: NEON\n");
+        printf("Architecture: ARM64\n");
 #endif
+        printf("Default tier: %s\n", json_simd_tier_name(json_get_simd_tier()));
+        printf("Counters: %s\n", counters ? "perf_event" : "unavailable");
+    }
 
-    printf("Iterations: %d\n\n", iterations);
-
-    /* Load JSON */
-    char *json;
-    size_t json_len;
-
+    /* Load corpora */
+    bench_corpus corpora[16];
+    size_t corpus_total = 0;
+    bool ok = true;
     if (file_path) {
-        json = load_file(file_path, &json_len);
-        if (!json) return 1;
-        printf("File: %s\n", file_path);
-    } else {
-        json_len = strlen(builtin_json);
-        json = malloc(json_len + 1);
-        memcpy(json, builtin_json, json_len + 1);
-        printf("Using built-in test data\n");
+        if (!corpus_load_file(file_path, &corpora[corpus_total])) {
+            fprintf(stderr, "Error: Cannot read file: %s\n", file_path);
+            return 1;
+        }
+        corpus_total++;
     }
-
-    char size_str[32];
-    format_size(json_len, size_str, sizeof(size_str));
-    printf("Size: %s\n\n", size_str);
-
-    /* Verify parsing works */
-    json_doc *doc = json_parse(json, json_len);
-    if (!doc) {
-        json_error_info err = json_get_error();
-        fprintf(stderr, "Error: Failed to parse JSON: %s\n", err.message);
-        free(json);
-        return 1;
+    if (all) {
+        for (size_t i = 0; i < corpus_count() && ok; i++) {
+            ok = corpus_load(i, corpus_dir, &corpora[corpus_total]);
+            if (ok) corpus_total++;
+        }
+    }
+    if (!file_path && !all) {
+        bench_corpus *c = &corpora[corpus_total++];
+        *c = (bench_corpus){ .name = "builtin", .len = strlen(builtin_json) };
+        c->json = malloc(c->len + 1);
+        if (c->json) memcpy(c->json, builtin_json, c->len + 1);
+        ok = c->json != NULL;
     }
 
-    size_t value_count = json_doc_count(doc);
-    printf("Values: %zu\n", value_count);
-
-    size_t mem = json_doc_memory(doc);
-    format_size(mem, size_str, sizeof(size_str));
-    printf("Memory: %s (%.1f bytes/value)\n\n", size_str, (double)mem / value_count);
-
-    json_doc_free(doc);
-
-    /* Run benchmarks */
-    printf("Results:\n");
-    printf("  %-15s  %10s  %12s  %12s\n", "Operation", "Size", "Time", "Throughput");
-    printf("  %-15s  %10s  %12s  %12s\n", "---------", "----", "----", "----------");
-
-    bench_result parse_result;
-    bench_parse(json, json_len, iterations, &parse_result);
-    print_results("Parse", json_len, &parse_result);
-
-    bench_result stringify_result;
-    bench_stringify(json, json_len, iterations, &stringify_result);
-    print_results("Stringify", json_len, &stringify_result);
+    result_list results = {0};
+    for (size_t t = 0; t < tier_count && ok; t++) {
+        if (!json_set_simd_tier(tiers[t])) {
+            fprintf(stderr, "Skipping tier %s: not supported here\n", json_simd_tier_name(tiers[t]));
+            continue;
+        }
+        const char *tier = json_simd_tier_name(json_get_simd_tier());
+        for (size_t i = 0; i < corpus_total && ok; i++) {
+            ok = bench_corpus_run(&cfg, &corpora[i], tier, text, &results);
+        }
+    }
+    json_set_simd_tier(JSON_SIMD_AUTO);
+
+    if (ok && !text) {
+        char *str = results_to_json(&results, cfg.iterations);
+        if (str) {
+            printf("%s\n", str);
+            free(str);
+        } else {
+            ok = false;
+        }
+    } else if (ok) {
+        printf("\n");
+    }
 
-    printf("\n");
+    int status = ok ? 0 : 1;
+    if (ok && baseline) {
+        int regressions = compare_baseline(&results, baseline, tolerance);
+        if (regressions != 0) status = 2;
+        if (regressions > 0) fprintf(stderr, "%d result(s) more than %.1f%% slower than %s\n",
+                                     regressions, tolerance, baseline);
+    }
 
-    free(json);
-    return 0;
+    free(results.items);
+    for (size_t i = 0; i < corpus_total; i++) corpus_free(&corpora[i]);
+    counters_close();
+    return status;
 }
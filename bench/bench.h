@@ -0,0 +1,61 @@
+/*
+ * json-asm: Benchmark tool, shared declarations
+ */
+
+#ifndef JSON_ASM_BENCH_H
+#define JSON_ASM_BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ============================================================================
+ * Corpora (corpus.c)
+ * ============================================================================ */
+
+/* A benchmark input. Records are whitespace-separated values (NDJSON),
+ * streamed with json_stream_next() instead of parsed as one document. */
+typedef struct bench_corpus {
+    const char *name;
+    char *json;
+    size_t len;
+    bool records;
+    bool synthetic;             /* Generated, not read from a file */
+} bench_corpus;
+
+/* Number of standard corpora */
+size_t corpus_count(void);
+
+/* Load standard corpus i from dir, or generate a stand-in of the same shape
+ * when dir has no copy of it. False only when out of memory. */
+bool corpus_load(size_t i, const char *dir, bench_corpus *out);
+
+/* Load an arbitrary file; .ndjson and .jsonl files are records */
+bool corpus_load_file(const char *path, bench_corpus *out);
+
+void corpus_free(bench_corpus *corpus);
+
+/* ============================================================================
+ * Hardware Counters (counters.c)
+ * ============================================================================ */
+
+enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_COUNT
+};
+
+/* perf_event counters for this thread, in user space only. Open fails when
+ * the kernel or its perf_event_paranoid setting does not allow them, and on
+ * systems other than Linux. */
+bool counters_open(void);
+void counters_close(void);
+bool counters_available(void);
+void counters_start(void);
+/* Counts since counters_start(); false if they could not be read */
+bool counters_stop(uint64_t values[COUNTER_COUNT]);
+const char *counter_name(int counter);
+
+#endif /* JSON_ASM_BENCH_H */
@@ -0,0 +1,278 @@
+/*
+ * json-asm: Benchmark tool, corpora
+ *
+ * The standard corpora are the files most JSON parsers are compared on
+ * (`make bench-data` downloads them into data/corpus/) and a large NDJSON
+ * log. When a file is missing, a generated stand-in of about the same size
+ * and shape is used instead: text and UTF-8 heavy tweets, integer heavy
+ * ticketing records, long arrays of floats. The generators are seeded, so
+ * stand-ins are identical from run to run and comparable across builds.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================================
+ * Generator Helpers
+ * ============================================================================ */
+
+typedef struct gen {
+    char *buf;
+    size_t len;
+    size_t cap;
+    bool failed;
+    uint64_t rng;
+} gen;
+
+static void gen_printf(gen *g, const char *fmt, ...) {
+    if (g->failed) return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(g->buf + g->len, g->cap - g->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            g->failed = true;
+            return;
+        }
+        if ((size_t)n < g->cap - g->len) {
+            g->len += (size_t)n;
+            return;
+        }
+        size_t cap = g->cap * 2 + (size_t)n;
+        char *buf = realloc(g->buf, cap);
+        if (!buf) {
+            g->failed = true;
+            return;
+        }
+        g->buf = buf;
+        g->cap = cap;
+    }
+}
+
+/* xorshift64*: fixed seed, same output everywhere */
+static uint64_t gen_rand(gen *g) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static unsigned gen_below(gen *g, unsigned n) {
+    return (unsigned)(gen_rand(g) % n);
+}
+
+static const char *gen_pick(gen *g, const char *const *words, size_t n) {
+    return words[gen_rand(g) % n];
+}
+
+/* Mixed ASCII and multi-byte text with the occasional escape */
+static const char *const g_words[] = {
+    "the", "json", "parser", "benchmark", "fast", "data", "stream", "value",
+    "\xe3\x81\x82\xe3\x82\x8a\xe3\x81\x8c\xe3\x81\xa8\xe3\x81\x86",
+    "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", "caf\xc3\xa9", "na\xc3\xafve",
+    "\\\"quoted\\\"", "line\\nbreak", "\\u3042\\u3044", "#hashtag", "@user",
+    "http:\\/\\/t.co\\/abc123", "\xf0\x9f\x98\x80", "semper", "fidelis"
+};
+
+#define WORD_COUNT (sizeof(g_words) / sizeof(g_words[0]))
+
+static void gen_text(gen *g, unsigned words) {
+    for (unsigned i = 0; i < words; i++) {
+        gen_printf(g, "%s%s", i ? " " : "", gen_pick(g, g_words, WORD_COUNT));
+    }
+}
+
+/* ============================================================================
+ * Stand-ins
+ * ============================================================================ */
+
+static void gen_twitter(gen *g, size_t target) {
+    gen_printf(g, "{\n  \"statuses\": [");
+    for (unsigned n = 0; g->len < target && !g->failed; n++) {
+        uint64_t id = 505874924095815681ULL + gen_rand(g) % 1000000;
+        gen_printf(g, "%s\n    {\n      \"metadata\": {\"result_type\": \"recent\", \"iso_language_code\": \"ja\"},\n",
+                   n ? "," : "");
+        gen_printf(g, "      \"created_at\": \"Sun Aug 31 00:%02u:%02u +0000 2014\",\n",
+                   gen_below(g, 60), gen_below(g, 60));
+        gen_printf(g, "      \"id\": %llu,\n      \"id_str\": \"%llu\",\n      \"text\": \"",
+                   (unsigned long long)id, (unsigned long long)id);
+        gen_text(g, 8 + gen_below(g, 16));
+        gen_printf(g, "\",\n      \"source\": \"<a href=\\\"http://twitter.com/download/iphone\\\" rel=\\\"nofollow\\\">Twitter for iPhone</a>\",\n");
+        gen_printf(g, "      \"truncated\": false,\n      \"in_reply_to_status_id\": null,\n");
+        gen_printf(g, "      \"user\": {\n        \"id\": %u,\n        \"name\": \"", gen_below(g, 2000000000));
+        gen_text(g, 2);
+        gen_printf(g, "\",\n        \"screen_name\": \"user_%u\",\n        \"description\": \"", gen_below(g, 100000));
+        gen_text(g, 4 + gen_below(g, 12));
+        gen_printf(g, "\",\n        \"followers_count\": %u,\n        \"friends_count\": %u,\n",
+                   gen_below(g, 100000), gen_below(g, 5000));
+        gen_printf(g, "        \"verified\": %s,\n        \"profile_image_url\": \"http://pbs.twimg.com/profile_images/%u/normal.jpeg\"\n      },\n",
+                   gen_below(g, 10) ? "false" : "true", gen_below(g, 1000000000));
+        gen_printf(g, "      \"entities\": {\"hashtags\": [], \"urls\": [{\"url\": \"http://t.co/%x\", \"indices\": [%u, %u]}], \"user_mentions\": []},\n",
+                   gen_below(g, 0xFFFFFF), gen_below(g, 40), 40 + gen_below(g, 40));
+        gen_printf(g, "      \"retweet_count\": %u,\n      \"favorite_count\": %u,\n      \"favorited\": false,\n      \"lang\": \"ja\"\n    }",
+                   gen_below(g, 1000), gen_below(g, 1000));
+    }
+    gen_printf(g, "\n  ],\n  \"search_metadata\": {\"completed_in\": 0.087, \"count\": 100, \"query\": \"%%E4%%B8%%80\"}\n}\n");
+}
+
+static void gen_citm(gen *g, size_t target) {
+    gen_printf(g, "{\n    \"areaNames\": {");
+    for (unsigned i = 0; i < 64; i++) {
+        gen_printf(g, "%s\n        \"%u\": \"", i ? "," : "", 205705993 + i * 6);
+        gen_text(g, 2);
+        gen_printf(g, "\"");
+    }
+    gen_printf(g, "\n    },\n    \"events\": {");
+    for (unsigned i = 0; g->len < target / 3 && !g->failed; i++) {
+        unsigned id = 138586341 + i * 4;
+        gen_printf(g, "%s\n        \"%u\": {\n            \"description\": null,\n            \"id\": %u,\n",
+                   i ? "," : "", id, id);
+        gen_printf(g, "            \"logo\": \"/images/UE0AAAAACEKo6QAAAAZDSVRN\",\n            \"name\": \"");
+        gen_text(g, 3);
+        gen_printf(g, "\",\n            \"subTopicIds\": [337184269, 337184283],\n            \"subjectCode\": null,\n");
+        gen_printf(g, "            \"subtitle\": null,\n            \"topicIds\": [324846099, %u]\n        }",
+                   107888604 + gen_below(g, 1000));
+    }
+    gen_printf(g, "\n    },\n    \"performances\": [");
+    for (unsigned i = 0; g->len < target && !g->failed; i++) {
+        gen_printf(g, "%s\n        {\n            \"eventId\": %u,\n            \"id\": %u,\n            \"logo\": null,\n            \"name\": null,\n            \"prices\": [",
+                   i ? "," : "", 138586341 + gen_below(g, 1000) * 4, 339887544 + i);
+        unsigned prices = 1 + gen_below(g, 4);
+        for (unsigned p = 0; p < prices; p++) {
+            gen_printf(g, "%s\n                {\"amount\": %u, \"audienceSubCategoryId\": 337100890, \"seatCategoryId\": %u}",
+                       p ? "," : "", 9000 + gen_below(g, 200) * 250, 338937295 + p);
+        }
+        gen_printf(g, "\n            ],\n            \"seatCategories\": [{\"areas\": [{\"areaId\": %u, \"blockIds\": []}], \"seatCategoryId\": 338937295}],\n",
+                   205705993 + gen_below(g, 64) * 6);
+        gen_printf(g, "            \"seatMapImage\": null,\n            \"start\": %llu,\n            \"venueCode\": \"PLEYEL_PLEYEL\"\n        }",
+                   1372701600000ULL + (unsigned long long)gen_below(g, 100000) * 60000);
+    }
+    gen_printf(g, "\n    ]\n}\n");
+}
+
+static void gen_canada(gen *g, size_t target) {
+    gen_printf(g, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+                  "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    double x = -65.613616999999977, y = 43.420273000000009;
+    for (unsigned ring = 0; g->len < target && !g->failed; ring++) {
+        gen_printf(g, "%s[", ring ? "," : "");
+        for (unsigned i = 0; i < 512; i++) {
+            x += (double)((int)gen_below(g, 2001) - 1000) * 1e-6;
+            y += (double)((int)gen_below(g, 2001) - 1000) * 1e-6;
+            gen_printf(g, "%s[%.15f,%.15f]", i ? "," : "", x, y);
+        }
+        gen_printf(g, "]");
+    }
+    gen_printf(g, "]}}]}\n");
+}
+
+static void gen_ndjson(gen *g, size_t target) {
+    static const char *const levels[] = { "debug", "info", "info", "info", "warn", "error" };
+    for (unsigned n = 0; g->len < target && !g->failed; n++) {
+        gen_printf(g, "{\"id\":%u,\"ts\":\"2024-03-%02uT%02u:%02u:%02u.%03uZ\",\"level\":\"%s\",\"msg\":\"",
+                   n, 1 + gen_below(g, 28), gen_below(g, 24), gen_below(g, 60), gen_below(g, 60),
+                   gen_below(g, 1000), gen_pick(g, levels, 6));
+        gen_text(g, 3 + gen_below(g, 8));
+        gen_printf(g, "\",\"tags\":[\"svc-%u\",\"zone-%c\"],\"latency_ms\":%.3f,\"ok\":%s,\"user\":{\"id\":%u,\"plan\":%s}}\n",
+                   gen_below(g, 32), 'a' + gen_below(g, 4), (double)gen_below(g, 100000) / 1000.0,
+                   gen_below(g, 20) ? "true" : "false", gen_below(g, 1000000),
+                   gen_below(g, 3) ? "\"free\"" : "null");
+    }
+}
+
+/* ============================================================================
+ * Corpus Table
+ * ============================================================================ */
+
+static const struct {
+    const char *name;
+    const char *file;
+    size_t size;                /* Stand-in size, close to the real file's */
+    bool records;
+    void (*generate)(gen *g, size_t target);
+} g_corpora[] = {
+    { "twitter",      "twitter.json",      631 * 1024,      false, gen_twitter },
+    { "citm_catalog", "citm_catalog.json", 1727 * 1024,     false, gen_citm },
+    { "canada",       "canada.json",       2251 * 1024,     false, gen_canada },
+    { "ndjson",       "large.ndjson",      8 * 1024 * 1024, true,  gen_ndjson },
+};
+
+#define CORPUS_COUNT (sizeof(g_corpora) / sizeof(g_corpora[0]))
+
+size_t corpus_count(void) {
+    return CORPUS_COUNT;
+}
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    char *buf = NULL;
+    long len = -1;
+    if (fseek(f, 0, SEEK_END) == 0) len = ftell(f);
+    if (len > 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = malloc((size_t)len + 1)) != NULL) {
+        if (fread(buf, 1, (size_t)len, f) == (size_t)len) {
+            buf[len] = '\0';
+            *size = (size_t)len;
+        } else {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+bool corpus_load(size_t i, const char *dir, bench_corpus *out) {
+    *out = (bench_corpus){
+        .name = g_corpora[i].name,
+        .records = g_corpora[i].records
+    };
+
+    if (dir) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, g_corpora[i].file);
+        out->json = read_file(path, &out->len);
+        if (out->json) return true;
+    }
+
+    gen g = { .cap = g_corpora[i].size + 4096, .rng = 0x9E3779B97F4A7C15ULL + i };
+    g.buf = malloc(g.cap);
+    if (!g.buf) return false;
+    g_corpora[i].generate(&g, g_corpora[i].size);
+    if (g.failed) {
+        free(g.buf);
+        return false;
+    }
+    out->json = g.buf;
+    out->len = g.len;
+    out->synthetic = true;
+    return true;
+}
+
+bool corpus_load_file(const char *path, bench_corpus *out) {
+    const char *base = strrchr(path, '/');
+    *out = (bench_corpus){
+        .name = base ? base + 1 : path,
+        .records = has_suffix(path, ".ndjson") || has_suffix(path, ".jsonl")
+    };
+    out->json = read_file(path, &out->len);
+    return out->json != NULL;
+}
+
+void corpus_free(bench_corpus *corpus) {
+    free(corpus->json);
+    corpus->json = NULL;
+}
@@ -0,0 +1,117 @@
+/*
+ * json-asm: Benchmark tool, hardware counters
+ *
+ * One perf_event group led by the cycle counter, so all counters cover
+ * exactly the same instructions. Counters the CPU lacks (cache misses in
+ * some VMs) are left out of the group and read as zero.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "bench.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int g_fds[COUNTER_COUNT] = { -1, -1, -1, -1 };
+static uint64_t g_ids[COUNTER_COUNT];
+
+static const uint64_t g_configs[COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES
+};
+
+static int counter_open_one(uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+bool counters_open(void) {
+    if (g_fds[COUNTER_CYCLES] >= 0) return true;
+
+    g_fds[COUNTER_CYCLES] = counter_open_one(g_configs[COUNTER_CYCLES], -1);
+    if (g_fds[COUNTER_CYCLES] < 0) return false;
+    for (int i = 1; i < COUNTER_COUNT; i++) {
+        g_fds[i] = counter_open_one(g_configs[i], g_fds[COUNTER_CYCLES]);
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (g_fds[i] >= 0) ioctl(g_fds[i], PERF_EVENT_IOC_ID, &g_ids[i]);
+    }
+    return true;
+}
+
+void counters_close(void) {
+    for (int i = COUNTER_COUNT; i-- > 0;) {
+        if (g_fds[i] >= 0) close(g_fds[i]);
+        g_fds[i] = -1;
+    }
+}
+
+bool counters_available(void) {
+    return g_fds[COUNTER_CYCLES] >= 0;
+}
+
+void counters_start(void) {
+    if (!counters_available()) return;
+    ioctl(g_fds[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_fds[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+bool counters_stop(uint64_t values[COUNTER_COUNT]) {
+    memset(values, 0, COUNTER_COUNT * sizeof(values[0]));
+    if (!counters_available()) return false;
+    ioctl(g_fds[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    /* { nr, { value, id } * nr } */
+    uint64_t buf[1 + 2 * COUNTER_COUNT];
+    ssize_t n = read(g_fds[COUNTER_CYCLES], buf, sizeof(buf));
+    if (n < (ssize_t)sizeof(uint64_t)) return false;
+
+    for (uint64_t k = 0; k < buf[0] && k < COUNTER_COUNT; k++) {
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            if (g_fds[i] >= 0 && g_ids[i] == buf[2 + 2 * k]) values[i] = buf[1 + 2 * k];
+        }
+    }
+    return true;
+}
+
+#else
+
+bool counters_open(void) { return false; }
+void counters_close(void) {}
+bool counters_available(void) { return false; }
+void counters_start(void) {}
+
+bool counters_stop(uint64_t values[COUNTER_COUNT]) {
+    memset(values, 0, COUNTER_COUNT * sizeof(values[0]));
+    return false;
+}
+
+#endif
+
+const char *counter_name(int counter) {
+    switch (counter) {
+        case COUNTER_CYCLES:        return "cycles";
+        case COUNTER_INSTRUCTIONS:  return "instructions";
+        case COUNTER_BRANCH_MISSES: return "branch_misses";
+        case COUNTER_CACHE_MISSES:  return "cache_misses";
+        default:                    return "unknown";
+    }
+}
@@ -53,26 +53,63 @@ typedef enum json_type {
 /* Opaque types */
 typedef struct json_doc json_doc;
 typedef struct json_val json_val;
+typedef struct json_parser json_parser;
+typedef struct json_stream json_stream;
+typedef struct json_path json_path;
+typedef struct json_schema json_schema;
+typedef struct json_stats json_stats;
 
 /* Parse options */
 typedef struct json_parse_options {
     uint32_t flags;             /* Parse flags (see JSON_PARSE_*) */
     size_t max_depth;           /* Maximum nesting depth (0 = unlimited) */
     void *user_data;            /* User data for callbacks */
+    uint32_t threads;           /* Parse threads for large inputs (0/1 = serial) */
+    size_t parallel_min_size;   /* Inputs below this stay serial (0 = 1 MB) */
+    json_stats *stats;          /* Filled in by each parse (stats builds only) */
 } json_parse_options;
 
+/* Batch worker pool (see json_batch_configure) */
+typedef struct json_batch_options {
+    uint32_t threads;           /* Parse threads, caller included (0 = online CPUs) */
+    const int *cpus;            /* Pin worker i to cpus[i % cpu_count] (NULL = unpinned) */
+    size_t cpu_count;           /* Entries in cpus */
+} json_batch_options;
+
 /* Parse flags */
 #define JSON_PARSE_DEFAULT          0x00
 #define JSON_PARSE_ALLOW_COMMENTS   0x01  /* Allow // and slash-star comments */
 #define JSON_PARSE_ALLOW_TRAILING   0x02  /* Allow trailing commas */
 #define JSON_PARSE_ALLOW_INF_NAN    0x04  /* Allow Infinity and NaN */
 #define JSON_PARSE_INSITU           0x08  /* In-situ parsing (modifies input) */
+#define JSON_PARSE_TWO_STAGE        0x10  /* Build a structural index first, then the DOM */
+#define JSON_PARSE_BORROW           0x20  /* Reference unescaped strings in the input */
+#define JSON_PARSE_HUGE_PAGES       0x40  /* Ask for huge pages when mapping files */
+#define JSON_PARSE_KEY_INDEX        0x80  /* Hash wide objects' keys during the parse */
+#define JSON_PARSE_INTERN          0x100  /* Store each repeated string once */
+#define JSON_PARSE_VALIDATE_UTF8   0x200  /* Reject strings that are not valid UTF-8 */
+
+/* Zero-copy strings: with JSON_PARSE_INSITU the input must be writable;
+ * strings are decoded in place and NUL-terminated over their closing quote.
+ * With JSON_PARSE_BORROW the input is left untouched and strings without
+ * escapes point into it, so they are not NUL-terminated (use
+ * json_get_str_len). In both modes the input must outlive the document. */
+
+/* Interning: with JSON_PARSE_INTERN, strings of 8 to 64 bytes that the
+ * parser copies (keys and values alike) are deduplicated, so a key repeated
+ * in every record is stored once. Strings left in the input by
+ * JSON_PARSE_INSITU or JSON_PARSE_BORROW are not affected. */
+
+/* UTF-8: by default string bytes are taken as they are. JSON_PARSE_VALIDATE_UTF8
+ * fails the parse with JSON_ERROR_UTF8 at the first malformed, overlong,
+ * surrogate or out-of-range sequence, checking each string as it is scanned. */
 
 /* Stringify options */
 typedef struct json_stringify_options {
     uint32_t flags;             /* Stringify flags (see JSON_STRINGIFY_*) */
     uint32_t indent;            /* Spaces per indent level (0 = minified) */
     const char *newline;        /* Newline string (NULL = "\n") */
+    json_stats *stats;          /* Filled in by each call (stats builds only) */
 } json_stringify_options;
 
 /* Stringify flags */
@@ -91,7 +128,8 @@ typedef enum json_error {
     JSON_ERROR_STRING,          /* Invalid string (bad escape, etc.) */
     JSON_ERROR_UTF8,            /* Invalid UTF-8 encoding */
     JSON_ERROR_IO,              /* File I/O error */
-    JSON_ERROR_TYPE             /* Type mismatch */
+    JSON_ERROR_TYPE,            /* Type mismatch */
+    JSON_ERROR_INCOMPLETE       /* Input ends inside a value (streaming) */
 } json_error;
 
 /* Error info */
@@ -123,6 +161,20 @@ typedef enum json_cpu_feature {
     JSON_CPU_SHA3       = 1 << 20
 } json_cpu_feature;
 
+/* SIMD implementation tiers (see json_set_simd_tier) */
+typedef enum json_simd_tier {
+    JSON_SIMD_AUTO      = 0,    /* Best tier supported by CPU and build */
+    JSON_SIMD_SCALAR    = 1,
+    /* x86-64 */
+    JSON_SIMD_SSE42     = 2,
+    JSON_SIMD_AVX2      = 3,
+    JSON_SIMD_AVX512    = 4,
+    /* ARM64 */
+    JSON_SIMD_NEON      = 5,
+    JSON_SIMD_SVE       = 6,
+    JSON_SIMD_SVE2      = 7
+} json_simd_tier;
+
 /* ============================================================================
  * Library Initialization
  * ============================================================================ */
@@ -136,6 +188,51 @@ JSON_API uint32_t json_get_cpu_features(void);
 /* Get version string */
 JSON_API const char *json_version(void);
 
+/* Force a SIMD tier for all subsequent operations (JSON_SIMD_AUTO restores
+ * the default selection). Returns false if the tier is not supported by the
+ * CPU or was not compiled in. Not thread-safe: call before parsing.
+ * The JSON_ASM_SIMD environment variable ("scalar", "sse42", "avx2",
+ * "avx512", "neon", "sve", "sve2") applies the same override at init. */
+JSON_API bool json_set_simd_tier(json_simd_tier tier);
+
+/* Get the SIMD tier currently in use */
+JSON_API json_simd_tier json_get_simd_tier(void);
+
+/* Get human-readable tier name */
+JSON_API const char *json_simd_tier_name(json_simd_tier tier);
+
+/* ============================================================================
+ * Statistics
+ * ============================================================================ */
+
+/* Counters kept by builds with STATS=1 (JSON_ASM_STATS); other builds keep
+ * none and pay nothing. Per call, through the stats field of the parse or
+ * stringify options, the struct describes that call alone. From
+ * json_get_stats() it holds totals since start or json_reset_stats(). */
+struct json_stats {
+    uint64_t parses;            /* Documents parsed */
+    uint64_t bytes_scanned;     /* Input bytes of those documents */
+    uint64_t values[JSON_OBJECT + 1]; /* Values by json_type, keys excluded */
+    uint64_t keys;              /* Object keys */
+    uint64_t max_depth;         /* Deepest container nesting (root = 1) */
+    uint64_t arena_grows;       /* Node blocks allocated */
+    uint64_t strings_grows;     /* String blocks allocated */
+    uint64_t bytes_copied;      /* String bytes copied into documents */
+    uint64_t scan_ns;           /* Structural scans of two-stage parses */
+    uint64_t parse_ns;          /* Whole parses, scans included */
+    uint64_t stringifies;       /* Serializations */
+    uint64_t bytes_written;     /* Their output bytes */
+    uint64_t stringify_ns;
+    json_simd_tier tier;        /* Tier in use */
+};
+
+/* Copy the process-wide counters. Returns false, with the counters zeroed,
+ * when the library was built without statistics. */
+JSON_API bool json_get_stats(json_stats *out);
+
+/* Zero the process-wide counters */
+JSON_API void json_reset_stats(void);
+
 /* ============================================================================
  * Parsing
  * ============================================================================ */
@@ -147,7 +244,9 @@ JSON_API json_doc *json_parse(const char *json, size_t len);
 JSON_API json_doc *json_parse_opts(const char *json, size_t len,
                                     const json_parse_options *opts);
 
-/* Parse JSON file */
+/* Parse JSON file. The file is memory-mapped; with JSON_PARSE_BORROW or
+ * JSON_PARSE_INSITU the document keeps the mapping until json_doc_free(),
+ * and INSITU writes go to a private copy-on-write mapping, not the file. */
 JSON_API json_doc *json_parse_file(const char *path);
 
 /* Parse JSON file with options */
@@ -157,6 +256,106 @@ JSON_API json_doc *json_parse_file_opts(const char *path,
 /* Get last parse error (call after json_parse returns NULL) */
 JSON_API json_error_info json_get_error(void);
 
+/* ============================================================================
+ * Validation and Minification (no document is built)
+ * ============================================================================ */
+
+/* Check that json is what json_parse_opts() would accept with the same
+ * options (opts may be NULL), UTF-8 included with JSON_PARSE_VALIDATE_UTF8.
+ * Nothing is allocated below 65536 levels of nesting. On failure the error
+ * is also stored in err when it is not NULL. Comments are rejected; strip
+ * them with json_minify(). */
+JSON_API bool json_validate(const char *json, size_t len,
+                            const json_parse_options *opts, json_error_info *err);
+
+/* Copy json to out without the whitespace between tokens, and without
+ * comments if flags has JSON_PARSE_ALLOW_COMMENTS. out needs room for len
+ * bytes and may be json itself. Returns the length written (no NUL is
+ * added). The input is not validated. */
+JSON_API size_t json_minify(const char *json, size_t len, char *out, uint32_t flags);
+
+/* ============================================================================
+ * Reusable Parser
+ * ============================================================================ */
+
+/* Create a parser that keeps its document memory between parses
+ * (opts may be NULL) */
+JSON_API json_parser *json_parser_new(const json_parse_options *opts);
+
+/* Parse into the parser's document. The document is owned by the parser
+ * and stays valid until the next parse or json_parser_free();
+ * json_doc_free() on it does nothing. */
+JSON_API json_doc *json_parser_parse(json_parser *parser, const char *json, size_t len);
+
+/* Free parser and its document */
+JSON_API void json_parser_free(json_parser *parser);
+
+/* ============================================================================
+ * Batch Parsing
+ * ============================================================================ */
+
+/* Parse n separate documents on a pool of worker threads. out_docs[i] gets
+ * the document for inputs[i], or NULL if it failed; out_errors[i] (when
+ * out_errors is not NULL) gets its error, or code JSON_OK. json_get_error()
+ * is not used. Returns the number of failed items. Batches from several
+ * threads run one at a time. */
+JSON_API size_t json_parse_batch(const char *const *inputs, const size_t *lens, size_t n,
+                                 const json_parse_options *opts, json_doc **out_docs,
+                                 json_error_info *out_errors);
+
+/* Size and CPU affinity of the batch pool (NULL = defaults). The running
+ * pool is stopped; the next batch starts one with the new settings. */
+JSON_API void json_batch_configure(const json_batch_options *opts);
+
+/* Stop the batch pool's threads (restarted by the next batch) */
+JSON_API void json_batch_shutdown(void);
+
+/* ============================================================================
+ * Push Parsing (chunked input)
+ * ============================================================================ */
+
+/* Feed the next piece of a document. Chunks may split the input at any byte
+ * and need not outlive the call. Returns JSON_ERROR_INCOMPLETE while more
+ * input is needed, JSON_OK once the root value is complete (a number at the
+ * root is only complete at json_feed_end()), or the error that stopped the
+ * parse. Error positions count from the start of the first chunk; line and
+ * column are not tracked. */
+JSON_API json_error json_feed(json_parser *parser, const char *chunk, size_t len);
+
+/* End the input and return the document, owned by the parser as with
+ * json_parser_parse(), or NULL. The next json_feed() starts a new document. */
+JSON_API json_doc *json_feed_end(json_parser *parser);
+
+/* ============================================================================
+ * Streaming (NDJSON / concatenated JSON)
+ * ============================================================================ */
+
+/* Iterate over the JSON values in a buffer holding many records, separated
+ * by whitespace (e.g. one per line) or simply concatenated. The buffer is
+ * not copied and must outlive the stream. opts may be NULL. */
+JSON_API json_stream *json_stream_new(const char *json, size_t len,
+                                      const json_parse_options *opts);
+
+/* Stream the records of a file (memory-mapped) */
+JSON_API json_stream *json_stream_open(const char *path,
+                                       const json_parse_options *opts);
+
+/* Parse the next record. The document is owned by the stream and stays
+ * valid until the next call or json_stream_free().
+ * Returns NULL with json_get_error().code set to:
+ *   JSON_OK                - no records left
+ *   JSON_ERROR_INCOMPLETE  - the last record is truncated; it starts at
+ *                            json_stream_position(), resume from there once
+ *                            more bytes are available
+ *   anything else          - the record is invalid and was skipped */
+JSON_API json_doc *json_stream_next(json_stream *stream);
+
+/* Byte offset of the next unconsumed record */
+JSON_API size_t json_stream_position(json_stream *stream);
+
+/* Free stream, its document and any file mapping */
+JSON_API void json_stream_free(json_stream *stream);
+
 /* ============================================================================
  * Document Operations
  * ============================================================================ */
@@ -164,15 +363,40 @@ JSON_API json_error_info json_get_error(void);
 /* Get document root value */
 JSON_API json_val *json_doc_root(json_doc *doc);
 
-/* Free document and all values */
+/* Free document and all values. Small documents are kept in a per-thread
+ * pool and reused by the next json_parse() on the same thread. */
 JSON_API void json_doc_free(json_doc *doc);
 
-/* Get document memory usage in bytes */
+/* Drop all values but keep the document's memory for reuse */
+JSON_API void json_doc_reset(json_doc *doc);
+
+/* Release the calling thread's pool of cached documents (also done
+ * automatically when a thread exits) */
+JSON_API void json_pool_clear(void);
+
+/* Get document memory usage in bytes, lookup tables included */
 JSON_API size_t json_doc_memory(json_doc *doc);
 
-/* Get number of values in document */
+/* Get number of values in document (after mutation this walks the tree,
+ * and gives 0 if it runs out of memory doing so) */
 JSON_API size_t json_doc_count(json_doc *doc);
 
+/* ============================================================================
+ * Binary Tape (saved documents)
+ * ============================================================================ */
+
+/* Save val and everything below it as a binary tape: a file that
+ * json_tape_open() maps back without parsing. Tapes hold raw value nodes,
+ * so they are only readable by the same library version on the same
+ * architecture, and must be trusted input. */
+JSON_API bool json_tape_save(json_val *val, const char *path);
+
+/* Map a tape as a read-only document. The values are used in place in the
+ * mapping, so opening costs about as much as mapping the file; the
+ * accessors, iteration and serialization work as on a parsed document,
+ * and the mutators fail with JSON_ERROR_TYPE. */
+JSON_API json_doc *json_tape_open(const char *path);
+
 /* ============================================================================
  * Value Type Inspection
  * ============================================================================ */
@@ -236,6 +460,7 @@ JSON_API json_val *json_obj_first(json_val *obj);
 JSON_API json_val *json_obj_next(json_val *val);
 JSON_API const char *json_obj_key(json_val *val);
 JSON_API size_t json_obj_key_len(json_val *val);
+JSON_API json_val *json_obj_val(json_val *key);
 
 /* ============================================================================
  * Array Operations
@@ -251,6 +476,189 @@ JSON_API size_t json_arr_size(json_val *arr);
 JSON_API json_val *json_arr_first(json_val *arr);
 JSON_API json_val *json_arr_next(json_val *val);
 
+/* ============================================================================
+ * On-Demand Cursor
+ * ============================================================================ */
+
+/* A position in unparsed input, read only as far as it is accessed: no
+ * document is built, values are checked when a getter reads them, and
+ * values stepped over are only bracket-matched, not validated. A plain
+ * value (copy it freely); the input must outlive it. Fields are private. */
+typedef struct json_cursor {
+    const char *json;
+    size_t len;
+    size_t pos;             /* Current value */
+    size_t key;             /* Its key (first byte inside the quotes) */
+    size_t key_len;         /* Raw length of that key */
+    char container;         /* '[' or '{' for elements and members, else 0 */
+} json_cursor;
+
+/* Point cur at the root value. Trailing content is not checked. */
+JSON_API bool json_cursor_init(json_cursor *cur, const char *json, size_t len);
+
+/* Type of the current value, from its first byte (numbers are read to tell
+ * JSON_INT from JSON_FLOAT); JSON_NULL if it is not a valid value */
+JSON_API json_type json_cursor_type(const json_cursor *cur);
+
+/* Find a member of the current object, stepping over the ones before it.
+ * Returns false if it is absent (json_get_error().code is JSON_OK) or the
+ * input is malformed (the error is set). */
+JSON_API bool json_cursor_find_field(const json_cursor *obj, const char *key,
+                                     json_cursor *out);
+JSON_API bool json_cursor_find_fieldn(const json_cursor *obj, const char *key,
+                                      size_t key_len, json_cursor *out);
+
+/* First element or member of the current array or object, then the next
+ * one after cur. Both return false at the end, with json_get_error().code
+ * JSON_OK, or on malformed input. */
+JSON_API bool json_cursor_child(const json_cursor *container, json_cursor *out);
+JSON_API bool json_cursor_next(json_cursor *cur);
+
+/* Typed getters: false with JSON_ERROR_TYPE if the value has another type,
+ * or with the parse error if it is malformed. Numbers convert as they do
+ * through json_get_int() and friends. */
+JSON_API bool json_cursor_get_bool(const json_cursor *cur, bool *out);
+JSON_API bool json_cursor_get_int(const json_cursor *cur, int64_t *out);
+JSON_API bool json_cursor_get_uint(const json_cursor *cur, uint64_t *out);
+JSON_API bool json_cursor_get_num(const json_cursor *cur, double *out);
+JSON_API bool json_cursor_is_null(const json_cursor *cur);
+
+/* Decode the string value, or the key of an object member, into buf,
+ * NUL-terminated. Returns its length; when that is >= buf_len nothing was
+ * written (buf holds "") and buf_len must be at least length + 1. Returns
+ * 0 with the error set if there is no valid string. */
+JSON_API size_t json_cursor_get_str(const json_cursor *cur, char *buf, size_t buf_len);
+JSON_API size_t json_cursor_get_key(const json_cursor *cur, char *buf, size_t buf_len);
+
+/* The current value's text in the input, unvalidated (json_parse() it to
+ * get a document of the subtree); NULL if it is malformed */
+JSON_API const char *json_cursor_raw(const json_cursor *cur, size_t *len);
+
+/* ============================================================================
+ * JSON Pointer Queries
+ * ============================================================================ */
+
+/* Compile a JSON Pointer (RFC 6901) such as "/user/id" once for repeated
+ * queries; "" is the value itself. A segment of just "*" matches every
+ * element of an array or member value of an object. Returns NULL with
+ * JSON_ERROR_SYNTAX for a malformed pointer. */
+JSON_API json_path *json_path_compile(const char *pointer);
+JSON_API json_path *json_path_compilen(const char *pointer, size_t len);
+JSON_API void json_path_free(json_path *path);
+
+/* First value under root the path matches, or NULL */
+JSON_API json_val *json_path_get(const json_path *path, json_val *root);
+
+/* Values under root the path matches, in document order: the first max go
+ * to out, and the number of matches is returned */
+JSON_API size_t json_path_eval(const json_path *path, json_val *root,
+                               json_val **out, size_t max);
+
+/* Projection parse: run the path over raw input with an on-demand cursor
+ * and parse only the values it matches, into a document whose root is an
+ * array of them in input order. The rest of the input is only stepped over,
+ * so it is not validated. */
+JSON_API json_doc *json_path_parse(const json_path *path, const char *json, size_t len);
+
+/* ============================================================================
+ * Schema Decoding and Encoding
+ * ============================================================================ */
+
+/* C type of a schema field */
+typedef enum json_field_type {
+    JSON_FIELD_BOOL,        /* bool */
+    JSON_FIELD_INT32,       /* int32_t */
+    JSON_FIELD_INT64,       /* int64_t */
+    JSON_FIELD_DOUBLE,      /* double; integers are converted */
+    JSON_FIELD_STRING,      /* char[size], NUL-terminated */
+    JSON_FIELD_OBJECT       /* Struct laid out by schema */
+} json_field_type;
+
+/* One member of a message: its key, and the type and offsetof() of the
+ * struct field it goes to */
+typedef struct json_field {
+    const char *key;
+    json_field_type type;
+    size_t offset;
+    size_t size;                /* JSON_FIELD_STRING: bytes in the field */
+    const json_schema *schema;  /* JSON_FIELD_OBJECT: its compiled schema */
+} json_field;
+
+/* Compile the fields of one struct for json_decode() and json_encode().
+ * Keys are at most 255 bytes and must be distinct. Returns NULL with
+ * JSON_ERROR_SYNTAX for an invalid field list. A nested schema must
+ * outlive the ones that use it. */
+JSON_API json_schema *json_schema_compile(const json_field *fields, size_t count);
+JSON_API void json_schema_free(json_schema *schema);
+
+/* Decode a JSON object straight into the struct at out, without building
+ * a document. Members are stored as they are met; members the schema does
+ * not list are validated and skipped, and missing or null ones leave their
+ * field untouched. A value of the wrong type, an integer out of range or a
+ * string that does not fit its field fails with JSON_ERROR_TYPE or
+ * JSON_ERROR_STRING; out may then be partly written. */
+JSON_API bool json_decode(const json_schema *schema, const char *json, size_t len, void *out);
+
+/* Encode the struct at in as an object with every schema field, in schema
+ * order. A string field ends at its first NUL (or fills the field), NaN and
+ * infinities become null. json_encode() returns a string to free();
+ * json_encode_buf() works as json_stringify_buf(). */
+JSON_API char *json_encode(const json_schema *schema, const void *in);
+JSON_API size_t json_encode_buf(const json_schema *schema, const void *in,
+                                char *buf, size_t buf_len);
+
+/* ============================================================================
+ * Building and Mutation
+ * ============================================================================ */
+
+/* Create an empty document to build into; its root is NULL until set */
+JSON_API json_doc *json_doc_new(void);
+
+/* Make a value of doc its root */
+JSON_API void json_doc_set_root(json_doc *doc, json_val *root);
+
+/* New values allocated from doc (strings are copied). They live as long as
+ * the document; add them to a container or make one the root. */
+JSON_API json_val *json_new_null(json_doc *doc);
+JSON_API json_val *json_new_bool(json_doc *doc, bool b);
+JSON_API json_val *json_new_int(json_doc *doc, int64_t i);
+JSON_API json_val *json_new_real(json_doc *doc, double d);
+JSON_API json_val *json_new_str(json_doc *doc, const char *str);
+JSON_API json_val *json_new_strn(json_doc *doc, const char *str, size_t len);
+JSON_API json_val *json_new_arr(json_doc *doc);
+JSON_API json_val *json_new_obj(json_doc *doc);
+
+/* Overwrite a value of doc in place; it keeps its position in its parent.
+ * Not for object keys. */
+JSON_API bool json_val_set_null(json_doc *doc, json_val *val);
+JSON_API bool json_val_set_bool(json_doc *doc, json_val *val, bool b);
+JSON_API bool json_val_set_int(json_doc *doc, json_val *val, int64_t i);
+JSON_API bool json_val_set_real(json_doc *doc, json_val *val, double d);
+JSON_API bool json_val_set_str(json_doc *doc, json_val *val, const char *str);
+JSON_API bool json_val_set_strn(json_doc *doc, json_val *val, const char *str, size_t len);
+
+/* Containers store a copy of the value node passed in, which must belong to
+ * doc; a container value brings its members along, shared rather than
+ * copied. Use the returned value, not the one passed in, for further
+ * changes. */
+
+/* Set a member, replacing the value of an existing key in place or
+ * appending a new member. Returns the stored value. */
+JSON_API json_val *json_obj_set(json_doc *doc, json_val *obj, const char *key, json_val *val);
+JSON_API json_val *json_obj_setn(json_doc *doc, json_val *obj, const char *key,
+                                 size_t key_len, json_val *val);
+
+/* Remove the first member with key; false if there is none */
+JSON_API bool json_obj_remove(json_doc *doc, json_val *obj, const char *key);
+JSON_API bool json_obj_removen(json_doc *doc, json_val *obj, const char *key, size_t key_len);
+
+/* Append, insert before index (index == size appends), or remove an
+ * element. Elements are contiguous, so these move the array's elements:
+ * pointers to elements of arr are invalidated. */
+JSON_API json_val *json_arr_push(json_doc *doc, json_val *arr, json_val *val);
+JSON_API json_val *json_arr_insert(json_doc *doc, json_val *arr, size_t index, json_val *val);
+JSON_API bool json_arr_remove(json_doc *doc, json_val *arr, size_t index);
+
 /* ============================================================================
  * Serialization
  * ============================================================================ */
@@ -261,10 +669,31 @@ JSON_API char *json_stringify(json_val *val);
 /* Stringify with options */
 JSON_API char *json_stringify_opts(json_val *val, const json_stringify_options *opts);
 
-/* Stringify to buffer (returns bytes written, or required size if too small) */
-JSON_API size_t json_stringify_buf(json_val *val, char *buf, size_t buf_len);
+/* Exact output length in bytes, excluding the NUL terminator */
+JSON_API size_t json_stringify_size(json_val *val, const json_stringify_options *opts);
 
-/* Stringify document root */
+/* Stringify straight into buf, NUL-terminated. Returns the output length;
+ * when that is >= buf_len nothing usable was written (buf holds "") and a
+ * buffer of length + 1 bytes is needed. */
+JSON_API size_t json_stringify_buf(json_val *val, char *buf, size_t buf_len);
+JSON_API size_t json_stringify_buf_opts(json_val *val, const json_stringify_options *opts,
+                                        char *buf, size_t buf_len);
+
+/* Streaming output: receives the output in order, in chunks that are only
+ * valid during the call. Return false to stop. */
+typedef bool (*json_write_fn)(void *user_data, const char *data, size_t len);
+
+/* Stringify through a fixed 64 KB buffer that is handed to write (or written
+ * to fd with writev) each time it fills, instead of building the whole
+ * output in memory. Long strings go out straight from the document without
+ * being copied. Returns false on a write error or when write returns false;
+ * output already written stays written. */
+JSON_API bool json_stringify_write(json_val *val, const json_stringify_options *opts,
+                                   json_write_fn write, void *user_data);
+JSON_API bool json_stringify_fd(json_val *val, const json_stringify_options *opts, int fd);
+
+/* Stringify document root. The document remembers the output length, so
+ * serialising it again allocates once. */
 JSON_API char *json_doc_stringify(json_doc *doc);
 
 /* ============================================================================
@@ -283,10 +712,15 @@ JSON_API char *json_doc_stringify(json_doc *doc);
  * Utility Functions
  * ============================================================================ */
 
-/* Compare two JSON values for equality */
+/* Compare two JSON values for equality; object member order is ignored */
 JSON_API bool json_equals(json_val *a, json_val *b);
 
-/* Deep copy a value into a new document */
+/* Hash of a value's contents: values that json_equals() finds equal hash
+ * equal (0 if walking a deeply nested value runs out of memory). Not stable
+ * across library versions. */
+JSON_API uint64_t json_hash(json_val *val);
+
+/* Deep copy a value into a new document that shares nothing with the source */
 JSON_API json_doc *json_clone(json_val *val);
 
 /* Get human-readable type name */
@@ -1,11 +1,25 @@
 /*
  * json-asm: Arena allocator for cache-efficient value storage
+ *
+ * Nodes and long strings live in chains of blocks. A block never moves once
+ * allocated, so child/next/str_ptr links stay valid as the document grows;
+ * a full block is simply retired and a larger one is pushed in front of it.
  */
 
+#define _DEFAULT_SOURCE
 #include "internal.h"
 
+#if defined(JSON_COMPACT_NODES) && !defined(_WIN32)
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #define ARENA_INITIAL_SIZE  (64 * 1024)     /* 64 KB initial arena */
 #define ARENA_GROWTH_FACTOR 2
+#define ARENA_MAX_BLOCK     (64 * 1024 * 1024) /* Stop doubling past 64 MB */
 #define STRING_INITIAL_SIZE (16 * 1024)     /* 16 KB initial string storage */
 #define ARENA_ALIGNMENT     64              /* Cache line alignment */
 
@@ -14,6 +28,11 @@ static inline size_t align_up(size_t size, size_t align) {
     return (size + align - 1) & ~(align - 1);
 }
 
+/* Node block header, padded so node data starts on a cache line */
+#define NODE_BLOCK_HEADER   align_up(sizeof(struct arena_block), ARENA_ALIGNMENT)
+#define STRING_BLOCK_HEADER sizeof(struct arena_block)
+
+#if !defined(JSON_COMPACT_NODES) || defined(_WIN32)
 /* Aligned memory allocation */
 static void *aligned_alloc_impl(size_t alignment, size_t size) {
 #if defined(_WIN32)
@@ -36,34 +55,125 @@ static void aligned_free_impl(void *ptr) {
     free(ptr);
 #endif
 }
+#endif
+
+/* Node blocks. Compact next offsets reach 2^31 nodes either way, so all
+ * blocks of a document must lie within that span. Heap blocks would not:
+ * small ones come from the heap and large ones from mappings far above
+ * it. So compact blocks are all mapped, and the kernel puts mappings next
+ * to each other. */
+#ifdef JSON_COMPACT_NODES
+#define NODE_REACH  ((uintptr_t)INT32_MAX * sizeof(struct json_val))
+
+static bool node_block_reachable(const struct json_doc *doc, uintptr_t lo, uintptr_t hi) {
+    if (!doc->arena) return true;
+    uintptr_t span_lo = lo < doc->nodes_lo ? lo : doc->nodes_lo;
+    uintptr_t span_hi = hi > doc->nodes_hi ? hi : doc->nodes_hi;
+    return span_hi - span_lo <= NODE_REACH;
+}
+
+static void node_block_track(struct json_doc *doc, uintptr_t lo, uintptr_t hi) {
+    if (!doc->arena || lo < doc->nodes_lo) doc->nodes_lo = lo;
+    if (!doc->arena || hi > doc->nodes_hi) doc->nodes_hi = hi;
+}
+#endif
+
+#if defined(JSON_COMPACT_NODES) && !defined(_WIN32)
+static struct arena_block *node_block_alloc(size_t bytes) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void node_block_free(struct arena_block *block) {
+    munmap(block, NODE_BLOCK_HEADER + block->size);
+}
+#else
+static struct arena_block *node_block_alloc(size_t bytes) {
+    return aligned_alloc_impl(ARENA_ALIGNMENT, bytes);
+}
+
+static void node_block_free(struct arena_block *block) {
+    aligned_free_impl(block);
+}
+#endif
+
+/* Size of the block that follows one of last_size bytes */
+static size_t next_block_size(size_t last_size, size_t needed) {
+    size_t size = last_size * ARENA_GROWTH_FACTOR;
+    if (size > ARENA_MAX_BLOCK) size = ARENA_MAX_BLOCK;
+    if (size < needed) size = needed;
+    return size;
+}
+
+/* Push a new node block of at least size bytes */
+static bool node_block_push(struct json_doc *doc, size_t size) {
+    size = align_up(size, ARENA_ALIGNMENT);
+
+    struct arena_block *block = node_block_alloc(NODE_BLOCK_HEADER + size);
+    if (!block) return false;
+
+#ifdef JSON_COMPACT_NODES
+    uintptr_t lo = (uintptr_t)block, hi = lo + NODE_BLOCK_HEADER + size;
+    if (!node_block_reachable(doc, lo, hi)) {
+        block->size = size;
+        node_block_free(block);
+        return false;
+    }
+    node_block_track(doc, lo, hi);
+#endif
+
+    /* Retire the current block */
+    if (doc->arena) {
+        doc->arena->used = (size_t)(doc->arena_ptr - arena_block_data(doc->arena, NODE_BLOCK_HEADER));
+    }
+
+    block->prev = doc->arena;
+    block->size = size;
+    block->used = 0;
+
+    doc->arena = block;
+    doc->arena_ptr = arena_block_data(block, NODE_BLOCK_HEADER);
+    doc->arena_end = doc->arena_ptr + size;
+    doc->arena_size += size;
+    STATS(doc->stats.arena_grows++);
+    return true;
+}
+
+/* Push a new string block of at least size bytes */
+static bool string_block_push(struct json_doc *doc, size_t size) {
+    struct arena_block *block = malloc(STRING_BLOCK_HEADER + size);
+    if (!block) return false;
+
+    if (doc->strings) {
+        doc->strings->used = (size_t)(doc->strings_ptr - arena_block_data(doc->strings, STRING_BLOCK_HEADER));
+    }
+
+    block->prev = doc->strings;
+    block->size = size;
+    block->used = 0;
+
+    doc->strings = block;
+    doc->strings_ptr = arena_block_data(block, STRING_BLOCK_HEADER);
+    doc->strings_end = doc->strings_ptr + size;
+    doc->strings_size += size;
+    STATS(doc->stats.strings_grows++);
+    return true;
+}
 
 struct json_doc *arena_create(size_t initial_size) {
     if (initial_size == 0) {
         initial_size = ARENA_INITIAL_SIZE;
     }
-    initial_size = align_up(initial_size, ARENA_ALIGNMENT);
 
     struct json_doc *doc = calloc(1, sizeof(struct json_doc));
     if (!doc) return NULL;
 
-    doc->arena = aligned_alloc_impl(ARENA_ALIGNMENT, initial_size);
-    if (!doc->arena) {
-        free(doc);
-        return NULL;
-    }
-
-    doc->arena_size = initial_size;
-    doc->arena_used = 0;
-
-    doc->strings = malloc(STRING_INITIAL_SIZE);
-    if (!doc->strings) {
-        aligned_free_impl(doc->arena);
-        free(doc);
+    if (!node_block_push(doc, initial_size) ||
+        !string_block_push(doc, STRING_INITIAL_SIZE)) {
+        arena_destroy(doc);
         return NULL;
     }
 
-    doc->strings_size = STRING_INITIAL_SIZE;
-    doc->strings_used = 0;
     doc->root = NULL;
     doc->value_count = 0;
     doc->cpu_features = g_cpu_features;
@@ -71,61 +181,146 @@ struct json_doc *arena_create(size_t initial_size) {
     return doc;
 }
 
+static void node_chain_free(struct arena_block *block) {
+    while (block) {
+        struct arena_block *prev = block->prev;
+        node_block_free(block);
+        block = prev;
+    }
+}
+
+static void string_chain_free(struct arena_block *block) {
+    while (block) {
+        struct arena_block *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
 void arena_destroy(struct json_doc *doc) {
     if (!doc) return;
 
-    if (doc->arena) {
-        aligned_free_impl(doc->arena);
-    }
-    if (doc->strings) {
-        free(doc->strings);
-    }
+    input_release(&doc->input);
+    key_index_release(doc);
+    array_runs_release(doc);
+    intern_release(doc);
+    node_chain_free(doc->arena);
+    string_chain_free(doc->strings);
     free(doc);
 }
 
-static bool arena_grow(struct json_doc *doc, size_t needed) {
-    size_t new_size = doc->arena_size * ARENA_GROWTH_FACTOR;
-    while (new_size < doc->arena_used + needed) {
-        new_size *= ARENA_GROWTH_FACTOR;
-    }
-    new_size = align_up(new_size, ARENA_ALIGNMENT);
+void arena_reset(struct json_doc *doc) {
+    /* A chain of several blocks is folded into one block of the combined
+     * size, so the next document of similar size needs no allocation. If
+     * that allocation fails the newest (largest) block is kept instead.
+     * Key indexes live in the blocks, so their tables go first. */
+    key_index_release(doc);
+    array_runs_release(doc);
+    intern_release(doc);
 
-    uint8_t *new_arena = aligned_alloc_impl(ARENA_ALIGNMENT, new_size);
-    if (!new_arena) return false;
+    struct arena_block *head = doc->arena;
+    size_t total = doc->arena_size;
+    node_chain_free(head->prev);
+    head->prev = NULL;
+    doc->arena_size = head->size;
+    if (total > head->size) {
+        doc->arena = NULL;
+        doc->arena_size = 0;
+        if (node_block_push(doc, total)) {
+            node_block_free(head);
+        } else {
+            doc->arena = head;
+            doc->arena_size = head->size;
+        }
+    }
+#ifdef JSON_COMPACT_NODES
+    doc->nodes_lo = (uintptr_t)doc->arena;
+    doc->nodes_hi = doc->nodes_lo + NODE_BLOCK_HEADER + doc->arena->size;
+#endif
+    doc->arena->used = 0;
+    doc->arena_ptr = arena_block_data(doc->arena, NODE_BLOCK_HEADER);
+    doc->arena_end = doc->arena_ptr + doc->arena->size;
 
-    memcpy(new_arena, doc->arena, doc->arena_used);
-    aligned_free_impl(doc->arena);
+    head = doc->strings;
+    total = doc->strings_size;
+    string_chain_free(head->prev);
+    head->prev = NULL;
+    doc->strings_size = head->size;
+    if (total > head->size) {
+        doc->strings = NULL;
+        doc->strings_size = 0;
+        if (string_block_push(doc, total)) {
+            free(head);
+        } else {
+            doc->strings = head;
+            doc->strings_size = head->size;
+        }
+    }
+    doc->strings->used = 0;
+    doc->strings_ptr = arena_block_data(doc->strings, STRING_BLOCK_HEADER);
+    doc->strings_end = doc->strings_ptr + doc->strings->size;
 
-    doc->arena = new_arena;
-    doc->arena_size = new_size;
-    return true;
+    input_release(&doc->input);
+    doc->root = NULL;
+    doc->value_count = 0;
+    doc->stringify_len = 0;
+    doc->mutated = false;
+    doc->readonly = false;
 }
 
-static bool strings_grow(struct json_doc *doc, size_t needed) {
-    size_t new_size = doc->strings_size * ARENA_GROWTH_FACTOR;
-    while (new_size < doc->strings_used + needed) {
-        new_size *= ARENA_GROWTH_FACTOR;
-    }
+/* Move the blocks of other behind the current blocks of doc and free
+ * other (parallel parse). Blocks never move, so values and strings in them
+ * stay valid, and doc keeps allocating from its own current blocks. Fails,
+ * changing nothing, if compact links could not cross between the two. */
+bool arena_adopt(struct json_doc *doc, struct json_doc *other) {
+#ifdef JSON_COMPACT_NODES
+    if (!node_block_reachable(doc, other->nodes_lo, other->nodes_hi)) return false;
+    node_block_track(doc, other->nodes_lo, other->nodes_hi);
+#endif
+    other->arena->used = (size_t)(other->arena_ptr - arena_block_data(other->arena, NODE_BLOCK_HEADER));
+    other->strings->used = (size_t)(other->strings_ptr - arena_block_data(other->strings, STRING_BLOCK_HEADER));
 
-    uint8_t *new_strings = realloc(doc->strings, new_size);
-    if (!new_strings) return false;
+    struct arena_block *oldest = other->arena;
+    while (oldest->prev) oldest = oldest->prev;
+    oldest->prev = doc->arena->prev;
+    doc->arena->prev = other->arena;
 
-    doc->strings = new_strings;
-    doc->strings_size = new_size;
+    oldest = other->strings;
+    while (oldest->prev) oldest = oldest->prev;
+    oldest->prev = doc->strings->prev;
+    doc->strings->prev = other->strings;
+
+    doc->arena_size += other->arena_size;
+    doc->strings_size += other->strings_size;
+    doc->value_count += other->value_count;
+#ifdef JSON_ASM_STATS
+    doc->stats.arena_grows += other->stats.arena_grows;
+    doc->stats.strings_grows += other->stats.strings_grows;
+    doc->stats.bytes_copied += other->stats.bytes_copied;
+#endif
+
+    if (other->key_indexes) {
+        struct key_index *last = other->key_indexes;
+        while (last->next) last = last->next;
+        last->next = doc->key_indexes;
+        doc->key_indexes = other->key_indexes;
+    }
+
+    intern_release(other);
+    input_release(&other->input);
+    free(other);
     return true;
 }
 
-struct json_val *arena_alloc_val(struct json_doc *doc) {
+struct json_val *arena_alloc_val_slow(struct json_doc *doc) {
     size_t needed = sizeof(struct json_val);
 
-    if (doc->arena_used + needed > doc->arena_size) {
-        if (!arena_grow(doc, needed)) {
-            return NULL;
-        }
+    if (!node_block_push(doc, next_block_size(doc->arena->size, needed))) {
+        return NULL;
     }
 
-    struct json_val *val = (struct json_val *)(doc->arena + doc->arena_used);
-    doc->arena_used += needed;
+    struct json_val *val = (struct json_val *)doc->arena_ptr;
+    doc->arena_ptr += needed;
     doc->value_count++;
 
     /* Zero-initialize */
@@ -133,17 +328,48 @@ struct json_val *arena_alloc_val(struct json_doc *doc) {
     return val;
 }
 
-char *arena_alloc_string(struct json_doc *doc, size_t len) {
+/* Allocate count adjacent, uninitialised value nodes (array elements) */
+struct json_val *arena_alloc_vals(struct json_doc *doc, size_t count) {
+    size_t needed = count * sizeof(struct json_val);
+    if ((size_t)(doc->arena_end - doc->arena_ptr) < needed &&
+        !node_block_push(doc, next_block_size(doc->arena->size, needed))) {
+        return NULL;
+    }
+
+    struct json_val *vals = (struct json_val *)doc->arena_ptr;
+    doc->arena_ptr += needed;
+    doc->value_count += count;
+    return vals;
+}
+
+/* Allocate size bytes of node storage that is not a value (indexes).
+ * Rounded to whole nodes when nodes are linked by distance. */
+void *arena_alloc_raw(struct json_doc *doc, size_t size) {
+#ifdef JSON_COMPACT_NODES
+    size = align_up(size, sizeof(struct json_val));
+#else
+    size = align_up(size, sizeof(void *));
+#endif
+    if ((size_t)(doc->arena_end - doc->arena_ptr) < size &&
+        !node_block_push(doc, next_block_size(doc->arena->size, size))) {
+        return NULL;
+    }
+
+    void *ptr = doc->arena_ptr;
+    doc->arena_ptr += size;
+    return ptr;
+}
+
+char *arena_alloc_string_slow(struct json_doc *doc, size_t len) {
     /* Include null terminator */
     size_t needed = len + 1;
 
-    if (doc->strings_used + needed > doc->strings_size) {
-        if (!strings_grow(doc, needed)) {
-            return NULL;
-        }
+    if (!string_block_push(doc, next_block_size(doc->strings->size, needed))) {
+        return NULL;
     }
 
-    char *str = (char *)(doc->strings + doc->strings_used);
-    doc->strings_used += needed;
+    char *str = (char *)doc->strings_ptr;
+    doc->strings_ptr += needed;
+    STATS(doc->stats.bytes_copied += len);
     return str;
 }
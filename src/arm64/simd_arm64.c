@@ -74,12 +74,59 @@ size_t scan_string_neon(const char *str, size_t len) {
     return len;
 }
 
+size_t skip_whitespace_neon(const char *str, size_t len) {
+    if (len == 0) return 0;
+
+    const uint8x16_t space_vec = vdupq_n_u8(' ');
+    const uint8x16_t tab_vec = vdupq_n_u8('\t');
+    const uint8x16_t lf_vec = vdupq_n_u8('\n');
+    const uint8x16_t cr_vec = vdupq_n_u8('\r');
+
+    size_t pos = 0;
+
+    while (pos + 16 <= len) {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(str + pos));
+
+        /* Mark whitespace bytes, then invert */
+        uint8x16_t ws = vceqq_u8(chunk, space_vec);
+        ws = vorrq_u8(ws, vceqq_u8(chunk, tab_vec));
+        ws = vorrq_u8(ws, vceqq_u8(chunk, lf_vec));
+        ws = vorrq_u8(ws, vceqq_u8(chunk, cr_vec));
+        uint8x16_t non_ws = vmvnq_u8(ws);
+
+        uint64x2_t match64 = vreinterpretq_u64_u8(non_ws);
+        uint64_t low = vgetq_lane_u64(match64, 0);
+        uint64_t high = vgetq_lane_u64(match64, 1);
+
+        /* Each matching byte is 0xFF, so the trailing zero count / 8 is the index */
+        if (low) return pos + ((size_t)__builtin_ctzll(low) >> 3);
+        if (high) return pos + 8 + ((size_t)__builtin_ctzll(high) >> 3);
+
+        pos += 16;
+    }
+
+    /* Handle remaining bytes */
+    while (pos < len) {
+        unsigned char c = (unsigned char)str[pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return pos;
+        }
+        pos++;
+    }
+
+    return len;
+}
+
 size_t find_structural_neon(const char *str, size_t len, uint64_t *mask) {
     if (len == 0) {
         *mask = 0;
         return 0;
     }
 
+    static const uint8_t bit_weights[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+
     const uint8x16_t lbrace = vdupq_n_u8('{');
     const uint8x16_t rbrace = vdupq_n_u8('}');
     const uint8x16_t lbrack = vdupq_n_u8('[');
@@ -90,8 +137,15 @@ size_t find_structural_neon(const char *str, size_t len, uint64_t *mask) {
 
     size_t count = len < 16 ? len : 16;
 
-    /* Load 16 bytes (may read past end, but we mask result) */
-    uint8x16_t chunk = vld1q_u8((const uint8_t *)str);
+    /* Never load past the end of the input */
+    uint8_t tail[16];
+    const uint8_t *src = (const uint8_t *)str;
+    if (count < 16) {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, str, count);
+        src = tail;
+    }
+    uint8x16_t chunk = vld1q_u8(src);
 
     /* Compare against each structural char */
     uint8x16_t m = vceqq_u8(chunk, lbrace);
@@ -102,26 +156,17 @@ size_t find_structural_neon(const char *str, size_t len, uint64_t *mask) {
     m = vorrq_u8(m, vceqq_u8(chunk, comma));
     m = vorrq_u8(m, vceqq_u8(chunk, quote));
 
-    /* Extract as bitmask */
-    /* Narrow the 8-bit match results to single bits */
-    uint16x8_t m16 = vreinterpretq_u16_u8(m);
-    m16 = vshrq_n_u16(m16, 7);  /* Shift high bit to bit 0 */
-
-    /* Pack to bytes and extract */
-    uint8x8_t m8 = vmovn_u16(m16);
-    uint64_t result = vget_lane_u64(vreinterpret_u64_u8(m8), 0);
-
-    /* Convert from packed bits to individual byte positions */
-    uint64_t final_mask = 0;
-    for (size_t i = 0; i < count; i++) {
-        unsigned char c = str[i];
-        if (c == '{' || c == '}' || c == '[' || c == ']' ||
-            c == ':' || c == ',' || c == '"') {
-            final_mask |= (1ULL << i);
-        }
+    /* Keep one weighted bit per byte, then sum each half into a byte */
+    uint8x16_t bits = vandq_u8(m, vld1q_u8(bit_weights));
+    uint64_t low = vaddv_u8(vget_low_u8(bits));
+    uint64_t high = vaddv_u8(vget_high_u8(bits));
+
+    uint64_t result = low | (high << 8);
+    if (count < 16) {
+        result &= (1ULL << count) - 1;
     }
 
-    *mask = final_mask;
+    *mask = result;
     return count;
 }
 
@@ -164,6 +209,61 @@ int64_t parse_int_neon(const char *str, size_t len, size_t *consumed) {
     return negative ? -result : result;
 }
 
+/* UTF-8 lookup tables, as in src/x86-64/validate_utf8.asm: each bit is an
+ * error case allowed by the nibble of the byte before (high, low) or of the
+ * byte itself (high) */
+static const uint8_t utf8_byte1_high[16] = {
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x80, 0x80, 0x80, 0x80, 0x21, 0x01, 0x15, 0x49
+};
+static const uint8_t utf8_byte1_low[16] = {
+    0xE7, 0xA3, 0x83, 0x83, 0x8B, 0xCB, 0xCB, 0xCB,
+    0xCB, 0xCB, 0xCB, 0xCB, 0xCB, 0xDB, 0xCB, 0xCB
+};
+static const uint8_t utf8_byte2_high[16] = {
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0xE6, 0xAE, 0xBA, 0xBA, 0x01, 0x01, 0x01, 0x01
+};
+
+/* Errors of block in following block prev, nonzero if any */
+static inline uint8x16_t utf8_block_errors(uint8x16_t in, uint8x16_t prev) {
+    uint8x16_t prev1 = vextq_u8(prev, in, 15);
+    uint8x16_t prev2 = vextq_u8(prev, in, 14);
+    uint8x16_t prev3 = vextq_u8(prev, in, 13);
+
+    uint8x16_t special = vqtbl1q_u8(vld1q_u8(utf8_byte1_high), vshrq_n_u8(prev1, 4));
+    special = vandq_u8(special, vqtbl1q_u8(vld1q_u8(utf8_byte1_low),
+                                           vandq_u8(prev1, vdupq_n_u8(0x0F))));
+    special = vandq_u8(special, vqtbl1q_u8(vld1q_u8(utf8_byte2_high), vshrq_n_u8(in, 4)));
+
+    /* Continuations owed to a 3- or 4-byte lead cancel "two continuations" */
+    uint8x16_t must23 = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)),
+                                 vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80)));
+    return veorq_u8(special, vandq_u8(must23, vdupq_n_u8(0x80)));
+}
+
+size_t validate_utf8_neon(const char *str, size_t len) {
+    const uint8_t *s = (const uint8_t *)str;
+    uint8x16_t prev = vdupq_n_u8(0);
+    bool prev_ascii = true;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t in = vld1q_u8(s + i);
+        bool ascii = vmaxvq_u8(in) < 0x80;
+        if ((!ascii || !prev_ascii) && vmaxvq_u8(utf8_block_errors(in, prev))) return i;
+        prev = in;
+        prev_ascii = ascii;
+    }
+
+    /* The rest, zero-padded; the padding also ends a sequence left open */
+    if (i == len && prev_ascii) return len;
+    uint8_t tail[16] = {0};
+    memcpy(tail, s + i, len - i);
+    if (vmaxvq_u8(utf8_block_errors(vld1q_u8(tail), prev))) return i < len ? i : len - 1;
+    return len;
+}
+
 /* ============================================================================
  * SVE Implementation (scalable vector length)
  * ============================================================================ */
@@ -204,6 +304,31 @@ size_t scan_string_sve(const char *str, size_t len) {
     return len;
 }
 
+size_t skip_whitespace_sve(const char *str, size_t len) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        svbool_t pg = svwhilelt_b8(pos, len);
+
+        svuint8_t chunk = svld1_u8(pg, (const uint8_t *)(str + pos));
+
+        /* Mark non-whitespace bytes */
+        svbool_t non_ws = svcmpne_n_u8(pg, chunk, ' ');
+        non_ws = svand_b_z(pg, non_ws, svcmpne_n_u8(pg, chunk, '\t'));
+        non_ws = svand_b_z(pg, non_ws, svcmpne_n_u8(pg, chunk, '\n'));
+        non_ws = svand_b_z(pg, non_ws, svcmpne_n_u8(pg, chunk, '\r'));
+
+        if (svptest_any(pg, non_ws)) {
+            svbool_t first = svbrkb_b_z(pg, non_ws);
+            return pos + svcntp_b8(pg, first);
+        }
+
+        pos += svcntb();
+    }
+
+    return len;
+}
+
 size_t find_structural_sve(const char *str, size_t len, uint64_t *mask) {
     if (len == 0) {
         *mask = 0;
@@ -263,6 +388,10 @@ size_t scan_string_sve(const char *str, size_t len) {
     return scan_string_neon(str, len);
 }
 
+size_t skip_whitespace_sve(const char *str, size_t len) {
+    return skip_whitespace_neon(str, len);
+}
+
 size_t find_structural_sve(const char *str, size_t len, uint64_t *mask) {
     return find_structural_neon(str, len, mask);
 }
@@ -285,6 +414,11 @@ size_t scan_string_sve2(const char *str, size_t len) {
     return scan_string_sve(str, len);
 }
 
+size_t skip_whitespace_sve2(const char *str, size_t len) {
+    /* SVE2 implementation - same as SVE */
+    return skip_whitespace_sve(str, len);
+}
+
 size_t find_structural_sve2(const char *str, size_t len, uint64_t *mask) {
     /* SVE2 implementation - same as SVE */
     return find_structural_sve(str, len, mask);
@@ -300,6 +434,10 @@ size_t scan_string_sve2(const char *str, size_t len) {
     return scan_string_neon(str, len);
 }
 
+size_t skip_whitespace_sve2(const char *str, size_t len) {
+    return skip_whitespace_neon(str, len);
+}
+
 size_t find_structural_sve2(const char *str, size_t len, uint64_t *mask) {
     return find_structural_neon(str, len, mask);
 }
@@ -0,0 +1,363 @@
+/*
+ * json-asm: Batch parsing of many small documents
+ *
+ * json_parse_batch() spreads a batch over a pool of worker threads that is
+ * started on first use and kept for later batches. The items are cut into
+ * one contiguous range per thread; a thread takes items from the front of
+ * its own range and, once that is empty, from the front of the others, so
+ * a few slow items do not hold the batch up. The calling thread works on
+ * the batch too. Each item gets its own document, and its error is copied
+ * out of the worker's thread-local into the caller's array.
+ *
+ * A worker's documents are freed on the caller's thread, so they would end
+ * up in that thread's pool. They go back to the worker's home cache
+ * instead (pool.c), and later batches parse into them again: once the
+ * caches are warm a worker allocates only for items larger than before.
+ *
+ * The parallel parse of large documents (parallel.c) runs its phases on
+ * the same workers through batch_run_tasks().
+ *
+ * Workers can be pinned to CPUs. A pinned worker's documents are allocated
+ * and first written on that CPU, so on NUMA systems their pages come from
+ * the local node, and they stay with that worker when reused.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include "internal.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#endif
+
+#define BATCH_MAX_THREADS   64      /* Including the caller */
+#define BATCH_MAX_CPUS      256     /* Affinity list entries kept */
+
+/* Parse one item into a new document, or NULL with the error set. A
+ * worker passes its home, which the document returns to when freed. */
+static struct json_doc *batch_parse_item(const char *json, size_t len,
+                                         const json_parse_options *opts,
+                                         struct structural_index *index,
+                                         struct doc_home *home) {
+    if (!json || len == 0) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return NULL;
+    }
+    struct json_doc *doc = home ? doc_home_get(home) : doc_pool_get();
+    if (!doc) {
+        doc = arena_create(parse_arena_estimate(len));
+        if (!doc) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+            return NULL;
+        }
+        doc->home = home;
+    }
+    if (!parse_json_into(doc, json, len, opts, index)) {
+        doc_release(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+/* Items [next, end) not yet taken; own cache line, as several threads
+ * take from it */
+struct batch_range {
+    size_t next;
+    size_t end;
+    char pad[64 - 2 * sizeof(size_t)];
+};
+
+struct batch_job {
+    void (*task)(void *arg, size_t i);  /* Run instead of parsing, if set */
+    void *arg;
+    const char *const *inputs;
+    const size_t *lens;
+    const json_parse_options *opts;
+    struct json_doc **docs;
+    json_error_info *errors;
+    struct batch_range *ranges;
+    size_t nranges;
+    size_t failed;
+};
+
+/* Work through the batch as thread self: own range first, then steal */
+static void batch_run(struct batch_job *job, size_t self, struct structural_index *index,
+                      struct doc_home *home) {
+    size_t failed = 0;
+    for (size_t k = 0; k < job->nranges; k++) {
+        struct batch_range *r = &job->ranges[(self + k) % job->nranges];
+        for (;;) {
+            size_t i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED);
+            if (i >= r->end) break;
+            if (job->task) {
+                job->task(job->arg, i);
+                continue;
+            }
+
+            struct json_doc *doc = batch_parse_item(job->inputs[i], job->lens[i],
+                                                    job->opts, index, home);
+            job->docs[i] = doc;
+            if (!doc) failed++;
+            if (job->errors) {
+                job->errors[i] = doc ? (json_error_info){ .code = JSON_OK, .message = "No error" }
+                                     : g_last_error;
+            }
+        }
+    }
+    if (failed) __atomic_fetch_add(&job->failed, failed, __ATOMIC_RELAXED);
+}
+
+static void batch_run_serial(struct batch_job *job) {
+    struct batch_range all = { .next = 0, .end = job->ranges[0].end };
+    struct structural_index index = {0};
+    job->ranges = &all;
+    job->nranges = 1;
+    batch_run(job, 0, &index, NULL);
+    structural_index_free(&index);
+}
+
+#if !defined(_WIN32)
+
+struct batch_worker {
+    pthread_t thread;
+    size_t id;
+    int cpu;                    /* CPU to pin to, or -1 */
+    uint64_t seen;              /* Last batch generation taken */
+    struct doc_home home;       /* Documents it made, once freed */
+};
+
+/* The pool. submit is held for a whole batch (and while the pool starts
+ * or stops); lock guards the hand-off to the workers. */
+static struct {
+    pthread_mutex_t submit;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    bool started;
+    bool stopping;
+    uint64_t generation;        /* Bumped for each batch */
+    size_t busy;                /* Workers still on the current batch */
+    struct batch_job *job;
+
+    uint32_t threads;           /* Configured size (0 = online CPUs) */
+    int cpus[BATCH_MAX_CPUS];
+    size_t cpu_count;
+
+    struct batch_worker workers[BATCH_MAX_THREADS - 1];
+    size_t nworkers;
+    struct batch_range ranges[BATCH_MAX_THREADS];
+} g_batch = {
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
+
+static void batch_pin(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+static void *batch_worker_main(void *arg) {
+    struct batch_worker *w = arg;
+    struct structural_index index = {0};
+
+    /* Before anything is allocated, so the worker's memory is local */
+    if (w->cpu >= 0) batch_pin(w->cpu);
+
+    pthread_mutex_lock(&g_batch.lock);
+    for (;;) {
+        while (g_batch.generation == w->seen && !g_batch.stopping) {
+            pthread_cond_wait(&g_batch.wake, &g_batch.lock);
+        }
+        if (g_batch.stopping) break;
+        w->seen = g_batch.generation;
+        struct batch_job *job = g_batch.job;
+        pthread_mutex_unlock(&g_batch.lock);
+
+        batch_run(job, w->id, &index, &w->home);
+
+        pthread_mutex_lock(&g_batch.lock);
+        if (--g_batch.busy == 0) pthread_cond_signal(&g_batch.done);
+    }
+    pthread_mutex_unlock(&g_batch.lock);
+
+    structural_index_free(&index);
+    return NULL;
+}
+
+/* Start the workers; called with submit held. A worker that cannot be
+ * started just leaves the pool smaller. */
+static void batch_start(void) {
+    size_t threads = g_batch.threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    if (threads > BATCH_MAX_THREADS) threads = BATCH_MAX_THREADS;
+
+    g_batch.stopping = false;
+    g_batch.nworkers = 0;
+    for (size_t i = 0; i + 1 < threads; i++) {
+        struct batch_worker *w = &g_batch.workers[g_batch.nworkers];
+        w->id = g_batch.nworkers;
+        w->cpu = g_batch.cpu_count ? g_batch.cpus[i % g_batch.cpu_count] : -1;
+        w->seen = g_batch.generation;
+        doc_home_open(&w->home);
+        if (pthread_create(&w->thread, NULL, batch_worker_main, w) == 0) {
+            g_batch.nworkers++;
+        } else {
+            doc_home_close(&w->home);
+        }
+    }
+    g_batch.started = true;
+}
+
+/* Stop and join the workers; called with submit held */
+static void batch_stop(void) {
+    if (!g_batch.started) return;
+    pthread_mutex_lock(&g_batch.lock);
+    g_batch.stopping = true;
+    pthread_cond_broadcast(&g_batch.wake);
+    pthread_mutex_unlock(&g_batch.lock);
+
+    for (size_t i = 0; i < g_batch.nworkers; i++) {
+        pthread_join(g_batch.workers[i].thread, NULL);
+        doc_home_close(&g_batch.workers[i].home);
+    }
+    g_batch.nworkers = 0;
+    g_batch.started = false;
+}
+
+void batch_configure(uint32_t threads, const int *cpus, size_t cpu_count) {
+    pthread_mutex_lock(&g_batch.submit);
+    batch_stop();
+    g_batch.threads = threads;
+    g_batch.cpu_count = cpus ? (cpu_count < BATCH_MAX_CPUS ? cpu_count : BATCH_MAX_CPUS) : 0;
+    for (size_t i = 0; i < g_batch.cpu_count; i++) g_batch.cpus[i] = cpus[i];
+    pthread_mutex_unlock(&g_batch.submit);
+}
+
+void batch_shutdown(void) {
+    pthread_mutex_lock(&g_batch.submit);
+    batch_stop();
+    pthread_mutex_unlock(&g_batch.submit);
+}
+
+/* Run n items of job on the workers and the caller; called with submit
+ * held */
+static void batch_dispatch(struct batch_job *job, size_t n) {
+    size_t nthreads = g_batch.nworkers + 1;
+    for (size_t i = 0; i < nthreads; i++) {
+        g_batch.ranges[i].next = n * i / nthreads;
+        g_batch.ranges[i].end = n * (i + 1) / nthreads;
+    }
+    job->ranges = g_batch.ranges;
+    job->nranges = nthreads;
+
+    pthread_mutex_lock(&g_batch.lock);
+    g_batch.job = job;
+    g_batch.busy = g_batch.nworkers;
+    g_batch.generation++;
+    pthread_cond_broadcast(&g_batch.wake);
+    pthread_mutex_unlock(&g_batch.lock);
+
+    struct structural_index index = {0};
+    batch_run(job, g_batch.nworkers, &index, NULL);
+    structural_index_free(&index);
+
+    pthread_mutex_lock(&g_batch.lock);
+    while (g_batch.busy > 0) pthread_cond_wait(&g_batch.done, &g_batch.lock);
+    g_batch.job = NULL;
+    pthread_mutex_unlock(&g_batch.lock);
+}
+
+size_t parse_batch(const char *const *inputs, const size_t *lens, size_t n,
+                   const json_parse_options *opts, struct json_doc **docs,
+                   json_error_info *errors) {
+    struct batch_range one = { .next = 0, .end = n };
+    struct batch_job job = {
+        .inputs = inputs,
+        .lens = lens,
+        .opts = opts,
+        .docs = docs,
+        .errors = errors,
+        .ranges = &one,
+        .nranges = 1
+    };
+
+    pthread_mutex_lock(&g_batch.submit);
+    if (!g_batch.started) batch_start();
+
+    /* Waking the pool costs more than a couple of items per thread */
+    size_t nthreads = g_batch.nworkers + 1;
+    if (g_batch.nworkers == 0 || n < 2 * nthreads) {
+        pthread_mutex_unlock(&g_batch.submit);
+        batch_run_serial(&job);
+        return job.failed;
+    }
+
+    batch_dispatch(&job, n);
+    pthread_mutex_unlock(&g_batch.submit);
+    return job.failed;
+}
+
+bool batch_run_tasks(void (*task)(void *arg, size_t i), void *arg, size_t n) {
+    /* A batch item that is itself parsed in parallel finds the pool taken
+     * by its own batch, hence trylock */
+    if (pthread_mutex_trylock(&g_batch.submit) != 0) return false;
+    if (!g_batch.started) batch_start();
+    if (g_batch.nworkers == 0) {
+        pthread_mutex_unlock(&g_batch.submit);
+        return false;
+    }
+
+    struct batch_job job = { .task = task, .arg = arg };
+    batch_dispatch(&job, n);
+    pthread_mutex_unlock(&g_batch.submit);
+    return true;
+}
+
+#else
+
+void batch_configure(uint32_t threads, const int *cpus, size_t cpu_count) {
+    (void)threads; (void)cpus; (void)cpu_count;
+}
+
+void batch_shutdown(void) {
+}
+
+bool batch_run_tasks(void (*task)(void *arg, size_t i), void *arg, size_t n) {
+    (void)task; (void)arg; (void)n;
+    return false;
+}
+
+size_t parse_batch(const char *const *inputs, const size_t *lens, size_t n,
+                   const json_parse_options *opts, struct json_doc **docs,
+                   json_error_info *errors) {
+    struct batch_range one = { .next = 0, .end = n };
+    struct batch_job job = {
+        .inputs = inputs,
+        .lens = lens,
+        .opts = opts,
+        .docs = docs,
+        .errors = errors,
+        .ranges = &one,
+        .nranges = 1
+    };
+    batch_run_serial(&job);
+    return job.failed;
+}
+
+#endif
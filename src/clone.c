@@ -0,0 +1,529 @@
+/*
+ * json-asm: Deep copy, comparison and hashing of value trees
+ *
+ * json_clone() copies a tree breadth first, as the tape writer does: each
+ * container's members are laid out as one run in the new arena, so an
+ * array's elements are copied with one memcpy() and only strings and
+ * nested containers need fixing up. Long strings are copied into the new
+ * document, so a clone never borrows from the source or its input.
+ *
+ * json_equals() walks objects in parallel while their keys come in the
+ * same order, which is the common case, and only hashes the rest of the
+ * members when the orders part. json_hash() gives equal values equal
+ * hashes: objects hash their members independently of order. None of the
+ * three recurses, so they take any tree the parser can build.
+ */
+
+#include "internal.h"
+
+/* ============================================================================
+ * Clone
+ * ============================================================================ */
+
+/* A copied container whose members are still to be copied */
+struct clone_pending {
+    struct json_val *dst;
+    const struct json_val *src;
+};
+
+struct clone_ctx {
+    struct json_doc *doc;
+    struct clone_pending *queue;
+    size_t queue_len;
+    size_t queue_cap;
+};
+
+static bool clone_enqueue(struct clone_ctx *c, struct json_val *dst, const struct json_val *src) {
+    if (c->queue_len == c->queue_cap) {
+        size_t cap = c->queue_cap ? c->queue_cap * 2 : 64;
+        struct clone_pending *queue = realloc(c->queue, cap * sizeof(*queue));
+        if (!queue) return false;
+        c->queue = queue;
+        c->queue_cap = cap;
+    }
+    c->queue[c->queue_len++] = (struct clone_pending){ dst, src };
+    return true;
+}
+
+/* dst holds a bitwise copy of src; give it its own string or members */
+static bool clone_fixup(struct clone_ctx *c, struct json_val *dst, const struct json_val *src) {
+    switch ((int)val_get_type(src)) {
+        case JSON_STRING_LONG: {
+            size_t len;
+            const char *str = val_str(src, &len);
+            char *copy = arena_alloc_string(c->doc, len);
+            if (!copy) return false;
+            memcpy(copy, str, len);
+            copy[len] = '\0';
+            return val_set_long_str(c->doc, dst, copy, len);
+        }
+        case JSON_ARRAY:
+            return clone_enqueue(c, dst, src);
+        case JSON_OBJECT:
+            /* The key index, if any, belongs to the source */
+            val_reset(dst, JSON_OBJECT);
+            return clone_enqueue(c, dst, src);
+        default:
+            return true;
+    }
+}
+
+static bool clone_array(struct clone_ctx *c, struct json_val *dst, const struct json_val *src) {
+    size_t count = val_arr_count(src);
+    if (count == 0) {
+        dst->child = NULL;
+        return true;
+    }
+
+    struct json_val *run = arena_alloc_vals(c->doc, count);
+    if (!run) return false;
+    memcpy(run, src->child, count * sizeof(*run));
+    dst->child = run;
+
+#ifndef JSON_COMPACT_NODES
+    /* Compact links are offsets, which a contiguous run keeps */
+    for (size_t i = 0; i + 1 < count; i++) run[i].next = &run[i + 1];
+    run[count - 1].next = NULL;
+#endif
+    for (size_t i = 0; i < count; i++) {
+        if (!clone_fixup(c, &run[i], &src->child[i])) return false;
+    }
+    return true;
+}
+
+static bool clone_object(struct clone_ctx *c, struct json_val *dst, const struct json_val *src) {
+    size_t count = 0;
+    for (const struct json_val *k = val_child(src); k; k = val_next(val_next(k))) count++;
+    if (count == 0) return true;
+
+    struct json_val *run = arena_alloc_vals(c->doc, 2 * count);
+    if (!run) return false;
+
+    size_t i = 0;
+    for (const struct json_val *k = val_child(src); k; k = val_next(val_next(k))) {
+        run[i] = *k;
+        run[i + 1] = *val_next(k);
+        if (!clone_fixup(c, &run[i], k) ||
+            !clone_fixup(c, &run[i + 1], val_next(k))) {
+            return false;
+        }
+        i += 2;
+    }
+    for (i = 0; i + 1 < 2 * count; i++) val_set_next(&run[i], &run[i + 1]);
+    val_set_next(&run[2 * count - 1], NULL);
+
+    dst->child = run;
+    if (count >= KEY_INDEX_MIN_MEMBERS) key_index_attach(c->doc, dst, count, 0);
+    return true;
+}
+
+struct json_doc *clone_tree(const struct json_val *val) {
+    /* The arena grows as the copy needs it; sizing it up front would take
+     * a walk of the whole tree */
+    struct clone_ctx c = { .doc = arena_create(0) };
+    if (!c.doc) goto fail;
+
+    struct json_val *root = arena_alloc_vals(c.doc, 1);
+    if (!root) goto fail;
+    *root = *val;
+    val_set_next(root, NULL);
+    if (!clone_fixup(&c, root, val)) goto fail;
+
+    for (size_t i = 0; i < c.queue_len; i++) {
+        struct clone_pending p = c.queue[i];
+        bool ok = val_get_type(p.src) == JSON_ARRAY ? clone_array(&c, p.dst, p.src)
+                                                    : clone_object(&c, p.dst, p.src);
+        if (!ok) goto fail;
+    }
+
+    free(c.queue);
+    c.doc->root = root;
+    return c.doc;
+
+fail:
+    free(c.queue);
+    arena_destroy(c.doc);
+    set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+    return NULL;
+}
+
+/* ============================================================================
+ * Equality
+ * ============================================================================ */
+
+#define EQUAL_INLINE_MEMBERS 16     /* Unordered members matched without malloc */
+#define EQUAL_FRAMES_INLINE 32      /* Open containers before the stacks move to the heap */
+
+static bool strings_equal(const struct json_val *a, const struct json_val *b) {
+    size_t la, lb;
+    const char *sa = val_str(a, &la);
+    const char *sb = val_str(b, &lb);
+    /* Interned strings of one document share their bytes */
+    return la == lb && (sa == sb || memcmp(sa, sb, la) == 0);
+}
+
+/* A member of b, chained to the later members with the same key */
+struct equal_member {
+    const struct json_val *key;
+    uint64_t hash;
+    size_t next;                    /* SIZE_MAX at the end of the chain */
+    bool taken;                     /* Already paired with a member of a */
+};
+
+/* Two values still to compare */
+struct equal_pair {
+    const struct json_val *a;
+    const struct json_val *b;
+};
+
+enum equal_kind {
+    EQUAL_ELEMENTS,                 /* Two arrays, walked in step */
+    EQUAL_MEMBERS,                  /* Two objects, while their keys agree */
+    EQUAL_PAIRS                     /* Two objects' members, paired by key */
+};
+
+/* Two containers being compared */
+struct equal_frame {
+    const struct json_val *a;       /* Next elements, or keys of the next members */
+    const struct json_val *b;
+    size_t pairs;                   /* EQUAL_PAIRS: left on top of the pair stack */
+    enum equal_kind kind;
+};
+
+struct equal_ctx {
+    struct equal_frame *frames;
+    size_t depth;
+    size_t frames_cap;
+    struct equal_pair *pairs;       /* Values of paired members, last to compare first */
+    size_t pairs_len;
+    size_t pairs_cap;
+    struct equal_frame inline_frames[EQUAL_FRAMES_INLINE];
+    struct equal_pair inline_pairs[EQUAL_FRAMES_INLINE];
+};
+
+static bool equal_grow(struct equal_ctx *c) {
+    size_t cap = c->frames_cap * 2;
+    bool heap = c->frames != c->inline_frames;
+    struct equal_frame *frames = heap
+        ? realloc(c->frames, cap * sizeof(*frames))
+        : malloc(cap * sizeof(*frames));
+    if (!frames) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    if (!heap) memcpy(frames, c->inline_frames, c->depth * sizeof(*frames));
+    c->frames = frames;
+    c->frames_cap = cap;
+    return true;
+}
+
+/* Make a and b the innermost containers, f, moving the ones they are in
+ * to the stack */
+static inline bool equal_open(struct equal_ctx *c, struct equal_frame *f, bool nested,
+                              const struct json_val *a, const struct json_val *b,
+                              enum equal_kind kind) {
+    if (nested) {
+        if (c->depth == c->frames_cap && !equal_grow(c)) return false;
+        c->frames[c->depth++] = *f;
+    }
+    *f = (struct equal_frame){ a, b, 0, kind };
+    return true;
+}
+
+static bool equal_reserve_pairs(struct equal_ctx *c, size_t n) {
+    if (c->pairs_cap - c->pairs_len >= n) return true;
+    size_t cap = c->pairs_cap * 2;
+    while (cap - c->pairs_len < n) cap *= 2;
+    bool heap = c->pairs != c->inline_pairs;
+    struct equal_pair *pairs = heap
+        ? realloc(c->pairs, cap * sizeof(*pairs))
+        : malloc(cap * sizeof(*pairs));
+    if (!pairs) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    if (!heap) memcpy(pairs, c->inline_pairs, c->pairs_len * sizeof(*pairs));
+    c->pairs = pairs;
+    c->pairs_cap = cap;
+    return true;
+}
+
+/* Pair the members from ka on with those from kb on by key, in any order,
+ * and push the pairs of their values. Duplicate keys pair up in the order
+ * they appear. False if the keys differ. */
+static bool members_pair_unordered(struct equal_ctx *c, struct equal_frame *f,
+                                   const struct json_val *ka, const struct json_val *kb) {
+    size_t n = 0, m = 0;
+    for (const struct json_val *k = ka; k; k = val_next(val_next(k))) n++;
+    for (const struct json_val *k = kb; k; k = val_next(val_next(k))) m++;
+    if (n != m || !equal_reserve_pairs(c, m)) return false;
+
+    size_t cap = 2;
+    while (cap < 2 * m) cap *= 2;
+
+    struct equal_member members_buf[EQUAL_INLINE_MEMBERS];
+    size_t heads_buf[2 * EQUAL_INLINE_MEMBERS];
+    struct equal_member *members = members_buf;
+    size_t *heads = heads_buf;
+    if (m > EQUAL_INLINE_MEMBERS) {
+        members = malloc(m * sizeof(*members));
+        heads = malloc(cap * sizeof(*heads));
+        if (!members || !heads) {
+            free(members);
+            free(heads);
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+            return false;
+        }
+    }
+    for (size_t i = 0; i < cap; i++) heads[i] = SIZE_MAX;
+
+    /* Slots hold the first member of each distinct key; inserting in
+     * reverse keeps each chain in document order */
+    size_t i = 0;
+    for (const struct json_val *k = kb; k; k = val_next(val_next(k))) {
+        size_t len;
+        const char *str = val_str(k, &len);
+        members[i++] = (struct equal_member){ k, key_hash(str, len), SIZE_MAX, false };
+    }
+    for (i = m; i-- > 0;) {
+        size_t slot = members[i].hash & (cap - 1);
+        while (heads[slot] != SIZE_MAX &&
+               (members[heads[slot]].hash != members[i].hash ||
+                !strings_equal(members[heads[slot]].key, members[i].key))) {
+            slot = (slot + 1) & (cap - 1);
+        }
+        members[i].next = heads[slot];
+        heads[slot] = i;
+    }
+
+    /* Pairs go on the stack backwards, to be compared in document order */
+    bool paired = true;
+    struct equal_pair *out = c->pairs + c->pairs_len + n;
+    for (const struct json_val *k = ka; k; k = val_next(val_next(k))) {
+        size_t len;
+        const char *str = val_str(k, &len);
+        uint64_t hash = key_hash(str, len);
+        size_t slot = hash & (cap - 1);
+        while (heads[slot] != SIZE_MAX &&
+               (members[heads[slot]].hash != hash || !strings_equal(members[heads[slot]].key, k))) {
+            slot = (slot + 1) & (cap - 1);
+        }
+        /* A drained chain keeps its last member, so later probes still
+         * find the key there */
+        size_t e = heads[slot];
+        if (e == SIZE_MAX || members[e].taken) {
+            paired = false;
+            break;
+        }
+        *--out = (struct equal_pair){ val_next(k), val_next(members[e].key) };
+        if (members[e].next != SIZE_MAX) {
+            heads[slot] = members[e].next;
+        } else {
+            members[e].taken = true;
+        }
+    }
+
+    if (members != members_buf) {
+        free(members);
+        free(heads);
+    }
+    if (!paired) return false;
+    c->pairs_len += n;
+    f->pairs = n;
+    f->kind = EQUAL_PAIRS;
+    return true;
+}
+
+/* Compare a and b, then take the next pair from the innermost containers
+ * being compared. The containers are frames on a stack rather than C calls,
+ * so any depth compares; the innermost is kept out of the stack in f. */
+bool values_equal(const struct json_val *a, const struct json_val *b) {
+    struct equal_ctx c;
+    c.frames = c.inline_frames;
+    c.depth = 0;
+    c.frames_cap = EQUAL_FRAMES_INLINE;
+    c.pairs = c.inline_pairs;
+    c.pairs_len = 0;
+    c.pairs_cap = EQUAL_FRAMES_INLINE;
+    struct equal_frame f = {0};
+    bool open = false;              /* Inside a container, f */
+    bool equal = false;
+
+    for (;;) {
+        if (a != b) {
+            json_type ta = val_get_type(a);
+            json_type tb = val_get_type(b);
+            if (ta == (json_type)JSON_STRING_LONG) ta = JSON_STRING;
+            if (tb == (json_type)JSON_STRING_LONG) tb = JSON_STRING;
+            if (ta != tb) goto out;
+
+            switch (ta) {
+                case JSON_INT:
+                    if (a->int_val != b->int_val) goto out;
+                    break;
+
+                case JSON_FLOAT:
+                    if (a->float_val != b->float_val) goto out;
+                    break;
+
+                case JSON_STRING:
+                    if (!strings_equal(a, b)) goto out;
+                    break;
+
+                case JSON_ARRAY:
+                    if (val_arr_count(a) != val_arr_count(b) ||
+                        !equal_open(&c, &f, open, a->child, b->child, EQUAL_ELEMENTS)) {
+                        goto out;
+                    }
+                    open = true;
+                    break;
+
+                case JSON_OBJECT:
+                    if (!equal_open(&c, &f, open, val_child(a), val_child(b), EQUAL_MEMBERS)) goto out;
+                    open = true;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        for (;;) {
+            if (!open) {
+                equal = true;
+                goto out;
+            }
+            if (f.kind == EQUAL_PAIRS) {
+                if (f.pairs) {
+                    f.pairs--;
+                    struct equal_pair p = c.pairs[--c.pairs_len];
+                    a = p.a;
+                    b = p.b;
+                    break;
+                }
+            } else if (f.a && f.b) {
+                if (f.kind == EQUAL_ELEMENTS) {
+                    a = f.a;
+                    b = f.b;
+                    f.a = val_next(a);
+                    f.b = val_next(b);
+                    break;
+                }
+                /* Objects are walked in parallel while their keys come in
+                 * the same order */
+                if (strings_equal(f.a, f.b)) {
+                    a = val_next(f.a);
+                    b = val_next(f.b);
+                    f.a = val_next(a);
+                    f.b = val_next(b);
+                    break;
+                }
+                if (!members_pair_unordered(&c, &f, f.a, f.b)) goto out;
+                continue;
+            } else if (f.a != f.b) {
+                goto out;           /* One object has more members */
+            }
+
+            /* Both containers are done: back out to the ones around them */
+            if (c.depth > 0) {
+                f = c.frames[--c.depth];
+            } else {
+                open = false;
+            }
+        }
+    }
+
+out:
+    if (c.frames != c.inline_frames) free(c.frames);
+    if (c.pairs != c.inline_pairs) free(c.pairs);
+    return equal;
+}
+
+/* ============================================================================
+ * Hashing
+ * ============================================================================ */
+
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 33);
+}
+
+static inline uint64_t type_seed(json_type t) {
+    return hash_mix(0x9E3779B97F4A7C15ULL * ((uint64_t)t + 1));
+}
+
+static uint64_t scalar_hash(const struct json_val *val) {
+    json_type t = val_get_type(val);
+    if (t == (json_type)JSON_STRING_LONG) t = JSON_STRING;
+    uint64_t h = type_seed(t);
+
+    switch (t) {
+        case JSON_INT:
+            return hash_mix(h ^ (uint64_t)val->int_val);
+
+        case JSON_FLOAT: {
+            /* 0.0 == -0.0, so they must hash alike */
+            double d = val->float_val == 0.0 ? 0.0 : val->float_val;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            return hash_mix(h ^ bits);
+        }
+
+        case JSON_STRING: {
+            size_t len;
+            const char *str = val_str(val, &len);
+            return hash_mix(h ^ key_hash(str, len));
+        }
+
+        default:
+            return h;
+    }
+}
+
+/* Containers fold in the hash of each member as the walk leaves it: in
+ * turn for arrays, and as a sum for objects so member order does not
+ * matter */
+uint64_t value_hash(const struct json_val *val) {
+    uint64_t h = 0;
+    struct tree_walk w;
+    tree_walk_init(&w, val);
+
+    for (;;) {
+        enum walk_event ev = tree_walk_next(&w);
+        if (ev == WALK_END) break;
+        if (ev == WALK_ERROR) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+            h = 0;
+            break;
+        }
+
+        if (ev == WALK_OPEN) {
+            struct walk_frame *f = &w.frames[w.depth - 1];
+            if (!f->object) f->acc = type_seed(JSON_ARRAY);
+            continue;
+        }
+        if (ev == WALK_VALUE) {
+            h = scalar_hash(w.val);
+        } else {
+            /* The closed container's frame is just above the open ones */
+            const struct walk_frame *f = &w.frames[w.depth];
+            h = f->object ? hash_mix(type_seed(JSON_OBJECT) ^ f->acc) : f->acc;
+        }
+
+        if (w.depth == 0) continue;
+        struct walk_frame *parent = &w.frames[w.depth - 1];
+        if (parent->object) {
+            size_t len;
+            const char *str = val_str(w.key, &len);
+            parent->acc += hash_mix(key_hash(str, len) ^ (h * 0x9E3779B97F4A7C15ULL));
+        } else {
+            parent->acc = hash_mix(parent->acc + h);
+        }
+    }
+
+    tree_walk_free(&w);
+    return h;
+}
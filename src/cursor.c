@@ -0,0 +1,246 @@
+/*
+ * json-asm: On-demand cursor over unparsed input
+ *
+ * A cursor is an offset into the input. Moving it only reads what lies on
+ * the way: the keys of an object while looking for one, and the separators
+ * between values. Values that are stepped over are not parsed; a string is
+ * skipped with the string scanner and a container with structural_skip(),
+ * which matches brackets 64 bytes at a time. A getter validates and decodes
+ * just the value it reads, with the parser's own routines. So a malformed
+ * value is only reported if it is read, and trailing garbage never is.
+ */
+
+#include "internal.h"
+#include <stdint.h>
+
+#define CURSOR_KEY_INLINE 256   /* Escaped keys up to this size decode on the stack */
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* First non-whitespace offset at or after pos; separators are usually zero
+ * or one byte, so only longer runs go to the kernel */
+static inline size_t skip_ws(const char *json, size_t len, size_t pos) {
+    if (pos >= len || !is_ws(json[pos])) return pos;
+    pos++;
+    if (pos >= len || !is_ws(json[pos])) return pos;
+    return pos + g_json_ops.skip_whitespace(json + pos, len - pos);
+}
+
+static inline bool is_delimiter(char c) {
+    return is_ws(c) || c == ',' || c == ']' || c == '}' || c == ':';
+}
+
+/* Offset of the closing quote of the string opened at pos, or len. Escapes
+ * are stepped over, not checked. */
+static size_t string_close(const char *json, size_t len, size_t pos) {
+    pos++;
+    while (pos < len) {
+        pos += g_json_ops.scan_string(json + pos, len - pos);
+        if (pos >= len || json[pos] == '"') return pos;
+        pos += json[pos] == '\\' ? 2 : 1;
+    }
+    return len;
+}
+
+/* Offset just past the value at pos, or SIZE_MAX with the error set */
+static size_t value_end(const char *json, size_t len, size_t pos) {
+    if (pos >= len) {
+        input_error(json, len, pos, JSON_ERROR_SYNTAX, "Unexpected end of input");
+        return SIZE_MAX;
+    }
+
+    size_t end;
+    switch (json[pos]) {
+        case '"':
+            end = string_close(json, len, pos);
+            if (end < len) return end + 1;
+            input_error(json, len, pos, JSON_ERROR_STRING, "Unterminated string");
+            return SIZE_MAX;
+        case '[': case '{':
+            end = structural_skip(json, len, pos);
+            if (end < len) return end + 1;
+            input_error(json, len, pos, JSON_ERROR_SYNTAX, "Unclosed container");
+            return SIZE_MAX;
+        default:
+            for (end = pos; end < len && !is_delimiter(json[end]); end++) {}
+            if (end > pos) return end;
+            input_error(json, len, pos, JSON_ERROR_SYNTAX, "Unexpected character");
+            return SIZE_MAX;
+    }
+}
+
+/* Read the member starting at pos into out: its key, the colon and the
+ * start of its value */
+static bool read_member(const json_cursor *cur, size_t pos, json_cursor *out) {
+    const char *json = cur->json;
+    size_t len = cur->len;
+
+    if (pos >= len || json[pos] != '"') {
+        input_error(json, len, pos, JSON_ERROR_SYNTAX, "Expected string key");
+        return false;
+    }
+    size_t close = string_close(json, len, pos);
+    if (close >= len) {
+        input_error(json, len, pos, JSON_ERROR_STRING, "Unterminated string");
+        return false;
+    }
+
+    size_t colon = skip_ws(json, len, close + 1);
+    if (colon >= len || json[colon] != ':') {
+        input_error(json, len, colon, JSON_ERROR_SYNTAX, "Expected ':'");
+        return false;
+    }
+    size_t value = skip_ws(json, len, colon + 1);
+    if (value >= len) {
+        input_error(json, len, value, JSON_ERROR_SYNTAX, "Unexpected end of input");
+        return false;
+    }
+
+    out->json = json;
+    out->len = len;
+    out->pos = value;
+    out->key = pos + 1;
+    out->key_len = close - pos - 1;
+    out->container = '{';
+    return true;
+}
+
+/* Read the element or member at pos, which may instead close the container */
+static bool read_item(const json_cursor *cur, size_t pos, char container,
+                      bool may_close, json_cursor *out) {
+    char close = container == '{' ? '}' : ']';
+    if (pos < cur->len && cur->json[pos] == close && may_close) {
+        set_error(JSON_OK, pos, 0, 0, "End of container");
+        return false;
+    }
+    if (container == '{') return read_member(cur, pos, out);
+
+    if (pos >= cur->len || cur->json[pos] == close) {
+        input_error(cur->json, cur->len, pos, JSON_ERROR_SYNTAX,
+                    pos >= cur->len ? "Unexpected end of input" : "Expected value");
+        return false;
+    }
+    *out = *cur;
+    out->pos = pos;
+    out->key = 0;
+    out->key_len = 0;
+    out->container = '[';
+    return true;
+}
+
+bool cursor_init(json_cursor *cur, const char *json, size_t len) {
+    size_t pos = skip_ws(json, len, 0);
+    if (pos >= len) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return false;
+    }
+    *cur = (json_cursor){ .json = json, .len = len, .pos = pos };
+    return true;
+}
+
+bool cursor_child(const json_cursor *container, json_cursor *out) {
+    char c = container->json[container->pos];
+    if (c != '[' && c != '{') {
+        set_error(JSON_ERROR_TYPE, container->pos, 0, 0, "Not an array or object");
+        return false;
+    }
+    size_t pos = skip_ws(container->json, container->len, container->pos + 1);
+    return read_item(container, pos, c, true, out);
+}
+
+bool cursor_next(json_cursor *cur) {
+    if (!cur->container) {
+        set_error(JSON_OK, cur->pos, 0, 0, "End of container");
+        return false;
+    }
+
+    size_t end = value_end(cur->json, cur->len, cur->pos);
+    if (end == SIZE_MAX) return false;
+
+    size_t pos = skip_ws(cur->json, cur->len, end);
+    char close = cur->container == '{' ? '}' : ']';
+    if (pos < cur->len && cur->json[pos] == close) {
+        set_error(JSON_OK, pos, 0, 0, "End of container");
+        return false;
+    }
+    if (pos >= cur->len || cur->json[pos] != ',') {
+        input_error(cur->json, cur->len, pos, JSON_ERROR_SYNTAX,
+                    close == '}' ? "Expected ',' or '}'" : "Expected ',' or ']'");
+        return false;
+    }
+
+    pos = skip_ws(cur->json, cur->len, pos + 1);
+    return read_item(cur, pos, cur->container, false, cur);
+}
+
+/* Does the member's key decode to key? Raw bytes settle it unless the key
+ * in the input has escapes. */
+static bool key_matches(const json_cursor *m, const char *key, size_t len) {
+    const char *raw = m->json + m->key;
+    if (m->key_len == len && memcmp(raw, key, len) == 0) return true;
+    if (m->key_len < len || !memchr(raw, '\\', m->key_len)) return false;
+
+    char inline_buf[CURSOR_KEY_INLINE];
+    char *buf = len < CURSOR_KEY_INLINE ? inline_buf : malloc(len + 1);
+    if (!buf) return false;
+
+    size_t decoded;
+    bool match = parse_string_at(m->json, m->len, m->key - 1, buf, len + 1, &decoded, NULL) &&
+                 decoded == len && memcmp(buf, key, len) == 0;
+    if (buf != inline_buf) free(buf);
+    return match;
+}
+
+bool cursor_find(const json_cursor *obj, const char *key, size_t len, json_cursor *out) {
+    if (obj->json[obj->pos] != '{') {
+        set_error(JSON_ERROR_TYPE, obj->pos, 0, 0, "Not an object");
+        return false;
+    }
+
+    json_cursor m;
+    if (!cursor_child(obj, &m)) return false;
+    while (!key_matches(&m, key, len)) {
+        if (!cursor_next(&m)) return false;
+    }
+    *out = m;
+    return true;
+}
+
+bool cursor_scalar(const json_cursor *cur, struct json_val *val) {
+    size_t end;
+    if (!parse_scalar_at(cur->json, cur->len, cur->pos, val, &end)) return false;
+
+    /* The token must end where the value does, as in "truex" it does not */
+    if (end < cur->len && !is_delimiter(cur->json[end])) {
+        input_error(cur->json, cur->len, end, JSON_ERROR_SYNTAX, "Unexpected character");
+        return false;
+    }
+    return true;
+}
+
+json_type cursor_type(const json_cursor *cur) {
+    switch (cur->json[cur->pos]) {
+        case '"': return JSON_STRING;
+        case '[': return JSON_ARRAY;
+        case '{': return JSON_OBJECT;
+        default: {
+            struct json_val val;
+            return cursor_scalar(cur, &val) ? val_get_type(&val) : JSON_NULL;
+        }
+    }
+}
+
+size_t cursor_string(const json_cursor *cur, size_t pos, char *buf, size_t buf_len) {
+    size_t len;
+    if (!parse_string_at(cur->json, cur->len, pos, buf, buf_len, &len, NULL)) return 0;
+    return len;
+}
+
+const char *cursor_raw(const json_cursor *cur, size_t *len) {
+    size_t end = value_end(cur->json, cur->len, cur->pos);
+    if (end == SIZE_MAX) return NULL;
+    *len = end - cur->pos;
+    return cur->json + cur->pos;
+}
@@ -0,0 +1,512 @@
+/*
+ * json-asm: Push parser for chunked input
+ *
+ * json_feed() takes a document in arbitrary pieces. Nesting lives on an
+ * explicit frame stack instead of the C stack, so parsing can stop at any
+ * byte and resume with the next chunk. Strings, numbers and literals that
+ * are complete within a chunk go straight to the regular token parsers;
+ * only a token split across chunks is collected in a side buffer first.
+ * The DOM is built in the parser's document as the input arrives.
+ */
+
+#include "internal.h"
+
+#define FEED_STACK_INITIAL  16
+#define FEED_BUF_INITIAL    256
+
+enum feed_expect {
+    EXPECT_VALUE,           /* Root value, or value after ':' */
+    EXPECT_ELEMENT_FIRST,   /* After '[': value or ']' */
+    EXPECT_ELEMENT,         /* After ',' in an array */
+    EXPECT_KEY_FIRST,       /* After '{': key or '}' */
+    EXPECT_KEY,             /* After ',' in an object */
+    EXPECT_COLON,           /* After a key */
+    EXPECT_COMMA,           /* After a member: ',' or the closing bracket */
+    EXPECT_END              /* Root complete; only whitespace may follow */
+};
+
+enum feed_token {
+    TOKEN_NONE,
+    TOKEN_STRING,
+    TOKEN_SCALAR
+};
+
+/* One open array or object */
+struct feed_frame {
+    struct json_val *container;
+    struct json_val *last;      /* Last element or member value */
+    struct json_val *key;       /* Key waiting for its value (objects) */
+    size_t count;               /* Elements or members so far */
+};
+
+struct feed_state {
+    struct feed_frame *stack;
+    size_t depth;
+    size_t capacity;
+    struct json_val *root;
+    uint8_t expect;             /* enum feed_expect */
+    uint8_t token;              /* enum feed_token split across chunks */
+    bool key_token;             /* The pending string is an object key */
+    bool escape;                /* The pending string ended on a backslash */
+    bool active;                /* A document is in progress */
+    char *buf;                  /* Bytes of the split token */
+    size_t buf_len;
+    size_t buf_cap;
+    size_t offset;              /* Input bytes consumed by earlier chunks */
+    size_t token_start;         /* Input offset of the current token */
+    json_error_info error;      /* Sticky error for the current document */
+};
+
+/* Bytes that end a number or literal */
+static const uint8_t is_delim[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1,
+    ['{'] = 1, ['}'] = 1, ['['] = 1, [']'] = 1,
+    [':'] = 1, [','] = 1, ['"'] = 1
+};
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static json_error feed_fail(struct feed_state *st, json_error code,
+                            size_t pos, const char *msg) {
+    set_error(code, pos, 0, 0, msg);
+    st->error = g_last_error;
+    return code;
+}
+
+static bool feed_begin(struct json_parser *parser) {
+    if (parser->doc) {
+        arena_reset(parser->doc);
+    } else {
+        parser->doc = arena_create(0);
+        if (!parser->doc) return false;
+        parser->doc->owner = parser;
+    }
+
+    struct feed_state *st = parser->feed;
+    st->depth = 0;
+    st->root = NULL;
+    st->expect = EXPECT_VALUE;
+    st->token = TOKEN_NONE;
+    st->escape = false;
+    st->buf_len = 0;
+    st->offset = 0;
+    st->error.code = JSON_OK;
+    st->active = true;
+    return true;
+}
+
+/* Attach a finished value to the innermost open container */
+static void feed_value(struct feed_state *st, struct json_val *val) {
+    if (st->depth == 0) {
+        st->root = val;
+        st->expect = EXPECT_END;
+        return;
+    }
+
+    struct feed_frame *f = &st->stack[st->depth - 1];
+    if (val_get_type(f->container) == JSON_ARRAY) {
+        if (f->last) {
+            val_set_next(f->last, val);
+        } else {
+            f->container->child = val;
+        }
+    } else {
+        /* Members alternate on the sibling chain: key, value, key, ... */
+        val_set_next(f->key, val);
+        if (f->last) {
+            val_set_next(f->last, f->key);
+        } else {
+            f->container->child = f->key;
+        }
+    }
+    f->last = val;
+    f->count++;
+    st->expect = EXPECT_COMMA;
+}
+
+static json_error feed_open(struct json_parser *parser, json_type type, size_t pos) {
+    struct feed_state *st = parser->feed;
+
+    if (parser->opts.max_depth > 0 && st->depth >= parser->opts.max_depth) {
+        return feed_fail(st, JSON_ERROR_DEPTH, pos, "Maximum depth exceeded");
+    }
+    if (st->depth == st->capacity) {
+        size_t cap = st->capacity ? st->capacity * 2 : FEED_STACK_INITIAL;
+        struct feed_frame *stack = realloc(st->stack, cap * sizeof(*stack));
+        if (!stack) return feed_fail(st, JSON_ERROR_MEMORY, pos, "Failed to grow parser stack");
+        st->stack = stack;
+        st->capacity = cap;
+    }
+
+    struct json_val *val = arena_alloc_val(parser->doc);
+    if (!val) return feed_fail(st, JSON_ERROR_MEMORY, pos, "Failed to allocate value");
+    val_set_type(val, type);
+    feed_value(st, val);
+
+    st->stack[st->depth++] = (struct feed_frame){val, NULL, NULL, 0};
+    st->expect = type == JSON_ARRAY ? EXPECT_ELEMENT_FIRST : EXPECT_KEY_FIRST;
+    return JSON_OK;
+}
+
+/* Elements are linked as they complete; move them into one contiguous run
+ * when the array closes, unless they already are (arrays of scalars) */
+static bool feed_pack_array(struct json_doc *doc, struct json_val *arr, size_t count) {
+    val_set_arr_count(arr, count);
+    struct json_val *first = arr->child;
+
+    size_t i = 0;
+    for (struct json_val *e = first; e; e = val_next(e), i++) {
+        if (e != first + i) break;
+    }
+    if (i == count) return true;
+
+    struct json_val *elems = arena_alloc_vals(doc, count);
+    if (!elems) return false;
+    i = 0;
+    for (struct json_val *e = first; e; e = val_next(e)) {
+        elems[i++] = *e;
+    }
+    for (i = 0; i + 1 < count; i++) {
+        val_set_next(&elems[i], &elems[i + 1]);
+    }
+    val_set_next(&elems[count - 1], NULL);
+    arr->child = elems;
+
+    /* The linked nodes stay behind unused */
+    doc->value_count -= count;
+    return true;
+}
+
+static json_error feed_close(struct json_parser *parser, size_t pos) {
+    struct feed_state *st = parser->feed;
+    struct feed_frame *f = &st->stack[--st->depth];
+    if (val_get_type(f->container) == JSON_OBJECT) {
+        key_index_attach(parser->doc, f->container, f->count, parser->opts.flags);
+    } else if (!feed_pack_array(parser->doc, f->container, f->count)) {
+        return feed_fail(st, JSON_ERROR_MEMORY, pos, "Failed to allocate value");
+    }
+    st->expect = st->depth > 0 ? EXPECT_COMMA : EXPECT_END;
+    return JSON_OK;
+}
+
+/* Record a token error; the token parser reports positions within the token */
+static json_error feed_token_error(struct feed_state *st) {
+    g_last_error.position += st->token_start;
+    g_last_error.line = 0;
+    g_last_error.column = 0;
+    st->error = g_last_error;
+    return st->error.code;
+}
+
+/* Attach a parsed string or scalar token */
+static void feed_add_token(struct feed_state *st, struct json_val *val) {
+    if (st->key_token) {
+        st->stack[st->depth - 1].key = val;
+        st->expect = EXPECT_COLON;
+    } else {
+        feed_value(st, val);
+    }
+}
+
+/* Parse a token that was collected across chunks */
+static json_error feed_buffered_token(struct json_parser *parser) {
+    struct feed_state *st = parser->feed;
+    size_t len = st->buf_len;
+    size_t used = 0;
+    st->buf_len = 0;
+    struct json_val *val = parse_token(parser->doc, st->buf, len,
+                                       parser->opts.flags, &used);
+    if (!val) return feed_token_error(st);
+    if (used != len) {
+        return feed_fail(st, JSON_ERROR_SYNTAX, st->token_start + used, "Unexpected character");
+    }
+    feed_add_token(st, val);
+    return JSON_OK;
+}
+
+static bool feed_buf_append(struct feed_state *st, const char *data, size_t len) {
+    if (st->buf_len + len > st->buf_cap) {
+        size_t cap = st->buf_cap ? st->buf_cap : FEED_BUF_INITIAL;
+        while (cap < st->buf_len + len) {
+            cap *= 2;
+        }
+        char *buf = realloc(st->buf, cap);
+        if (!buf) return false;
+        st->buf = buf;
+        st->buf_cap = cap;
+    }
+    memcpy(st->buf + st->buf_len, data, len);
+    st->buf_len += len;
+    return true;
+}
+
+/* Advance *pos past the closing quote of a string body that continues at
+ * chunk + *pos. Returns false (with *pos = len) if the chunk ends first. */
+static bool string_end(struct feed_state *st, const char *chunk, size_t len, size_t *pos) {
+    size_t i = *pos;
+    if (st->escape) {
+        if (i >= len) return false;
+        i++;
+        st->escape = false;
+    }
+
+    while (i < len) {
+        i += g_json_ops.scan_string(chunk + i, len - i);
+        if (i >= len) break;
+        char c = chunk[i++];
+        if (c == '"') {
+            *pos = i;
+            return true;
+        }
+        if (c == '\\') {
+            if (i >= len) {
+                st->escape = true;
+                break;
+            }
+            i++;
+        }
+        /* Control characters are rejected by the token parser */
+    }
+    *pos = len;
+    return false;
+}
+
+/* End of the number or literal starting at chunk + pos (len if unfinished) */
+static inline size_t scalar_end(const char *chunk, size_t len, size_t pos) {
+    while (pos < len && !is_delim[(unsigned char)chunk[pos]]) {
+        pos++;
+    }
+    return pos;
+}
+
+/* Finish the token carried over from the previous chunk. Returns the bytes
+ * of chunk it used, or len if it is still unfinished. */
+static json_error feed_resume_token(struct json_parser *parser, const char *chunk,
+                                    size_t len, size_t *used) {
+    struct feed_state *st = parser->feed;
+    size_t end = 0;
+    bool done;
+    if (st->token == TOKEN_STRING) {
+        done = string_end(st, chunk, len, &end);
+    } else {
+        end = scalar_end(chunk, len, 0);
+        done = end < len;
+    }
+
+    if (!feed_buf_append(st, chunk, end)) {
+        return feed_fail(st, JSON_ERROR_MEMORY, st->offset, "Failed to buffer token");
+    }
+    *used = end;
+    if (!done) return JSON_ERROR_INCOMPLETE;
+
+    st->token = TOKEN_NONE;
+    return feed_buffered_token(parser);
+}
+
+/* Start a string or scalar token at chunk + *pos */
+static json_error feed_start_token(struct json_parser *parser, const char *chunk,
+                                   size_t len, size_t *pos, bool key) {
+    struct feed_state *st = parser->feed;
+    size_t start = *pos;
+    char c = chunk[start];
+    st->key_token = key;
+    st->token_start = st->offset + start;
+
+    if (c != '"' && is_delim[(unsigned char)c]) {
+        return feed_fail(st, JSON_ERROR_SYNTAX, st->token_start, "Unexpected character");
+    }
+
+    /* Usually the whole token is in this chunk: parse it in place. A number
+     * or literal that reaches the end of the chunk may still continue. */
+    size_t used = 0;
+    struct json_val *val = parse_token(parser->doc, chunk + start, len - start,
+                                       parser->opts.flags, &used);
+    if (val && (c == '"' || start + used < len)) {
+        *pos = start + used;
+        feed_add_token(st, val);
+        return JSON_OK;
+    }
+
+    /* Either the token is cut off by the end of the chunk, or it is invalid */
+    size_t end = start + 1;
+    bool done;
+    if (c == '"') {
+        st->escape = false;
+        done = string_end(st, chunk, len, &end);
+    } else {
+        end = scalar_end(chunk, len, end);
+        done = end < len;
+    }
+    if (done) return feed_token_error(st);
+
+    /* Keep the partial token for the next chunk */
+    st->token = c == '"' ? TOKEN_STRING : TOKEN_SCALAR;
+    st->buf_len = 0;
+    if (!feed_buf_append(st, chunk + start, len - start)) {
+        return feed_fail(st, JSON_ERROR_MEMORY, st->token_start, "Failed to buffer token");
+    }
+    *pos = len;
+    return JSON_ERROR_INCOMPLETE;
+}
+
+json_error feed_chunk(struct json_parser *parser, const char *chunk, size_t len) {
+    if (!parser->feed) {
+        parser->feed = calloc(1, sizeof(struct feed_state));
+        if (!parser->feed) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate parser state");
+            return JSON_ERROR_MEMORY;
+        }
+    }
+
+    struct feed_state *st = parser->feed;
+    if (!st->active && !feed_begin(parser)) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+        return JSON_ERROR_MEMORY;
+    }
+    if (st->error.code != JSON_OK) {
+        g_last_error = st->error;
+        return st->error.code;
+    }
+
+    size_t i = 0;
+    json_error err;
+    if (st->token != TOKEN_NONE) {
+        err = feed_resume_token(parser, chunk, len, &i);
+        if (err != JSON_OK) goto out;
+    }
+
+    while (i < len) {
+        char c = chunk[i];
+        if (is_ws(c)) {
+            i++;
+            if (i < len && is_ws(chunk[i])) {
+                i += g_json_ops.skip_whitespace(chunk + i, len - i);
+            }
+            continue;
+        }
+
+        size_t pos = st->offset + i;
+        bool trailing = (parser->opts.flags & JSON_PARSE_ALLOW_TRAILING) != 0;
+
+        switch (st->expect) {
+            case EXPECT_END:
+                err = feed_fail(st, JSON_ERROR_SYNTAX, pos, "Trailing content after JSON");
+                goto out;
+
+            case EXPECT_COLON:
+                if (c != ':') {
+                    err = feed_fail(st, JSON_ERROR_SYNTAX, pos, "Expected ':'");
+                    goto out;
+                }
+                st->expect = EXPECT_VALUE;
+                i++;
+                continue;
+
+            case EXPECT_COMMA: {
+                bool array = val_get_type(st->stack[st->depth - 1].container) == JSON_ARRAY;
+                if (c == ',') {
+                    st->expect = array ? EXPECT_ELEMENT : EXPECT_KEY;
+                } else if (c == (array ? ']' : '}')) {
+                    err = feed_close(parser, pos);
+                    if (err != JSON_OK) goto out;
+                } else {
+                    err = feed_fail(st, JSON_ERROR_SYNTAX, pos,
+                                    array ? "Expected ',' or ']'" : "Expected ',' or '}'");
+                    goto out;
+                }
+                i++;
+                continue;
+            }
+
+            case EXPECT_KEY_FIRST:
+            case EXPECT_KEY:
+                if (c == '}' && (st->expect == EXPECT_KEY_FIRST || trailing)) {
+                    err = feed_close(parser, pos);
+                    if (err != JSON_OK) goto out;
+                    i++;
+                    continue;
+                }
+                if (c != '"') {
+                    err = feed_fail(st, JSON_ERROR_SYNTAX, pos, "Expected string key");
+                    goto out;
+                }
+                err = feed_start_token(parser, chunk, len, &i, true);
+                if (err != JSON_OK) goto out;
+                continue;
+
+            case EXPECT_ELEMENT_FIRST:
+            case EXPECT_ELEMENT:
+                if (c == ']' && (st->expect == EXPECT_ELEMENT_FIRST || trailing)) {
+                    err = feed_close(parser, pos);
+                    if (err != JSON_OK) goto out;
+                    i++;
+                    continue;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        /* A value */
+        if (c == '[' || c == '{') {
+            err = feed_open(parser, c == '[' ? JSON_ARRAY : JSON_OBJECT, pos);
+            if (err != JSON_OK) goto out;
+            i++;
+            continue;
+        }
+        err = feed_start_token(parser, chunk, len, &i, false);
+        if (err != JSON_OK) goto out;
+    }
+
+    err = st->expect == EXPECT_END ? JSON_OK : JSON_ERROR_INCOMPLETE;
+
+out:
+    st->offset += len;
+    return err;
+}
+
+struct json_doc *feed_finish(struct json_parser *parser) {
+    struct feed_state *st = parser->feed;
+    if (!st || !st->active) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return NULL;
+    }
+    st->active = false;
+
+    if (st->error.code != JSON_OK) {
+        g_last_error = st->error;
+        return NULL;
+    }
+
+    /* Only the end of input can finish a number or literal at the root */
+    if (st->token == TOKEN_SCALAR) {
+        st->token = TOKEN_NONE;
+        if (feed_buffered_token(parser) != JSON_OK) return NULL;
+    } else if (st->token == TOKEN_STRING) {
+        st->token = TOKEN_NONE;
+        feed_fail(st, JSON_ERROR_INCOMPLETE, st->token_start, "Unterminated string");
+        return NULL;
+    }
+
+    if (st->expect != EXPECT_END) {
+        feed_fail(st, JSON_ERROR_INCOMPLETE, st->offset, "Unexpected end of input");
+        return NULL;
+    }
+
+    parser->doc->root = st->root;
+    return parser->doc;
+}
+
+void feed_cancel(struct feed_state *st) {
+    if (st) st->active = false;
+}
+
+void feed_destroy(struct feed_state *st) {
+    if (!st) return;
+    free(st->stack);
+    free(st->buf);
+    free(st);
+}
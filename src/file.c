@@ -0,0 +1,170 @@
+/*
+ * json-asm: File input
+ *
+ * Files are memory-mapped rather than read into a heap copy. The mapping is
+ * padded with zero pages so SIMD kernels may read past the last byte, and
+ * with JSON_PARSE_BORROW or JSON_PARSE_INSITU the document keeps it alive
+ * so strings can point straight into the file.
+ */
+
+#define _DEFAULT_SOURCE
+#include "internal.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#define ZERO_COPY_FLAGS     (JSON_PARSE_INSITU | JSON_PARSE_BORROW)
+
+void input_release(struct owned_input *in) {
+    if (!in->data) return;
+#if !defined(_WIN32)
+    if (in->mapped) {
+        munmap(in->data, in->size);
+    } else
+#endif
+    {
+        free(in->data);
+    }
+    in->data = NULL;
+    in->len = 0;
+    in->size = 0;
+    in->mapped = false;
+}
+
+#if !defined(_WIN32)
+
+/* Map len bytes of fd followed by at least JSON_INPUT_PADDING zero bytes.
+ * An anonymous region is reserved first and the file mapped over its start,
+ * so the padding never extends the file mapping past EOF (which would
+ * fault). Private mappings are copy-on-write, so INSITU can decode in them. */
+static void *map_file(int fd, size_t len, uint32_t flags, size_t *map_size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (len + JSON_INPUT_PADDING + page - 1) & ~(page - 1);
+    int prot = (flags & JSON_PARSE_INSITU) ? PROT_READ | PROT_WRITE : PROT_READ;
+
+    void *base = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+
+    int map_flags = MAP_PRIVATE | MAP_FIXED;
+#ifdef MAP_POPULATE
+    map_flags |= MAP_POPULATE;      /* Fault the whole file in up front */
+#endif
+    if (mmap(base, len, prot, map_flags, fd, 0) == MAP_FAILED) {
+        munmap(base, size);
+        return NULL;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(base, len, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_HUGEPAGE
+    if (flags & JSON_PARSE_HUGE_PAGES) {
+        madvise(base, size, MADV_HUGEPAGE);
+    }
+#endif
+
+    *map_size = size;
+    return base;
+}
+
+bool input_load_file(struct owned_input *in, const char *path, uint32_t flags) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot open file");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Empty or invalid file");
+        return false;
+    }
+
+    size_t len = (size_t)st.st_size;
+    size_t map_size = 0;
+    void *map = map_file(fd, len, flags, &map_size);
+    close(fd);
+    if (!map) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot map file");
+        return false;
+    }
+
+    in->data = map;
+    in->len = len;
+    in->size = map_size;
+    in->mapped = true;
+    return true;
+}
+
+#else
+
+bool input_load_file(struct owned_input *in, const char *path, uint32_t flags) {
+    (void)flags;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot open file");
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0) {
+        fclose(f);
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Empty or invalid file");
+        return false;
+    }
+
+    /* Zeroed padding for SIMD over-reads, as with the mapped path */
+    size_t buf_size = (size_t)size + JSON_INPUT_PADDING;
+    char *buf = calloc(1, buf_size);
+    if (!buf) {
+        fclose(f);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+
+    size_t read = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+
+    if (read != (size_t)size) {
+        free(buf);
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Read error");
+        return false;
+    }
+
+    in->data = buf;
+    in->len = (size_t)size;
+    in->size = buf_size;
+    in->mapped = false;
+    return true;
+}
+
+#endif
+
+struct json_doc *parse_file(const char *path, const json_parse_options *opts) {
+    uint32_t flags = opts ? opts->flags : 0;
+    struct owned_input in = {0};
+    if (!input_load_file(&in, path, flags)) return NULL;
+
+    struct json_doc *doc = parse_json(in.data, in.len, opts);
+
+    /* Hand the buffer to the document if strings may point into it */
+    if (doc && (flags & ZERO_COPY_FLAGS)) {
+        doc->input = in;
+    } else {
+        input_release(&in);
+    }
+    return doc;
+}
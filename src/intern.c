@@ -0,0 +1,80 @@
+/*
+ * json-asm: String interning for JSON_PARSE_INTERN
+ *
+ * Records repeat the same keys and enum-like values over and over. With
+ * JSON_PARSE_INTERN the parser passes each long string (8 to
+ * INTERN_MAX_LEN bytes; shorter ones are stored in the node anyway) through
+ * an open-addressed table of the copies already in the document's string
+ * pool, so every distinct string is stored once and the nodes share it.
+ * Equal strings of one document then also compare equal by pointer.
+ *
+ * The table is only needed while strings are added, so parse_json_into()
+ * drops it when the parse ends; documents fed token by token keep it until
+ * they are freed or reset.
+ */
+
+#include "internal.h"
+
+#define INTERN_MIN_SLOTS 256
+
+static inline size_t intern_home(const struct intern_table *t, uint64_t hash) {
+    return (size_t)hash & t->mask;
+}
+
+/* Double the table (or create it); false leaves it as it was */
+static bool intern_grow(struct intern_table *t) {
+    size_t size = t->slots ? (t->mask + 1) * 2 : INTERN_MIN_SLOTS;
+    struct intern_slot *slots = calloc(size, sizeof(struct intern_slot));
+    if (!slots) return false;
+
+    struct intern_table grown = { slots, size - 1, t->count };
+    for (size_t i = 0; t->slots && i <= t->mask; i++) {
+        if (!t->slots[i].str) continue;
+        size_t j = intern_home(&grown, t->slots[i].hash);
+        while (slots[j].str) j = (j + 1) & grown.mask;
+        slots[j] = t->slots[i];
+    }
+    free(t->slots);
+    *t = grown;
+    return true;
+}
+
+const char *intern_string(struct json_doc *doc, const char *str, size_t len) {
+    struct intern_table *t = &doc->interned;
+    uint64_t hash = key_hash(str, len);
+
+    size_t i = 0;
+    if (t->slots) {
+        for (i = intern_home(t, hash); t->slots[i].str; i = (i + 1) & t->mask) {
+            const struct intern_slot *slot = &t->slots[i];
+            if (slot->hash == hash && slot->len == len && memcmp(slot->str, str, len) == 0) {
+                return slot->str;
+            }
+        }
+    }
+
+    char *copy = arena_alloc_string(doc, len);
+    if (!copy) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    /* Past half full the table grows; if it cannot, the copy just goes
+     * unshared */
+    if ((t->count + 1) * 2 > (t->slots ? t->mask + 1 : 0)) {
+        if (!intern_grow(t)) return copy;
+        for (i = intern_home(t, hash); t->slots[i].str; i = (i + 1) & t->mask) {}
+    }
+    t->slots[i] = (struct intern_slot){ copy, len, hash };
+    t->count++;
+    return copy;
+}
+
+size_t intern_memory(const struct json_doc *doc) {
+    const struct intern_table *t = &doc->interned;
+    return t->slots ? (t->mask + 1) * sizeof(struct intern_slot) : 0;
+}
+
+void intern_release(struct json_doc *doc) {
+    free(doc->interned.slots);
+    doc->interned = (struct intern_table){0};
+}
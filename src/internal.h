@@ -10,6 +10,10 @@
 #include <string.h>
 #include <stdio.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 /* ============================================================================
  * Platform Detection
  * ============================================================================ */
@@ -23,43 +27,158 @@
 #endif
 
 /* ============================================================================
- * Value Node Layout (24 bytes)
+ * Value Node Layout
+ *
+ * Default (24 bytes):
+ *   Bytes 0-7:   4-bit type tag + 60-bit payload
+ *   Bytes 8-15:  next sibling pointer
+ *   Bytes 16-23: first child, string pointer, inline string, int or double
+ *
+ * JSON_COMPACT_NODES (16 bytes, four per cache line):
+ *   Bytes 0-7:   4-bit type tag + 28-bit payload + 32-bit next offset
+ *   Bytes 8-15:  as bytes 16-23 above
  *
- * Bytes 0-7:   4-bit type tag + 60-bit payload
- * Bytes 8-15:  next sibling pointer OR string length
- * Bytes 16-23: first child pointer OR string pointer
+ * The compact next link is the signed distance to the sibling in nodes
+ * (0 = none), so it survives the file mapping of tapes unchanged. arena.c
+ * keeps all node blocks of a document within its reach. Go through the
+ * val_* helpers below rather than the fields when touching the first word
+ * or the links.
  * ============================================================================ */
 
 #define JSON_TAG_MASK    0x0FULL
 #define JSON_TAG_SHIFT   0
 #define JSON_PAYLOAD_SHIFT 4
 
-/* Value node (24 bytes) */
+struct key_index;
+struct doc_home;
+
+/* Object members are stored as alternating key and value nodes on the
+ * sibling chain: obj->child is the first key, key->next is its value and
+ * value->next is the following key. */
+#ifdef JSON_COMPACT_NODES
+#define JSON_PAYLOAD_BITS 28
+#define JSON_NEXT_SHIFT   32
+
 struct json_val {
-    uint64_t tag_payload;       /* 4-bit tag + 60-bit inline payload */
+    uint64_t tag_payload;       /* 4-bit tag + 28-bit payload + next offset */
     union {
-        struct json_val *next;  /* Next sibling (objects/arrays) */
-        size_t str_len;         /* String length (strings) */
-        int64_t int_ext;        /* Extended integer bits */
+        struct json_val *child; /* First child (arrays, objects) */
+        struct key_index *key_index; /* Indexed objects; it holds the child */
+        const char *str_ptr;    /* String pointer (long strings) */
+        char short_str[8];      /* Inline bytes, NUL-padded (short strings) */
+        int64_t int_val;        /* Integer value */
+        double float_val;       /* Float value */
     };
+};
+#else
+#define JSON_PAYLOAD_BITS 60
+
+struct json_val {
+    uint64_t tag_payload;       /* 4-bit tag + 60-bit inline payload */
+    struct json_val *next;      /* Next sibling */
     union {
-        struct json_val *child; /* First child (objects/arrays) */
+        struct json_val *child; /* First child (arrays, objects) */
         const char *str_ptr;    /* String pointer (long strings) */
+        char short_str[8];      /* Inline bytes, NUL-padded (short strings) */
+        int64_t int_val;        /* Integer value */
         double float_val;       /* Float value */
     };
 };
+#endif
+
+#define JSON_PAYLOAD_MAX ((1ULL << JSON_PAYLOAD_BITS) - 1)
+
+/* Arena block (arena.c). Blocks are chained newest first and never move,
+ * so pointers into them stay valid for the lifetime of the document. */
+struct arena_block {
+    struct arena_block *prev;   /* Previously filled block */
+    size_t size;                /* Data capacity in bytes */
+    size_t used;                /* Data bytes used (set when retired) */
+};
+
+/* Input buffer owned by a document or stream (file.c) */
+struct owned_input {
+    void *data;                 /* Buffer or file mapping, NULL if none */
+    size_t len;                 /* JSON bytes */
+    size_t size;                /* Allocated size, including padding */
+    bool mapped;                /* data is a file mapping, not malloc'd */
+};
+
+/* Element runs that mutation allocated with spare capacity (mutate.c):
+ * an open-addressed table keyed by the run's first element */
+struct array_run {
+    struct json_val *elems;     /* NULL if empty */
+    size_t capacity;            /* Elements that fit in the run */
+};
+
+struct array_runs {
+    struct array_run *slots;
+    size_t mask;                /* Slot count - 1 */
+    size_t count;
+};
+
+/* Strings interned by a JSON_PARSE_INTERN parse (intern.c): an
+ * open-addressed table of the copies in the document's string pool */
+struct intern_slot {
+    const char *str;            /* NULL if empty */
+    size_t len;
+    uint64_t hash;              /* key_hash() of str */
+};
+
+struct intern_table {
+    struct intern_slot *slots;
+    size_t mask;                /* Slot count - 1 */
+    size_t count;
+};
+
+/* Zeroed bytes kept after owned input buffers so SIMD kernels may over-read */
+#define JSON_INPUT_PADDING 64
+
+/* Statistics builds (STATS=1) count events as they happen; STATS() drops
+ * its statement from other builds */
+#ifdef JSON_ASM_STATS
+#define STATS(stmt) do { stmt; } while (0)
+
+/* Running counts of a document, diffed around each parse (stats.c) */
+struct doc_stats {
+    uint64_t arena_grows;
+    uint64_t strings_grows;
+    uint64_t bytes_copied;
+    uint64_t scan_ns;
+};
+#else
+#define STATS(stmt) ((void)0)
+#endif
 
 /* Document structure */
 struct json_doc {
-    uint8_t *arena;             /* Node arena (64-byte aligned) */
-    size_t arena_size;          /* Arena capacity */
-    size_t arena_used;          /* Arena bytes used */
-    uint8_t *strings;           /* Long string storage */
-    size_t strings_size;        /* String storage capacity */
-    size_t strings_used;        /* String storage used */
+    struct arena_block *arena;  /* Current node block (64-byte aligned data) */
+    uint8_t *arena_ptr;         /* Next free node byte */
+    uint8_t *arena_end;         /* End of current node block */
+    size_t arena_size;          /* Node capacity across all blocks */
+    struct arena_block *strings; /* Current long string block */
+    uint8_t *strings_ptr;       /* Next free string byte */
+    uint8_t *strings_end;       /* End of current string block */
+    size_t strings_size;        /* String capacity across all blocks */
     struct json_val *root;      /* Root value */
     size_t value_count;         /* Number of values */
     uint32_t cpu_features;      /* Detected CPU features */
+    struct json_parser *owner;  /* Parser that reuses this document, if any */
+    struct doc_home *home;      /* Batch worker cache it returns to, if any */
+    struct owned_input input;   /* Input kept alive for borrowed strings */
+    struct key_index *key_indexes; /* Key indexes of wide objects */
+    size_t stringify_len;       /* Length of the last json_doc_stringify() */
+    struct array_runs array_runs; /* Arrays grown by json_arr_push() and co. */
+    struct intern_table interned; /* Shared strings, while JSON_PARSE_INTERN adds them */
+    bool mutated;               /* value_count is stale; count the tree */
+    bool readonly;              /* Values live in a read-only tape mapping */
+#ifdef JSON_ASM_STATS
+    struct doc_stats stats;
+#endif
+#ifdef JSON_COMPACT_NODES
+    uintptr_t nodes_lo;         /* Span of the node blocks, which next */
+    uintptr_t nodes_hi;         /* offsets must be able to cross */
+#endif
 };
 
 /* ============================================================================
@@ -75,14 +194,58 @@ static inline void val_set_type(struct json_val *v, json_type t) {
 }
 
 static inline uint64_t val_get_payload(const struct json_val *v) {
-    return v->tag_payload >> JSON_PAYLOAD_SHIFT;
+    return (v->tag_payload >> JSON_PAYLOAD_SHIFT) & JSON_PAYLOAD_MAX;
 }
 
 static inline void val_set_payload(struct json_val *v, uint64_t p) {
-    v->tag_payload = (v->tag_payload & JSON_TAG_MASK) | (p << JSON_PAYLOAD_SHIFT);
+    uint64_t field = JSON_PAYLOAD_MAX << JSON_PAYLOAD_SHIFT;
+    v->tag_payload = (v->tag_payload & ~field) | ((p << JSON_PAYLOAD_SHIFT) & field);
+}
+
+/* Make v a value of type t with an empty payload, keeping its sibling */
+static inline void val_reset(struct json_val *v, json_type t) {
+#ifdef JSON_COMPACT_NODES
+    v->tag_payload = (v->tag_payload & ~0xFFFFFFFFULL) | (uint64_t)t;
+#else
+    v->tag_payload = (uint64_t)t;
+#endif
+    v->child = NULL;
+}
+
+/* Copy the value of src over dst, keeping dst's place on its sibling chain */
+static inline void val_copy_value(struct json_val *dst, const struct json_val *src) {
+#ifdef JSON_COMPACT_NODES
+    dst->tag_payload = (dst->tag_payload & ~0xFFFFFFFFULL) | (src->tag_payload & 0xFFFFFFFFULL);
+#else
+    dst->tag_payload = src->tag_payload;
+#endif
+    dst->child = src->child;
+}
+
+static inline struct json_val *val_next(const struct json_val *v) {
+#ifdef JSON_COMPACT_NODES
+    int32_t off = (int32_t)(uint32_t)(v->tag_payload >> JSON_NEXT_SHIFT);
+    if (off == 0) return NULL;
+    return (struct json_val *)((uintptr_t)v + (uintptr_t)((intptr_t)off * (intptr_t)sizeof(struct json_val)));
+#else
+    return v->next;
+#endif
+}
+
+static inline void val_set_next(struct json_val *v, const struct json_val *next) {
+#ifdef JSON_COMPACT_NODES
+    uint64_t off = 0;
+    if (next) {
+        intptr_t d = ((intptr_t)(uintptr_t)next - (intptr_t)(uintptr_t)v) / (intptr_t)sizeof(struct json_val);
+        off = (uint32_t)(int32_t)d;
+    }
+    v->tag_payload = (v->tag_payload & 0xFFFFFFFFULL) | (off << JSON_NEXT_SHIFT);
+#else
+    v->next = (struct json_val *)next;
+#endif
 }
 
-/* Short string: type 6, payload contains length (3 bits) + chars (up to 7 bytes) */
+/* Short string: type 6, payload holds the length; the bytes are inline */
 #define JSON_STRING_SHORT  6
 #define JSON_STRING_LONG   7
 #define JSON_SHORT_STR_MAX 7
@@ -96,7 +259,55 @@ static inline size_t val_short_str_len(const struct json_val *v) {
 }
 
 static inline const char *val_short_str_ptr(const struct json_val *v) {
-    return ((const char *)&v->tag_payload) + 1;
+    return v->short_str;
+}
+
+/* Store len <= JSON_SHORT_STR_MAX bytes inline; always NUL-terminated */
+static inline void val_set_short_str(struct json_val *v, const char *str, size_t len) {
+    char bytes[sizeof(v->short_str)] = {0};
+    memcpy(bytes, str, len);
+    val_reset(v, (json_type)JSON_STRING_SHORT);
+    val_set_payload(v, len);
+    memcpy(v->short_str, bytes, sizeof(bytes));
+}
+
+/* Long strings too long for the payload keep their pointer and length out
+ * of line (compact nodes only), with the payload at JSON_PAYLOAD_MAX */
+struct json_str_ext {
+    const char *ptr;
+    size_t len;
+};
+
+/* Bytes of a string node of either layout */
+static inline const char *val_str(const struct json_val *v, size_t *len) {
+    if (val_is_short_string(v)) {
+        *len = val_short_str_len(v);
+        return val_short_str_ptr(v);
+    }
+    *len = (size_t)val_get_payload(v);
+#ifdef JSON_COMPACT_NODES
+    if (*len == JSON_PAYLOAD_MAX) {
+        const struct json_str_ext *ext = (const struct json_str_ext *)v->str_ptr;
+        *len = ext->len;
+        return ext->ptr;
+    }
+#endif
+    return v->str_ptr;
+}
+
+/* Element count in an array's payload; a count too large for it is kept
+ * at JSON_PAYLOAD_MAX and found by walking the elements */
+static inline size_t val_arr_count(const struct json_val *arr) {
+    size_t count = (size_t)val_get_payload(arr);
+    if (count == JSON_PAYLOAD_MAX) {
+        count = 0;
+        for (const struct json_val *e = arr->child; e; e = val_next(e)) count++;
+    }
+    return count;
+}
+
+static inline void val_set_arr_count(struct json_val *arr, size_t count) {
+    val_set_payload(arr, count < JSON_PAYLOAD_MAX ? count : JSON_PAYLOAD_MAX);
 }
 
 /* ============================================================================
@@ -106,8 +317,157 @@ static inline const char *val_short_str_ptr(const struct json_val *v) {
 /* Arena functions (arena.c) */
 struct json_doc *arena_create(size_t initial_size);
 void arena_destroy(struct json_doc *doc);
-struct json_val *arena_alloc_val(struct json_doc *doc);
-char *arena_alloc_string(struct json_doc *doc, size_t len);
+void arena_reset(struct json_doc *doc);
+bool arena_adopt(struct json_doc *doc, struct json_doc *other);
+void *arena_alloc_raw(struct json_doc *doc, size_t size);
+struct json_val *arena_alloc_vals(struct json_doc *doc, size_t count);
+struct json_val *arena_alloc_val_slow(struct json_doc *doc);
+char *arena_alloc_string_slow(struct json_doc *doc, size_t len);
+
+/* Data area of a block with a header of the given size */
+static inline uint8_t *arena_block_data(struct arena_block *block, size_t header) {
+    return (uint8_t *)block + header;
+}
+
+/* Allocate a zeroed value node. Bumps a pointer in the current block and
+ * only calls into arena.c when a new block is needed. */
+static inline struct json_val *arena_alloc_val(struct json_doc *doc) {
+    if ((size_t)(doc->arena_end - doc->arena_ptr) < sizeof(struct json_val)) {
+        return arena_alloc_val_slow(doc);
+    }
+
+    struct json_val *val = (struct json_val *)doc->arena_ptr;
+    doc->arena_ptr += sizeof(struct json_val);
+    doc->value_count++;
+
+    memset(val, 0, sizeof(*val));
+    return val;
+}
+
+/* Allocate len + 1 bytes of string storage (room for the terminator) */
+static inline char *arena_alloc_string(struct json_doc *doc, size_t len) {
+    if ((size_t)(doc->strings_end - doc->strings_ptr) <= len) {
+        return arena_alloc_string_slow(doc, len);
+    }
+
+    char *str = (char *)doc->strings_ptr;
+    doc->strings_ptr += len + 1;
+    STATS(doc->stats.bytes_copied += len);
+    return str;
+}
+
+/* Make v a long string node for len bytes at str. Only compact nodes can
+ * need memory, for a length the payload cannot hold. */
+static inline bool val_set_long_str(struct json_doc *doc, struct json_val *v,
+                                    const char *str, size_t len) {
+    val_reset(v, (json_type)JSON_STRING_LONG);
+#ifdef JSON_COMPACT_NODES
+    if (len >= JSON_PAYLOAD_MAX) {
+        struct json_str_ext *ext = arena_alloc_raw(doc, sizeof(*ext));
+        if (!ext) return false;
+        ext->ptr = str;
+        ext->len = len;
+        str = (const char *)ext;
+        len = JSON_PAYLOAD_MAX;
+    }
+#else
+    (void)doc;
+#endif
+    val_set_payload(v, len);
+    v->str_ptr = str;
+    return true;
+}
+
+/* ============================================================================
+ * Object Key Index
+ * ============================================================================ */
+
+/* Objects with at least this many members get a hash index over their keys.
+ * It is built on the first lookup, or during the parse with
+ * JSON_PARSE_KEY_INDEX. Find it with val_key_index(). */
+#define KEY_INDEX_MIN_MEMBERS 32
+
+/* Open-addressed slot; the first of any duplicate keys is indexed */
+struct key_slot {
+    struct json_val *key;       /* NULL if empty */
+    uint64_t hash;
+};
+
+/* Lives in the node arena. The slot table is malloc'd when first needed and
+ * published with an atomic store, so concurrent readers may race to build it
+ * without a lock. */
+struct key_index {
+    struct key_index *next;     /* Next index of the same document */
+    size_t count;               /* Members, including duplicate keys */
+    size_t mask;                /* Slot count - 1 */
+    struct key_slot *slots;     /* NULL until built */
+    struct json_val *tail;      /* Last key, NULL until a mutation needs it */
+#ifdef JSON_COMPACT_NODES
+    struct json_val *child;     /* First key of the object */
+#endif
+};
+
+#ifdef JSON_COMPACT_NODES
+/* The payload has no room for a pointer, so an indexed object points at
+ * its key_index instead of its first key, and a payload of 1 says so */
+static inline struct key_index *val_key_index(const struct json_val *obj) {
+    return val_get_payload(obj) ? obj->key_index : NULL;
+}
+#else
+static inline struct key_index *val_key_index(const struct json_val *obj) {
+    return (struct key_index *)(uintptr_t)val_get_payload(obj);
+}
+#endif
+
+/* First element or key of a container */
+static inline struct json_val *val_child(const struct json_val *v) {
+#ifdef JSON_COMPACT_NODES
+    if (val_get_type(v) == JSON_OBJECT && val_get_payload(v)) return v->key_index->child;
+#endif
+    return v->child;
+}
+
+static inline void val_set_child(struct json_val *v, struct json_val *child) {
+#ifdef JSON_COMPACT_NODES
+    if (val_get_type(v) == JSON_OBJECT && val_get_payload(v)) {
+        v->key_index->child = child;
+        return;
+    }
+#endif
+    v->child = child;
+}
+
+/* Key hash, also for callers that hash a key once and look it up often */
+static inline uint64_t key_hash(const char *key, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    uint64_t w;
+    while (len >= 8) {
+        memcpy(&w, key, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        key += 8;
+        len -= 8;
+    }
+    if (len > 0) {
+        w = 0;
+        memcpy(&w, key, len);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+    }
+    h ^= h >> 29;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 32);
+}
+
+/* Key index functions (keyindex.c) */
+void key_index_attach(struct json_doc *doc, struct json_val *obj, size_t count,
+                      uint32_t flags);
+bool key_index_find(const struct json_val *obj, const char *key, size_t len,
+                    uint64_t hash, struct json_val **value);
+void key_index_release(struct json_doc *doc);
+size_t key_index_memory(const struct json_doc *doc);
+void key_index_append(struct json_val *obj, struct json_val *key);
+void key_index_remove(struct json_val *obj, struct json_val *key,
+                      struct json_val *prev_key);
 
 /* ============================================================================
  * CPU Feature Detection
@@ -123,6 +483,9 @@ uint32_t cpu_detect_features(void);
 /* String scanning - find quote, backslash, or control char */
 typedef size_t (*scan_string_fn)(const char *str, size_t len);
 
+/* Whitespace skipping - find first byte that is not space, tab, CR or LF */
+typedef size_t (*skip_whitespace_fn)(const char *str, size_t len);
+
 /* Structural char detection - find {}[]":, */
 typedef size_t (*find_structural_fn)(const char *str, size_t len, uint64_t *mask);
 
@@ -130,55 +493,121 @@ typedef size_t (*find_structural_fn)(const char *str, size_t len, uint64_t *mask
 typedef int64_t (*parse_int_fn)(const char *str, size_t len, size_t *consumed);
 typedef double (*parse_float_fn)(const char *str, size_t len, size_t *consumed);
 
+/* UTF-8 validation - len if valid, else an offset below len at most 3 bytes
+ * past the start of the first invalid sequence (utf8_error_offset() finds it) */
+typedef size_t (*validate_utf8_fn)(const char *str, size_t len);
+
 /* Operations table */
 struct json_ops {
     scan_string_fn scan_string;
+    skip_whitespace_fn skip_whitespace;
     find_structural_fn find_structural;
     parse_int_fn parse_int;
     parse_float_fn parse_float;
+    validate_utf8_fn validate_utf8;
 };
 
 /* Global ops (set during init) */
 extern struct json_ops g_json_ops;
 extern uint32_t g_cpu_features;
+extern json_simd_tier g_simd_tier;
 extern bool g_initialized;
 
 /* Implementation variants */
 #ifdef JSON_ARCH_X86_64
     /* AVX-512 */
     size_t scan_string_avx512(const char *str, size_t len);
+    size_t skip_whitespace_avx512(const char *str, size_t len);
     size_t find_structural_avx512(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_avx512(const char *str, size_t len, size_t *consumed);
     /* AVX2 */
     size_t scan_string_avx2(const char *str, size_t len);
+    size_t skip_whitespace_avx2(const char *str, size_t len);
     size_t find_structural_avx2(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_avx2(const char *str, size_t len, size_t *consumed);
+    size_t validate_utf8_avx2(const char *str, size_t len);
     /* SSE4.2 */
     size_t scan_string_sse42(const char *str, size_t len);
+    size_t skip_whitespace_sse42(const char *str, size_t len);
     size_t find_structural_sse42(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_sse42(const char *str, size_t len, size_t *consumed);
+    size_t validate_utf8_sse42(const char *str, size_t len);
 #endif
 
 #ifdef JSON_ARCH_ARM64
     /* SVE2 */
     size_t scan_string_sve2(const char *str, size_t len);
+    size_t skip_whitespace_sve2(const char *str, size_t len);
     size_t find_structural_sve2(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_sve2(const char *str, size_t len, size_t *consumed);
     /* SVE */
     size_t scan_string_sve(const char *str, size_t len);
+    size_t skip_whitespace_sve(const char *str, size_t len);
     size_t find_structural_sve(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_sve(const char *str, size_t len, size_t *consumed);
     /* NEON */
     size_t scan_string_neon(const char *str, size_t len);
+    size_t skip_whitespace_neon(const char *str, size_t len);
     size_t find_structural_neon(const char *str, size_t len, uint64_t *mask);
     int64_t parse_int_neon(const char *str, size_t len, size_t *consumed);
+    size_t validate_utf8_neon(const char *str, size_t len);
 #endif
 
 /* Scalar fallback */
 size_t scan_string_scalar(const char *str, size_t len);
+size_t skip_whitespace_scalar(const char *str, size_t len);
 size_t find_structural_scalar(const char *str, size_t len, uint64_t *mask);
 int64_t parse_int_scalar(const char *str, size_t len, size_t *consumed);
 double parse_float_scalar(const char *str, size_t len, size_t *consumed);
+size_t validate_utf8_scalar(const char *str, size_t len);
+
+/* Exact offset of the first invalid UTF-8 sequence from a validate_utf8 result */
+size_t utf8_error_offset(const char *str, size_t len, size_t hint);
+
+/* SWAR helpers for the scalar kernels: eight bytes in a little-endian word */
+#define SWAR_LOW7  0x7F7F7F7F7F7F7F7FULL
+#define SWAR_ONES  0x0101010101010101ULL
+
+/* High bit set in each byte of x that equals c (exact, no false positives) */
+static inline uint64_t swar_eq(uint64_t x, unsigned char c) {
+    uint64_t y = x ^ (SWAR_ONES * c);
+    uint64_t t = (y & SWAR_LOW7) + SWAR_LOW7;
+    return ~(t | y | SWAR_LOW7);
+}
+
+/* High bit set in each byte of x below c, for c <= 0x80 (exact) */
+static inline uint64_t swar_lt(uint64_t x, unsigned char c) {
+    uint64_t t = (x & SWAR_LOW7) + SWAR_ONES * (uint64_t)(0x80 - c);
+    return ~(t | x | SWAR_LOW7);
+}
+
+/* Index of the first byte flagged in a nonzero swar_* result */
+static inline size_t swar_first(uint64_t hi) {
+    return (size_t)__builtin_ctzll(hi) >> 3;
+}
+
+/* Gather the high bit of each byte into an 8-bit mask */
+static inline uint64_t swar_movemask(uint64_t hi) {
+    return ((hi >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/* ============================================================================
+ * Number Conversion (number.c)
+ * ============================================================================ */
+
+/* Buffer size that fits any number_format_int/number_format_double output */
+#define NUMBER_BUF_SIZE 32
+
+/* mantissa * 10^exp10, correctly rounded. truncated means nonzero digits were
+ * dropped after the mantissa. Fails when the fast algorithms cannot decide;
+ * parse_float_scalar() handles those. */
+bool number_from_decimal(uint64_t mantissa, int64_t exp10, bool negative,
+                         bool truncated, double *out);
+
+/* Decimal text, not NUL-terminated; returns the length. Doubles must be
+ * finite and get the shortest form that reads back as the same value. */
+size_t number_format_int(int64_t v, char *buf);
+size_t number_format_double(double d, char *buf);
 
 /* ============================================================================
  * Parser State Machine
@@ -216,9 +645,385 @@ struct parse_state {
     char error_msg[256];        /* Error message */
 };
 
+/* Structural index (structural.c): offsets of structural characters outside
+ * strings, plus opening quotes. offsets[count] holds the input length. */
+struct structural_index {
+    uint32_t *offsets;
+    size_t count;
+    size_t capacity;
+};
+
+bool structural_index_build(struct structural_index *idx,
+                            const char *json, size_t len);
+uint64_t structural_block(const char *json, size_t len, size_t base,
+                          uint64_t *in_string);
+/* Bytes inside strings of a 64-byte block already in memory, n of them
+ * input. Carries the string state and a pending backslash between calls,
+ * so it never reads before the block (safe for in-place rewriting). */
+uint64_t structural_strings(const char *block, size_t n, uint64_t *in_string,
+                            bool *escaped);
+void structural_index_free(struct structural_index *idx);
+
+/* Bracket depth change over a chunk for either string state at its start,
+ * and whether the chunk leaves the string state flipped (parallel parse) */
+struct chunk_summary {
+    int64_t depth_delta[2];
+    bool flips_string;
+};
+
+void structural_chunk_summary(const char *json, size_t end, size_t start,
+                              struct chunk_summary *out);
+
+/* First ',' directly inside the root at or after start (64-byte aligned),
+ * given the string state and bracket depth there; len if there is none */
+size_t structural_find_split(const char *json, size_t len, size_t start,
+                             bool in_string, int64_t depth);
+
+/* Offset of the bracket closing the one at open (given outside a string);
+ * len if it is never closed */
+size_t structural_skip(const char *json, size_t len, size_t open);
+
 /* Parse functions (parse.c) */
 struct json_doc *parse_json(const char *json, size_t len,
                             const json_parse_options *opts);
+bool parse_json_into(struct json_doc *doc, const char *json, size_t len,
+                     const json_parse_options *opts,
+                     struct structural_index *index);
+size_t parse_arena_estimate(size_t len);
+struct json_val *parse_token(struct json_doc *doc, const char *tok, size_t len,
+                             uint32_t flags, size_t *consumed);
+bool parse_segment(struct json_doc *doc, const char *json, size_t len,
+                   size_t start, size_t end, bool object, bool last,
+                   const json_parse_options *opts, struct json_val **first,
+                   struct json_val **tail, size_t *count);
+void input_error(const char *input, size_t len, size_t pos, json_error code,
+                 const char *msg);
+
+/* The checks of parse_json() with no document (parse.c): of a whole
+ * input, or of the one value at pos, ending at *end */
+bool validate_json(const char *json, size_t len, const json_parse_options *opts);
+bool validate_value_at(const char *json, size_t len, size_t pos, size_t *end);
+
+/* Whitespace and, with JSON_PARSE_ALLOW_COMMENTS, comment removal
+ * (minify.c); out may equal json */
+size_t minify_json(const char *json, size_t len, char *out, uint32_t flags);
+
+/* Single values for the cursor (cursor.c), with no document: the literal or
+ * number at pos into val, or the string whose opening quote is at pos
+ * decoded into buf when its length (always set) is below buf_len; end,
+ * if not NULL, gets the offset past the value */
+bool parse_scalar_at(const char *json, size_t len, size_t pos,
+                     struct json_val *val, size_t *end);
+bool parse_string_at(const char *json, size_t len, size_t pos,
+                     char *buf, size_t buf_len, size_t *out_len, size_t *end);
+
+/* The value at pos (any type) parsed into val, its members into doc */
+bool parse_value_at(struct json_doc *doc, const char *json, size_t len,
+                    size_t pos, struct json_val *val, size_t *end);
+
+/* Multi-threaded parse of large documents (parallel.c) */
+bool parallel_eligible(const char *json, size_t len,
+                       const json_parse_options *opts);
+bool parse_parallel(struct json_doc *doc, const char *json, size_t len,
+                    const json_parse_options *opts);
+
+/* Many documents on the worker pool (batch.c); returns the failures */
+size_t parse_batch(const char *const *inputs, const size_t *lens, size_t n,
+                   const json_parse_options *opts, struct json_doc **docs,
+                   json_error_info *errors);
+void batch_configure(uint32_t threads, const int *cpus, size_t cpu_count);
+void batch_shutdown(void);
+
+/* Run task(arg, i) for every i < n on the worker pool, the caller included.
+ * Returns false, having run nothing, if the pool has no workers or another
+ * thread's batch holds it. */
+bool batch_run_tasks(void (*task)(void *arg, size_t i), void *arg, size_t n);
+
+/* Binary tape (tape.c) */
+bool tape_save(struct json_val *root, const char *path);
+struct json_doc *tape_open(const char *path);
+
+/* File input (file.c) */
+bool input_load_file(struct owned_input *in, const char *path, uint32_t flags);
+void input_release(struct owned_input *in);
+struct json_doc *parse_file(const char *path, const json_parse_options *opts);
+
+/* ============================================================================
+ * Document Pool and Reusable Parser
+ * ============================================================================ */
+
+/* Reusable parser: keeps one document and the stage 1 index between parses */
+struct json_parser {
+    struct json_doc *doc;
+    struct structural_index index;
+    json_parse_options opts;
+    struct feed_state *feed;    /* Push parser state, allocated on first feed */
+};
+
+/* Pool functions (pool.c) */
+struct json_doc *doc_pool_get(void);
+bool doc_pool_put(struct json_doc *doc);
+void doc_release(struct json_doc *doc);
+void doc_pool_clear(void);
+
+#if !defined(_WIN32)
+#define DOC_HOME_SIZE       1024                /* Documents kept per worker */
+
+/* Documents of one batch worker. They are freed on the caller's thread,
+ * so they come back here under lock rather than to that thread's pool. */
+struct doc_home {
+    pthread_mutex_t lock;
+    bool ready;                 /* lock initialised */
+    bool open;                  /* Worker running; closed homes free instead */
+    size_t count;
+    size_t bytes;
+    struct json_doc *docs[DOC_HOME_SIZE];
+};
+
+void doc_home_open(struct doc_home *home);
+void doc_home_close(struct doc_home *home);
+struct json_doc *doc_home_get(struct doc_home *home);
+#endif
+
+struct json_parser *parser_create(const json_parse_options *opts);
+struct json_doc *parser_parse(struct json_parser *parser,
+                              const char *json, size_t len);
+void parser_destroy(struct json_parser *parser);
+
+/* Push parser (feed.c) */
+struct feed_state;
+json_error feed_chunk(struct json_parser *parser, const char *chunk, size_t len);
+struct json_doc *feed_finish(struct json_parser *parser);
+void feed_cancel(struct feed_state *st);
+void feed_destroy(struct feed_state *st);
+
+/* Streaming parser over many concatenated records (stream.c) */
+struct json_stream {
+    struct json_parser *parser; /* Reused document and stage 1 index */
+    struct owned_input input;   /* Mapped file when opened by path */
+    const char *json;
+    size_t len;
+    size_t pos;                 /* Start of the next record */
+    size_t block_base;          /* Offset of the current scan block */
+    uint64_t block_bits;        /* Unconsumed structural bits of that block */
+    uint64_t in_string;         /* String state at the end of that block */
+    bool block_valid;           /* block_* describe a scanned block */
+};
+
+struct json_stream *stream_create(const char *json, size_t len,
+                                  const json_parse_options *opts);
+struct json_stream *stream_open_file(const char *path,
+                                     const json_parse_options *opts);
+struct json_doc *stream_next(struct json_stream *stream);
+void stream_destroy(struct json_stream *stream);
+
+/* ============================================================================
+ * String Interning (intern.c)
+ * ============================================================================ */
+
+#define INTERN_MAX_LEN 64       /* Longer strings are rarely repeated */
+
+/* The copy of str in doc's string pool, made on first use; NULL when out
+ * of memory */
+const char *intern_string(struct json_doc *doc, const char *str, size_t len);
+void intern_release(struct json_doc *doc);
+size_t intern_memory(const struct json_doc *doc);
+
+/* ============================================================================
+ * Tree Walk (walk.c)
+ *
+ * Depth first over a tree without recursion, so any tree the parser builds
+ * can be walked, however deep. Each container is reported when it opens
+ * and again when it closes, with its members in between. The frames of the
+ * open containers start inline and move to the heap.
+ * ============================================================================ */
+
+enum walk_event {
+    WALK_VALUE,                 /* A scalar */
+    WALK_OPEN,                  /* An array or object, before its members */
+    WALK_CLOSE,                 /* The same container, after them */
+    WALK_END,
+    WALK_ERROR                  /* Out of memory for frames */
+};
+
+/* One open container */
+struct walk_frame {
+    const struct json_val *container;
+    const struct json_val *next;    /* Next element, or key of the next member */
+    const struct json_val *key;     /* The container's own key, in an object */
+    uint64_t acc;                   /* For the caller, zero on WALK_OPEN */
+    bool object;
+};
+
+#define WALK_FRAMES_INLINE 32
+
+struct tree_walk {
+    const struct json_val *val;     /* The value just reported */
+    const struct json_val *key;     /* Its key, if it is an object member */
+    const struct json_val *root;    /* Not yet reported */
+    struct walk_frame *frames;
+    size_t depth;                   /* Containers open, val's own included on WALK_OPEN */
+    size_t cap;
+    struct walk_frame inline_frames[WALK_FRAMES_INLINE];
+};
+
+bool tree_walk_grow(struct tree_walk *w);
+
+static inline void tree_walk_init(struct tree_walk *w, const struct json_val *root) {
+    w->root = root;
+    w->frames = w->inline_frames;
+    w->depth = 0;
+    w->cap = WALK_FRAMES_INLINE;
+}
+
+static inline void tree_walk_free(struct tree_walk *w) {
+    if (w->frames != w->inline_frames) free(w->frames);
+}
+
+static inline enum walk_event tree_walk_next(struct tree_walk *w) {
+    const struct json_val *val;
+    const struct json_val *key = NULL;
+
+    if (w->root) {
+        val = w->root;
+        w->root = NULL;
+    } else {
+        if (w->depth == 0) return WALK_END;
+        struct walk_frame *f = &w->frames[w->depth - 1];
+        if (!f->next) {
+            w->depth--;
+            w->val = f->container;
+            w->key = f->key;
+            return WALK_CLOSE;
+        }
+        if (f->object) {
+            key = f->next;
+            val = val_next(key);
+        } else {
+            val = f->next;
+        }
+        f->next = val_next(val);
+    }
+
+    w->val = val;
+    w->key = key;
+
+    json_type t = val_get_type(val);
+    if (t != JSON_ARRAY && t != JSON_OBJECT) return WALK_VALUE;
+
+    if (w->depth == w->cap && !tree_walk_grow(w)) return WALK_ERROR;
+    struct walk_frame *f = &w->frames[w->depth++];
+    f->container = val;
+    f->next = t == JSON_ARRAY ? val->child : val_child(val);
+    f->key = key;
+    f->acc = 0;
+    f->object = t == JSON_OBJECT;
+    return WALK_OPEN;
+}
+
+/* ============================================================================
+ * Mutation (mutate.c)
+ * ============================================================================ */
+
+/* Mutators copy the value node they are given into the container and set
+ * doc->mutated */
+size_t mut_tree_count(const struct json_val *val);
+void mut_store_int(struct json_val *val, int64_t v);
+bool mut_store_string(struct json_doc *doc, struct json_val *val,
+                      const char *str, size_t len);
+struct json_val *mut_obj_set(struct json_doc *doc, struct json_val *obj,
+                             const char *key, size_t len,
+                             const struct json_val *val);
+bool mut_obj_remove(struct json_doc *doc, struct json_val *obj,
+                    const char *key, size_t len);
+struct json_val *mut_arr_insert(struct json_doc *doc, struct json_val *arr,
+                                size_t index, const struct json_val *val);
+bool mut_arr_remove(struct json_doc *doc, struct json_val *arr, size_t index);
+void array_runs_release(struct json_doc *doc);
+size_t array_runs_memory(const struct json_doc *doc);
+
+/* ============================================================================
+ * Statistics (stats.c)
+ * ============================================================================ */
+
+#ifdef JSON_ASM_STATS
+uint64_t stats_now(void);
+/* Account a successful parse of len bytes that began at start, given doc's
+ * counts before it; out, if not NULL, gets this parse alone */
+void stats_parse_done(const struct json_doc *doc, size_t len,
+                      const struct doc_stats *before, uint64_t start, json_stats *out);
+void stats_stringify_done(size_t len, uint64_t start, json_stats *out);
+#endif
+bool stats_get(json_stats *out);
+void stats_reset(void);
+
+/* ============================================================================
+ * Clone, Equality and Hashing (clone.c)
+ * ============================================================================ */
+
+/* A copy of the tree at val in a new document, with its own strings */
+struct json_doc *clone_tree(const struct json_val *val);
+bool values_equal(const struct json_val *a, const struct json_val *b);
+uint64_t value_hash(const struct json_val *val);
+
+/* ============================================================================
+ * On-Demand Cursor (cursor.c)
+ * ============================================================================ */
+
+bool cursor_init(json_cursor *cur, const char *json, size_t len);
+bool cursor_child(const json_cursor *container, json_cursor *out);
+bool cursor_next(json_cursor *cur);
+bool cursor_find(const json_cursor *obj, const char *key, size_t len, json_cursor *out);
+bool cursor_scalar(const json_cursor *cur, struct json_val *val);
+json_type cursor_type(const json_cursor *cur);
+size_t cursor_string(const json_cursor *cur, size_t pos, char *buf, size_t buf_len);
+const char *cursor_raw(const json_cursor *cur, size_t *len);
+
+/* ============================================================================
+ * JSON Pointer Queries (path.c)
+ * ============================================================================ */
+
+struct json_path *path_compile(const char *pointer, size_t len);
+/* Matches under root; the first max go to out. Unless all, the walk stops
+ * at the first. */
+size_t path_eval(const struct json_path *path, struct json_val *root,
+                 struct json_val **out, size_t max, bool all);
+struct json_doc *path_parse(const struct json_path *path, const char *json, size_t len);
+
+/* ============================================================================
+ * Schemas
+ * ============================================================================ */
+
+#define SCHEMA_KEY_MAX      255         /* Longest key a schema may have */
+#define SCHEMA_MAX_FIELDS   UINT16_MAX  /* Slots hold a field number */
+
+struct schema_field {
+    const char *key;
+    size_t key_len;
+    const char *quoted;         /* "key": as written, NULL if it needs escapes */
+    size_t quoted_len;
+    json_field_type type;
+    size_t offset;
+    size_t size;
+    const struct json_schema *schema;
+};
+
+/* One allocation: the fields, the slot table, then the key bytes */
+struct json_schema {
+    size_t count;
+    uint64_t seed;              /* Perfect hash multiplier */
+    unsigned shift;             /* 64 - log2(slot count) */
+    bool full_hash;             /* Slots hash whole keys with key_hash() */
+    uint16_t *slots;            /* Field number + 1, or 0 */
+    struct schema_field fields[];
+};
+
+/* Schema functions (schema.c; the encoder is in stringify.c) */
+struct json_schema *schema_compile(const json_field *fields, size_t count);
+bool schema_decode(const struct json_schema *s, const char *json, size_t len, void *out);
+char *schema_encode(const struct json_schema *s, const void *in, size_t *len);
+size_t schema_encode_into(const struct json_schema *s, const void *in,
+                          char *buf, size_t buf_len);
 
 /* ============================================================================
  * Stringify
@@ -232,7 +1037,13 @@ struct stringify_buf {
 };
 
 /* Stringify functions (stringify.c) */
-char *stringify_value(struct json_val *val, const json_stringify_options *opts);
+char *stringify_value(struct json_val *val, const json_stringify_options *opts,
+                      size_t size_hint, size_t *len);
+size_t stringify_size(struct json_val *val, const json_stringify_options *opts);
+size_t stringify_into(struct json_val *val, const json_stringify_options *opts,
+                      char *buf, size_t buf_len);
+bool stringify_write(struct json_val *val, const json_stringify_options *opts,
+                     json_write_fn write, void *user_data, int fd);
 
 /* ============================================================================
  * Error Handling
@@ -11,6 +11,7 @@
 
 struct json_ops g_json_ops;
 uint32_t g_cpu_features = 0;
+json_simd_tier g_simd_tier = JSON_SIMD_SCALAR;
 bool g_initialized = false;
 _Thread_local json_error_info g_last_error = {0};
 
@@ -18,62 +19,196 @@ _Thread_local json_error_info g_last_error = {0};
  * Initialization
  * ============================================================================ */
 
-JSON_API void json_init(void) {
-    if (g_initialized) return;
+/* Build-time cap on the SIMD tier (make MAX_SIMD=...) */
+#if defined(MAX_SIMD_scalar) || defined(MAX_SIMD_SCALAR)
+    #define JSON_MAX_SIMD_TIER JSON_SIMD_SCALAR
+#elif defined(MAX_SIMD_sse42) || defined(MAX_SIMD_SSE42)
+    #define JSON_MAX_SIMD_TIER JSON_SIMD_SSE42
+#elif defined(MAX_SIMD_avx2) || defined(MAX_SIMD_AVX2)
+    #define JSON_MAX_SIMD_TIER JSON_SIMD_AVX2
+#elif defined(MAX_SIMD_neon) || defined(MAX_SIMD_NEON)
+    #define JSON_MAX_SIMD_TIER JSON_SIMD_NEON
+#elif defined(MAX_SIMD_sve) || defined(MAX_SIMD_SVE)
+    #define JSON_MAX_SIMD_TIER JSON_SIMD_SVE
+#endif
 
-    g_cpu_features = cpu_detect_features();
+static const char *const simd_tier_names[] = {
+    [JSON_SIMD_AUTO]   = "auto",
+    [JSON_SIMD_SCALAR] = "scalar",
+    [JSON_SIMD_SSE42]  = "sse42",
+    [JSON_SIMD_AVX2]   = "avx2",
+    [JSON_SIMD_AVX512] = "avx512",
+    [JSON_SIMD_NEON]   = "neon",
+    [JSON_SIMD_SVE]    = "sve",
+    [JSON_SIMD_SVE2]   = "sve2"
+};
+
+/* Check whether a tier is compiled in and supported by the CPU */
+static bool simd_tier_supported(json_simd_tier tier) {
+    if (tier == JSON_SIMD_SCALAR) return true;
+#ifdef JSON_MAX_SIMD_TIER
+    if (tier > JSON_MAX_SIMD_TIER) return false;
+#endif
 
-    /* Select best implementation based on CPU features */
 #if defined(USE_SCALAR_ONLY)
-    /* Scalar-only build (no NASM or unknown architecture) */
-    g_json_ops.scan_string = scan_string_scalar;
-    g_json_ops.find_structural = find_structural_scalar;
-    g_json_ops.parse_int = parse_int_scalar;
+    return false;
 #elif defined(JSON_ARCH_X86_64)
+    switch (tier) {
+        case JSON_SIMD_SSE42:
+            return true;
+        case JSON_SIMD_AVX2:
+            return (g_cpu_features & JSON_CPU_AVX2) != 0;
     #ifndef NO_AVX512
-    if ((g_cpu_features & (JSON_CPU_AVX512F | JSON_CPU_AVX512BW)) ==
-        (JSON_CPU_AVX512F | JSON_CPU_AVX512BW)) {
-        g_json_ops.scan_string = scan_string_avx512;
-        g_json_ops.find_structural = find_structural_avx512;
-        g_json_ops.parse_int = parse_int_avx512;
-    } else
+        case JSON_SIMD_AVX512:
+            return (g_cpu_features & (JSON_CPU_AVX512F | JSON_CPU_AVX512BW)) ==
+                   (JSON_CPU_AVX512F | JSON_CPU_AVX512BW);
     #endif
-    if (g_cpu_features & JSON_CPU_AVX2) {
-        g_json_ops.scan_string = scan_string_avx2;
-        g_json_ops.find_structural = find_structural_avx2;
-        g_json_ops.parse_int = parse_int_avx2;
-    } else {
-        g_json_ops.scan_string = scan_string_sse42;
-        g_json_ops.find_structural = find_structural_sse42;
-        g_json_ops.parse_int = parse_int_sse42;
+        default:
+            return false;
     }
 #elif defined(JSON_ARCH_ARM64)
+    switch (tier) {
+        case JSON_SIMD_NEON:
+            return true;
     #ifndef NO_SVE
-    if (g_cpu_features & JSON_CPU_SVE2) {
-        g_json_ops.scan_string = scan_string_sve2;
-        g_json_ops.find_structural = find_structural_sve2;
-        g_json_ops.parse_int = parse_int_sve2;
-    } else if (g_cpu_features & JSON_CPU_SVE) {
-        g_json_ops.scan_string = scan_string_sve;
-        g_json_ops.find_structural = find_structural_sve;
-        g_json_ops.parse_int = parse_int_sve;
-    } else
+        case JSON_SIMD_SVE:
+            return (g_cpu_features & JSON_CPU_SVE) != 0;
+        case JSON_SIMD_SVE2:
+            return (g_cpu_features & JSON_CPU_SVE2) != 0;
     #endif
-    {
-        g_json_ops.scan_string = scan_string_neon;
-        g_json_ops.find_structural = find_structural_neon;
-        g_json_ops.parse_int = parse_int_neon;
+        default:
+            return false;
     }
 #else
-    g_json_ops.scan_string = scan_string_scalar;
-    g_json_ops.find_structural = find_structural_scalar;
-    g_json_ops.parse_int = parse_int_scalar;
+    return false;
+#endif
+}
+
+/* Best supported tier, highest first */
+static json_simd_tier simd_tier_best(void) {
+    static const json_simd_tier order[] = {
+        JSON_SIMD_AVX512, JSON_SIMD_AVX2, JSON_SIMD_SSE42,
+        JSON_SIMD_SVE2, JSON_SIMD_SVE, JSON_SIMD_NEON
+    };
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        if (simd_tier_supported(order[i])) return order[i];
+    }
+    return JSON_SIMD_SCALAR;
+}
+
+/* Fill g_json_ops for a supported tier */
+static void simd_tier_install(json_simd_tier tier) {
+    switch (tier) {
+#if !defined(USE_SCALAR_ONLY) && defined(JSON_ARCH_X86_64)
+    #ifndef NO_AVX512
+        case JSON_SIMD_AVX512:
+            g_json_ops.scan_string = scan_string_avx512;
+            g_json_ops.skip_whitespace = skip_whitespace_avx512;
+            g_json_ops.find_structural = find_structural_avx512;
+            g_json_ops.parse_int = parse_int_avx512;
+            g_json_ops.validate_utf8 = validate_utf8_avx2;
+            break;
+    #endif
+        case JSON_SIMD_AVX2:
+            g_json_ops.scan_string = scan_string_avx2;
+            g_json_ops.skip_whitespace = skip_whitespace_avx2;
+            g_json_ops.find_structural = find_structural_avx2;
+            g_json_ops.parse_int = parse_int_avx2;
+            g_json_ops.validate_utf8 = validate_utf8_avx2;
+            break;
+        case JSON_SIMD_SSE42:
+            g_json_ops.scan_string = scan_string_sse42;
+            g_json_ops.skip_whitespace = skip_whitespace_sse42;
+            g_json_ops.find_structural = find_structural_sse42;
+            g_json_ops.parse_int = parse_int_sse42;
+            g_json_ops.validate_utf8 = validate_utf8_sse42;
+            break;
+#elif !defined(USE_SCALAR_ONLY) && defined(JSON_ARCH_ARM64)
+    #ifndef NO_SVE
+        case JSON_SIMD_SVE2:
+            g_json_ops.scan_string = scan_string_sve2;
+            g_json_ops.skip_whitespace = skip_whitespace_sve2;
+            g_json_ops.find_structural = find_structural_sve2;
+            g_json_ops.parse_int = parse_int_sve2;
+            g_json_ops.validate_utf8 = validate_utf8_neon;
+            break;
+        case JSON_SIMD_SVE:
+            g_json_ops.scan_string = scan_string_sve;
+            g_json_ops.skip_whitespace = skip_whitespace_sve;
+            g_json_ops.find_structural = find_structural_sve;
+            g_json_ops.parse_int = parse_int_sve;
+            g_json_ops.validate_utf8 = validate_utf8_neon;
+            break;
+    #endif
+        case JSON_SIMD_NEON:
+            g_json_ops.scan_string = scan_string_neon;
+            g_json_ops.skip_whitespace = skip_whitespace_neon;
+            g_json_ops.find_structural = find_structural_neon;
+            g_json_ops.parse_int = parse_int_neon;
+            g_json_ops.validate_utf8 = validate_utf8_neon;
+            break;
 #endif
+        default:
+            tier = JSON_SIMD_SCALAR;
+            g_json_ops.scan_string = scan_string_scalar;
+            g_json_ops.skip_whitespace = skip_whitespace_scalar;
+            g_json_ops.find_structural = find_structural_scalar;
+            g_json_ops.parse_int = parse_int_scalar;
+            g_json_ops.validate_utf8 = validate_utf8_scalar;
+            break;
+    }
 
     g_json_ops.parse_float = parse_float_scalar;
+    g_simd_tier = tier;
+}
+
+/* Parse a tier name as accepted by JSON_ASM_SIMD */
+static json_simd_tier simd_tier_from_name(const char *name) {
+    for (size_t i = 0; i < sizeof(simd_tier_names) / sizeof(simd_tier_names[0]); i++) {
+        if (strcmp(name, simd_tier_names[i]) == 0) return (json_simd_tier)i;
+    }
+    return JSON_SIMD_AUTO;
+}
+
+JSON_API void json_init(void) {
+    if (g_initialized) return;
+
+    g_cpu_features = cpu_detect_features();
+
+    /* Select best implementation based on CPU features, unless overridden */
+    json_simd_tier tier = simd_tier_best();
+    const char *env = getenv("JSON_ASM_SIMD");
+    if (env) {
+        json_simd_tier forced = simd_tier_from_name(env);
+        if (forced != JSON_SIMD_AUTO && simd_tier_supported(forced)) {
+            tier = forced;
+        }
+    }
+
+    simd_tier_install(tier);
     g_initialized = true;
 }
 
+JSON_API bool json_set_simd_tier(json_simd_tier tier) {
+    if (!g_initialized) json_init();
+    if (tier == JSON_SIMD_AUTO) tier = simd_tier_best();
+    if (!simd_tier_supported(tier)) return false;
+    simd_tier_install(tier);
+    return true;
+}
+
+JSON_API json_simd_tier json_get_simd_tier(void) {
+    if (!g_initialized) json_init();
+    return g_simd_tier;
+}
+
+JSON_API const char *json_simd_tier_name(json_simd_tier tier) {
+    if ((size_t)tier >= sizeof(simd_tier_names) / sizeof(simd_tier_names[0])) {
+        return "unknown";
+    }
+    return simd_tier_names[tier];
+}
+
 JSON_API uint32_t json_get_cpu_features(void) {
     if (!g_initialized) json_init();
     return g_cpu_features;
@@ -83,6 +218,16 @@ JSON_API const char *json_version(void) {
     return JSON_ASM_VERSION_STRING;
 }
 
+JSON_API bool json_get_stats(json_stats *out) {
+    if (!out) return false;
+    if (!g_initialized) json_init();
+    return stats_get(out);
+}
+
+JSON_API void json_reset_stats(void) {
+    stats_reset();
+}
+
 /* ============================================================================
  * Parsing API
  * ============================================================================ */
@@ -107,52 +252,131 @@ JSON_API json_doc *json_parse_file(const char *path) {
 
 JSON_API json_doc *json_parse_file_opts(const char *path,
                                          const json_parse_options *opts) {
+    if (!g_initialized) json_init();
     if (!path) {
         set_error(JSON_ERROR_IO, 0, 0, 0, "NULL path");
         return NULL;
     }
+    return parse_file(path, opts);
+}
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot open file");
+JSON_API json_parser *json_parser_new(const json_parse_options *opts) {
+    if (!g_initialized) json_init();
+    json_parser *parser = parser_create(opts);
+    if (!parser) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate parser");
+    }
+    return parser;
+}
+
+JSON_API json_doc *json_parser_parse(json_parser *parser, const char *json, size_t len) {
+    if (!parser) return NULL;
+    if (!json || len == 0) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
         return NULL;
     }
+    return parser_parse(parser, json, len);
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+JSON_API void json_parser_free(json_parser *parser) {
+    if (parser) parser_destroy(parser);
+}
 
-    if (size <= 0) {
-        fclose(f);
-        set_error(JSON_ERROR_IO, 0, 0, 0, "Empty or invalid file");
-        return NULL;
+JSON_API size_t json_parse_batch(const char *const *inputs, const size_t *lens, size_t n,
+                                 const json_parse_options *opts, json_doc **out_docs,
+                                 json_error_info *out_errors) {
+    if (!g_initialized) json_init();
+    if (n == 0) return 0;
+    if (!inputs || !lens || !out_docs) return n;
+    return parse_batch(inputs, lens, n, opts, out_docs, out_errors);
+}
+
+JSON_API void json_batch_configure(const json_batch_options *opts) {
+    if (opts) {
+        batch_configure(opts->threads, opts->cpus, opts->cpu_count);
+    } else {
+        batch_configure(0, NULL, 0);
     }
+}
 
-    char *buf = malloc((size_t)size);
-    if (!buf) {
-        fclose(f);
-        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
-        return NULL;
+JSON_API void json_batch_shutdown(void) {
+    batch_shutdown();
+}
+
+JSON_API json_error json_feed(json_parser *parser, const char *chunk, size_t len) {
+    if (!parser || (!chunk && len > 0)) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "NULL input");
+        return JSON_ERROR_SYNTAX;
     }
+    return feed_chunk(parser, chunk, len);
+}
 
-    size_t read = fread(buf, 1, (size_t)size, f);
-    fclose(f);
+JSON_API json_doc *json_feed_end(json_parser *parser) {
+    if (!parser) return NULL;
+    return feed_finish(parser);
+}
 
-    if (read != (size_t)size) {
-        free(buf);
-        set_error(JSON_ERROR_IO, 0, 0, 0, "Read error");
+JSON_API json_stream *json_stream_new(const char *json, size_t len,
+                                      const json_parse_options *opts) {
+    if (!g_initialized) json_init();
+    if (!json && len > 0) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "NULL input");
         return NULL;
     }
+    json_stream *stream = stream_create(json, len, opts);
+    if (!stream) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate stream");
+    }
+    return stream;
+}
 
-    json_doc *doc = json_parse_opts(buf, (size_t)size, opts);
-    free(buf);
-    return doc;
+JSON_API json_stream *json_stream_open(const char *path,
+                                       const json_parse_options *opts) {
+    if (!g_initialized) json_init();
+    if (!path) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "NULL path");
+        return NULL;
+    }
+    return stream_open_file(path, opts);
+}
+
+JSON_API json_doc *json_stream_next(json_stream *stream) {
+    if (!stream) return NULL;
+    return stream_next(stream);
+}
+
+JSON_API size_t json_stream_position(json_stream *stream) {
+    return stream ? stream->pos : 0;
+}
+
+JSON_API void json_stream_free(json_stream *stream) {
+    if (stream) stream_destroy(stream);
 }
 
 JSON_API json_error_info json_get_error(void) {
     return g_last_error;
 }
 
+JSON_API bool json_validate(const char *json, size_t len,
+                            const json_parse_options *opts, json_error_info *err) {
+    if (!g_initialized) json_init();
+    bool ok;
+    if (!json || len == 0) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        ok = false;
+    } else {
+        ok = validate_json(json, len, opts);
+    }
+    if (err) *err = ok ? (json_error_info){ .code = JSON_OK, .message = "No error" } : g_last_error;
+    return ok;
+}
+
+JSON_API size_t json_minify(const char *json, size_t len, char *out, uint32_t flags) {
+    if (!g_initialized) json_init();
+    if (!json || !out) return 0;
+    return minify_json(json, len, out, flags);
+}
+
 /* ============================================================================
  * Document Operations
  * ============================================================================ */
@@ -162,16 +386,51 @@ JSON_API json_val *json_doc_root(json_doc *doc) {
 }
 
 JSON_API void json_doc_free(json_doc *doc) {
-    if (doc) arena_destroy(doc);
+    /* Parser-owned documents are released with their parser */
+    if (doc && !doc->owner) doc_release(doc);
+}
+
+JSON_API void json_doc_reset(json_doc *doc) {
+    if (doc) arena_reset(doc);
+}
+
+JSON_API void json_pool_clear(void) {
+    doc_pool_clear();
 }
 
 JSON_API size_t json_doc_memory(json_doc *doc) {
     if (!doc) return 0;
-    return sizeof(struct json_doc) + doc->arena_size + doc->strings_size;
+    /* Key index, intern and array run tables are allocated outside the
+     * arenas */
+    return sizeof(struct json_doc) + doc->arena_size + doc->strings_size +
+           key_index_memory(doc) + intern_memory(doc) + array_runs_memory(doc);
 }
 
 JSON_API size_t json_doc_count(json_doc *doc) {
-    return doc ? doc->value_count : 0;
+    if (!doc) return 0;
+    if (doc->mutated) return doc->root ? mut_tree_count(doc->root) : 0;
+    return doc->value_count;
+}
+
+/* ============================================================================
+ * Binary Tape
+ * ============================================================================ */
+
+JSON_API bool json_tape_save(json_val *val, const char *path) {
+    if (!val || !path) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "NULL value or path");
+        return false;
+    }
+    return tape_save(val, path);
+}
+
+JSON_API json_doc *json_tape_open(const char *path) {
+    if (!g_initialized) json_init();
+    if (!path) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "NULL path");
+        return NULL;
+    }
+    return tape_open(path);
 }
 
 /* ============================================================================
@@ -250,13 +509,7 @@ JSON_API int64_t json_get_int(json_val *val) {
     if (!val) return 0;
     json_type t = val_get_type(val);
     if (t == JSON_INT) {
-        uint64_t payload = val_get_payload(val);
-        /* Sign-extend from 60 bits to 64 bits */
-        if (payload & (1ULL << 59)) {
-            /* Negative number - set upper 4 bits */
-            return (int64_t)(payload | 0xF000000000000000ULL);
-        }
-        return (int64_t)payload;
+        return val->int_val;
     }
     if (t == JSON_FLOAT) {
         return (int64_t)val->float_val;
@@ -284,11 +537,9 @@ JSON_API double json_get_num(json_val *val) {
 JSON_API const char *json_get_str(json_val *val) {
     if (!val) return NULL;
     json_type t = val_get_type(val);
-    if (t == JSON_STRING_SHORT) {
-        return val_short_str_ptr(val);
-    }
-    if (t == JSON_STRING_LONG) {
-        return val->str_ptr;
+    if (t == JSON_STRING_SHORT || t == JSON_STRING_LONG) {
+        size_t len;
+        return val_str(val, &len);
     }
     return NULL;
 }
@@ -296,11 +547,10 @@ JSON_API const char *json_get_str(json_val *val) {
 JSON_API size_t json_get_str_len(json_val *val) {
     if (!val) return 0;
     json_type t = val_get_type(val);
-    if (t == JSON_STRING_SHORT) {
-        return val_short_str_len(val);
-    }
-    if (t == JSON_STRING_LONG) {
-        return (size_t)val_get_payload(val);  /* Length stored in payload, not str_len */
+    if (t == JSON_STRING_SHORT || t == JSON_STRING_LONG) {
+        size_t len;
+        val_str(val, &len);
+        return len;
     }
     return 0;
 }
@@ -317,17 +567,23 @@ JSON_API json_val *json_obj_get(json_val *obj, const char *key) {
 JSON_API json_val *json_obj_getn(json_val *obj, const char *key, size_t key_len) {
     if (!obj || !key || val_get_type(obj) != JSON_OBJECT) return NULL;
 
-    json_val *child = obj->child;
+    /* Wide objects answer from their key index */
+    json_val *value;
+    if (val_key_index(obj) && key_index_find(obj, key, key_len, key_hash(key, key_len), &value)) {
+        return value;
+    }
+
+    json_val *child = val_child(obj);
     while (child) {
-        /* Each object child is a key-value pair: child is key, child->next is value */
+        /* Members alternate on the sibling chain: key, value, key, ... */
         size_t child_key_len = json_get_str_len(child);
         if (child_key_len == key_len) {
             const char *child_key = json_get_str(child);
             if (child_key && memcmp(child_key, key, key_len) == 0) {
-                return child->child; /* Value is stored as child of key node */
+                return val_next(child);
             }
         }
-        child = child->next;
+        child = val_next(val_next(child));
     }
     return NULL;
 }
@@ -338,22 +594,24 @@ JSON_API bool json_obj_has(json_val *obj, const char *key) {
 
 JSON_API size_t json_obj_size(json_val *obj) {
     if (!obj || val_get_type(obj) != JSON_OBJECT) return 0;
+    struct key_index *ki = val_key_index(obj);
+    if (ki) return ki->count;
     size_t count = 0;
-    json_val *child = obj->child;
+    json_val *child = val_child(obj);
     while (child) {
         count++;
-        child = child->next;
+        child = val_next(val_next(child));
     }
     return count;
 }
 
 JSON_API json_val *json_obj_first(json_val *obj) {
     if (!obj || val_get_type(obj) != JSON_OBJECT) return NULL;
-    return obj->child;
+    return val_child(obj);
 }
 
 JSON_API json_val *json_obj_next(json_val *val) {
-    return val ? val->next : NULL;
+    return (val && val_next(val)) ? val_next(val_next(val)) : NULL;
 }
 
 JSON_API const char *json_obj_key(json_val *val) {
@@ -364,6 +622,10 @@ JSON_API size_t json_obj_key_len(json_val *val) {
     return json_get_str_len(val);
 }
 
+JSON_API json_val *json_obj_val(json_val *key) {
+    return key ? val_next(key) : NULL;
+}
+
 /* ============================================================================
  * Array Operations
  * ============================================================================ */
@@ -371,24 +633,14 @@ JSON_API size_t json_obj_key_len(json_val *val) {
 JSON_API json_val *json_arr_get(json_val *arr, size_t index) {
     if (!arr || val_get_type(arr) != JSON_ARRAY) return NULL;
 
-    json_val *child = arr->child;
-    size_t i = 0;
-    while (child && i < index) {
-        child = child->next;
-        i++;
-    }
-    return child;
+    /* Elements are contiguous, with the count in the payload */
+    if (index >= val_arr_count(arr)) return NULL;
+    return arr->child + index;
 }
 
 JSON_API size_t json_arr_size(json_val *arr) {
     if (!arr || val_get_type(arr) != JSON_ARRAY) return 0;
-    size_t count = 0;
-    json_val *child = arr->child;
-    while (child) {
-        count++;
-        child = child->next;
-    }
-    return count;
+    return val_arr_count(arr);
 }
 
 JSON_API json_val *json_arr_first(json_val *arr) {
@@ -397,7 +649,371 @@ JSON_API json_val *json_arr_first(json_val *arr) {
 }
 
 JSON_API json_val *json_arr_next(json_val *val) {
-    return val ? val->next : NULL;
+    return val ? val_next(val) : NULL;
+}
+
+/* ============================================================================
+ * On-Demand Cursor
+ * ============================================================================ */
+
+JSON_API bool json_cursor_init(json_cursor *cur, const char *json, size_t len) {
+    if (!g_initialized) json_init();
+    if (!cur || !json) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return false;
+    }
+    return cursor_init(cur, json, len);
+}
+
+JSON_API json_type json_cursor_type(const json_cursor *cur) {
+    return cur ? cursor_type(cur) : JSON_NULL;
+}
+
+JSON_API bool json_cursor_find_field(const json_cursor *obj, const char *key,
+                                     json_cursor *out) {
+    if (!key) return false;
+    return json_cursor_find_fieldn(obj, key, strlen(key), out);
+}
+
+JSON_API bool json_cursor_find_fieldn(const json_cursor *obj, const char *key,
+                                      size_t key_len, json_cursor *out) {
+    if (!obj || !key || !out) return false;
+    return cursor_find(obj, key, key_len, out);
+}
+
+JSON_API bool json_cursor_child(const json_cursor *container, json_cursor *out) {
+    if (!container || !out) return false;
+    return cursor_child(container, out);
+}
+
+JSON_API bool json_cursor_next(json_cursor *cur) {
+    return cur ? cursor_next(cur) : false;
+}
+
+/* Read a literal or number, failing unless it has one of the types given */
+static bool cursor_read(const json_cursor *cur, struct json_val *val,
+                        json_type a, json_type b) {
+    if (!cur) return false;
+    char c = cur->json[cur->pos];
+    bool scalar = c != '"' && c != '[' && c != '{';
+    if (scalar && !cursor_scalar(cur, val)) return false;
+    if (!scalar || (val_get_type(val) != a && val_get_type(val) != b)) {
+        set_error(JSON_ERROR_TYPE, cur->pos, 0, 0, "Unexpected value type");
+        return false;
+    }
+    return true;
+}
+
+JSON_API bool json_cursor_get_bool(const json_cursor *cur, bool *out) {
+    struct json_val val;
+    if (!cursor_read(cur, &val, JSON_TRUE, JSON_FALSE)) return false;
+    *out = val_get_type(&val) == JSON_TRUE;
+    return true;
+}
+
+JSON_API bool json_cursor_get_int(const json_cursor *cur, int64_t *out) {
+    struct json_val val;
+    if (!cursor_read(cur, &val, JSON_INT, JSON_FLOAT)) return false;
+    *out = json_get_int(&val);
+    return true;
+}
+
+JSON_API bool json_cursor_get_uint(const json_cursor *cur, uint64_t *out) {
+    struct json_val val;
+    if (!cursor_read(cur, &val, JSON_INT, JSON_FLOAT)) return false;
+    *out = json_get_uint(&val);
+    return true;
+}
+
+JSON_API bool json_cursor_get_num(const json_cursor *cur, double *out) {
+    struct json_val val;
+    if (!cursor_read(cur, &val, JSON_INT, JSON_FLOAT)) return false;
+    *out = json_get_num(&val);
+    return true;
+}
+
+JSON_API bool json_cursor_is_null(const json_cursor *cur) {
+    struct json_val val;
+    return cursor_read(cur, &val, JSON_NULL, JSON_NULL);
+}
+
+JSON_API size_t json_cursor_get_str(const json_cursor *cur, char *buf, size_t buf_len) {
+    if (buf && buf_len > 0) buf[0] = '\0';
+    if (!cur) return 0;
+    if (cur->json[cur->pos] != '"') {
+        set_error(JSON_ERROR_TYPE, cur->pos, 0, 0, "Not a string");
+        return 0;
+    }
+    return cursor_string(cur, cur->pos, buf, buf ? buf_len : 0);
+}
+
+JSON_API size_t json_cursor_get_key(const json_cursor *cur, char *buf, size_t buf_len) {
+    if (buf && buf_len > 0) buf[0] = '\0';
+    if (!cur) return 0;
+    if (cur->container != '{') {
+        set_error(JSON_ERROR_TYPE, cur->pos, 0, 0, "Not an object member");
+        return 0;
+    }
+    return cursor_string(cur, cur->key - 1, buf, buf ? buf_len : 0);
+}
+
+JSON_API const char *json_cursor_raw(const json_cursor *cur, size_t *len) {
+    size_t n = 0;
+    const char *raw = cur ? cursor_raw(cur, &n) : NULL;
+    if (len) *len = n;
+    return raw;
+}
+
+/* ============================================================================
+ * JSON Pointer Queries
+ * ============================================================================ */
+
+JSON_API json_path *json_path_compile(const char *pointer) {
+    if (!pointer) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "NULL JSON Pointer");
+        return NULL;
+    }
+    return path_compile(pointer, strlen(pointer));
+}
+
+JSON_API json_path *json_path_compilen(const char *pointer, size_t len) {
+    if (!pointer) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "NULL JSON Pointer");
+        return NULL;
+    }
+    return path_compile(pointer, len);
+}
+
+JSON_API void json_path_free(json_path *path) {
+    free(path);
+}
+
+JSON_API json_val *json_path_get(const json_path *path, json_val *root) {
+    json_val *match = NULL;
+    if (!path || !root) return NULL;
+    return path_eval(path, root, &match, 1, false) ? match : NULL;
+}
+
+JSON_API size_t json_path_eval(const json_path *path, json_val *root,
+                               json_val **out, size_t max) {
+    if (!path || !root) return 0;
+    return path_eval(path, root, out, out ? max : 0, true);
+}
+
+JSON_API json_doc *json_path_parse(const json_path *path, const char *json, size_t len) {
+    if (!g_initialized) json_init();
+    if (!path || !json) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return NULL;
+    }
+    return path_parse(path, json, len);
+}
+
+/* ============================================================================
+ * Schema Decoding and Encoding
+ * ============================================================================ */
+
+JSON_API json_schema *json_schema_compile(const json_field *fields, size_t count) {
+    if (!fields) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "NULL schema fields");
+        return NULL;
+    }
+    return schema_compile(fields, count);
+}
+
+JSON_API void json_schema_free(json_schema *schema) {
+    free(schema);
+}
+
+JSON_API bool json_decode(const json_schema *schema, const char *json, size_t len, void *out) {
+    if (!g_initialized) json_init();
+    if (!schema || !json || !out) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return false;
+    }
+    return schema_decode(schema, json, len, out);
+}
+
+JSON_API char *json_encode(const json_schema *schema, const void *in) {
+    if (!schema || !in) return NULL;
+    return schema_encode(schema, in, NULL);
+}
+
+JSON_API size_t json_encode_buf(const json_schema *schema, const void *in,
+                                char *buf, size_t buf_len) {
+    if (!schema || !in) return 0;
+    return schema_encode_into(schema, in, buf, buf_len);
+}
+
+/* ============================================================================
+ * Building and Mutation
+ * ============================================================================ */
+
+JSON_API json_doc *json_doc_new(void) {
+    if (!g_initialized) json_init();
+    json_doc *doc = arena_create(0);
+    if (!doc) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+        return NULL;
+    }
+    doc->mutated = true;
+    return doc;
+}
+
+JSON_API void json_doc_set_root(json_doc *doc, json_val *root) {
+    if (!doc) return;
+    doc->root = root;
+    doc->mutated = true;
+}
+
+/* Tapes are mapped read-only */
+static bool doc_writable(json_doc *doc) {
+    if (!doc->readonly) return true;
+    set_error(JSON_ERROR_TYPE, 0, 0, 0, "Document is read-only");
+    return false;
+}
+
+/* A zeroed value: null */
+static json_val *new_val(json_doc *doc) {
+    if (!doc) return NULL;
+    json_val *val = arena_alloc_val(doc);
+    if (!val) set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+    return val;
+}
+
+JSON_API json_val *json_new_null(json_doc *doc) {
+    return new_val(doc);
+}
+
+JSON_API json_val *json_new_bool(json_doc *doc, bool b) {
+    json_val *val = new_val(doc);
+    if (val) val_set_type(val, b ? JSON_TRUE : JSON_FALSE);
+    return val;
+}
+
+JSON_API json_val *json_new_int(json_doc *doc, int64_t i) {
+    json_val *val = new_val(doc);
+    if (val) mut_store_int(val, i);
+    return val;
+}
+
+JSON_API json_val *json_new_real(json_doc *doc, double d) {
+    json_val *val = new_val(doc);
+    if (val) {
+        val_set_type(val, JSON_FLOAT);
+        val->float_val = d;
+    }
+    return val;
+}
+
+JSON_API json_val *json_new_str(json_doc *doc, const char *str) {
+    if (!str) return NULL;
+    return json_new_strn(doc, str, strlen(str));
+}
+
+JSON_API json_val *json_new_strn(json_doc *doc, const char *str, size_t len) {
+    if (!str) return NULL;
+    json_val *val = new_val(doc);
+    if (val && !mut_store_string(doc, val, str, len)) return NULL;
+    return val;
+}
+
+JSON_API json_val *json_new_arr(json_doc *doc) {
+    json_val *val = new_val(doc);
+    if (val) val_set_type(val, JSON_ARRAY);
+    return val;
+}
+
+JSON_API json_val *json_new_obj(json_doc *doc) {
+    json_val *val = new_val(doc);
+    if (val) val_set_type(val, JSON_OBJECT);
+    return val;
+}
+
+JSON_API bool json_val_set_null(json_doc *doc, json_val *val) {
+    if (!doc || !val || !doc_writable(doc)) return false;
+    doc->mutated = true;
+    val_reset(val, JSON_NULL);
+    return true;
+}
+
+JSON_API bool json_val_set_bool(json_doc *doc, json_val *val, bool b) {
+    if (!doc || !val || !doc_writable(doc)) return false;
+    doc->mutated = true;
+    val_reset(val, b ? JSON_TRUE : JSON_FALSE);
+    return true;
+}
+
+JSON_API bool json_val_set_int(json_doc *doc, json_val *val, int64_t i) {
+    if (!doc || !val || !doc_writable(doc)) return false;
+    doc->mutated = true;
+    mut_store_int(val, i);
+    return true;
+}
+
+JSON_API bool json_val_set_real(json_doc *doc, json_val *val, double d) {
+    if (!doc || !val || !doc_writable(doc)) return false;
+    doc->mutated = true;
+    val_reset(val, JSON_FLOAT);
+    val->float_val = d;
+    return true;
+}
+
+JSON_API bool json_val_set_str(json_doc *doc, json_val *val, const char *str) {
+    if (!str) return false;
+    return json_val_set_strn(doc, val, str, strlen(str));
+}
+
+JSON_API bool json_val_set_strn(json_doc *doc, json_val *val, const char *str, size_t len) {
+    if (!doc || !val || !str || !doc_writable(doc)) return false;
+    doc->mutated = true;
+    return mut_store_string(doc, val, str, len);
+}
+
+JSON_API json_val *json_obj_set(json_doc *doc, json_val *obj, const char *key, json_val *val) {
+    if (!key) return NULL;
+    return json_obj_setn(doc, obj, key, strlen(key), val);
+}
+
+JSON_API json_val *json_obj_setn(json_doc *doc, json_val *obj, const char *key,
+                                 size_t key_len, json_val *val) {
+    if (!doc || !obj || !key || !val || !doc_writable(doc)) return NULL;
+    if (val_get_type(obj) != JSON_OBJECT) {
+        set_error(JSON_ERROR_TYPE, 0, 0, 0, "Not an object");
+        return NULL;
+    }
+    return mut_obj_set(doc, obj, key, key_len, val);
+}
+
+JSON_API bool json_obj_remove(json_doc *doc, json_val *obj, const char *key) {
+    if (!key) return false;
+    return json_obj_removen(doc, obj, key, strlen(key));
+}
+
+JSON_API bool json_obj_removen(json_doc *doc, json_val *obj, const char *key, size_t key_len) {
+    if (!doc || !obj || !key || val_get_type(obj) != JSON_OBJECT) return false;
+    if (!doc_writable(doc)) return false;
+    return mut_obj_remove(doc, obj, key, key_len);
+}
+
+JSON_API json_val *json_arr_push(json_doc *doc, json_val *arr, json_val *val) {
+    return json_arr_insert(doc, arr, json_arr_size(arr), val);
+}
+
+JSON_API json_val *json_arr_insert(json_doc *doc, json_val *arr, size_t index, json_val *val) {
+    if (!doc || !arr || !val || !doc_writable(doc)) return NULL;
+    if (val_get_type(arr) != JSON_ARRAY) {
+        set_error(JSON_ERROR_TYPE, 0, 0, 0, "Not an array");
+        return NULL;
+    }
+    if (index > val_arr_count(arr)) return NULL;
+    return mut_arr_insert(doc, arr, index, val);
+}
+
+JSON_API bool json_arr_remove(json_doc *doc, json_val *arr, size_t index) {
+    if (!doc || !arr || val_get_type(arr) != JSON_ARRAY) return false;
+    if (index >= val_arr_count(arr) || !doc_writable(doc)) return false;
+    return mut_arr_remove(doc, arr, index);
 }
 
 /* ============================================================================
@@ -410,23 +1026,44 @@ JSON_API char *json_stringify(json_val *val) {
 
 JSON_API char *json_stringify_opts(json_val *val, const json_stringify_options *opts) {
     if (!val) return NULL;
-    return stringify_value(val, opts);
+    return stringify_value(val, opts, 0, NULL);
+}
+
+JSON_API size_t json_stringify_size(json_val *val, const json_stringify_options *opts) {
+    if (!val) return 0;
+    return stringify_size(val, opts);
 }
 
 JSON_API size_t json_stringify_buf(json_val *val, char *buf, size_t buf_len) {
-    char *str = json_stringify(val);
-    if (!str) return 0;
+    return json_stringify_buf_opts(val, NULL, buf, buf_len);
+}
 
-    size_t len = strlen(str);
-    if (buf && buf_len > len) {
-        memcpy(buf, str, len + 1);
-    }
-    free(str);
-    return len;
+JSON_API size_t json_stringify_buf_opts(json_val *val, const json_stringify_options *opts,
+                                        char *buf, size_t buf_len) {
+    if (!val) return 0;
+    return stringify_into(val, opts, buf, buf_len);
+}
+
+JSON_API bool json_stringify_write(json_val *val, const json_stringify_options *opts,
+                                   json_write_fn write, void *user_data) {
+    if (!val || !write) return false;
+    return stringify_write(val, opts, write, user_data, -1);
+}
+
+JSON_API bool json_stringify_fd(json_val *val, const json_stringify_options *opts, int fd) {
+    if (!val || fd < 0) return false;
+    return stringify_write(val, opts, NULL, NULL, fd);
 }
 
 JSON_API char *json_doc_stringify(json_doc *doc) {
-    return doc ? json_stringify(doc->root) : NULL;
+    if (!doc || !doc->root) return NULL;
+
+    /* The last length sizes the buffer, so repeats allocate once */
+    size_t len;
+    size_t hint = __atomic_load_n(&doc->stringify_len, __ATOMIC_RELAXED);
+    char *str = stringify_value(doc->root, NULL, hint, &len);
+    if (str) __atomic_store_n(&doc->stringify_len, len, __ATOMIC_RELAXED);
+    return str;
 }
 
 /* ============================================================================
@@ -436,60 +1073,18 @@ JSON_API char *json_doc_stringify(json_doc *doc) {
 JSON_API bool json_equals(json_val *a, json_val *b) {
     if (a == b) return true;
     if (!a || !b) return false;
+    return values_equal(a, b);
+}
 
-    json_type ta = json_get_type(a);
-    json_type tb = json_get_type(b);
-    if (ta != tb) return false;
-
-    switch (ta) {
-        case JSON_NULL:
-        case JSON_TRUE:
-        case JSON_FALSE:
-            return true;
-
-        case JSON_INT:
-            return json_get_int(a) == json_get_int(b);
-
-        case JSON_FLOAT:
-            return json_get_num(a) == json_get_num(b);
-
-        case JSON_STRING: {
-            size_t la = json_get_str_len(a);
-            size_t lb = json_get_str_len(b);
-            if (la != lb) return false;
-            return memcmp(json_get_str(a), json_get_str(b), la) == 0;
-        }
-
-        case JSON_ARRAY: {
-            json_val *ca = json_arr_first(a);
-            json_val *cb = json_arr_first(b);
-            while (ca && cb) {
-                if (!json_equals(ca, cb)) return false;
-                ca = json_arr_next(ca);
-                cb = json_arr_next(cb);
-            }
-            return ca == NULL && cb == NULL;
-        }
-
-        case JSON_OBJECT: {
-            if (json_obj_size(a) != json_obj_size(b)) return false;
-            json_obj_foreach(a, key) {
-                json_val *va = key->child;
-                json_val *vb = json_obj_getn(b, json_obj_key(key), json_obj_key_len(key));
-                if (!vb || !json_equals(va, vb)) return false;
-            }
-            return true;
-        }
-    }
-    return false;
+JSON_API uint64_t json_hash(json_val *val) {
+    if (!val) return 0;
+    return value_hash(val);
 }
 
 JSON_API json_doc *json_clone(json_val *val) {
-    char *str = json_stringify(val);
-    if (!str) return NULL;
-    json_doc *doc = json_parse(str, strlen(str));
-    free(str);
-    return doc;
+    if (!val) return NULL;
+    if (!g_initialized) json_init();
+    return clone_tree(val);
 }
 
 JSON_API const char *json_type_name(json_type type) {
@@ -517,6 +1112,7 @@ JSON_API const char *json_error_string(json_error err) {
         case JSON_ERROR_UTF8:   return "Invalid UTF-8 encoding";
         case JSON_ERROR_IO:     return "File I/O error";
         case JSON_ERROR_TYPE:   return "Type mismatch";
+        case JSON_ERROR_INCOMPLETE: return "Incomplete input";
         default:                return "Unknown error";
     }
 }
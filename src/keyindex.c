@@ -0,0 +1,164 @@
+/*
+ * json-asm: Hashed key index for wide objects
+ *
+ * json_obj_getn() walks the member chain, which makes repeated lookups on
+ * objects with thousands of keys quadratic overall. Objects with at least
+ * KEY_INDEX_MIN_MEMBERS members get a key_index when they are parsed; its
+ * open-addressed slot table is built on the first lookup (or straight away
+ * with JSON_PARSE_KEY_INDEX) and answers lookups with one probe sequence.
+ */
+
+#include "internal.h"
+
+static inline bool key_matches(const struct key_slot *slot, const char *key,
+                               size_t len, uint64_t hash) {
+    if (slot->hash != hash) return false;
+    size_t slot_len;
+    const char *slot_key = val_str(slot->key, &slot_len);
+    return slot_len == len && memcmp(slot_key, key, len) == 0;
+}
+
+/* Fill a table with the members of obj, in order, so the first of any
+ * duplicate keys wins as it does for the linear scan */
+static struct key_slot *key_index_build(const struct key_index *ki,
+                                        const struct json_val *obj) {
+    struct key_slot *slots = calloc(ki->mask + 1, sizeof(struct key_slot));
+    if (!slots) return NULL;
+
+    for (struct json_val *key = val_child(obj); key; key = val_next(val_next(key))) {
+        size_t len;
+        const char *str = val_str(key, &len);
+        uint64_t hash = key_hash(str, len);
+
+        size_t i = (size_t)hash & ki->mask;
+        while (slots[i].key && !key_matches(&slots[i], str, len, hash)) {
+            i = (i + 1) & ki->mask;
+        }
+        if (!slots[i].key) {
+            slots[i].key = key;
+            slots[i].hash = hash;
+        }
+    }
+    return slots;
+}
+
+/* Publish a table for ki; when another reader got there first, use theirs */
+static struct key_slot *key_index_publish(struct key_index *ki,
+                                          struct key_slot *slots) {
+    struct key_slot *expected = NULL;
+    if (__atomic_compare_exchange_n(&ki->slots, &expected, slots, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return slots;
+    }
+    free(slots);
+    return expected;
+}
+
+void key_index_attach(struct json_doc *doc, struct json_val *obj, size_t count,
+                      uint32_t flags) {
+    if (count < KEY_INDEX_MIN_MEMBERS) return;
+
+    /* The index is optional: without one, lookups scan the members */
+    struct key_index *ki = arena_alloc_raw(doc, sizeof(struct key_index));
+    if (!ki) return;
+
+    /* At most half full */
+    size_t slots = 1;
+    while (slots < count * 2) slots <<= 1;
+
+    ki->count = count;
+    ki->mask = slots - 1;
+    ki->slots = NULL;
+    ki->tail = NULL;
+    ki->next = doc->key_indexes;
+    doc->key_indexes = ki;
+#ifdef JSON_COMPACT_NODES
+    ki->child = obj->child;
+    obj->key_index = ki;
+    val_set_payload(obj, 1);
+#else
+    val_set_payload(obj, (uint64_t)(uintptr_t)ki);
+#endif
+
+    if (flags & JSON_PARSE_KEY_INDEX) {
+        ki->slots = key_index_build(ki, obj);
+    }
+}
+
+bool key_index_find(const struct json_val *obj, const char *key, size_t len,
+                    uint64_t hash, struct json_val **value) {
+    struct key_index *ki = val_key_index(obj);
+    if (!ki) return false;
+
+    struct key_slot *slots = __atomic_load_n(&ki->slots, __ATOMIC_ACQUIRE);
+    if (!slots) {
+        slots = key_index_build(ki, obj);
+        if (!slots) return false;
+        slots = key_index_publish(ki, slots);
+    }
+
+    size_t i = (size_t)hash & ki->mask;
+    while (slots[i].key) {
+        if (key_matches(&slots[i], key, len, hash)) {
+            *value = val_next(slots[i].key);
+            return true;
+        }
+        i = (i + 1) & ki->mask;
+    }
+    *value = NULL;
+    return true;
+}
+
+void key_index_release(struct json_doc *doc) {
+    /* The key_index structs live in the node arena; only tables are freed */
+    for (struct key_index *ki = doc->key_indexes; ki; ki = ki->next) {
+        free(ki->slots);
+    }
+    doc->key_indexes = NULL;
+}
+
+size_t key_index_memory(const struct json_doc *doc) {
+    /* Tables are built by lookups, which may run on other threads */
+    size_t total = 0;
+    for (const struct key_index *ki = doc->key_indexes; ki; ki = ki->next) {
+        if (__atomic_load_n(&ki->slots, __ATOMIC_ACQUIRE)) {
+            total += (ki->mask + 1) * sizeof(struct key_slot);
+        }
+    }
+    return total;
+}
+
+void key_index_append(struct json_val *obj, struct json_val *key) {
+    struct key_index *ki = val_key_index(obj);
+    ki->count++;
+    ki->tail = key;
+
+    /* Past half full the table is dropped and rebuilt larger when needed */
+    if (ki->count * 2 > ki->mask + 1) {
+        free(ki->slots);
+        ki->slots = NULL;
+        ki->mask = ki->mask * 2 + 1;
+        return;
+    }
+    if (!ki->slots) return;
+
+    /* The key is new, so it takes the first free slot */
+    size_t len;
+    const char *str = val_str(key, &len);
+    uint64_t hash = key_hash(str, len);
+    size_t i = (size_t)hash & ki->mask;
+    while (ki->slots[i].key) i = (i + 1) & ki->mask;
+    ki->slots[i].key = key;
+    ki->slots[i].hash = hash;
+}
+
+void key_index_remove(struct json_val *obj, struct json_val *key,
+                      struct json_val *prev_key) {
+    /* A duplicate of the removed key may become visible, so the table is
+     * rebuilt on the next lookup rather than patched */
+    struct key_index *ki = val_key_index(obj);
+    ki->count--;
+    if (ki->tail == key) ki->tail = prev_key;
+    free(ki->slots);
+    ki->slots = NULL;
+}
@@ -0,0 +1,104 @@
+/*
+ * json-asm: Minification without a parse
+ *
+ * Works through the input in 64-byte blocks like the structural index: the
+ * find_structural kernels locate the quotes, a prefix XOR turns them into a
+ * mask of the bytes inside strings, and every other byte up to 0x20 is
+ * dropped, which in valid JSON is exactly the whitespace between tokens.
+ * Each block is copied out before anything is written, so the output may
+ * overwrite the input. Nothing is validated; json_validate() does that.
+ */
+
+#include "internal.h"
+#include <string.h>
+
+#define MINIFY_BLOCK 64
+
+/* Bytes of the block at or below ' ' and, separately, equal to c */
+static inline void block_classify(const char *block, unsigned char c,
+                                  uint64_t *spaces, uint64_t *matches) {
+    uint64_t s = 0, m = 0;
+    for (size_t i = 0; i < MINIFY_BLOCK; i += 8) {
+        uint64_t w;
+        memcpy(&w, block + i, sizeof(w));
+        s |= swar_movemask(swar_lt(w, 0x21)) << i;
+        m |= swar_movemask(swar_eq(w, c)) << i;
+    }
+    *spaces = s;
+    *matches = m;
+}
+
+/* Append the bytes of the block flagged in keep */
+static inline size_t emit(char *out, const char *block, uint64_t keep) {
+    if (keep == UINT64_MAX) {
+        memcpy(out, block, MINIFY_BLOCK);
+        return MINIFY_BLOCK;
+    }
+    size_t n = 0;
+    for (; keep; keep &= keep - 1) {
+        out[n++] = block[__builtin_ctzll(keep)];
+    }
+    return n;
+}
+
+/* End of the comment starting at json[pos] == '/', or pos if none does.
+ * A line comment ends before its newline, which is then whitespace; an
+ * unterminated block comment runs to the end of the input. */
+static size_t comment_end(const char *json, size_t len, size_t pos) {
+    if (pos + 1 >= len) return pos;
+    if (json[pos + 1] == '/') {
+        const char *nl = memchr(json + pos + 2, '\n', len - pos - 2);
+        return nl ? (size_t)(nl - json) : len;
+    }
+    if (json[pos + 1] == '*') {
+        for (size_t i = pos + 2; i + 1 < len; i++) {
+            if (json[i] == '*' && json[i + 1] == '/') return i + 2;
+        }
+        return len;
+    }
+    return pos;
+}
+
+size_t minify_json(const char *json, size_t len, char *out, uint32_t flags) {
+    bool comments = (flags & JSON_PARSE_ALLOW_COMMENTS) != 0;
+    char block[MINIFY_BLOCK];
+    uint64_t in_string = 0;
+    bool escaped = false;
+    size_t pos = 0, written = 0;
+
+    while (pos < len) {
+        size_t n = len - pos < MINIFY_BLOCK ? len - pos : MINIFY_BLOCK;
+        memcpy(block, json + pos, n);
+        memset(block + n, ' ', MINIFY_BLOCK - n);
+        uint64_t valid = n < MINIFY_BLOCK ? (1ULL << n) - 1 : UINT64_MAX;
+
+        uint64_t inside = structural_strings(block, n, &in_string, &escaped);
+        uint64_t spaces, slashes;
+        block_classify(block, '/', &spaces, &slashes);
+        uint64_t keep = (~spaces | inside) & valid;
+
+        /* Cut the block at the first comment outside a string and resume
+         * after it, outside any string */
+        size_t skip_to = pos;
+        slashes &= ~inside & valid;
+        for (; comments && slashes; slashes &= slashes - 1) {
+            size_t at = pos + (size_t)__builtin_ctzll(slashes);
+            skip_to = comment_end(json, len, at);
+            if (skip_to != at) {
+                keep &= (1ULL << (at - pos)) - 1;
+                break;
+            }
+            skip_to = pos;
+        }
+
+        written += emit(out + written, block, keep);
+        if (skip_to != pos) {
+            pos = skip_to;
+            in_string = 0;
+            escaped = false;
+        } else {
+            pos += n;
+        }
+    }
+    return written;
+}
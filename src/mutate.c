@@ -0,0 +1,320 @@
+/*
+ * json-asm: In-place mutation of parsed and built documents
+ *
+ * New values come from the document's arena like parsed ones, so a patched
+ * document is still freed in one go. The node layout constrains the rest:
+ *
+ *   - Array elements must stay contiguous. A run that is full is copied to
+ *     a new run with room to double, and the spare capacity of such runs is
+ *     kept in a side table (doc->array_runs), since there is no free field
+ *     in the node for it. Growing or shrinking an array moves its elements.
+ *   - Object members are appended to the sibling chain; wide objects keep
+ *     their key index, and its tail pointer, in step.
+ *   - Values are copied into the container (one node; the members of a
+ *     container value are shared), so any node may be passed in, even an
+ *     element of the array being changed.
+ *
+ * Mutation leaves garbage nodes behind, so a mutated document stops keeping
+ * doc->value_count and json_doc_count() counts the tree instead.
+ */
+
+#include "internal.h"
+
+#define ARRAY_RUN_MIN 4         /* Smallest run allocated for a growing array */
+
+/* ============================================================================
+ * Array Run Table
+ * ============================================================================ */
+
+static inline size_t run_home(const struct array_runs *t, const struct json_val *elems) {
+    uint64_t h = (uint64_t)(uintptr_t)elems * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & t->mask;
+}
+
+/* Capacity of a run; runs not in the table are exactly full */
+static size_t run_capacity(const struct json_doc *doc, const struct json_val *elems,
+                           size_t count) {
+    const struct array_runs *t = &doc->array_runs;
+    if (!t->slots) return count;
+    for (size_t i = run_home(t, elems); t->slots[i].elems; i = (i + 1) & t->mask) {
+        if (t->slots[i].elems == elems) return t->slots[i].capacity;
+    }
+    return count;
+}
+
+static void run_forget(struct json_doc *doc, const struct json_val *elems) {
+    struct array_runs *t = &doc->array_runs;
+    if (!t->slots || !elems) return;
+
+    size_t i = run_home(t, elems);
+    while (t->slots[i].elems != elems) {
+        if (!t->slots[i].elems) return;
+        i = (i + 1) & t->mask;
+    }
+    t->count--;
+
+    /* Backward-shift deletion keeps every probe sequence unbroken */
+    for (size_t j = (i + 1) & t->mask; t->slots[j].elems; j = (j + 1) & t->mask) {
+        size_t home = run_home(t, t->slots[j].elems);
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+        t->slots[i] = t->slots[j];
+        i = j;
+    }
+    t->slots[i].elems = NULL;
+}
+
+/* Record a run's capacity. Failing to is harmless: the run is then treated
+ * as full and copied again on the next insert. */
+static void run_record(struct json_doc *doc, struct json_val *elems, size_t capacity) {
+    struct array_runs *t = &doc->array_runs;
+
+    if ((t->count + 1) * 2 > (t->slots ? t->mask + 1 : 0)) {
+        size_t size = t->slots ? (t->mask + 1) * 2 : 16;
+        struct array_run *slots = calloc(size, sizeof(struct array_run));
+        if (!slots) return;
+
+        struct array_runs grown = { slots, size - 1, t->count };
+        for (size_t i = 0; t->slots && i <= t->mask; i++) {
+            if (!t->slots[i].elems) continue;
+            size_t j = run_home(&grown, t->slots[i].elems);
+            while (slots[j].elems) j = (j + 1) & grown.mask;
+            slots[j] = t->slots[i];
+        }
+        free(t->slots);
+        *t = grown;
+    }
+
+    size_t i = run_home(t, elems);
+    while (t->slots[i].elems) i = (i + 1) & t->mask;
+    t->slots[i].elems = elems;
+    t->slots[i].capacity = capacity;
+    t->count++;
+}
+
+void array_runs_release(struct json_doc *doc) {
+    free(doc->array_runs.slots);
+    doc->array_runs = (struct array_runs){0};
+}
+
+size_t array_runs_memory(const struct json_doc *doc) {
+    const struct array_runs *t = &doc->array_runs;
+    return t->slots ? (t->mask + 1) * sizeof(struct array_run) : 0;
+}
+
+/* ============================================================================
+ * Values
+ * ============================================================================ */
+
+size_t mut_tree_count(const struct json_val *val) {
+    /* Keys count too, as in doc->value_count */
+    size_t count = 0;
+    struct tree_walk w;
+    tree_walk_init(&w, val);
+    for (;;) {
+        enum walk_event ev = tree_walk_next(&w);
+        if (ev == WALK_END) break;
+        if (ev == WALK_ERROR) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+            count = 0;
+            break;
+        }
+        if (ev != WALK_CLOSE) count += w.key ? 2 : 1;
+    }
+    tree_walk_free(&w);
+    return count;
+}
+
+void mut_store_int(struct json_val *val, int64_t v) {
+    val_reset(val, JSON_INT);
+    val->int_val = v;
+}
+
+bool mut_store_string(struct json_doc *doc, struct json_val *val,
+                      const char *str, size_t len) {
+    /* Same layouts as the parser: up to 7 bytes inline, else in the arena.
+     * str may point into val itself; val_set_short_str() copies it first. */
+    if (len <= JSON_SHORT_STR_MAX) {
+        val_set_short_str(val, str, len);
+        return true;
+    }
+
+    char *dst = arena_alloc_string(doc, len);
+    if (!dst) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    if (!val_set_long_str(doc, val, dst, len)) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    return true;
+}
+
+static bool key_equals(const struct json_val *key, const char *str, size_t len) {
+    size_t key_len;
+    const char *key_str = val_str(key, &key_len);
+    return key_len == len && memcmp(key_str, str, len) == 0;
+}
+
+/* ============================================================================
+ * Objects
+ * ============================================================================ */
+
+struct json_val *mut_obj_set(struct json_doc *doc, struct json_val *obj,
+                             const char *key, size_t len,
+                             const struct json_val *val) {
+    doc->mutated = true;
+    struct json_val *existing = NULL;
+    struct json_val *tail = NULL;
+    size_t count = 0;
+    struct key_index *ki = val_key_index(obj);
+
+    if (!ki || !key_index_find(obj, key, len, key_hash(key, len), &existing)) {
+        for (struct json_val *k = val_child(obj); k; k = val_next(val_next(k))) {
+            if (key_equals(k, key, len)) {
+                existing = val_next(k);
+                break;
+            }
+            tail = k;
+            count++;
+        }
+    } else if (!existing) {
+        tail = ki->tail;
+        if (!tail && val_child(obj)) {
+            for (tail = val_child(obj); val_next(val_next(tail)); tail = val_next(val_next(tail))) {}
+        }
+    }
+
+    /* Replacing a value keeps the key, its position and the index */
+    if (existing) {
+        val_copy_value(existing, val);
+        return existing;
+    }
+
+    struct json_val *key_node = arena_alloc_val(doc);
+    struct json_val *value = key_node ? arena_alloc_val(doc) : NULL;
+    if (!value) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    if (!mut_store_string(doc, key_node, key, len)) return NULL;
+
+    val_set_next(key_node, value);
+    val_copy_value(value, val);
+    val_set_next(value, NULL);
+    if (tail) {
+        val_set_next(val_next(tail), key_node);
+    } else {
+        val_set_child(obj, key_node);
+    }
+
+    if (ki) {
+        key_index_append(obj, key_node);
+    } else if (count + 1 >= KEY_INDEX_MIN_MEMBERS) {
+        /* Grown wide enough for an index, like a parsed object would be */
+        key_index_attach(doc, obj, count + 1, 0);
+        if (val_key_index(obj)) val_key_index(obj)->tail = key_node;
+    }
+    return value;
+}
+
+bool mut_obj_remove(struct json_doc *doc, struct json_val *obj,
+                    const char *key, size_t len) {
+    doc->mutated = true;
+    /* The first matching member goes, as lookups find the first */
+    struct json_val *prev_key = NULL;
+    struct json_val *k = val_child(obj);
+    while (k && !key_equals(k, key, len)) {
+        prev_key = k;
+        k = val_next(val_next(k));
+    }
+    if (!k) return false;
+
+    struct json_val *value = val_next(k);
+    if (prev_key) {
+        val_set_next(val_next(prev_key), val_next(value));
+    } else {
+        val_set_child(obj, val_next(value));
+    }
+
+    if (val_key_index(obj)) key_index_remove(obj, k, prev_key);
+    return true;
+}
+
+/* ============================================================================
+ * Arrays
+ * ============================================================================ */
+
+/* Relink the sibling chain of elems[from..count) */
+static void relink(struct json_val *elems, size_t from, size_t count) {
+    for (size_t i = from; i + 1 < count; i++) val_set_next(&elems[i], &elems[i + 1]);
+    if (count > 0) val_set_next(&elems[count - 1], NULL);
+}
+
+/* Make room for needed elements, moving the run if it is full */
+static struct json_val *arr_reserve(struct json_doc *doc, struct json_val *arr,
+                                    size_t needed, bool *moved) {
+    struct json_val *elems = arr->child;
+    size_t count = val_arr_count(arr);
+    size_t capacity = elems ? run_capacity(doc, elems, count) : 0;
+
+    *moved = false;
+    if (needed <= capacity) return elems;
+
+    size_t grown = capacity < ARRAY_RUN_MIN ? ARRAY_RUN_MIN : capacity * 2;
+    if (grown < needed) grown = needed;
+
+    struct json_val *run = arena_alloc_vals(doc, grown);
+    if (!run) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    if (count > 0) memcpy(run, elems, count * sizeof(struct json_val));
+    run_forget(doc, elems);
+    run_record(doc, run, grown);
+
+    arr->child = run;
+    *moved = true;
+    return run;
+}
+
+struct json_val *mut_arr_insert(struct json_doc *doc, struct json_val *arr,
+                                size_t index, const struct json_val *val) {
+    doc->mutated = true;
+    /* val may be an element of this array, which is about to move */
+    struct json_val copy = *val;
+    size_t count = val_arr_count(arr);
+
+    bool moved;
+    struct json_val *elems = arr_reserve(doc, arr, count + 1, &moved);
+    if (!elems) return NULL;
+
+    memmove(&elems[index + 1], &elems[index], (count - index) * sizeof(struct json_val));
+    val_copy_value(&elems[index], &copy);
+    count++;
+    val_set_arr_count(arr, count);
+    relink(elems, moved || index == 0 ? 0 : index - 1, count);
+    return &elems[index];
+}
+
+bool mut_arr_remove(struct json_doc *doc, struct json_val *arr, size_t index) {
+    doc->mutated = true;
+    struct json_val *elems = arr->child;
+    size_t count = val_arr_count(arr);
+
+    memmove(&elems[index], &elems[index + 1], (count - index - 1) * sizeof(struct json_val));
+    count--;
+    val_set_arr_count(arr, count);
+
+    if (count == 0) {
+        /* Empty arrays have no run, as when parsed */
+        run_forget(doc, elems);
+        arr->child = NULL;
+    } else {
+        relink(elems, index == 0 ? 0 : index - 1, count);
+    }
+    return true;
+}
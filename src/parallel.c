@@ -0,0 +1,282 @@
+/*
+ * json-asm: Multi-threaded parsing of large documents
+ *
+ * The root array or object is cut into segments at top-level commas and the
+ * segments are parsed concurrently, each into its own arena:
+ *
+ *   1. Each thread summarises one 64-byte aligned chunk with the structural
+ *      kernels: its bracket depth change for both possible string states at
+ *      the chunk start, and whether it flips the string state.
+ *   2. A serial prefix over the summaries gives the exact string state and
+ *      depth at every chunk start.
+ *   3. Each thread looks for the first comma at depth 1 in its chunk.
+ *   4. The segments between those commas are parsed in parallel, then linked
+ *      into one sibling chain and their arenas spliced into the document.
+ *
+ * Splits only ever fall on commas that are structurally between elements, so
+ * a malformed input is rejected exactly as the serial parser would reject it.
+ *
+ * The phases run on the persistent worker pool of batch.c, which the first
+ * parallel parse starts if no batch has.
+ */
+
+#include "internal.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#define PARALLEL_MIN_SIZE       (1024 * 1024)   /* Default serial threshold */
+#define PARALLEL_MAX_THREADS    64
+#define PARALLEL_CHUNK_ALIGN    64              /* Structural block size */
+
+bool parallel_eligible(const char *json, size_t len,
+                       const json_parse_options *opts) {
+#if defined(_WIN32)
+    (void)json; (void)len; (void)opts;
+    return false;
+#else
+    if (!opts || opts->threads < 2) return false;
+
+    size_t min_size = opts->parallel_min_size ? opts->parallel_min_size : PARALLEL_MIN_SIZE;
+    if (len < min_size) return false;
+
+    /* Only a container root has elements to split between */
+    size_t pos = g_json_ops.skip_whitespace(json, len);
+    return pos < len && (json[pos] == '[' || json[pos] == '{');
+#endif
+}
+
+#if !defined(_WIN32)
+
+struct parallel_job {
+    const char *json;
+    size_t len;
+    const json_parse_options *opts;
+
+    /* Chunk scan (phases 1 and 3) */
+    size_t chunk_start;
+    size_t chunk_end;
+    struct chunk_summary summary;
+    bool in_string;             /* String state at chunk_start */
+    int64_t depth;              /* Bracket depth at chunk_start */
+    size_t split;               /* First top-level comma, or chunk_end */
+
+    /* Segment parse (phase 4) */
+    size_t start;
+    size_t end;
+    bool object;
+    bool last;
+    struct json_doc *doc;
+    struct json_val *first;
+    struct json_val *tail;
+    size_t count;               /* Elements or members parsed */
+    bool ok;
+    json_error_info error;      /* Copied out of the worker's thread-local */
+};
+
+static void *job_summarise(void *arg) {
+    struct parallel_job *job = arg;
+    structural_chunk_summary(job->json, job->chunk_end, job->chunk_start, &job->summary);
+    return NULL;
+}
+
+static void *job_find_split(void *arg) {
+    struct parallel_job *job = arg;
+    job->split = structural_find_split(job->json, job->chunk_end, job->chunk_start,
+                                       job->in_string, job->depth);
+    return NULL;
+}
+
+static void *job_parse(void *arg) {
+    struct parallel_job *job = arg;
+    job->doc = arena_create(parse_arena_estimate(job->end - job->start));
+    if (!job->doc) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+        job->error = g_last_error;
+        return NULL;
+    }
+    job->ok = parse_segment(job->doc, job->json, job->len, job->start, job->end,
+                            job->object, job->last, job->opts, &job->first, &job->tail,
+                            &job->count);
+    if (!job->ok) job->error = g_last_error;
+    return NULL;
+}
+
+struct parallel_phase {
+    void *(*fn)(void *);
+    struct parallel_job *jobs;
+};
+
+static void run_phase_job(void *arg, size_t i) {
+    struct parallel_phase *phase = arg;
+    phase->fn(&phase->jobs[i]);
+}
+
+/* Run fn over jobs on the batch worker pool, so a parse does not start
+ * and join threads for every phase. If the pool is taken (by a batch this
+ * parse is an item of, or by another thread) the jobs get threads of
+ * their own, the first on the calling thread; a job whose thread cannot
+ * be started runs on the calling thread too. */
+static void run_jobs(void *(*fn)(void *), struct parallel_job *jobs, size_t n) {
+    struct parallel_phase phase = { .fn = fn, .jobs = jobs };
+    if (batch_run_tasks(run_phase_job, &phase, n)) return;
+
+    pthread_t threads[PARALLEL_MAX_THREADS];
+    bool started[PARALLEL_MAX_THREADS];
+
+    for (size_t i = 1; i < n; i++) {
+        started[i] = pthread_create(&threads[i], NULL, fn, &jobs[i]) == 0;
+    }
+    fn(&jobs[0]);
+    for (size_t i = 1; i < n; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            fn(&jobs[i]);
+        }
+    }
+}
+
+bool parse_parallel(struct json_doc *doc, const char *json, size_t len,
+                    const json_parse_options *opts) {
+    struct parallel_job jobs[PARALLEL_MAX_THREADS];
+    size_t root_pos = g_json_ops.skip_whitespace(json, len);
+    bool object = json[root_pos] == '{';
+
+    /* Phase 1: one aligned chunk per thread */
+    size_t n = opts->threads < PARALLEL_MAX_THREADS ? opts->threads : PARALLEL_MAX_THREADS;
+    size_t chunk = (len / n + PARALLEL_CHUNK_ALIGN - 1) & ~(size_t)(PARALLEL_CHUNK_ALIGN - 1);
+    if (chunk == 0) chunk = PARALLEL_CHUNK_ALIGN;
+    n = (len + chunk - 1) / chunk;
+
+    for (size_t i = 0; i < n; i++) {
+        jobs[i] = (struct parallel_job){
+            .json = json,
+            .len = len,
+            .opts = opts,
+            .chunk_start = i * chunk,
+            .chunk_end = i + 1 < n ? (i + 1) * chunk : len
+        };
+    }
+    run_jobs(job_summarise, jobs, n);
+
+    /* Phase 2: string state and depth at each chunk start */
+    bool in_string = false;
+    int64_t depth = 0;
+    for (size_t i = 0; i < n; i++) {
+        jobs[i].in_string = in_string;
+        jobs[i].depth = depth;
+        depth += jobs[i].summary.depth_delta[in_string];
+        in_string ^= jobs[i].summary.flips_string;
+    }
+
+    /* Phase 3: a split point in every chunk but the first */
+    if (n > 1) run_jobs(job_find_split, jobs + 1, n - 1);
+
+    /* Segments run from one split to the next; chunks without a split
+     * (inside one large element, or past the root) are merged away */
+    size_t nseg = 0;
+    size_t start = root_pos + 1;
+    for (size_t i = 1; i < n; i++) {
+        size_t split = jobs[i].split;
+        if (split >= jobs[i].chunk_end || split <= start) continue;
+        jobs[nseg].start = start;
+        jobs[nseg].end = split;
+        nseg++;
+        start = split + 1;
+    }
+    jobs[nseg].start = start;
+    jobs[nseg].end = len;
+    nseg++;
+
+    for (size_t i = 0; i < nseg; i++) {
+        jobs[i].object = object;
+        jobs[i].last = i + 1 == nseg;
+        jobs[i].doc = NULL;
+        jobs[i].first = NULL;
+        jobs[i].tail = NULL;
+        jobs[i].ok = false;
+    }
+
+    /* Phase 4: parse the segments */
+    run_jobs(job_parse, jobs, nseg);
+
+    /* The earliest failing segment holds the first error in the input */
+    for (size_t i = 0; i < nseg; i++) {
+        if (!jobs[i].ok) {
+            g_last_error = jobs[i].error;
+            for (size_t j = 0; j < nseg; j++) arena_destroy(jobs[j].doc);
+            return false;
+        }
+    }
+
+    struct json_val *root = arena_alloc_val(doc);
+    size_t count = 0;
+    for (size_t i = 0; i < nseg; i++) count += jobs[i].count;
+
+    /* Array elements are contiguous, so the segment runs are copied into
+     * one run of the document */
+    struct json_val *elems = NULL;
+    if (root && !object && count > 0) elems = arena_alloc_vals(doc, count);
+
+    if (!root || (!object && count > 0 && !elems)) {
+        for (size_t j = 0; j < nseg; j++) arena_destroy(jobs[j].doc);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+
+    /* Take over the segment arenas before linking into them. The runs
+     * copied below stay behind, unused, in the adopted blocks. */
+    for (size_t i = 0; i < nseg; i++) {
+        if (!arena_adopt(doc, jobs[i].doc)) {
+            for (size_t j = i; j < nseg; j++) arena_destroy(jobs[j].doc);
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+            return false;
+        }
+    }
+
+    if (object) {
+        /* Stitch the member chains together. Only the last segment can be
+         * empty (an empty root, or a trailing comma before the bracket). */
+        val_set_type(root, JSON_OBJECT);
+        struct json_val *tail = NULL;
+        for (size_t i = 0; i < nseg; i++) {
+            if (!jobs[i].first) continue;
+            if (tail) {
+                val_set_next(tail, jobs[i].first);
+            } else {
+                root->child = jobs[i].first;
+            }
+            tail = jobs[i].tail;
+        }
+        key_index_attach(doc, root, count, opts->flags);
+    } else {
+        val_set_type(root, JSON_ARRAY);
+        val_set_arr_count(root, count);
+        struct json_val *dst = elems;
+        for (size_t i = 0; i < nseg; i++) {
+            if (jobs[i].count == 0) continue;
+            memcpy(dst, jobs[i].first, jobs[i].count * sizeof(struct json_val));
+            dst += jobs[i].count;
+        }
+        for (size_t i = 0; i + 1 < count; i++) val_set_next(&elems[i], &elems[i + 1]);
+        if (count > 0) val_set_next(&elems[count - 1], NULL);
+        root->child = elems;
+    }
+
+    if (!object) doc->value_count -= count;
+
+    doc->root = root;
+    return true;
+}
+
+#else
+
+bool parse_parallel(struct json_doc *doc, const char *json, size_t len,
+                    const json_parse_options *opts) {
+    (void)doc; (void)json; (void)len; (void)opts;
+    return false;
+}
+
+#endif
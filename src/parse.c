@@ -4,11 +4,8 @@
 
 #include "internal.h"
 #include <math.h>
-#include <errno.h>
-#include <ctype.h>
 
-/* Character classification table (for future table-driven state machine) */
-__attribute__((unused))
+/* Character classification table, for the tree parser's dispatch */
 static const uint8_t char_class[256] = {
     /* 0x00-0x1F: Control characters */
     [0x00] = CC_EOF, [0x01] = CC_CTRL, [0x02] = CC_CTRL, [0x03] = CC_CTRL,
@@ -61,8 +58,9 @@ static const uint8_t char_class[256] = {
     ['{']  = CC_LBRACE, ['|']  = CC_OTHER, ['}']  = CC_RBRACE,
     ['~']  = CC_OTHER, [0x7F] = CC_CTRL,
 
-    /* 0x80-0xFF: Extended ASCII (UTF-8 continuation bytes, etc.) */
-    /* Default to CC_OTHER for all extended bytes */
+    /* 0x80-0xFF: Extended ASCII (UTF-8 continuation bytes, etc.) are left
+     * 0, which is CC_SPACE. Whitespace is skipped before any lookup, so the
+     * dispatch treats them as CC_OTHER. */
 };
 
 /* Parser context */
@@ -70,32 +68,59 @@ typedef struct {
     const char *input;
     size_t len;
     size_t pos;
-    size_t line;
-    size_t col;
     struct json_doc *doc;
     uint32_t flags;
     size_t max_depth;
     size_t depth;
+    const uint32_t *idx;        /* Structural offsets (two-stage parse only) */
+    size_t idx_pos;             /* Next unconsumed offset */
+    struct json_val *stack;     /* Elements of the arrays still open */
+    size_t stack_len;
+    size_t stack_cap;
+    bool stack_heap;            /* stack was malloc'd, not the caller's buffer */
 } parser_ctx;
 
-/* Forward declarations */
-static struct json_val *parse_value(parser_ctx *ctx);
+/* Array elements buffered on the C stack before the parser stack moves to
+ * the heap */
+#define PARSE_STACK_INLINE 64
 
-/* Skip whitespace */
-static void skip_ws(parser_ctx *ctx) {
-    while (ctx->pos < ctx->len) {
-        char c = ctx->input[ctx->pos];
-        if (c == ' ' || c == '\t' || c == '\r') {
-            ctx->pos++;
-            ctx->col++;
-        } else if (c == '\n') {
-            ctx->pos++;
-            ctx->line++;
-            ctx->col = 1;
-        } else {
-            break;
+/* Forward declarations */
+static bool parse_value(parser_ctx *ctx, struct json_val *val);
+
+/* Record an error at pos in input. Line and column are derived from the
+ * input here so the hot paths never have to track them. */
+void input_error(const char *input, size_t len, size_t pos, json_error code,
+                 const char *msg) {
+    size_t line = 1;
+    size_t line_start = 0;
+    for (size_t i = 0; i < pos && i < len; i++) {
+        if (input[i] == '\n') {
+            line++;
+            line_start = i + 1;
         }
     }
+    set_error(code, pos, line, pos - line_start + 1, msg);
+}
+
+static void parse_error(parser_ctx *ctx, json_error code, const char *msg) {
+    input_error(ctx->input, ctx->len, ctx->pos, code, msg);
+}
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool is_digit(char c) {
+    return (unsigned char)(c - '0') <= 9;
+}
+
+/* Skip whitespace. Token separators are usually zero or one byte, so those
+ * are handled inline; longer runs (indentation) go to the SIMD kernel. */
+static inline void skip_ws(parser_ctx *ctx) {
+    if (ctx->pos >= ctx->len || !is_ws(ctx->input[ctx->pos])) return;
+    ctx->pos++;
+    if (ctx->pos >= ctx->len || !is_ws(ctx->input[ctx->pos])) return;
+    ctx->pos += g_json_ops.skip_whitespace(ctx->input + ctx->pos, ctx->len - ctx->pos);
 }
 
 /* Check and consume a character */
@@ -103,7 +128,6 @@ static bool consume(parser_ctx *ctx, char expected) {
     skip_ws(ctx);
     if (ctx->pos < ctx->len && ctx->input[ctx->pos] == expected) {
         ctx->pos++;
-        ctx->col++;
         return true;
     }
     return false;
@@ -117,43 +141,37 @@ static inline char peek(parser_ctx *ctx) {
 }
 
 /* Parse null literal */
-static struct json_val *parse_null(parser_ctx *ctx) {
+static bool parse_null(parser_ctx *ctx, struct json_val *val) {
     if (ctx->pos + 4 <= ctx->len &&
         ctx->input[ctx->pos] == 'n' &&
         ctx->input[ctx->pos + 1] == 'u' &&
         ctx->input[ctx->pos + 2] == 'l' &&
         ctx->input[ctx->pos + 3] == 'l') {
         ctx->pos += 4;
-        ctx->col += 4;
-        struct json_val *val = arena_alloc_val(ctx->doc);
-        if (!val) return NULL;
         val_set_type(val, JSON_NULL);
-        return val;
+        return true;
     }
-    set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected 'null'");
-    return NULL;
+    parse_error(ctx, JSON_ERROR_SYNTAX, "Expected 'null'");
+    return false;
 }
 
 /* Parse true literal */
-static struct json_val *parse_true(parser_ctx *ctx) {
+static bool parse_true(parser_ctx *ctx, struct json_val *val) {
     if (ctx->pos + 4 <= ctx->len &&
         ctx->input[ctx->pos] == 't' &&
         ctx->input[ctx->pos + 1] == 'r' &&
         ctx->input[ctx->pos + 2] == 'u' &&
         ctx->input[ctx->pos + 3] == 'e') {
         ctx->pos += 4;
-        ctx->col += 4;
-        struct json_val *val = arena_alloc_val(ctx->doc);
-        if (!val) return NULL;
         val_set_type(val, JSON_TRUE);
-        return val;
+        return true;
     }
-    set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected 'true'");
-    return NULL;
+    parse_error(ctx, JSON_ERROR_SYNTAX, "Expected 'true'");
+    return false;
 }
 
 /* Parse false literal */
-static struct json_val *parse_false(parser_ctx *ctx) {
+static bool parse_false(parser_ctx *ctx, struct json_val *val) {
     if (ctx->pos + 5 <= ctx->len &&
         ctx->input[ctx->pos] == 'f' &&
         ctx->input[ctx->pos + 1] == 'a' &&
@@ -161,54 +179,80 @@ static struct json_val *parse_false(parser_ctx *ctx) {
         ctx->input[ctx->pos + 3] == 's' &&
         ctx->input[ctx->pos + 4] == 'e') {
         ctx->pos += 5;
-        ctx->col += 5;
-        struct json_val *val = arena_alloc_val(ctx->doc);
-        if (!val) return NULL;
         val_set_type(val, JSON_FALSE);
-        return val;
+        return true;
     }
-    set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected 'false'");
-    return NULL;
+    parse_error(ctx, JSON_ERROR_SYNTAX, "Expected 'false'");
+    return false;
+}
+
+/* Does a 19-digit run overflow int64? (the kernels stop at 19 digits) */
+static inline bool int19_overflows(const char *digits, bool negative) {
+    return memcmp(digits, negative ? "9223372036854775808" : "9223372036854775807", 19) > 0;
 }
 
 /* Parse a number */
-static struct json_val *parse_number(parser_ctx *ctx) {
+static bool parse_number(parser_ctx *ctx, struct json_val *val) {
     const char *start = ctx->input + ctx->pos;
     size_t remaining = ctx->len - ctx->pos;
+    bool negative = start[0] == '-';
     bool is_float = false;
 
-    size_t i = 0;
-
-    /* Optional minus */
-    if (i < remaining && start[i] == '-') {
-        i++;
-    }
+    size_t i = negative ? 1 : 0;
 
     /* Integer part */
-    if (i >= remaining || !isdigit((unsigned char)start[i])) {
-        set_error(JSON_ERROR_NUMBER, ctx->pos, ctx->line, ctx->col, "Invalid number");
-        return NULL;
+    if (i >= remaining || !is_digit(start[i])) {
+        parse_error(ctx, JSON_ERROR_NUMBER, "Invalid number");
+        return false;
     }
 
     /* Check for leading zero */
-    if (start[i] == '0' && i + 1 < remaining && isdigit((unsigned char)start[i + 1])) {
-        set_error(JSON_ERROR_NUMBER, ctx->pos, ctx->line, ctx->col, "Leading zeros not allowed");
-        return NULL;
+    if (start[i] == '0' && i + 1 < remaining && is_digit(start[i + 1])) {
+        parse_error(ctx, JSON_ERROR_NUMBER, "Leading zeros not allowed");
+        return false;
     }
 
-    while (i < remaining && isdigit((unsigned char)start[i])) {
-        i++;
+    /* Sign and up to 19 digits through the dispatched kernel */
+    size_t consumed = 0;
+    int64_t ival = g_json_ops.parse_int(start, remaining, &consumed);
+    i = consumed;
+
+    /* The float significand: the kernel's digits, then fraction digits
+     * while 19 significant ones fit; later digits only move the point */
+    uint64_t mantissa = negative ? 0 - (uint64_t)ival : (uint64_t)ival;
+    int sig_digits = mantissa ? (int)(i - (negative ? 1 : 0)) : 0;
+    int64_t exp10 = 0;
+    bool truncated = false;
+
+    bool overflow = false;
+    if (i < remaining && is_digit(start[i])) {
+        /* More than 19 digits */
+        overflow = true;
+        while (i < remaining && is_digit(start[i])) {
+            exp10++;
+            truncated |= start[i] != '0';
+            i++;
+        }
+    } else if (i - (negative ? 1 : 0) == 19 && int19_overflows(start + i - 19, negative)) {
+        overflow = true;
     }
 
     /* Fractional part */
     if (i < remaining && start[i] == '.') {
         is_float = true;
         i++;
-        if (i >= remaining || !isdigit((unsigned char)start[i])) {
-            set_error(JSON_ERROR_NUMBER, ctx->pos, ctx->line, ctx->col, "Expected digit after decimal point");
-            return NULL;
+        if (i >= remaining || !is_digit(start[i])) {
+            parse_error(ctx, JSON_ERROR_NUMBER, "Expected digit after decimal point");
+            return false;
         }
-        while (i < remaining && isdigit((unsigned char)start[i])) {
+        while (i < remaining && is_digit(start[i])) {
+            if (sig_digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(start[i] - '0');
+                if (mantissa) sig_digits++;
+                exp10--;
+            } else {
+                truncated |= start[i] != '0';
+            }
             i++;
         }
     }
@@ -217,53 +261,44 @@ static struct json_val *parse_number(parser_ctx *ctx) {
     if (i < remaining && (start[i] == 'e' || start[i] == 'E')) {
         is_float = true;
         i++;
+        bool exp_negative = false;
         if (i < remaining && (start[i] == '+' || start[i] == '-')) {
+            exp_negative = start[i] == '-';
             i++;
         }
-        if (i >= remaining || !isdigit((unsigned char)start[i])) {
-            set_error(JSON_ERROR_NUMBER, ctx->pos, ctx->line, ctx->col, "Expected digit in exponent");
-            return NULL;
+        if (i >= remaining || !is_digit(start[i])) {
+            parse_error(ctx, JSON_ERROR_NUMBER, "Expected digit in exponent");
+            return false;
         }
-        while (i < remaining && isdigit((unsigned char)start[i])) {
+        int64_t e = 0;
+        while (i < remaining && is_digit(start[i])) {
+            /* Saturate: such exponents give 0 or infinity anyway */
+            if (e < 100000000) e = e * 10 + (start[i] - '0');
             i++;
         }
+        exp10 += exp_negative ? -e : e;
     }
 
-    struct json_val *val = arena_alloc_val(ctx->doc);
-    if (!val) return NULL;
-
-    if (is_float) {
-        /* Parse as double */
-        char *end;
-        errno = 0;
-        double d = strtod(start, &end);
-        if (errno == ERANGE) {
-            set_error(JSON_ERROR_NUMBER, ctx->pos, ctx->line, ctx->col, "Number out of range");
-            return NULL;
+    if (is_float || overflow) {
+        /* Parse as double (also the fallback for out-of-range integers);
+         * the rare undecided cases go through the full converter */
+        double d;
+        if (!number_from_decimal(mantissa, exp10, negative, truncated, &d)) {
+            d = g_json_ops.parse_float(start, i, NULL);
+        }
+        if (is_float && isinf(d)) {
+            parse_error(ctx, JSON_ERROR_NUMBER, "Number out of range");
+            return false;
         }
         val_set_type(val, JSON_FLOAT);
         val->float_val = d;
     } else {
-        /* Parse as integer */
-        char *end;
-        errno = 0;
-        long long ll = strtoll(start, &end, 10);
-        if (errno == ERANGE) {
-            /* Fall back to double for very large integers */
-            double d = strtod(start, &end);
-            val_set_type(val, JSON_FLOAT);
-            val->float_val = d;
-        } else {
-            val_set_type(val, JSON_INT);
-            int64_t ival = (int64_t)ll;
-            /* Store value in 60-bit payload */
-            val_set_payload(val, (uint64_t)ival & 0x0FFFFFFFFFFFFFFFULL);
-        }
+        val_set_type(val, JSON_INT);
+        val->int_val = ival;
     }
 
     ctx->pos += i;
-    ctx->col += i;
-    return val;
+    return true;
 }
 
 /* Parse hex digit */
@@ -288,7 +323,6 @@ static int parse_unicode_escape(parser_ctx *ctx, uint32_t *codepoint) {
     }
 
     ctx->pos += 4;
-    ctx->col += 4;
     *codepoint = cp;
     return 0;
 }
@@ -317,21 +351,140 @@ static size_t encode_utf8(uint32_t cp, char *buf) {
     return 0;
 }
 
-/* Parse string */
-static struct json_val *parse_string(parser_ctx *ctx) {
-    if (ctx->pos >= ctx->len || ctx->input[ctx->pos] != '"') {
-        set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected '\"'");
-        return NULL;
+/* Validate an escape sequence at ctx->pos (just past the backslash) and
+ * return the number of bytes it decodes to, or 0 on error. */
+static size_t check_escape(parser_ctx *ctx) {
+    if (ctx->pos >= ctx->len) {
+        parse_error(ctx, JSON_ERROR_STRING, "Unterminated escape");
+        return 0;
     }
-    ctx->pos++;
-    ctx->col++;
+    char esc = ctx->input[ctx->pos];
+    switch (esc) {
+        case '"': case '\\': case '/': case 'b':
+        case 'f': case 'n': case 'r': case 't':
+            ctx->pos++;
+            return 1;
+        case 'u': {
+            ctx->pos++;
+            uint32_t cp;
+            if (parse_unicode_escape(ctx, &cp) < 0) {
+                parse_error(ctx, JSON_ERROR_STRING, "Invalid unicode escape");
+                return 0;
+            }
+            /* Handle surrogate pairs */
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (ctx->pos + 2 > ctx->len ||
+                    ctx->input[ctx->pos] != '\\' ||
+                    ctx->input[ctx->pos + 1] != 'u') {
+                    parse_error(ctx, JSON_ERROR_STRING, "Expected surrogate pair");
+                    return 0;
+                }
+                ctx->pos += 2;
+                uint32_t cp2;
+                if (parse_unicode_escape(ctx, &cp2) < 0) {
+                    parse_error(ctx, JSON_ERROR_STRING, "Invalid unicode escape");
+                    return 0;
+                }
+                if (cp2 < 0xDC00 || cp2 > 0xDFFF) {
+                    parse_error(ctx, JSON_ERROR_STRING, "Invalid low surrogate");
+                    return 0;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (cp2 - 0xDC00);
+            }
+            char utf8[4];
+            return encode_utf8(cp, utf8);
+        }
+        default:
+            parse_error(ctx, JSON_ERROR_STRING, "Invalid escape sequence");
+            return 0;
+    }
+}
 
-    /* First pass: find string length and check for escapes */
-    size_t start = ctx->pos;
+/* Decode a validated string body containing escapes into dst */
+static size_t decode_string(const char *src, size_t src_len, char *dst) {
+    size_t src_pos = 0;
+    size_t dst_pos = 0;
+
+    while (src_pos < src_len) {
+        /* Copy the run up to the next backslash in one go. dst may be src
+         * itself (in-situ parsing); it never gets ahead of src. */
+        size_t run = g_json_ops.scan_string(src + src_pos, src_len - src_pos);
+        memmove(dst + dst_pos, src + src_pos, run);
+        src_pos += run;
+        dst_pos += run;
+        if (src_pos >= src_len) break;
+
+        src_pos++; /* Skip backslash */
+        char esc = src[src_pos++];
+        switch (esc) {
+            case '"':  dst[dst_pos++] = '"'; break;
+            case '\\': dst[dst_pos++] = '\\'; break;
+            case '/':  dst[dst_pos++] = '/'; break;
+            case 'b':  dst[dst_pos++] = '\b'; break;
+            case 'f':  dst[dst_pos++] = '\f'; break;
+            case 'n':  dst[dst_pos++] = '\n'; break;
+            case 'r':  dst[dst_pos++] = '\r'; break;
+            case 't':  dst[dst_pos++] = '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                for (int i = 0; i < 4; i++) {
+                    cp = (cp << 4) | (uint32_t)hex_digit(src[src_pos++]);
+                }
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    src_pos += 2; /* Skip \u */
+                    uint32_t cp2 = 0;
+                    for (int i = 0; i < 4; i++) {
+                        cp2 = (cp2 << 4) | (uint32_t)hex_digit(src[src_pos++]);
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (cp2 - 0xDC00);
+                }
+                dst_pos += encode_utf8(cp, dst + dst_pos);
+                break;
+            }
+        }
+    }
+    return dst_pos;
+}
+
+/* JSON_PARSE_VALIDATE_UTF8 check of the run of string bytes ending at
+ * ctx->pos. Runs end at a quote, backslash or control byte, none of which
+ * can be part of a multibyte sequence, so each run is valid on its own. */
+static bool check_utf8_run(parser_ctx *ctx, size_t run) {
+    const char *s = ctx->input + ctx->pos - run;
+    if (run < 16) {
+        /* Short runs are mostly ASCII keys; OR them rather than call out */
+        unsigned char high = 0;
+        for (size_t i = 0; i < run; i++) high |= (unsigned char)s[i];
+        if (high < 0x80) return true;
+    }
+
+    size_t hint = g_json_ops.validate_utf8(s, run);
+    if (hint == run) return true;
+    ctx->pos += utf8_error_offset(s, run, hint) - run;
+    parse_error(ctx, JSON_ERROR_UTF8, "Invalid UTF-8");
+    return false;
+}
+
+/* Validate a string body from ctx->pos up to its closing quote, where it
+ * stops, giving the decoded length and whether it has escapes */
+static inline bool scan_string_body(parser_ctx *ctx, size_t *out_len, bool *out_escapes) {
     size_t len = 0;
     bool has_escapes = false;
 
-    while (ctx->pos < ctx->len) {
+    while (1) {
+        /* Skip ordinary bytes with the SIMD scanner */
+        size_t run = g_json_ops.scan_string(ctx->input + ctx->pos, ctx->len - ctx->pos);
+        ctx->pos += run;
+        len += run;
+
+        if (ctx->pos >= ctx->len) {
+            parse_error(ctx, JSON_ERROR_STRING, "Unterminated string");
+            return false;
+        }
+        if ((ctx->flags & JSON_PARSE_VALIDATE_UTF8) && !check_utf8_run(ctx, run)) {
+            return false;
+        }
+
         char c = ctx->input[ctx->pos];
         if (c == '"') {
             break;
@@ -339,355 +492,910 @@ static struct json_val *parse_string(parser_ctx *ctx) {
         if (c == '\\') {
             has_escapes = true;
             ctx->pos++;
-            ctx->col++;
-            if (ctx->pos >= ctx->len) {
-                set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Unterminated escape");
-                return NULL;
-            }
-            char esc = ctx->input[ctx->pos];
-            switch (esc) {
-                case '"': case '\\': case '/': case 'b':
-                case 'f': case 'n': case 'r': case 't':
-                    len++;
-                    ctx->pos++;
-                    ctx->col++;
-                    break;
-                case 'u': {
-                    ctx->pos++;
-                    ctx->col++;
-                    uint32_t cp;
-                    if (parse_unicode_escape(ctx, &cp) < 0) {
-                        set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Invalid unicode escape");
-                        return NULL;
-                    }
-                    /* Handle surrogate pairs */
-                    if (cp >= 0xD800 && cp <= 0xDBFF) {
-                        if (ctx->pos + 2 > ctx->len ||
-                            ctx->input[ctx->pos] != '\\' ||
-                            ctx->input[ctx->pos + 1] != 'u') {
-                            set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Expected surrogate pair");
-                            return NULL;
-                        }
-                        ctx->pos += 2;
-                        ctx->col += 2;
-                        uint32_t cp2;
-                        if (parse_unicode_escape(ctx, &cp2) < 0) {
-                            set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Invalid unicode escape");
-                            return NULL;
-                        }
-                        if (cp2 < 0xDC00 || cp2 > 0xDFFF) {
-                            set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Invalid low surrogate");
-                            return NULL;
-                        }
-                        cp = 0x10000 + ((cp - 0xD800) << 10) + (cp2 - 0xDC00);
-                    }
-                    char utf8[4];
-                    len += encode_utf8(cp, utf8);
-                    break;
-                }
-                default:
-                    set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Invalid escape sequence");
-                    return NULL;
-            }
-        } else if ((unsigned char)c < 0x20) {
-            set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Control character in string");
-            return NULL;
+            size_t n = check_escape(ctx);
+            if (n == 0) return false;
+            len += n;
         } else {
-            len++;
-            ctx->pos++;
-            ctx->col++;
+            parse_error(ctx, JSON_ERROR_STRING, "Control character in string");
+            return false;
         }
     }
 
-    if (ctx->pos >= ctx->len) {
-        set_error(JSON_ERROR_STRING, ctx->pos, ctx->line, ctx->col, "Unterminated string");
-        return NULL;
+    *out_len = len;
+    *out_escapes = has_escapes;
+    return true;
+}
+
+/* Parse string */
+static bool parse_string(parser_ctx *ctx, struct json_val *val) {
+    if (ctx->pos >= ctx->len || ctx->input[ctx->pos] != '"') {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected '\"'");
+        return false;
     }
+    ctx->pos++;
+
+    /* First pass: find string length and check for escapes */
+    size_t start = ctx->pos;
+    size_t len;
+    bool has_escapes;
+    if (!scan_string_body(ctx, &len, &has_escapes)) return false;
+
+    size_t src_len = ctx->pos - start;
 
     /* Skip closing quote */
     ctx->pos++;
-    ctx->col++;
-
-    struct json_val *val = arena_alloc_val(ctx->doc);
-    if (!val) return NULL;
 
     /* Check for short string optimization */
     if (!has_escapes && len <= JSON_SHORT_STR_MAX) {
-        val_set_type(val, JSON_STRING_SHORT);
-        val->tag_payload = JSON_STRING_SHORT | ((uint64_t)len << 4);
-        char *dst = ((char *)&val->tag_payload) + 1;
-        memcpy(dst, ctx->input + start, len);
-        return val;
+        val_set_short_str(val, ctx->input + start, len);
+        return true;
     }
 
-    /* Allocate string in string arena */
-    char *str = arena_alloc_string(ctx->doc, len);
-    if (!str) return NULL;
-
-    /* Second pass: copy string with escape processing */
-    if (!has_escapes) {
-        memcpy(str, ctx->input + start, len);
-        str[len] = '\0';
+    const char *str;
+    if (ctx->flags & JSON_PARSE_INSITU) {
+        /* Decode in the caller's buffer; the terminator lands at or before
+         * the closing quote, which has already been consumed */
+        char *dst = (char *)ctx->input + start;
+        if (has_escapes) {
+            decode_string(dst, src_len, dst);
+        }
+        dst[len] = '\0';
+        str = dst;
+    } else if (!has_escapes && (ctx->flags & JSON_PARSE_BORROW)) {
+        /* Point straight into the input (not NUL-terminated) */
+        str = ctx->input + start;
+    } else if ((ctx->flags & JSON_PARSE_INTERN) && len <= INTERN_MAX_LEN) {
+        /* Share one copy of each repeated string */
+        char decoded[INTERN_MAX_LEN];
+        const char *src = ctx->input + start;
+        if (has_escapes) {
+            decode_string(src, src_len, decoded);
+            src = decoded;
+        }
+        str = intern_string(ctx->doc, src, len);
+        if (!str) return false;
     } else {
-        /* Re-parse from start position */
-        size_t src_pos = start;
-        size_t dst_pos = 0;
-        size_t src_end = ctx->pos - 1; /* Exclude closing quote */
-
-        while (src_pos < src_end) {
-            char c = ctx->input[src_pos];
-            if (c == '\\') {
-                src_pos++;
-                char esc = ctx->input[src_pos++];
-                switch (esc) {
-                    case '"':  str[dst_pos++] = '"'; break;
-                    case '\\': str[dst_pos++] = '\\'; break;
-                    case '/':  str[dst_pos++] = '/'; break;
-                    case 'b':  str[dst_pos++] = '\b'; break;
-                    case 'f':  str[dst_pos++] = '\f'; break;
-                    case 'n':  str[dst_pos++] = '\n'; break;
-                    case 'r':  str[dst_pos++] = '\r'; break;
-                    case 't':  str[dst_pos++] = '\t'; break;
-                    case 'u': {
-                        uint32_t cp = 0;
-                        for (int i = 0; i < 4; i++) {
-                            cp = (cp << 4) | (uint32_t)hex_digit(ctx->input[src_pos++]);
-                        }
-                        if (cp >= 0xD800 && cp <= 0xDBFF) {
-                            src_pos += 2; /* Skip \u */
-                            uint32_t cp2 = 0;
-                            for (int i = 0; i < 4; i++) {
-                                cp2 = (cp2 << 4) | (uint32_t)hex_digit(ctx->input[src_pos++]);
-                            }
-                            cp = 0x10000 + ((cp - 0xD800) << 10) + (cp2 - 0xDC00);
-                        }
-                        dst_pos += encode_utf8(cp, str + dst_pos);
-                        break;
-                    }
-                }
-            } else {
-                str[dst_pos++] = c;
-                src_pos++;
-            }
+        /* Allocate string in string arena */
+        char *dst = arena_alloc_string(ctx->doc, len);
+        if (!dst) return false;
+
+        /* Second pass: copy string with escape processing */
+        if (!has_escapes) {
+            memcpy(dst, ctx->input + start, len);
+        } else {
+            decode_string(ctx->input + start, src_len, dst);
         }
-        str[dst_pos] = '\0';
+        dst[len] = '\0';
+        str = dst;
+    }
+
+    if (!val_set_long_str(ctx->doc, val, str, len)) {
+        parse_error(ctx, JSON_ERROR_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    return true;
+}
+
+/* Buffer an array element until its array closes */
+static bool stack_grow(parser_ctx *ctx) {
+    size_t cap = ctx->stack_cap * 2;
+    struct json_val *stack = ctx->stack_heap
+        ? realloc(ctx->stack, cap * sizeof(struct json_val))
+        : malloc(cap * sizeof(struct json_val));
+    if (!stack) {
+        parse_error(ctx, JSON_ERROR_MEMORY, "Failed to grow parser stack");
+        return false;
     }
+    if (!ctx->stack_heap) {
+        memcpy(stack, ctx->stack, ctx->stack_len * sizeof(struct json_val));
+    }
+    ctx->stack = stack;
+    ctx->stack_cap = cap;
+    ctx->stack_heap = true;
+    return true;
+}
+
+static inline bool stack_push(parser_ctx *ctx, const struct json_val *val) {
+    if (ctx->stack_len == ctx->stack_cap && !stack_grow(ctx)) return false;
+    ctx->stack[ctx->stack_len++] = *val;
+    return true;
+}
+
+static void stack_free(parser_ctx *ctx) {
+    if (ctx->stack_heap) free(ctx->stack);
+}
 
-    val_set_type(val, JSON_STRING_LONG);
-    val_set_payload(val, len);  /* Store length in payload, not str_len (which overlaps with next) */
-    val->str_ptr = str;
-    return val;
+/* Move the elements buffered since base into one contiguous run under arr,
+ * with the count in its payload */
+static bool array_close(parser_ctx *ctx, struct json_val *arr, size_t base) {
+    size_t count = ctx->stack_len - base;
+    val_set_type(arr, JSON_ARRAY);
+    val_set_arr_count(arr, count);
+    arr->child = NULL;
+    if (count == 0) return true;
+
+    struct json_val *elems = arena_alloc_vals(ctx->doc, count);
+    if (!elems) {
+        parse_error(ctx, JSON_ERROR_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    memcpy(elems, ctx->stack + base, count * sizeof(struct json_val));
+
+    /* Keep the sibling links for json_arr_next() and the tree walkers */
+    for (size_t i = 0; i + 1 < count; i++) {
+        val_set_next(&elems[i], &elems[i + 1]);
+    }
+    val_set_next(&elems[count - 1], NULL);
+
+    arr->child = elems;
+    ctx->stack_len = base;
+    return true;
 }
 
-/* Parse array */
-static struct json_val *parse_array(parser_ctx *ctx) {
-    if (!consume(ctx, '[')) {
-        set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected '['");
+/* Parse one "key": value member. Members alternate on the sibling chain
+ * (key, value, key, ...), so the value is returned linked as key->next. */
+static inline struct json_val *parse_member(parser_ctx *ctx) {
+    if (peek(ctx) != '"') {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected string key");
         return NULL;
     }
+    struct json_val *key = arena_alloc_val(ctx->doc);
+    if (!key || !parse_string(ctx, key)) return NULL;
 
-    if (ctx->max_depth > 0 && ctx->depth >= ctx->max_depth) {
-        set_error(JSON_ERROR_DEPTH, ctx->pos, ctx->line, ctx->col, "Maximum depth exceeded");
+    if (!consume(ctx, ':')) {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected ':'");
         return NULL;
     }
-    ctx->depth++;
 
-    struct json_val *arr = arena_alloc_val(ctx->doc);
-    if (!arr) return NULL;
-    val_set_type(arr, JSON_ARRAY);
+    struct json_val *value = arena_alloc_val(ctx->doc);
+    if (!value || !parse_value(ctx, value)) return NULL;
+
+    val_set_next(key, value);
+    return key;
+}
+
+/* Parse a literal or number at ctx->pos */
+static bool parse_scalar(parser_ctx *ctx, struct json_val *val) {
+    char c = ctx->pos < ctx->len ? ctx->input[ctx->pos] : '\0';
 
-    /* Empty array */
-    if (peek(ctx) == ']') {
-        consume(ctx, ']');
-        ctx->depth--;
-        return arr;
+    switch (c) {
+        case 'n': return parse_null(ctx, val);
+        case 't': return parse_true(ctx, val);
+        case 'f': return parse_false(ctx, val);
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return parse_number(ctx, val);
+        case '\0':
+            parse_error(ctx, JSON_ERROR_SYNTAX, "Unexpected end of input");
+            return false;
+        default:
+            parse_error(ctx, JSON_ERROR_SYNTAX, "Unexpected character");
+            return false;
     }
+}
 
-    struct json_val *first = NULL;
-    struct json_val *prev = NULL;
+/* ============================================================================
+ * Tree Parser
+ *
+ * One loop builds the whole tree. Open arrays and objects are frames on an
+ * explicit stack rather than C calls, so nesting is bounded by memory and
+ * not by the thread's stack. Each value is dispatched on the char_class of
+ * its first byte, through computed gotos where the compiler has them, and
+ * whitespace is skipped once before every token.
+ *
+ * With a structural index (two-stage parse) the structural characters come
+ * from the index: whitespace is only skipped in the gap after an indexed
+ * character, and anything in a gap that is not whitespace must be a scalar.
+ * ============================================================================ */
 
-    while (1) {
-        struct json_val *elem = parse_value(ctx);
-        if (!elem) return NULL;
+#if defined(__GNUC__) && !defined(JSON_ASM_NO_COMPUTED_GOTO)
+#define PARSE_COMPUTED_GOTO 1
+#endif
 
-        if (!first) {
-            first = elem;
-            arr->child = first;
-        } else {
-            prev->next = elem;
-        }
-        prev = elem;
+/* One open array or object */
+typedef struct {
+    struct json_val *node;      /* The container, or NULL if it is the element at slot */
+    size_t slot;
+    size_t base;                /* Its first element on ctx->stack (arrays) */
+    struct json_val *key;       /* Key waiting for its value (objects) */
+    struct json_val *last;      /* Last member value (objects) */
+    size_t count;               /* Members so far (objects) */
+} parse_frame;
 
-        if (peek(ctx) == ']') {
-            consume(ctx, ']');
-            break;
-        }
-        if (!consume(ctx, ',')) {
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected ',' or ']'");
-            return NULL;
-        }
-        /* Allow trailing comma if flag is set */
-        if ((ctx->flags & JSON_PARSE_ALLOW_TRAILING) && peek(ctx) == ']') {
-            consume(ctx, ']');
-            break;
-        }
+/* Frames kept on the C stack before the frame stack moves to the heap */
+#define PARSE_FRAMES_INLINE 32
+
+typedef struct {
+    parse_frame *frames;
+    size_t len;
+    size_t cap;
+    bool heap;
+} frame_stack;
+
+static bool frame_grow(parser_ctx *ctx, frame_stack *fs) {
+    size_t cap = fs->cap * 2;
+    parse_frame *frames = fs->heap
+        ? realloc(fs->frames, cap * sizeof(parse_frame))
+        : malloc(cap * sizeof(parse_frame));
+    if (!frames) {
+        parse_error(ctx, JSON_ERROR_MEMORY, "Failed to grow parser stack");
+        return false;
+    }
+    if (!fs->heap) {
+        memcpy(frames, fs->frames, fs->len * sizeof(parse_frame));
     }
+    fs->frames = frames;
+    fs->cap = cap;
+    fs->heap = true;
+    return true;
+}
 
-    ctx->depth--;
-    return arr;
+/* Reserve a zeroed element on ctx->stack for the array being parsed */
+static inline struct json_val *stack_slot(parser_ctx *ctx) {
+    if (ctx->stack_len == ctx->stack_cap && !stack_grow(ctx)) return NULL;
+    struct json_val *slot = &ctx->stack[ctx->stack_len++];
+    memset(slot, 0, sizeof(*slot));
+    return slot;
 }
 
-/* Parse object */
-static struct json_val *parse_object(parser_ctx *ctx) {
-    if (!consume(ctx, '{')) {
-        set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected '{'");
-        return NULL;
-    }
+static inline struct json_val *frame_node(parser_ctx *ctx, const parse_frame *f) {
+    return f->node ? f->node : &ctx->stack[f->slot];
+}
+
+/* Skip whitespace and return the next byte, '\0' at the end of the input.
+ * With a structural index, bytes it does not list read as '\0' as well and
+ * are left to parse_scalar(). */
+static inline unsigned char next_token(parser_ctx *ctx) {
+    skip_ws(ctx);
+    if (ctx->pos >= ctx->len) return '\0';
+    if (ctx->idx && ctx->pos != ctx->idx[ctx->idx_pos]) return '\0';
+    return (unsigned char)ctx->input[ctx->pos];
+}
+
+/* Step over the structural byte returned by next_token() (idx_pos is only
+ * read with an index, so it is bumped unconditionally) */
+static inline void advance(parser_ctx *ctx) {
+    ctx->pos++;
+    ctx->idx_pos++;
+}
+
+/* Step into the container at dst, buffered at its slot on ctx->stack if it
+ * is an array element */
+static inline parse_frame *frame_open(parser_ctx *ctx, frame_stack *fs,
+                                      struct json_val *dst, bool buffered) {
+    advance(ctx);
 
     if (ctx->max_depth > 0 && ctx->depth >= ctx->max_depth) {
-        set_error(JSON_ERROR_DEPTH, ctx->pos, ctx->line, ctx->col, "Maximum depth exceeded");
+        parse_error(ctx, JSON_ERROR_DEPTH, "Maximum depth exceeded");
         return NULL;
     }
+    if (fs->len == fs->cap && !frame_grow(ctx, fs)) return NULL;
     ctx->depth++;
 
-    struct json_val *obj = arena_alloc_val(ctx->doc);
-    if (!obj) return NULL;
-    val_set_type(obj, JSON_OBJECT);
+    parse_frame *f = &fs->frames[fs->len++];
+    f->node = buffered ? NULL : dst;
+    f->slot = buffered ? (size_t)(dst - ctx->stack) : 0;
+    f->base = ctx->stack_len;
+    f->last = NULL;
+    f->count = 0;
+    return f;
+}
 
-    /* Empty object */
-    if (peek(ctx) == '}') {
-        consume(ctx, '}');
-        ctx->depth--;
-        return obj;
+#ifdef PARSE_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+/* Parse any value into val. Array elements are parsed onto the context's
+ * stack and moved into the arena when their array closes; object members
+ * are allocated in the arena as they are read. */
+static bool parse_value(parser_ctx *ctx, struct json_val *val) {
+    parse_frame inline_frames[PARSE_FRAMES_INLINE];
+    frame_stack fs = { inline_frames, 0, PARSE_FRAMES_INLINE, false };
+    bool trailing = (ctx->flags & JSON_PARSE_ALLOW_TRAILING) != 0;
+    struct json_val *dst = val;     /* Where the next value goes */
+    bool buffered = false;          /* dst is an element on ctx->stack */
+    parse_frame *f;
+    unsigned char c;
+    bool ok = false;
+
+#ifdef PARSE_COMPUTED_GOTO
+    static const void *const dispatch[CC_INVALID + 1] = {
+        [CC_SPACE]  = &&scalar, [CC_LBRACE] = &&object, [CC_RBRACE] = &&scalar,
+        [CC_LBRACK] = &&array,  [CC_RBRACK] = &&scalar, [CC_COLON]  = &&scalar,
+        [CC_COMMA]  = &&scalar, [CC_QUOTE]  = &&string, [CC_DIGIT]  = &&number,
+        [CC_MINUS]  = &&number, [CC_ALPHA]  = &&scalar, [CC_ESCAPE] = &&scalar,
+        [CC_CTRL]   = &&scalar, [CC_OTHER]  = &&scalar, [CC_EOF]    = &&scalar,
+        [CC_INVALID] = &&scalar
+    };
+#endif
+
+value:
+    c = next_token(ctx);
+value_at:
+#ifdef PARSE_COMPUTED_GOTO
+    goto *dispatch[char_class[c]];
+#else
+    switch (char_class[c]) {
+        case CC_QUOTE:  goto string;
+        case CC_LBRACK: goto array;
+        case CC_LBRACE: goto object;
+        case CC_DIGIT:
+        case CC_MINUS:  goto number;
+        default:        goto scalar;
+    }
+#endif
+
+string:
+    /* The opening quote is indexed, the closing one is not */
+    ctx->idx_pos++;
+    if (!parse_string(ctx, dst)) goto out;
+    goto done;
+
+number:
+    if (!parse_number(ctx, dst)) goto out;
+    goto done;
+
+scalar:
+    /* Literals, and the errors for anything that cannot start a value */
+    if (!parse_scalar(ctx, dst)) goto out;
+    goto done;
+
+array:
+    f = frame_open(ctx, &fs, dst, buffered);
+    if (!f) goto out;
+    c = next_token(ctx);
+    if (c == ']') goto close_array;
+element:
+    dst = stack_slot(ctx);
+    if (!dst) goto out;
+    buffered = true;
+    goto value_at;
+
+object:
+    f = frame_open(ctx, &fs, dst, buffered);
+    if (!f) goto out;
+    val_set_type(dst, JSON_OBJECT);
+    c = next_token(ctx);
+    if (c == '}') goto close_object;
+member:
+    if (c != '"') {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected string key");
+        goto out;
+    }
+    ctx->idx_pos++;
+    f->key = arena_alloc_val(ctx->doc);
+    if (!f->key || !parse_string(ctx, f->key)) goto out;
+    if (next_token(ctx) != ':') {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected ':'");
+        goto out;
+    }
+    advance(ctx);
+    dst = arena_alloc_val(ctx->doc);
+    if (!dst) goto out;
+    buffered = false;
+    goto value;
+
+done:
+    /* dst is complete: attach it and look past it */
+    if (fs.len == 0) {
+        ok = true;
+        goto out;
+    }
+    f = &fs.frames[fs.len - 1];
+    c = next_token(ctx);
+
+    if (!buffered) {
+        /* Members alternate on the sibling chain: key, value, key, ... */
+        val_set_next(f->key, dst);
+        if (f->last) {
+            val_set_next(f->last, f->key);
+        } else {
+            frame_node(ctx, f)->child = f->key;
+        }
+        f->last = dst;
+        f->count++;
+
+        if (c == ',') {
+            advance(ctx);
+            c = next_token(ctx);
+            /* Allow trailing comma if flag is set */
+            if (trailing && c == '}') goto close_object;
+            goto member;
+        }
+        if (c == '}') goto close_object;
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected ',' or '}'");
+        goto out;
     }
 
-    struct json_val *first = NULL;
-    struct json_val *prev = NULL;
+    if (c == ',') {
+        advance(ctx);
+        c = next_token(ctx);
+        /* Allow trailing comma if flag is set */
+        if (trailing && c == ']') goto close_array;
+        goto element;
+    }
+    if (c == ']') goto close_array;
+    parse_error(ctx, JSON_ERROR_SYNTAX, "Expected ',' or ']'");
+    goto out;
 
-    while (1) {
-        /* Parse key */
-        if (peek(ctx) != '"') {
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected string key");
-            return NULL;
-        }
-        struct json_val *key = parse_string(ctx);
-        if (!key) return NULL;
+close_array:
+    advance(ctx);
+    ctx->depth--;
+    f = &fs.frames[--fs.len];
+    dst = frame_node(ctx, f);
+    buffered = f->node == NULL;
+    if (!array_close(ctx, dst, f->base)) goto out;
+    goto done;
+
+close_object:
+    advance(ctx);
+    ctx->depth--;
+    f = &fs.frames[--fs.len];
+    dst = frame_node(ctx, f);
+    buffered = f->node == NULL;
+    key_index_attach(ctx->doc, dst, f->count, ctx->flags);
+    goto done;
+
+out:
+    if (fs.heap) free(fs.frames);
+    return ok;
+}
 
-        /* Colon */
-        if (!consume(ctx, ':')) {
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected ':'");
-            return NULL;
-        }
+#ifdef PARSE_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+/* Parse the string, number or literal at the start of tok (push parser)
+ * and set *consumed to its length. The token is copied into the document,
+ * as chunks do not outlive the call. */
+struct json_val *parse_token(struct json_doc *doc, const char *tok, size_t len,
+                             uint32_t flags, size_t *consumed) {
+    parser_ctx ctx = {
+        .input = tok,
+        .len = len,
+        .pos = 0,
+        .doc = doc,
+        .flags = flags & ~(uint32_t)(JSON_PARSE_INSITU | JSON_PARSE_BORROW)
+    };
+
+    struct json_val *val = arena_alloc_val(doc);
+    if (!val) return NULL;
+    bool ok = tok[0] == '"' ? parse_string(&ctx, val) : parse_scalar(&ctx, val);
+    *consumed = ctx.pos;
+    return ok ? val : NULL;
+}
+
+bool parse_scalar_at(const char *json, size_t len, size_t pos,
+                     struct json_val *val, size_t *end) {
+    /* Literals and numbers never touch the arena */
+    parser_ctx ctx = { .input = json, .len = len, .pos = pos };
+    bool ok = parse_scalar(&ctx, val);
+    *end = ctx.pos;
+    return ok;
+}
 
-        /* Parse value */
-        struct json_val *value = parse_value(ctx);
-        if (!value) return NULL;
+bool parse_value_at(struct json_doc *doc, const char *json, size_t len,
+                    size_t pos, struct json_val *val, size_t *end) {
+    struct json_val stack[PARSE_STACK_INLINE];
+    parser_ctx ctx = {
+        .input = json,
+        .len = len,
+        .pos = pos,
+        .doc = doc,
+        .stack = stack,
+        .stack_cap = PARSE_STACK_INLINE
+    };
 
-        /* Link key to value */
-        key->child = value;
+    *val = (struct json_val){0};
+    bool ok = parse_value(&ctx, val);
+    stack_free(&ctx);
+    *end = ctx.pos;
+    return ok;
+}
 
-        if (!first) {
-            first = key;
-            obj->child = first;
+bool parse_string_at(const char *json, size_t len, size_t pos,
+                     char *buf, size_t buf_len, size_t *out_len, size_t *end) {
+    parser_ctx ctx = { .input = json, .len = len, .pos = pos + 1 };
+    size_t start = ctx.pos;
+    bool has_escapes;
+    if (!scan_string_body(&ctx, out_len, &has_escapes)) return false;
+    if (end) *end = ctx.pos + 1;
+
+    if (*out_len < buf_len) {
+        if (has_escapes) {
+            decode_string(json + start, ctx.pos - start, buf);
         } else {
-            prev->next = key;
+            memcpy(buf, json + start, *out_len);
         }
-        prev = key;
+        buf[*out_len] = '\0';
+    } else if (buf_len > 0) {
+        buf[0] = '\0';
+    }
+    return true;
+}
+
+/* The root closed at ctx->pos, inside a segment that ends before the input
+ * does; report it as the serial parser would */
+static bool segment_closed_early(parser_ctx *ctx) {
+    ctx->pos++;
+    skip_ws(ctx);
+    parse_error(ctx, JSON_ERROR_SYNTAX, "Trailing content after JSON");
+    return false;
+}
+
+static bool segment_list(parser_ctx *ctx, size_t start, size_t end, bool object,
+                         bool last, struct json_val **first,
+                         struct json_val **tail, size_t *count) {
+    char close = object ? '}' : ']';
+    bool trailing = (ctx->flags & JSON_PARSE_ALLOW_TRAILING) != 0;
 
-        if (peek(ctx) == '}') {
-            consume(ctx, '}');
+    /* Segments start just past the opening bracket or a split comma. A
+     * closing bracket may follow the former, or the latter as a trailing
+     * comma. */
+    bool may_close = ctx->input[start - 1] != ',' || trailing;
+    struct json_val *prev = NULL;
+
+    while (1) {
+        if (may_close && peek(ctx) == close) {
+            if (!last) return segment_closed_early(ctx);
+            ctx->pos++;
             break;
         }
-        if (!consume(ctx, ',')) {
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Expected ',' or '}'");
-            return NULL;
+
+        if (object) {
+            struct json_val *key = parse_member(ctx);
+            if (!key) return false;
+            if (prev) {
+                val_set_next(prev, key);
+            } else {
+                *first = key;
+            }
+            prev = val_next(key);
+        } else {
+            /* Elements go on the stack until the segment ends */
+            struct json_val elem = {0};
+            if (!parse_value(ctx, &elem) || !stack_push(ctx, &elem)) return false;
         }
-        /* Allow trailing comma if flag is set */
-        if ((ctx->flags & JSON_PARSE_ALLOW_TRAILING) && peek(ctx) == '}') {
-            consume(ctx, '}');
+        (*count)++;
+
+        if (peek(ctx) == close) {
+            if (!last) return segment_closed_early(ctx);
+            ctx->pos++;
             break;
         }
+        if (!last && ctx->pos == end) break;
+        if (!consume(ctx, ',')) {
+            parse_error(ctx, JSON_ERROR_SYNTAX,
+                        object ? "Expected ',' or '}'" : "Expected ',' or ']'");
+            return false;
+        }
+        may_close = trailing;
     }
 
-    ctx->depth--;
-    return obj;
+    if (object) {
+        *tail = prev;
+    } else {
+        struct json_val run = {0};
+        if (!array_close(ctx, &run, 0)) return false;
+        *first = run.child;
+        *tail = *count ? run.child + *count - 1 : NULL;
+    }
+
+    if (last) {
+        skip_ws(ctx);
+        if (ctx->pos < ctx->len) {
+            parse_error(ctx, JSON_ERROR_SYNTAX, "Trailing content after JSON");
+            return false;
+        }
+    }
+    return true;
 }
 
-/* Parse any value */
-static struct json_val *parse_value(parser_ctx *ctx) {
-    char c = peek(ctx);
+/* Parse the elements (or members) of the root container that lie in
+ * [start, end) and count them (parallel parse). Members come back as a
+ * sibling chain first..tail, elements as a contiguous run. Segments are
+ * split at top-level commas, so each one is a plain comma-separated list;
+ * the last one runs on to the closing bracket and the end of the input. */
+bool parse_segment(struct json_doc *doc, const char *json, size_t len,
+                   size_t start, size_t end, bool object, bool last,
+                   const json_parse_options *opts, struct json_val **first,
+                   struct json_val **tail, size_t *count) {
+    struct json_val stack[PARSE_STACK_INLINE];
+    parser_ctx ctx = {
+        .input = json,
+        .len = last ? len : end,
+        .pos = start,
+        .doc = doc,
+        .flags = opts->flags,
+        .max_depth = opts->max_depth,
+        .depth = 1,
+        .stack = stack,
+        .stack_cap = PARSE_STACK_INLINE
+    };
 
-    switch (c) {
-        case 'n': return parse_null(ctx);
-        case 't': return parse_true(ctx);
-        case 'f': return parse_false(ctx);
-        case '"': return parse_string(ctx);
-        case '[': return parse_array(ctx);
-        case '{': return parse_object(ctx);
-        case '-':
-        case '0': case '1': case '2': case '3': case '4':
-        case '5': case '6': case '7': case '8': case '9':
-            return parse_number(ctx);
-        case '\0':
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Unexpected end of input");
-            return NULL;
-        default:
-            set_error(JSON_ERROR_SYNTAX, ctx->pos, ctx->line, ctx->col, "Unexpected character");
-            return NULL;
-    }
+    *first = NULL;
+    *tail = NULL;
+    *count = 0;
+
+    bool ok = segment_list(&ctx, start, end, object, last, first, tail, count);
+    stack_free(&ctx);
+    return ok;
 }
 
-/* Main parse function */
-struct json_doc *parse_json(const char *json, size_t len,
-                            const json_parse_options *opts) {
+/* Initial node arena size for an input of len bytes */
+size_t parse_arena_estimate(size_t len) {
     /* Estimate arena size: assume ~1 value per 4 chars, each value is 24 bytes.
-     * Use at least 64KB to avoid reallocation for small inputs. */
+     * Use at least 64KB for small inputs. If the estimate is short the arena
+     * chains further blocks; nothing already allocated moves. */
     size_t estimated_values = (len / 4) + 1;
     size_t arena_size = estimated_values * sizeof(struct json_val);
     if (arena_size < 64 * 1024) arena_size = 64 * 1024;
-    struct json_doc *doc = arena_create(arena_size);
-    if (!doc) {
-        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
-        return NULL;
-    }
+    return arena_size;
+}
 
+static bool parse_json_run(struct json_doc *doc, const char *json, size_t len,
+                           const json_parse_options *opts,
+                           struct structural_index *index) {
+    struct json_val stack[PARSE_STACK_INLINE];
     parser_ctx ctx = {
         .input = json,
         .len = len,
         .pos = 0,
-        .line = 1,
-        .col = 1,
         .doc = doc,
         .flags = opts ? opts->flags : JSON_PARSE_DEFAULT,
         .max_depth = opts ? opts->max_depth : 0,
-        .depth = 0
+        .depth = 0,
+        .idx = NULL,
+        .idx_pos = 0,
+        .stack = stack,
+        .stack_cap = PARSE_STACK_INLINE
     };
 
-    struct json_val *root = parse_value(&ctx);
-    if (!root) {
-        arena_destroy(doc);
-        return NULL;
+    if (parallel_eligible(json, len, opts)) {
+        return parse_parallel(doc, json, len, opts);
     }
 
-    doc->root = root;
+    /* Offsets are 32-bit; larger inputs use the single-pass parser */
+    if ((ctx.flags & JSON_PARSE_TWO_STAGE) && len <= UINT32_MAX) {
+#ifdef JSON_ASM_STATS
+        uint64_t scan_start = stats_now();
+#endif
+        if (!structural_index_build(index, json, len)) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate structural index");
+            return false;
+        }
+        STATS(doc->stats.scan_ns += stats_now() - scan_start);
+        ctx.idx = index->offsets;
+    }
+
+    struct json_val *root = arena_alloc_val(doc);
+    if (!root) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    bool ok = parse_value(&ctx, root);
+    stack_free(&ctx);
+    intern_release(doc);
+    if (!ok) return false;
 
     /* Check for trailing content */
     skip_ws(&ctx);
     if (ctx.pos < ctx.len) {
-        set_error(JSON_ERROR_SYNTAX, ctx.pos, ctx.line, ctx.col, "Trailing content after JSON");
-        arena_destroy(doc);
+        parse_error(&ctx, JSON_ERROR_SYNTAX, "Trailing content after JSON");
+        return false;
+    }
+
+    doc->root = root;
+    return true;
+}
+
+/* Parse into an empty document. index is reused for two-stage parses and
+ * left allocated for the caller to free or keep. */
+bool parse_json_into(struct json_doc *doc, const char *json, size_t len,
+                     const json_parse_options *opts,
+                     struct structural_index *index) {
+#ifdef JSON_ASM_STATS
+    struct doc_stats before = doc->stats;
+    uint64_t start = stats_now();
+    bool ok = parse_json_run(doc, json, len, opts, index);
+    if (ok) stats_parse_done(doc, len, &before, start, opts ? opts->stats : NULL);
+    return ok;
+#else
+    return parse_json_run(doc, json, len, opts, index);
+#endif
+}
+
+/* Main parse function */
+struct json_doc *parse_json(const char *json, size_t len,
+                            const json_parse_options *opts) {
+    /* Reuse a warm document from this thread's pool when there is one */
+    struct json_doc *doc = doc_pool_get();
+    if (!doc) {
+        doc = arena_create(parse_arena_estimate(len));
+        if (!doc) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+            return NULL;
+        }
+    }
+
+    struct structural_index index = {0};
+    bool ok = parse_json_into(doc, json, len, opts, &index);
+    structural_index_free(&index);
+    if (!ok) {
+        doc_release(doc);
         return NULL;
     }
 
     return doc;
 }
 
+/* ============================================================================
+ * Validation
+ * ============================================================================ */
+
+/* Open containers, one bit each, set for objects */
+typedef struct {
+    uint64_t *words;
+    size_t cap;                 /* In containers */
+    bool heap;
+} bit_stack;
+
+/* Nesting tracked on the C stack before the bits move to the heap */
+#define VALIDATE_DEPTH_INLINE 65536
+
+static bool bit_stack_grow(parser_ctx *ctx, bit_stack *bs) {
+    size_t cap = bs->cap * 2;
+    uint64_t *words = bs->heap
+        ? realloc(bs->words, cap / 64 * sizeof(uint64_t))
+        : malloc(cap / 64 * sizeof(uint64_t));
+    if (!words) {
+        parse_error(ctx, JSON_ERROR_MEMORY, "Failed to grow validator stack");
+        return false;
+    }
+    if (!bs->heap) {
+        memcpy(words, bs->words, bs->cap / 64 * sizeof(uint64_t));
+    }
+    bs->words = words;
+    bs->cap = cap;
+    bs->heap = true;
+    return true;
+}
+
+static bool validate_string(parser_ctx *ctx) {
+    size_t len;
+    bool has_escapes;
+    ctx->pos++;
+    if (!scan_string_body(ctx, &len, &has_escapes)) return false;
+    ctx->pos++;
+    return true;
+}
+
+/* A member's key and colon, up to its value */
+static bool validate_key(parser_ctx *ctx) {
+    if (peek(ctx) != '"') {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected string key");
+        return false;
+    }
+    if (!validate_string(ctx)) return false;
+    if (!consume(ctx, ':')) {
+        parse_error(ctx, JSON_ERROR_SYNTAX, "Expected ':'");
+        return false;
+    }
+    return true;
+}
+
+/* The parser's checks and errors, in a loop instead of recursion and
+ * with nothing built: the open containers are bits on bs, and scalars are
+ * parsed into a node on the stack */
+static bool validate_tree(parser_ctx *ctx, bit_stack *bs) {
+    bool trailing = (ctx->flags & JSON_PARSE_ALLOW_TRAILING) != 0;
+    uint64_t *objects = bs->words;
+    size_t depth = 0;
+    struct json_val scalar;
+
+    for (;;) {
+        char c = peek(ctx);
+        if (c == '[' || c == '{') {
+            ctx->pos++;
+            if (ctx->max_depth > 0 && depth >= ctx->max_depth) {
+                parse_error(ctx, JSON_ERROR_DEPTH, "Maximum depth exceeded");
+                return false;
+            }
+            if (depth == bs->cap) {
+                if (!bit_stack_grow(ctx, bs)) return false;
+                objects = bs->words;
+            }
+            uint64_t bit = 1ULL << (depth & 63);
+            objects[depth >> 6] = c == '{' ? objects[depth >> 6] | bit : objects[depth >> 6] & ~bit;
+            depth++;
+
+            if (peek(ctx) == (c == '{' ? '}' : ']')) {
+                ctx->pos++;
+                depth--;
+            } else {
+                if (c == '{' && !validate_key(ctx)) return false;
+                continue;
+            }
+        } else if (c == '"') {
+            if (!validate_string(ctx)) return false;
+        } else if (!parse_scalar(ctx, &scalar)) {
+            return false;
+        }
+
+        /* A value ended: close containers until one has a next value */
+        while (depth > 0) {
+            bool object = (objects[(depth - 1) >> 6] >> ((depth - 1) & 63)) & 1;
+            char close = object ? '}' : ']';
+            c = peek(ctx);
+            if (c == close) {
+                ctx->pos++;
+                depth--;
+                continue;
+            }
+            if (c != ',') {
+                parse_error(ctx, JSON_ERROR_SYNTAX, object ? "Expected ',' or '}'" : "Expected ',' or ']'");
+                return false;
+            }
+            ctx->pos++;
+            if (trailing && peek(ctx) == close) {
+                ctx->pos++;
+                depth--;
+                continue;
+            }
+            if (object && !validate_key(ctx)) return false;
+            break;
+        }
+        if (depth == 0) return true;
+    }
+}
+
+/* One value from ctx->pos on, leaving ctx->pos just past it */
+static bool validate_value(parser_ctx *ctx) {
+    uint64_t words[VALIDATE_DEPTH_INLINE / 64];
+    bit_stack bs = { words, VALIDATE_DEPTH_INLINE, false };
+    bool ok = validate_tree(ctx, &bs);
+    if (bs.heap) free(bs.words);
+    return ok;
+}
+
+bool validate_json(const char *json, size_t len, const json_parse_options *opts) {
+    parser_ctx ctx = {
+        .input = json,
+        .len = len,
+        .flags = opts ? opts->flags : JSON_PARSE_DEFAULT,
+        .max_depth = opts ? opts->max_depth : 0
+    };
+    if (!validate_value(&ctx)) return false;
+
+    skip_ws(&ctx);
+    if (ctx.pos < ctx.len) {
+        parse_error(&ctx, JSON_ERROR_SYNTAX, "Trailing content after JSON");
+        return false;
+    }
+    return true;
+}
+
+bool validate_value_at(const char *json, size_t len, size_t pos, size_t *end) {
+    parser_ctx ctx = { .input = json, .len = len, .pos = pos };
+    bool ok = validate_value(&ctx);
+    *end = ctx.pos;
+    return ok;
+}
+
 /* ============================================================================
  * Scalar Fallback Implementations
  * ============================================================================ */
 
 size_t scan_string_scalar(const char *str, size_t len) {
-    for (size_t i = 0; i < len; i++) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x;
+        memcpy(&x, str + i, 8);
+        uint64_t hi = swar_eq(x, '"') | swar_eq(x, '\\') | swar_lt(x, 0x20);
+        if (hi) return i + swar_first(hi);
+    }
+    for (; i < len; i++) {
         unsigned char c = (unsigned char)str[i];
         if (c == '"' || c == '\\' || c < 0x20) {
             return i;
@@ -696,22 +1404,98 @@ size_t scan_string_scalar(const char *str, size_t len) {
     return len;
 }
 
+/* UTF-8 as in Unicode table 3-7: no overlong forms, surrogates or code
+ * points past U+10FFFF. Exact: returns the start of the bad sequence. */
+size_t validate_utf8_scalar(const char *str, size_t len) {
+    const unsigned char *s = (const unsigned char *)str;
+    size_t i = 0;
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t x;
+            memcpy(&x, s + i, 8);
+            if (!(x & ~SWAR_LOW7)) {
+                i += 8;
+                continue;
+            }
+        }
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+
+        /* Sequence length and the range of its second byte */
+        size_t n;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            n = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 3;
+            if (c == 0xE0) lo = 0xA0;           /* Overlong */
+            else if (c == 0xED) hi = 0x9F;      /* Surrogates */
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 4;
+            if (c == 0xF0) lo = 0x90;           /* Overlong */
+            else if (c == 0xF4) hi = 0x8F;      /* Past U+10FFFF */
+        } else {
+            return i;
+        }
+        if (len - i < n || s[i + 1] < lo || s[i + 1] > hi) return i;
+        for (size_t k = 2; k < n; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) return i;
+        }
+        i += n;
+    }
+    return len;
+}
+
+size_t utf8_error_offset(const char *str, size_t len, size_t hint) {
+    /* The bad sequence starts at most 3 bytes before hint, and is not one
+     * of the continuation bytes passed over on the way forward */
+    size_t start = hint > 3 ? hint - 3 : 0;
+    while (start < hint && ((unsigned char)str[start] & 0xC0) == 0x80) start++;
+    return start + validate_utf8_scalar(str + start, len - start);
+}
+
+size_t skip_whitespace_scalar(const char *str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!is_ws(str[i])) {
+            return i;
+        }
+    }
+    return len;
+}
+
+/* Structural characters {}[]:," */
+static const uint8_t is_structural[256] = {
+    ['{'] = 1, ['}'] = 1, ['['] = 1, [']'] = 1,
+    [':'] = 1, [','] = 1, ['"'] = 1
+};
+
 size_t find_structural_scalar(const char *str, size_t len, uint64_t *mask) {
     uint64_t m = 0;
     size_t count = len < 64 ? len : 64;
-    for (size_t i = 0; i < count; i++) {
-        char c = str[i];
-        if (c == '{' || c == '}' || c == '[' || c == ']' ||
-            c == ':' || c == ',' || c == '"') {
-            m |= (1ULL << i);
-        }
+    size_t i = 0;
+
+    /* Eight bytes at a time. '[' and ']' differ from '{' and '}' only in
+     * bit 5, so setting it folds the brackets into the braces. */
+    for (; i + 8 <= count; i += 8) {
+        uint64_t x;
+        memcpy(&x, str + i, 8);
+        uint64_t folded = x | (SWAR_ONES * 0x20);
+        uint64_t hi = swar_eq(folded, '{') | swar_eq(folded, '}') |
+                      swar_eq(x, ':') | swar_eq(x, ',') | swar_eq(x, '"');
+        m |= swar_movemask(hi) << i;
+    }
+    for (; i < count; i++) {
+        m |= (uint64_t)is_structural[(unsigned char)str[i]] << i;
     }
     *mask = m;
     return count;
 }
 
 int64_t parse_int_scalar(const char *str, size_t len, size_t *consumed) {
-    int64_t result = 0;
+    uint64_t result = 0;
     bool negative = false;
     size_t i = 0;
 
@@ -720,23 +1504,15 @@ int64_t parse_int_scalar(const char *str, size_t len, size_t *consumed) {
         i++;
     }
 
-    while (i < len && str[i] >= '0' && str[i] <= '9') {
-        result = result * 10 + (str[i] - '0');
+    /* Same contract as the SIMD kernels: at most 19 digits, wrapping */
+    size_t end = len - i > 19 ? i + 19 : len;
+    size_t digits_start = i;
+    while (i < end && is_digit(str[i])) {
+        result = result * 10 + (uint64_t)(str[i] - '0');
         i++;
     }
+    if (i == digits_start) i = 0;
 
     if (consumed) *consumed = i;
-    return negative ? -result : result;
-}
-
-double parse_float_scalar(const char *str, size_t len, size_t *consumed) {
-    char buf[64];
-    size_t copy_len = len < 63 ? len : 63;
-    memcpy(buf, str, copy_len);
-    buf[copy_len] = '\0';
-
-    char *end;
-    double result = strtod(buf, &end);
-    if (consumed) *consumed = (size_t)(end - buf);
-    return result;
+    return (int64_t)(negative ? 0 - result : result);
 }
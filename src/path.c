@@ -0,0 +1,275 @@
+/*
+ * json-asm: Compiled JSON Pointer queries
+ *
+ * A pointer (RFC 6901, plus "*" segments matching every element or member)
+ * is split and unescaped once, and each segment keeps what the lookups need
+ * precomputed:
+ *
+ *   - the key's hash, for the key index of wide objects;
+ *   - for keys of up to 7 bytes, the first word of an inline string node
+ *     holding that key, so scanning a small object compares one word per
+ *     member;
+ *   - the array index the segment spells, if any, for direct access into
+ *     the contiguous element run.
+ *
+ * The same query runs on a parsed tree or, through the cursor, on raw input,
+ * where only the matched values are parsed.
+ */
+
+#include "internal.h"
+#include <stdint.h>
+
+#define PATH_MATCHES_MIN 8      /* First capacity of the projection's match list */
+
+struct path_segment {
+    const char *key;            /* Unescaped segment */
+    size_t len;
+    uint64_t hash;              /* key_hash() of key */
+    uint64_t short_tag;         /* Tag and length of key as an inline string, or 0 */
+    int64_t short_word;         /* Its inline bytes, NUL-padded */
+    size_t index;               /* Array index, or SIZE_MAX if key is not one */
+    bool wildcard;              /* The segment is "*" */
+};
+
+struct json_path {
+    size_t count;
+    struct path_segment segs[];  /* Followed by the unescaped key bytes */
+};
+
+/* ============================================================================
+ * Compilation
+ * ============================================================================ */
+
+/* Array index spelled by a segment: digits without a leading zero */
+static size_t segment_index(const char *s, size_t len) {
+    if (len == 0 || len > 19 || (s[0] == '0' && len > 1)) return SIZE_MAX;
+    uint64_t index = 0;
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)(s[i] - '0') > 9) return SIZE_MAX;
+        index = index * 10 + (uint64_t)(s[i] - '0');
+    }
+    return index < SIZE_MAX ? (size_t)index : SIZE_MAX;
+}
+
+struct json_path *path_compile(const char *pointer, size_t len) {
+    if (len > 0 && pointer[0] != '/') {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "JSON Pointer must start with '/'");
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) count += pointer[i] == '/';
+
+    /* Unescaping only shrinks the keys, so len bytes hold them all */
+    struct json_path *path = malloc(sizeof(struct json_path) +
+                                    count * sizeof(struct path_segment) + len + 1);
+    if (!path) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    path->count = count;
+    char *keys = (char *)&path->segs[count];
+
+    size_t pos = 1;
+    for (size_t n = 0; n < count; n++) {
+        struct path_segment *seg = &path->segs[n];
+        seg->key = keys;
+
+        char *dst = keys;
+        for (; pos < len && pointer[pos] != '/'; pos++) {
+            if (pointer[pos] != '~') {
+                *dst++ = pointer[pos];
+                continue;
+            }
+            char esc = pos + 1 < len ? pointer[pos + 1] : '\0';
+            if (esc != '0' && esc != '1') {
+                free(path);
+                set_error(JSON_ERROR_SYNTAX, pos, 1, pos + 1, "Invalid '~' escape in JSON Pointer");
+                return NULL;
+            }
+            *dst++ = esc == '0' ? '~' : '/';
+            pos++;
+        }
+        pos++;
+
+        seg->len = (size_t)(dst - keys);
+        seg->hash = key_hash(seg->key, seg->len);
+        seg->index = segment_index(seg->key, seg->len);
+        seg->wildcard = seg->len == 1 && seg->key[0] == '*';
+        seg->short_tag = 0;
+        seg->short_word = 0;
+        if (seg->len <= JSON_SHORT_STR_MAX) {
+            seg->short_tag = JSON_STRING_SHORT | ((uint64_t)seg->len << JSON_PAYLOAD_SHIFT);
+            memcpy(&seg->short_word, seg->key, seg->len);
+        }
+        keys = dst;
+    }
+    return path;
+}
+
+/* ============================================================================
+ * Evaluation on a Tree
+ * ============================================================================ */
+
+static struct json_val *step(const struct path_segment *seg, struct json_val *v) {
+    json_type t = val_get_type(v);
+
+    if (t == JSON_ARRAY) {
+        return seg->index < val_arr_count(v) ? &v->child[seg->index] : NULL;
+    }
+    if (t != JSON_OBJECT) return NULL;
+
+    struct json_val *value;
+    if (val_key_index(v) && key_index_find(v, seg->key, seg->len, seg->hash, &value)) {
+        return value;
+    }
+    for (struct json_val *k = val_child(v); k; k = val_next(val_next(k))) {
+        /* Keys up to 7 bytes are inline: tag and length in the low byte,
+         * the bytes in the data word. Only a key with escapes in the input
+         * is stored out of line. */
+        if ((k->tag_payload & 0xFF) == seg->short_tag && k->int_val == seg->short_word) {
+            return val_next(k);
+        }
+        size_t len;
+        if (val_get_type(k) == JSON_STRING_LONG) {
+            const char *str = val_str(k, &len);
+            if (len == seg->len && memcmp(str, seg->key, len) == 0) return val_next(k);
+        }
+    }
+    return NULL;
+}
+
+static size_t eval_from(const struct json_path *path, size_t i, struct json_val *v,
+                        struct json_val **out, size_t max, bool all, size_t found) {
+    /* Plain segments are followed in a loop; only wildcards branch */
+    for (; i < path->count; i++) {
+        const struct path_segment *seg = &path->segs[i];
+        if (!seg->wildcard) {
+            v = step(seg, v);
+            if (!v) return found;
+            continue;
+        }
+
+        json_type t = val_get_type(v);
+        if (t == JSON_ARRAY) {
+            for (struct json_val *e = v->child; e && (all || !found); e = val_next(e)) {
+                found = eval_from(path, i + 1, e, out, max, all, found);
+            }
+        } else if (t == JSON_OBJECT) {
+            for (struct json_val *k = val_child(v); k && (all || !found); k = val_next(val_next(k))) {
+                found = eval_from(path, i + 1, val_next(k), out, max, all, found);
+            }
+        }
+        return found;
+    }
+
+    if (found < max) out[found] = v;
+    return found + 1;
+}
+
+size_t path_eval(const struct json_path *path, struct json_val *root,
+                 struct json_val **out, size_t max, bool all) {
+    return eval_from(path, 0, root, out, max, all, 0);
+}
+
+/* ============================================================================
+ * Projection Parse
+ * ============================================================================ */
+
+struct projection {
+    struct json_doc *doc;
+    struct json_val *vals;      /* Matched values, parsed */
+    size_t count;
+    size_t capacity;
+};
+
+static bool project_value(struct projection *p, const json_cursor *cur) {
+    if (p->count == p->capacity) {
+        size_t cap = p->capacity ? p->capacity * 2 : PATH_MATCHES_MIN;
+        struct json_val *vals = realloc(p->vals, cap * sizeof(struct json_val));
+        if (!vals) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+            return false;
+        }
+        p->vals = vals;
+        p->capacity = cap;
+    }
+    size_t end;
+    if (!parse_value_at(p->doc, cur->json, cur->len, cur->pos, &p->vals[p->count], &end)) {
+        return false;
+    }
+    p->count++;
+    return true;
+}
+
+/* A cursor call that returned false: the end, or an error */
+static inline bool cursor_failed(void) {
+    return g_last_error.code != JSON_OK;
+}
+
+static bool project_from(const struct json_path *path, size_t i, json_cursor cur,
+                         struct projection *p) {
+    for (; i < path->count; i++) {
+        const struct path_segment *seg = &path->segs[i];
+        char c = cur.json[cur.pos];
+        json_cursor next;
+
+        if (seg->wildcard) {
+            if (c != '[' && c != '{') return true;
+            if (!cursor_child(&cur, &next)) return !cursor_failed();
+            do {
+                if (!project_from(path, i + 1, next, p)) return false;
+            } while (cursor_next(&next));
+            return !cursor_failed();
+        }
+
+        if (c == '{') {
+            if (!cursor_find(&cur, seg->key, seg->len, &next)) return !cursor_failed();
+        } else if (c == '[' && seg->index != SIZE_MAX) {
+            if (!cursor_child(&cur, &next)) return !cursor_failed();
+            for (size_t n = 0; n < seg->index; n++) {
+                if (!cursor_next(&next)) return !cursor_failed();
+            }
+        } else {
+            return true;
+        }
+        cur = next;
+    }
+    return project_value(p, &cur);
+}
+
+struct json_doc *path_parse(const struct json_path *path, const char *json, size_t len) {
+    json_cursor root;
+    if (!cursor_init(&root, json, len)) return NULL;
+
+    struct projection p = { .doc = arena_create(0) };
+    if (!p.doc) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+        return NULL;
+    }
+
+    struct json_val *arr = arena_alloc_val(p.doc);
+    bool ok = arr && project_from(path, 0, root, &p);
+    struct json_val *elems = ok && p.count ? arena_alloc_vals(p.doc, p.count) : NULL;
+    if (!ok || (p.count && !elems)) {
+        if (ok) set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        free(p.vals);
+        arena_destroy(p.doc);
+        return NULL;
+    }
+
+    /* The matches become one contiguous run under the root array */
+    val_reset(arr, JSON_ARRAY);
+    val_set_next(arr, NULL);
+    val_set_arr_count(arr, p.count);
+    arr->child = elems;
+    if (p.count) {
+        memcpy(elems, p.vals, p.count * sizeof(struct json_val));
+        for (size_t i = 0; i + 1 < p.count; i++) val_set_next(&elems[i], &elems[i + 1]);
+        val_set_next(&elems[p.count - 1], NULL);
+    }
+    free(p.vals);
+
+    p.doc->root = arr;
+    return p.doc;
+}
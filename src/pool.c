@@ -0,0 +1,194 @@
+/*
+ * json-asm: Reusable parsers and thread-local document pool
+ *
+ * json_doc_free() parks small documents in a per-thread pool instead of
+ * releasing them, and json_parse() takes from that pool first, so tight
+ * parse/free loops on small messages stop hitting the allocator.
+ *
+ * Documents made by a batch worker are freed on the caller's thread, where
+ * the thread pool would keep them from the worker for good. They carry the
+ * worker's home instead and go back to it, so each worker reuses its own.
+ */
+
+#include "internal.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#define DOC_POOL_SIZE       4                   /* Documents kept per thread */
+#define DOC_POOL_MAX_BYTES  (1024 * 1024)       /* Larger documents are freed */
+#define DOC_HOME_MAX_BYTES  (8 * 1024 * 1024)   /* Per worker, all documents */
+
+struct doc_pool {
+    struct json_doc *docs[DOC_POOL_SIZE];
+    size_t count;
+    bool registered;            /* Thread-exit destructor installed */
+};
+
+static _Thread_local struct doc_pool t_pool;
+
+static void doc_pool_drain(struct doc_pool *pool) {
+    while (pool->count > 0) {
+        arena_destroy(pool->docs[--pool->count]);
+    }
+}
+
+#if !defined(_WIN32)
+static pthread_key_t g_pool_key;
+static pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+static void doc_pool_thread_exit(void *arg) {
+    doc_pool_drain(arg);
+}
+
+static void doc_pool_key_create(void) {
+    pthread_key_create(&g_pool_key, doc_pool_thread_exit);
+}
+
+/* Make sure the pool is drained when the thread exits */
+static void doc_pool_register(struct doc_pool *pool) {
+    pthread_once(&g_pool_once, doc_pool_key_create);
+    pthread_setspecific(g_pool_key, pool);
+    pool->registered = true;
+}
+#else
+static void doc_pool_register(struct doc_pool *pool) {
+    /* No thread-exit hook; json_pool_clear() releases the pool */
+    pool->registered = true;
+}
+#endif
+
+struct json_doc *doc_pool_get(void) {
+    struct doc_pool *pool = &t_pool;
+    if (pool->count == 0) return NULL;
+    return pool->docs[--pool->count];
+}
+
+bool doc_pool_put(struct json_doc *doc) {
+    struct doc_pool *pool = &t_pool;
+    if (pool->count >= DOC_POOL_SIZE) return false;
+    if (doc->arena_size + doc->strings_size > DOC_POOL_MAX_BYTES) return false;
+
+    if (!pool->registered) doc_pool_register(pool);
+
+    arena_reset(doc);
+    pool->docs[pool->count++] = doc;
+    return true;
+}
+
+#if !defined(_WIN32)
+/* Called with the batch pool's submit lock held, which orders the first
+ * initialisation against everything else */
+void doc_home_open(struct doc_home *home) {
+    if (!home->ready) {
+        pthread_mutex_init(&home->lock, NULL);
+        home->ready = true;
+    }
+    pthread_mutex_lock(&home->lock);
+    home->open = true;
+    pthread_mutex_unlock(&home->lock);
+}
+
+/* Free the cached documents; those still out are freed when released */
+void doc_home_close(struct doc_home *home) {
+    pthread_mutex_lock(&home->lock);
+    home->open = false;
+    while (home->count > 0) {
+        arena_destroy(home->docs[--home->count]);
+    }
+    home->bytes = 0;
+    pthread_mutex_unlock(&home->lock);
+}
+
+struct json_doc *doc_home_get(struct doc_home *home) {
+    struct json_doc *doc = NULL;
+    pthread_mutex_lock(&home->lock);
+    if (home->count > 0) {
+        doc = home->docs[--home->count];
+        home->bytes -= doc->arena_size + doc->strings_size;
+    }
+    pthread_mutex_unlock(&home->lock);
+    return doc;
+}
+
+static bool doc_home_put(struct doc_home *home, struct json_doc *doc) {
+    size_t size = doc->arena_size + doc->strings_size;
+    if (size > DOC_POOL_MAX_BYTES) return false;
+
+    /* Reset outside the lock; a document that then finds no room is
+     * simply freed */
+    arena_reset(doc);
+    size = doc->arena_size + doc->strings_size;
+
+    bool kept = false;
+    pthread_mutex_lock(&home->lock);
+    if (home->open && home->count < DOC_HOME_SIZE &&
+        home->bytes + size <= DOC_HOME_MAX_BYTES) {
+        home->docs[home->count++] = doc;
+        home->bytes += size;
+        kept = true;
+    }
+    pthread_mutex_unlock(&home->lock);
+    return kept;
+}
+#endif
+
+void doc_release(struct json_doc *doc) {
+#if !defined(_WIN32)
+    if (doc->home) {
+        if (!doc_home_put(doc->home, doc)) arena_destroy(doc);
+        return;
+    }
+#endif
+    if (!doc_pool_put(doc)) {
+        arena_destroy(doc);
+    }
+}
+
+void doc_pool_clear(void) {
+    doc_pool_drain(&t_pool);
+}
+
+/* ============================================================================
+ * Reusable Parser
+ * ============================================================================ */
+
+struct json_parser *parser_create(const json_parse_options *opts) {
+    struct json_parser *parser = calloc(1, sizeof(struct json_parser));
+    if (!parser) return NULL;
+    if (opts) {
+        parser->opts = *opts;
+    }
+    return parser;
+}
+
+struct json_doc *parser_parse(struct json_parser *parser,
+                              const char *json, size_t len) {
+    /* Any json_feed() document in progress lives in the same arena */
+    feed_cancel(parser->feed);
+    if (parser->doc) {
+        arena_reset(parser->doc);
+    } else {
+        parser->doc = arena_create(parse_arena_estimate(len));
+        if (!parser->doc) {
+            set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+            return NULL;
+        }
+        parser->doc->owner = parser;
+    }
+
+    if (!parse_json_into(parser->doc, json, len, &parser->opts, &parser->index)) {
+        return NULL;
+    }
+    return parser->doc;
+}
+
+void parser_destroy(struct json_parser *parser) {
+    if (parser->doc) {
+        arena_destroy(parser->doc);
+    }
+    structural_index_free(&parser->index);
+    feed_destroy(parser->feed);
+    free(parser);
+}
@@ -0,0 +1,343 @@
+/*
+ * json-asm: Schema-driven decoding into C structs
+ *
+ * A schema lists the members of one message type and where each goes in a
+ * struct. It is compiled once into a perfect hash of its keys: a multiply
+ * and a shift of a hash over the key's first and last 8 bytes and its
+ * length pick the one field the key can be, and a single memcmp confirms
+ * it. Decoding then walks the input once, storing each known member
+ * straight into the struct with the parser's scalar and string routines;
+ * no nodes are built. Unknown members are validated and stepped over.
+ *
+ * The encoder, which writes a struct back out through the same number and
+ * string writers as json_stringify(), is in stringify.c.
+ */
+
+#include "internal.h"
+#include <stdint.h>
+
+#define SCHEMA_HASH_TRIES   64      /* Multipliers tried per table size */
+#define SCHEMA_HASH_GROWTH  4       /* Table doublings tried past the smallest */
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline size_t skip_ws(const char *json, size_t len, size_t pos) {
+    if (pos >= len || !is_ws(json[pos])) return pos;
+    pos++;
+    if (pos >= len || !is_ws(json[pos])) return pos;
+    return pos + g_json_ops.skip_whitespace(json + pos, len - pos);
+}
+
+/* ============================================================================
+ * Compilation
+ * ============================================================================ */
+
+/* Key hash before the multiply. Cheap enough to run on every member of the
+ * input; keys that differ only in bytes 8 from both ends fall back to the
+ * full key_hash(). */
+static inline uint64_t schema_key_word(const struct json_schema *s, const char *key, size_t len) {
+    if (s->full_hash) return key_hash(key, len);
+    uint64_t first = 0, last = 0;
+    size_t n = len < 8 ? len : 8;
+    memcpy(&first, key, n);
+    memcpy(&last, key + len - n, n);
+    return first ^ ((last << 29) | (last >> 35)) ^ ((uint64_t)len << 56);
+}
+
+static inline size_t schema_slot(const struct json_schema *s, const char *key, size_t len) {
+    return (size_t)((schema_key_word(s, key, len) * s->seed) >> s->shift);
+}
+
+/* Multipliers to try: odd, and spread over all 64 bits */
+static uint64_t schema_seed(unsigned i) {
+    uint64_t z = 0x9E3779B97F4A7C15ULL * (i + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) | 1;
+}
+
+/* log2 of the smallest slot table for count keys */
+static unsigned schema_min_bits(size_t count) {
+    unsigned bits = 1;
+    while (((size_t)1 << bits) < count) bits++;
+    return bits;
+}
+
+/* Find a multiplier under which no two keys share a slot */
+static bool schema_place(struct json_schema *s) {
+    unsigned min_bits = schema_min_bits(s->count);
+
+    for (unsigned bits = min_bits; bits <= min_bits + SCHEMA_HASH_GROWTH; bits++) {
+        size_t slots = (size_t)1 << bits;
+        s->shift = 64 - bits;
+        for (unsigned t = 0; t < SCHEMA_HASH_TRIES; t++) {
+            s->seed = schema_seed(t);
+            memset(s->slots, 0, slots * sizeof(*s->slots));
+            size_t i = 0;
+            for (; i < s->count; i++) {
+                const struct schema_field *f = &s->fields[i];
+                size_t slot = schema_slot(s, f->key, f->key_len);
+                if (s->slots[slot]) break;
+                s->slots[slot] = (uint16_t)(i + 1);
+            }
+            if (i == s->count) return true;
+        }
+    }
+    return false;
+}
+
+/* "key": as it is written out, if the key needs no escaping */
+static bool schema_plain_key(const char *key, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)key[i];
+        if (c < 0x20 || c == '"' || c == '\\') return false;
+    }
+    return true;
+}
+
+static bool schema_field_valid(const json_field *f) {
+    if (!f->key || strlen(f->key) > SCHEMA_KEY_MAX) return false;
+    switch (f->type) {
+        case JSON_FIELD_BOOL:
+        case JSON_FIELD_INT32:
+        case JSON_FIELD_INT64:
+        case JSON_FIELD_DOUBLE:
+            return true;
+        case JSON_FIELD_STRING:
+            return f->size > 0;
+        case JSON_FIELD_OBJECT:
+            return f->schema != NULL;
+    }
+    return false;
+}
+
+struct json_schema *schema_compile(const json_field *fields, size_t count) {
+    if (count == 0 || count > SCHEMA_MAX_FIELDS) {
+        set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "Invalid schema field count");
+        return NULL;
+    }
+
+    size_t key_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!schema_field_valid(&fields[i])) {
+            set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "Invalid schema field");
+            return NULL;
+        }
+        /* Room for the quoted key and colon, '"' key '"' ':', too */
+        key_bytes += 2 * strlen(fields[i].key) + 4;
+    }
+
+    /* Fields, then the largest slot table that may be needed, then keys */
+    size_t max_slots = (size_t)1 << (schema_min_bits(count) + SCHEMA_HASH_GROWTH);
+    size_t slots_at = sizeof(struct json_schema) + count * sizeof(struct schema_field);
+    size_t keys_at = slots_at + max_slots * sizeof(uint16_t);
+    struct json_schema *s = malloc(keys_at + key_bytes);
+    if (!s) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    s->count = count;
+    s->full_hash = false;
+    s->slots = (uint16_t *)((char *)s + slots_at);
+
+    char *keys = (char *)s + keys_at;
+    for (size_t i = 0; i < count; i++) {
+        struct schema_field *f = &s->fields[i];
+        size_t len = strlen(fields[i].key);
+        memcpy(keys, fields[i].key, len);
+        f->key = keys;
+        f->key_len = len;
+        keys += len;
+
+        f->quoted = NULL;
+        f->quoted_len = 0;
+        if (schema_plain_key(f->key, len)) {
+            keys[0] = '"';
+            memcpy(keys + 1, f->key, len);
+            keys[len + 1] = '"';
+            keys[len + 2] = ':';
+            f->quoted = keys;
+            f->quoted_len = len + 3;
+            keys += len + 3;
+        }
+
+        f->type = fields[i].type;
+        f->offset = fields[i].offset;
+        f->size = fields[i].size;
+        f->schema = fields[i].schema;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (s->fields[i].key_len == s->fields[j].key_len &&
+                memcmp(s->fields[i].key, s->fields[j].key, s->fields[i].key_len) == 0) {
+                free(s);
+                set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "Duplicate schema key");
+                return NULL;
+            }
+        }
+    }
+
+    if (!schema_place(s)) {
+        s->full_hash = true;
+        if (!schema_place(s)) {
+            free(s);
+            set_error(JSON_ERROR_SYNTAX, 0, 0, 0, "No perfect hash for schema keys");
+            return NULL;
+        }
+    }
+    return s;
+}
+
+/* ============================================================================
+ * Decoding
+ * ============================================================================ */
+
+static const struct schema_field *schema_find(const struct json_schema *s,
+                                              const char *key, size_t len) {
+    size_t i = s->slots[schema_slot(s, key, len)];
+    if (!i) return NULL;
+    const struct schema_field *f = &s->fields[i - 1];
+    return f->key_len == len && memcmp(f->key, key, len) == 0 ? f : NULL;
+}
+
+static bool decode_object(const struct json_schema *s, const char *json, size_t len,
+                          size_t *pos, char *out);
+
+static bool type_error(const char *json, size_t len, size_t pos) {
+    input_error(json, len, pos, JSON_ERROR_TYPE, "Unexpected value type");
+    return false;
+}
+
+/* The member value at *pos into its field; null leaves the field alone */
+static bool decode_field(const struct schema_field *f, const char *json, size_t len,
+                         size_t *pos, char *out) {
+    size_t at = *pos;
+    char *dst = out + f->offset;
+    char c = json[at];
+
+    if (c == '{' && f->type == JSON_FIELD_OBJECT) {
+        return decode_object(f->schema, json, len, pos, dst);
+    }
+    if (c == '"') {
+        if (f->type != JSON_FIELD_STRING) return type_error(json, len, at);
+        size_t str_len;
+        if (!parse_string_at(json, len, at, dst, f->size, &str_len, pos)) return false;
+        if (str_len >= f->size) {
+            input_error(json, len, at, JSON_ERROR_STRING, "String too long for field");
+            return false;
+        }
+        return true;
+    }
+    if (c == '[' || c == '{') return type_error(json, len, at);
+
+    struct json_val val;
+    if (!parse_scalar_at(json, len, at, &val, pos)) return false;
+    json_type t = val_get_type(&val);
+    if (t == JSON_NULL) return true;
+
+    switch (f->type) {
+        case JSON_FIELD_BOOL:
+            if (t != JSON_TRUE && t != JSON_FALSE) return type_error(json, len, at);
+            *(bool *)dst = t == JSON_TRUE;
+            return true;
+        case JSON_FIELD_INT32:
+            if (t != JSON_INT || val.int_val < INT32_MIN || val.int_val > INT32_MAX) {
+                return type_error(json, len, at);
+            }
+            *(int32_t *)dst = (int32_t)val.int_val;
+            return true;
+        case JSON_FIELD_INT64:
+            if (t != JSON_INT) return type_error(json, len, at);
+            *(int64_t *)dst = val.int_val;
+            return true;
+        case JSON_FIELD_DOUBLE:
+            if (t != JSON_INT && t != JSON_FLOAT) return type_error(json, len, at);
+            *(double *)dst = t == JSON_INT ? (double)val.int_val : val.float_val;
+            return true;
+        default:
+            return type_error(json, len, at);
+    }
+}
+
+/* The object at *pos into out, leaving *pos just past it */
+static bool decode_object(const struct json_schema *s, const char *json, size_t len,
+                          size_t *pos, char *out) {
+    size_t p = *pos + 1;
+    char key_buf[SCHEMA_KEY_MAX + 1];
+
+    p = skip_ws(json, len, p);
+    if (p < len && json[p] == '}') {
+        *pos = p + 1;
+        return true;
+    }
+
+    for (;;) {
+        if (p >= len || json[p] != '"') {
+            input_error(json, len, p, JSON_ERROR_SYNTAX, "Expected string key");
+            return false;
+        }
+
+        /* Keys without escapes are matched where they are */
+        const char *key = json + p + 1;
+        size_t key_len = g_json_ops.scan_string(key, len - p - 1);
+        size_t end = p + 1 + key_len;
+        if (end < len && json[end] == '"') {
+            end++;
+        } else {
+            if (!parse_string_at(json, len, p, key_buf, sizeof(key_buf), &key_len, &end)) {
+                return false;
+            }
+            key = key_buf;
+        }
+        const struct schema_field *f = key_len <= SCHEMA_KEY_MAX ? schema_find(s, key, key_len) : NULL;
+
+        p = skip_ws(json, len, end);
+        if (p >= len || json[p] != ':') {
+            input_error(json, len, p, JSON_ERROR_SYNTAX, "Expected ':'");
+            return false;
+        }
+        p = skip_ws(json, len, p + 1);
+        if (p >= len) {
+            input_error(json, len, p, JSON_ERROR_SYNTAX, "Unexpected end of input");
+            return false;
+        }
+
+        bool ok = f ? decode_field(f, json, len, &p, out) : validate_value_at(json, len, p, &p);
+        if (!ok) return false;
+
+        p = skip_ws(json, len, p);
+        if (p < len && json[p] == ',') {
+            p = skip_ws(json, len, p + 1);
+            continue;
+        }
+        if (p < len && json[p] == '}') {
+            *pos = p + 1;
+            return true;
+        }
+        input_error(json, len, p, JSON_ERROR_SYNTAX, "Expected ',' or '}'");
+        return false;
+    }
+}
+
+bool schema_decode(const struct json_schema *s, const char *json, size_t len, void *out) {
+    size_t pos = skip_ws(json, len, 0);
+    if (pos >= len) {
+        set_error(JSON_ERROR_SYNTAX, 0, 1, 1, "Empty input");
+        return false;
+    }
+    if (json[pos] != '{') {
+        input_error(json, len, pos, JSON_ERROR_SYNTAX, "Expected '{'");
+        return false;
+    }
+    if (!decode_object(s, json, len, &pos, out)) return false;
+
+    pos = skip_ws(json, len, pos);
+    if (pos < len) {
+        input_error(json, len, pos, JSON_ERROR_SYNTAX, "Trailing content after JSON");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+/*
+ * json-asm: Runtime statistics
+ *
+ * Only STATS=1 builds keep any. Parses and serializations then add their
+ * counts to process-wide totals, once per call with relaxed atomics, so
+ * threads never contend on the hot paths. Values by type and the nesting
+ * depth come from a walk of each parsed tree, which keeps the parsers
+ * themselves free of counting.
+ */
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include "internal.h"
+
+#ifdef JSON_ASM_STATS
+
+#include <time.h>
+
+static json_stats g_stats;
+
+uint64_t stats_now(void) {
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void stats_add(uint64_t *total, uint64_t n) {
+    if (n) __atomic_fetch_add(total, n, __ATOMIC_RELAXED);
+}
+
+static inline void stats_max(uint64_t *total, uint64_t n) {
+    uint64_t cur = __atomic_load_n(total, __ATOMIC_RELAXED);
+    while (n > cur &&
+           !__atomic_compare_exchange_n(total, &cur, n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/* Count the values under root. A walk that runs out of memory for its
+ * frames counts what it reached. */
+static void stats_walk(const struct json_val *root, json_stats *s) {
+    struct tree_walk w;
+    tree_walk_init(&w, root);
+    for (;;) {
+        enum walk_event ev = tree_walk_next(&w);
+        if (ev == WALK_END || ev == WALK_ERROR) break;
+        if (ev == WALK_CLOSE) continue;
+
+        json_type t = val_get_type(w.val);
+        if (t == (json_type)JSON_STRING_LONG) t = JSON_STRING;
+        s->values[t]++;
+        if (w.key) s->keys++;
+        if (ev == WALK_OPEN && w.depth > s->max_depth) s->max_depth = w.depth;
+    }
+    tree_walk_free(&w);
+}
+
+void stats_parse_done(const struct json_doc *doc, size_t len,
+                      const struct doc_stats *before, uint64_t start, json_stats *out) {
+    json_stats s = {
+        .parses = 1,
+        .bytes_scanned = len,
+        .arena_grows = doc->stats.arena_grows - before->arena_grows,
+        .strings_grows = doc->stats.strings_grows - before->strings_grows,
+        .bytes_copied = doc->stats.bytes_copied - before->bytes_copied,
+        .scan_ns = doc->stats.scan_ns - before->scan_ns,
+        .tier = g_simd_tier
+    };
+    if (doc->root) stats_walk(doc->root, &s);
+    s.parse_ns = stats_now() - start;
+
+    stats_add(&g_stats.parses, 1);
+    stats_add(&g_stats.bytes_scanned, s.bytes_scanned);
+    for (size_t t = 0; t <= JSON_OBJECT; t++) stats_add(&g_stats.values[t], s.values[t]);
+    stats_add(&g_stats.keys, s.keys);
+    stats_max(&g_stats.max_depth, s.max_depth);
+    stats_add(&g_stats.arena_grows, s.arena_grows);
+    stats_add(&g_stats.strings_grows, s.strings_grows);
+    stats_add(&g_stats.bytes_copied, s.bytes_copied);
+    stats_add(&g_stats.scan_ns, s.scan_ns);
+    stats_add(&g_stats.parse_ns, s.parse_ns);
+    if (out) *out = s;
+}
+
+void stats_stringify_done(size_t len, uint64_t start, json_stats *out) {
+    json_stats s = {
+        .stringifies = 1,
+        .bytes_written = len,
+        .stringify_ns = stats_now() - start,
+        .tier = g_simd_tier
+    };
+    stats_add(&g_stats.stringifies, 1);
+    stats_add(&g_stats.bytes_written, s.bytes_written);
+    stats_add(&g_stats.stringify_ns, s.stringify_ns);
+    if (out) *out = s;
+}
+
+#define STATS_LOAD(field) out->field = __atomic_load_n(&g_stats.field, __ATOMIC_RELAXED)
+#define STATS_ZERO(field) __atomic_store_n(&g_stats.field, 0, __ATOMIC_RELAXED)
+
+/* Every counter of json_stats, for get and reset */
+#define STATS_EACH(op) \
+    op(parses); op(bytes_scanned); op(keys); op(max_depth); \
+    op(arena_grows); op(strings_grows); op(bytes_copied); op(scan_ns); \
+    op(parse_ns); op(stringifies); op(bytes_written); op(stringify_ns)
+
+bool stats_get(json_stats *out) {
+    STATS_EACH(STATS_LOAD);
+    for (size_t t = 0; t <= JSON_OBJECT; t++) STATS_LOAD(values[t]);
+    out->tier = g_simd_tier;
+    return true;
+}
+
+void stats_reset(void) {
+    STATS_EACH(STATS_ZERO);
+    for (size_t t = 0; t <= JSON_OBJECT; t++) STATS_ZERO(values[t]);
+}
+
+#else
+
+bool stats_get(json_stats *out) {
+    memset(out, 0, sizeof(*out));
+    out->tier = g_simd_tier;
+    return false;
+}
+
+void stats_reset(void) {
+}
+
+#endif /* JSON_ASM_STATS */
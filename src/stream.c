@@ -0,0 +1,164 @@
+/*
+ * json-asm: Streaming parser for concatenated and newline-delimited JSON
+ *
+ * Record boundaries come from the same 64-byte structural blocks as stage 1
+ * of the two-stage parser: bracket depth is tracked over the structural bits
+ * until it returns to zero. The scan state carries over from one record to
+ * the next, so a block shared by several small records is scanned once.
+ * Each record is then parsed into the stream's reusable parser.
+ */
+
+#include "internal.h"
+
+#define STREAM_BLOCK 64
+
+struct json_stream *stream_create(const char *json, size_t len,
+                                  const json_parse_options *opts) {
+    struct json_stream *stream = calloc(1, sizeof(struct json_stream));
+    if (!stream) return NULL;
+
+    stream->parser = parser_create(opts);
+    if (!stream->parser) {
+        free(stream);
+        return NULL;
+    }
+    stream->json = json;
+    stream->len = len;
+    return stream;
+}
+
+struct json_stream *stream_open_file(const char *path,
+                                     const json_parse_options *opts) {
+    struct owned_input in = {0};
+    if (!input_load_file(&in, path, opts ? opts->flags : 0)) return NULL;
+
+    struct json_stream *stream = stream_create(in.data, in.len, opts);
+    if (!stream) {
+        input_release(&in);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate stream");
+        return NULL;
+    }
+    stream->input = in;
+    return stream;
+}
+
+void stream_destroy(struct json_stream *stream) {
+    parser_destroy(stream->parser);
+    input_release(&stream->input);
+    free(stream);
+}
+
+/* Find the bracket that closes the container opened at start */
+static bool stream_find_close(struct json_stream *s, size_t start, size_t *end) {
+    /* start is outside any string, so a fresh scan can begin there */
+    if (!s->block_valid || start >= s->block_base + STREAM_BLOCK) {
+        s->block_base = start;
+        s->in_string = 0;
+        s->block_bits = structural_block(s->json, s->len, start, &s->in_string);
+        s->block_valid = true;
+    }
+
+    /* Drop whatever lies before the record */
+    uint64_t bits = s->block_bits & (~0ULL << (start - s->block_base));
+    size_t depth = 0;
+
+    for (;;) {
+        while (bits) {
+            size_t pos = s->block_base + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            char c = s->json[pos];
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                s->block_bits = bits;
+                *end = pos + 1;
+                return true;
+            }
+        }
+
+        s->block_base += STREAM_BLOCK;
+        if (s->block_base >= s->len) {
+            s->block_valid = false;
+            return false;
+        }
+        bits = structural_block(s->json, s->len, s->block_base, &s->in_string);
+    }
+}
+
+/* Find the end of the top-level string opened at start */
+static bool stream_find_string_end(const struct json_stream *s, size_t start,
+                                   size_t *end) {
+    size_t pos = start + 1;
+    while (pos < s->len) {
+        pos += g_json_ops.scan_string(s->json + pos, s->len - pos);
+        if (pos >= s->len) break;
+        if (s->json[pos] == '"') {
+            *end = pos + 1;
+            return true;
+        }
+        /* Skip the escaped byte; control characters are left to the parser */
+        pos += s->json[pos] == '\\' ? 2 : 1;
+    }
+    return false;
+}
+
+/* A top-level scalar runs to the next whitespace or structural character,
+ * or to the end of the buffer */
+static size_t stream_scalar_end(const struct json_stream *s, size_t start) {
+    size_t pos = start + 1;
+    while (pos < s->len) {
+        switch (s->json[pos]) {
+            case ' ': case '\t': case '\n': case '\r':
+            case '{': case '}': case '[': case ']':
+            case ':': case ',': case '"':
+                return pos;
+            default:
+                pos++;
+        }
+    }
+    return pos;
+}
+
+struct json_doc *stream_next(struct json_stream *s) {
+    size_t start = s->pos;
+    if (start < s->len) {
+        start += g_json_ops.skip_whitespace(s->json + start, s->len - start);
+    }
+    s->pos = start;
+
+    if (start >= s->len) {
+        set_error(JSON_OK, start, 0, 0, "End of stream");
+        return NULL;
+    }
+
+    size_t end;
+    bool complete;
+    switch (s->json[start]) {
+        case '{':
+        case '[':
+            complete = stream_find_close(s, start, &end);
+            break;
+        case '"':
+            complete = stream_find_string_end(s, start, &end);
+            break;
+        default:
+            end = stream_scalar_end(s, start);
+            complete = true;
+            break;
+    }
+
+    if (!complete) {
+        /* Leave pos at the record so the caller can resume from it */
+        set_error(JSON_ERROR_INCOMPLETE, start, 0, 0, "Truncated record");
+        return NULL;
+    }
+
+    s->pos = end;
+    struct json_doc *doc = parser_parse(s->parser, s->json + start, end - start);
+    if (!doc) {
+        /* Report the error against the whole buffer; the bad record is
+         * skipped so the next call moves on */
+        g_last_error.position += start;
+    }
+    return doc;
+}
@@ -5,11 +5,46 @@
 #include "internal.h"
 #include <math.h>
 
-/* String buffer with automatic growth */
+#if !defined(_WIN32)
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
+/* Streaming output (json_stringify_write, json_stringify_fd) */
+#define SINK_BUF_SIZE   (64 * 1024)
+#define SINK_SEGMENTS   64
+#define SINK_REF_MIN    1024        /* String runs this long are not copied */
+
+/* Output queued for a sink: slices of the buffer, and string runs that
+ * point straight into the document */
+struct stringify_sink {
+    json_write_fn write;        /* Callback, or NULL to write to fd */
+    void *user_data;
+    int fd;
+    struct iovec segments[SINK_SEGMENTS];
+    size_t count;
+    size_t mark;                /* Buffer bytes before mark are queued */
+#ifdef JSON_ASM_STATS
+    size_t written;             /* Bytes handed on so far */
+#endif
+};
+
+/* Output buffer. It grows by doubling, writes into a fixed caller buffer,
+ * or flushes to a sink as it fills; with data NULL it only counts, which
+ * is also where a fixed buffer ends up when the output does not fit. */
 typedef struct {
     char *data;
     size_t len;
     size_t cap;
+    bool fixed;
+    struct stringify_sink *sink;
 } strbuf;
 
 static bool strbuf_init(strbuf *sb, size_t initial_cap) {
@@ -17,9 +52,27 @@ static bool strbuf_init(strbuf *sb, size_t initial_cap) {
     if (!sb->data) return false;
     sb->len = 0;
     sb->cap = initial_cap;
+    sb->fixed = false;
+    sb->sink = NULL;
     return true;
 }
 
+static void strbuf_init_fixed(strbuf *sb, char *buf, size_t cap) {
+    sb->data = buf;
+    sb->len = 0;
+    sb->cap = buf ? cap : 0;
+    sb->fixed = true;
+    sb->sink = NULL;
+}
+
+static void strbuf_init_count(strbuf *sb) {
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = SIZE_MAX;
+    sb->fixed = true;
+    sb->sink = NULL;
+}
+
 static void strbuf_free(strbuf *sb) {
     free(sb->data);
     sb->data = NULL;
@@ -27,9 +80,97 @@ static void strbuf_free(strbuf *sb) {
     sb->cap = 0;
 }
 
+/* Hand the queued segments to the callback or the fd */
+static bool sink_write(struct stringify_sink *sink) {
+    struct iovec *iov = sink->segments;
+    size_t n = sink->count;
+    sink->count = 0;
+#ifdef JSON_ASM_STATS
+    for (size_t i = 0; i < n; i++) sink->written += iov[i].iov_len;
+#endif
+
+    if (sink->write) {
+        for (size_t i = 0; i < n; i++) {
+            if (!sink->write(sink->user_data, iov[i].iov_base, iov[i].iov_len)) {
+                set_error(JSON_ERROR_IO, 0, 0, 0, "Write callback failed");
+                return false;
+            }
+        }
+        return true;
+    }
+
+#if !defined(_WIN32)
+    while (n > 0) {
+        ssize_t written = writev(sink->fd, iov, (int)n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            set_error(JSON_ERROR_IO, 0, 0, 0, "Write failed");
+            return false;
+        }
+
+        /* Skip what went out; a partial write resumes mid-segment */
+        size_t left = (size_t)written;
+        while (n > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        const char *p = iov[i].iov_base;
+        size_t left = iov[i].iov_len;
+        while (left > 0) {
+            unsigned chunk = left > 0x40000000 ? 0x40000000 : (unsigned)left;
+            int written = _write(sink->fd, p, chunk);
+            if (written <= 0) {
+                set_error(JSON_ERROR_IO, 0, 0, 0, "Write failed");
+                return false;
+            }
+            p += written;
+            left -= (size_t)written;
+        }
+    }
+#endif
+    return true;
+}
+
+/* Queue the buffer bytes written since the last segment */
+static void sink_close_slice(strbuf *sb) {
+    struct stringify_sink *sink = sb->sink;
+    if (sb->len > sink->mark) {
+        sink->segments[sink->count].iov_base = sb->data + sink->mark;
+        sink->segments[sink->count].iov_len = sb->len - sink->mark;
+        sink->count++;
+        sink->mark = sb->len;
+    }
+}
+
+/* Write out everything queued and start the buffer over */
+static bool strbuf_flush(strbuf *sb) {
+    sink_close_slice(sb);
+    sb->len = 0;
+    sb->sink->mark = 0;
+    return sink_write(sb->sink);
+}
+
 static bool strbuf_grow(strbuf *sb, size_t needed) {
     if (sb->len + needed <= sb->cap) return true;
 
+    /* Sinks take what does not fit in pieces (see strbuf_append) */
+    if (sb->sink) return strbuf_flush(sb);
+
+    if (sb->fixed) {
+        /* Out of room: keep measuring so the caller learns the size */
+        sb->data = NULL;
+        sb->cap = SIZE_MAX;
+        return true;
+    }
+
     size_t new_cap = sb->cap * 2;
     while (new_cap < sb->len + needed) {
         new_cap *= 2;
@@ -43,13 +184,42 @@ static bool strbuf_grow(strbuf *sb, size_t needed) {
     return true;
 }
 
+/* Copy into a sink's buffer, flushing each time it fills */
+static bool sink_append(strbuf *sb, const char *str, size_t len) {
+    while (len > 0) {
+        if (sb->len == sb->cap && !strbuf_flush(sb)) return false;
+        size_t n = sb->cap - sb->len < len ? sb->cap - sb->len : len;
+        memcpy(sb->data + sb->len, str, n);
+        sb->len += n;
+        str += n;
+        len -= n;
+    }
+    return true;
+}
+
 static bool strbuf_append(strbuf *sb, const char *str, size_t len) {
+    if (sb->sink && sb->len + len > sb->cap) return sink_append(sb, str, len);
     if (!strbuf_grow(sb, len)) return false;
-    memcpy(sb->data + sb->len, str, len);
+    if (sb->data) memcpy(sb->data + sb->len, str, len);
     sb->len += len;
     return true;
 }
 
+/* Append bytes that stay valid until the output is finished (string
+ * contents in the document). A sink queues long runs without copying. */
+static bool strbuf_append_ref(strbuf *sb, const char *str, size_t len) {
+    if (!sb->sink || len < SINK_REF_MIN) return strbuf_append(sb, str, len);
+
+    /* Room for the buffered slice, this run, and the final slice */
+    struct stringify_sink *sink = sb->sink;
+    if (sink->count + 3 > SINK_SEGMENTS && !strbuf_flush(sb)) return false;
+    sink_close_slice(sb);
+    sink->segments[sink->count].iov_base = (void *)str;
+    sink->segments[sink->count].iov_len = len;
+    sink->count++;
+    return true;
+}
+
 static bool strbuf_append_char(strbuf *sb, char c) {
     return strbuf_append(sb, &c, 1);
 }
@@ -61,225 +231,403 @@ static bool strbuf_append_str(strbuf *sb, const char *str) {
 /* Hex digits for \uXXXX escapes */
 static const char hex_digits[] = "0123456789abcdef";
 
-/* Stringify a string value with escaping */
-static bool stringify_string(strbuf *sb, const char *str, size_t len) {
-    if (!strbuf_append_char(sb, '"')) return false;
+/* Append a \uXXXX escape */
+static bool strbuf_append_u(strbuf *sb, uint32_t cp) {
+    char esc[6] = {
+        '\\', 'u',
+        hex_digits[(cp >> 12) & 0xF], hex_digits[(cp >> 8) & 0xF],
+        hex_digits[(cp >> 4) & 0xF], hex_digits[cp & 0xF]
+    };
+    return strbuf_append(sb, esc, sizeof(esc));
+}
+
+/* Decode one UTF-8 sequence; 0 if it is malformed, overlong, a surrogate or
+ * out of range */
+static size_t utf8_decode(const unsigned char *s, size_t len, uint32_t *cp) {
+    unsigned char c = s[0];
+    size_t n;
+    uint32_t v, min;
+    if (c >= 0xF5) {
+        return 0;
+    } else if (c >= 0xF0) {
+        n = 4; v = c & 0x07; min = 0x10000;
+    } else if (c >= 0xE0) {
+        n = 3; v = c & 0x0F; min = 0x800;
+    } else if (c >= 0xC2) {
+        n = 2; v = c & 0x1F; min = 0x80;
+    } else {
+        return 0;
+    }
+    if (n > len) return 0;
+
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+        v = (v << 6) | (s[i] & 0x3F);
+    }
+    if (v < min || v > 0x10FFFF || (v >= 0xD800 && v <= 0xDFFF)) return 0;
+    *cp = v;
+    return n;
+}
 
-    for (size_t i = 0; i < len; i++) {
+/* Length of the run before the first '/' (ESCAPE_SLASH) or non-ASCII byte
+ * (ESCAPE_UNI) */
+static size_t scan_flagged(const char *str, size_t len, uint32_t flags) {
+    bool slash = flags & JSON_STRINGIFY_ESCAPE_SLASH;
+    bool uni = flags & JSON_STRINGIFY_ESCAPE_UNI;
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x;
+        memcpy(&x, str + i, 8);
+        uint64_t hi = (slash ? swar_eq(x, '/') : 0) | (uni ? x & ~SWAR_LOW7 : 0);
+        if (hi) return i + swar_first(hi);
+    }
+    for (; i < len; i++) {
         unsigned char c = (unsigned char)str[i];
+        if ((slash && c == '/') || (uni && c >= 0x80)) return i;
+    }
+    return len;
+}
 
-        switch (c) {
-            case '"':
-                if (!strbuf_append(sb, "\\\"", 2)) return false;
-                break;
-            case '\\':
-                if (!strbuf_append(sb, "\\\\", 2)) return false;
-                break;
-            case '\b':
-                if (!strbuf_append(sb, "\\b", 2)) return false;
-                break;
-            case '\f':
-                if (!strbuf_append(sb, "\\f", 2)) return false;
-                break;
-            case '\n':
-                if (!strbuf_append(sb, "\\n", 2)) return false;
-                break;
-            case '\r':
-                if (!strbuf_append(sb, "\\r", 2)) return false;
-                break;
-            case '\t':
-                if (!strbuf_append(sb, "\\t", 2)) return false;
-                break;
-            default:
-                if (c < 0x20) {
-                    /* Control character - escape as \uXXXX */
-                    char esc[7];
-                    esc[0] = '\\';
-                    esc[1] = 'u';
-                    esc[2] = '0';
-                    esc[3] = '0';
-                    esc[4] = hex_digits[(c >> 4) & 0xF];
-                    esc[5] = hex_digits[c & 0xF];
-                    esc[6] = '\0';
-                    if (!strbuf_append(sb, esc, 6)) return false;
-                } else {
-                    if (!strbuf_append_char(sb, (char)c)) return false;
-                }
-                break;
-        }
+/* Escape the sequence at s; returns the bytes consumed, 0 on failure */
+static size_t stringify_escape(strbuf *sb, const unsigned char *s, size_t len) {
+    bool ok;
+    switch (s[0]) {
+        case '"':  return strbuf_append(sb, "\\\"", 2) ? 1 : 0;
+        case '\\': return strbuf_append(sb, "\\\\", 2) ? 1 : 0;
+        case '/':  return strbuf_append(sb, "\\/", 2) ? 1 : 0;
+        case '\b': return strbuf_append(sb, "\\b", 2) ? 1 : 0;
+        case '\f': return strbuf_append(sb, "\\f", 2) ? 1 : 0;
+        case '\n': return strbuf_append(sb, "\\n", 2) ? 1 : 0;
+        case '\r': return strbuf_append(sb, "\\r", 2) ? 1 : 0;
+        case '\t': return strbuf_append(sb, "\\t", 2) ? 1 : 0;
+        default:
+            break;
     }
 
+    /* Control character */
+    if (s[0] < 0x20) return strbuf_append_u(sb, s[0]) ? 1 : 0;
+
+    /* Non-ASCII under ESCAPE_UNI; malformed bytes become U+FFFD */
+    uint32_t cp;
+    size_t n = utf8_decode(s, len, &cp);
+    if (n == 0) {
+        cp = 0xFFFD;
+        n = 1;
+    }
+    if (cp >= 0x10000) {
+        cp -= 0x10000;
+        ok = strbuf_append_u(sb, 0xD800 + (cp >> 10)) &&
+             strbuf_append_u(sb, 0xDC00 + (cp & 0x3FF));
+    } else {
+        ok = strbuf_append_u(sb, cp);
+    }
+    return ok ? n : 0;
+}
+
+/* Stringify a string value with escaping. The dispatched scan_string
+ * kernel finds the next quote, backslash or control character; the run
+ * before it is copied in one go. */
+static bool stringify_string(strbuf *sb, const char *str, size_t len, uint32_t flags) {
+    /* Reserve for the unescaped case up front */
+    if (!strbuf_grow(sb, len + 2)) return false;
     if (!strbuf_append_char(sb, '"')) return false;
-    return true;
+
+    bool flagged = flags & (JSON_STRINGIFY_ESCAPE_SLASH | JSON_STRINGIFY_ESCAPE_UNI);
+    size_t i = 0;
+    while (i < len) {
+        size_t run = g_json_ops.scan_string(str + i, len - i);
+        if (flagged) run = scan_flagged(str + i, run, flags);
+        if (run && !strbuf_append_ref(sb, str + i, run)) return false;
+        i += run;
+        if (i >= len) break;
+
+        size_t n = stringify_escape(sb, (const unsigned char *)str + i, len - i);
+        if (n == 0) return false;
+        i += n;
+    }
+
+    return strbuf_append_char(sb, '"');
 }
 
 /* Stringify a number */
 static bool stringify_number(strbuf *sb, struct json_val *val) {
-    char buf[64];
-    int len;
+    char buf[NUMBER_BUF_SIZE];
+    size_t len;
 
     json_type t = val_get_type(val);
     if (t == JSON_INT) {
-        int64_t ival = json_get_int(val);
-        len = snprintf(buf, sizeof(buf), "%lld", (long long)ival);
+        len = number_format_int(json_get_int(val), buf);
     } else {
         double d = val->float_val;
-        if (isnan(d)) {
-            len = snprintf(buf, sizeof(buf), "null"); /* JSON doesn't support NaN */
-        } else if (isinf(d)) {
-            len = snprintf(buf, sizeof(buf), "null"); /* JSON doesn't support Infinity */
-        } else {
-            /* Use enough precision to round-trip */
-            len = snprintf(buf, sizeof(buf), "%.17g", d);
+        if (isnan(d) || isinf(d)) {
+            /* JSON has no NaN or Infinity */
+            return strbuf_append(sb, "null", 4);
         }
+        /* Shortest form that round-trips */
+        len = number_format_double(d, buf);
     }
 
-    return strbuf_append(sb, buf, (size_t)len);
+    return strbuf_append(sb, buf, len);
 }
 
-/* Forward declaration */
-static bool stringify_value_impl(strbuf *sb, struct json_val *val,
-                                  const json_stringify_options *opts,
-                                  int depth);
-
 /* Stringify with optional indentation */
-static bool stringify_indent(strbuf *sb, const json_stringify_options *opts, int depth) {
-    if (!opts || !(opts->flags & JSON_STRINGIFY_PRETTY)) return true;
-
+static bool stringify_indent(strbuf *sb, const json_stringify_options *opts, size_t depth) {
     const char *nl = opts->newline ? opts->newline : "\n";
     if (!strbuf_append_str(sb, nl)) return false;
 
-    for (int i = 0; i < depth; i++) {
-        for (uint32_t j = 0; j < opts->indent; j++) {
-            if (!strbuf_append_char(sb, ' ')) return false;
-        }
+    static const char spaces[] = "                                "
+                                 "                                ";
+    for (size_t n = depth * opts->indent; n > 0;) {
+        size_t chunk = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        if (!strbuf_append(sb, spaces, chunk)) return false;
+        n -= chunk;
     }
     return true;
 }
 
-/* Stringify an array */
-static bool stringify_array(strbuf *sb, struct json_val *arr,
-                            const json_stringify_options *opts, int depth) {
-    if (!strbuf_append_char(sb, '[')) return false;
+/* Stringify a scalar */
+static bool stringify_scalar(strbuf *sb, struct json_val *val, uint32_t flags) {
+    switch ((int)val_get_type(val)) {
+        case JSON_FALSE:
+            return strbuf_append_str(sb, "false");
 
-    struct json_val *elem = arr->child;
-    bool first = true;
+        case JSON_TRUE:
+            return strbuf_append_str(sb, "true");
 
-    while (elem) {
-        if (!first) {
-            if (!strbuf_append_char(sb, ',')) return false;
-        }
-        first = false;
+        case JSON_INT:
+        case JSON_FLOAT:
+            return stringify_number(sb, val);
 
-        if (opts && (opts->flags & JSON_STRINGIFY_PRETTY)) {
-            if (!stringify_indent(sb, opts, depth + 1)) return false;
+        case JSON_STRING_SHORT:
+        case JSON_STRING_LONG: {
+            const char *str = json_get_str(val);
+            size_t len = json_get_str_len(val);
+            return stringify_string(sb, str, len, flags);
         }
 
-        if (!stringify_value_impl(sb, elem, opts, depth + 1)) return false;
-        elem = elem->next;
+        default:
+            return strbuf_append_str(sb, "null");
     }
+}
 
-    if (!first && opts && (opts->flags & JSON_STRINGIFY_PRETTY)) {
-        if (!stringify_indent(sb, opts, depth)) return false;
-    }
+/* One open array or object */
+typedef struct {
+    struct json_val *next;      /* Next element, or key of the next member */
+    bool object;
+} emit_frame;
+
+/* Frames kept on the C stack before the frame stack moves to the heap */
+#define EMIT_FRAMES_INLINE 32
 
-    if (!strbuf_append_char(sb, ']')) return false;
+typedef struct {
+    emit_frame *frames;
+    size_t len;
+    size_t cap;
+    bool heap;
+} emit_stack;
+
+static bool emit_grow(emit_stack *es) {
+    size_t cap = es->cap * 2;
+    emit_frame *frames = es->heap
+        ? realloc(es->frames, cap * sizeof(emit_frame))
+        : malloc(cap * sizeof(emit_frame));
+    if (!frames) return false;
+    if (!es->heap) {
+        memcpy(frames, es->frames, es->len * sizeof(emit_frame));
+    }
+    es->frames = frames;
+    es->cap = cap;
+    es->heap = true;
     return true;
 }
 
-/* Stringify an object */
-static bool stringify_object(strbuf *sb, struct json_val *obj,
-                             const json_stringify_options *opts, int depth) {
-    if (!strbuf_append_char(sb, '{')) return false;
-
-    struct json_val *key = obj->child;
-    bool first = true;
+/* Stringify any value. Open containers are frames on an explicit stack,
+ * as in the parser, so any document it accepts can be written back. */
+static bool stringify_value_impl(strbuf *sb, struct json_val *val,
+                                 const json_stringify_options *opts) {
+    if (!val) {
+        return strbuf_append_str(sb, "null");
+    }
 
-    while (key) {
-        if (!first) {
-            if (!strbuf_append_char(sb, ',')) return false;
-        }
-        first = false;
+    emit_frame inline_frames[EMIT_FRAMES_INLINE];
+    emit_stack es = { inline_frames, 0, EMIT_FRAMES_INLINE, false };
+    uint32_t flags = opts ? opts->flags : 0;
+    bool pretty = (flags & JSON_STRINGIFY_PRETTY) != 0;
+    struct json_val *key;
+    bool ok = false;
 
-        if (opts && (opts->flags & JSON_STRINGIFY_PRETTY)) {
-            if (!stringify_indent(sb, opts, depth + 1)) return false;
-        }
-
-        /* Stringify key */
-        const char *key_str = json_get_str(key);
-        size_t key_len = json_get_str_len(key);
-        if (!stringify_string(sb, key_str, key_len)) return false;
+value:
+    switch ((int)val_get_type(val)) {
+        case JSON_ARRAY:
+            if (!strbuf_append_char(sb, '[')) goto out;
+            if (!val->child) {
+                if (!strbuf_append_char(sb, ']')) goto out;
+                goto next;
+            }
+            if (es.len == es.cap && !emit_grow(&es)) goto out;
+            es.frames[es.len++] = (emit_frame){ val_next(val->child), false };
+            val = val->child;
+            goto element;
 
-        if (!strbuf_append_char(sb, ':')) return false;
+        case JSON_OBJECT:
+            if (!strbuf_append_char(sb, '{')) goto out;
+            key = val_child(val);
+            if (!key) {
+                if (!strbuf_append_char(sb, '}')) goto out;
+                goto next;
+            }
+            if (es.len == es.cap && !emit_grow(&es)) goto out;
+            es.frames[es.len++] = (emit_frame){ val_next(val_next(key)), true };
+            goto member;
 
-        if (opts && (opts->flags & JSON_STRINGIFY_PRETTY)) {
-            if (!strbuf_append_char(sb, ' ')) return false;
-        }
+        default:
+            if (!stringify_scalar(sb, val, flags)) goto out;
+            goto next;
+    }
 
-        /* Stringify value */
-        if (!stringify_value_impl(sb, key->child, opts, depth + 1)) return false;
+element:
+    if (pretty && !stringify_indent(sb, opts, es.len)) goto out;
+    goto value;
 
-        key = key->next;
+member:
+    if (pretty && !stringify_indent(sb, opts, es.len)) goto out;
+    if (!stringify_string(sb, json_get_str(key), json_get_str_len(key), flags) ||
+        !strbuf_append_char(sb, ':') ||
+        (pretty && !strbuf_append_char(sb, ' '))) {
+        goto out;
     }
-
-    if (!first && opts && (opts->flags & JSON_STRINGIFY_PRETTY)) {
-        if (!stringify_indent(sb, opts, depth)) return false;
+    val = val_next(key);
+    goto value;
+
+next:
+    /* val is written: go on with the innermost open container */
+    if (es.len == 0) {
+        ok = true;
+        goto out;
     }
-
-    if (!strbuf_append_char(sb, '}')) return false;
-    return true;
-}
-
-/* Stringify any value */
-static bool stringify_value_impl(strbuf *sb, struct json_val *val,
-                                  const json_stringify_options *opts,
-                                  int depth) {
-    if (!val) {
-        return strbuf_append_str(sb, "null");
+    emit_frame *f = &es.frames[es.len - 1];
+    if (f->next) {
+        if (!strbuf_append_char(sb, ',')) goto out;
+        if (f->object) {
+            key = f->next;
+            f->next = val_next(val_next(key));
+            goto member;
+        }
+        val = f->next;
+        f->next = val_next(val);
+        goto element;
     }
+    es.len--;
+    if (pretty && !stringify_indent(sb, opts, es.len)) goto out;
+    if (!strbuf_append_char(sb, f->object ? '}' : ']')) goto out;
+    goto next;
+
+out:
+    if (es.heap) free(es.frames);
+    return ok;
+}
 
-    int t = (int)val_get_type(val);
-
-    switch (t) {
-        case JSON_NULL:
-            return strbuf_append_str(sb, "null");
+/* ============================================================================
+ * Schema Encoding
+ * ============================================================================ */
 
-        case JSON_FALSE:
-            return strbuf_append_str(sb, "false");
+/* The struct at in as an object with the schema's members, in order */
+static bool encode_struct(strbuf *sb, const struct json_schema *schema, const char *in) {
+    if (!strbuf_append_char(sb, '{')) return false;
 
-        case JSON_TRUE:
-            return strbuf_append_str(sb, "true");
+    for (size_t i = 0; i < schema->count; i++) {
+        const struct schema_field *f = &schema->fields[i];
+        const char *src = in + f->offset;
 
-        case JSON_INT:
-        case JSON_FLOAT:
-            return stringify_number(sb, val);
+        if (i > 0 && !strbuf_append_char(sb, ',')) return false;
+        if (f->quoted) {
+            if (!strbuf_append(sb, f->quoted, f->quoted_len)) return false;
+        } else if (!stringify_string(sb, f->key, f->key_len, 0) || !strbuf_append_char(sb, ':')) {
+            return false;
+        }
 
-        case JSON_STRING_SHORT:
-        case JSON_STRING_LONG: {
-            const char *str = json_get_str(val);
-            size_t len = json_get_str_len(val);
-            return stringify_string(sb, str, len);
+        char buf[NUMBER_BUF_SIZE];
+        bool ok;
+        switch (f->type) {
+            case JSON_FIELD_BOOL:
+                ok = *(const bool *)src ? strbuf_append(sb, "true", 4) : strbuf_append(sb, "false", 5);
+                break;
+            case JSON_FIELD_INT32:
+                ok = strbuf_append(sb, buf, number_format_int(*(const int32_t *)src, buf));
+                break;
+            case JSON_FIELD_INT64:
+                ok = strbuf_append(sb, buf, number_format_int(*(const int64_t *)src, buf));
+                break;
+            case JSON_FIELD_DOUBLE: {
+                double d = *(const double *)src;
+                /* JSON has no NaN or Infinity */
+                ok = isnan(d) || isinf(d) ? strbuf_append(sb, "null", 4)
+                                          : strbuf_append(sb, buf, number_format_double(d, buf));
+                break;
+            }
+            case JSON_FIELD_STRING: {
+                const char *end = memchr(src, '\0', f->size);
+                size_t len = end ? (size_t)(end - src) : f->size;
+                ok = stringify_string(sb, src, len, 0);
+                break;
+            }
+            case JSON_FIELD_OBJECT:
+                ok = encode_struct(sb, f->schema, src);
+                break;
+            default:
+                ok = strbuf_append(sb, "null", 4);
+                break;
         }
+        if (!ok) return false;
+    }
 
-        case JSON_ARRAY:
-            return stringify_array(sb, val, opts, depth);
+    return strbuf_append_char(sb, '}');
+}
 
-        case JSON_OBJECT:
-            return stringify_object(sb, val, opts, depth);
+char *schema_encode(const struct json_schema *s, const void *in, size_t *len) {
+    strbuf sb;
+    if (!strbuf_init(&sb, 256)) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    if (!encode_struct(&sb, s, in) || !strbuf_append_char(&sb, '\0')) {
+        strbuf_free(&sb);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return NULL;
+    }
+    if (len) *len = sb.len - 1;
+    return sb.data;
+}
 
-        default:
-            return strbuf_append_str(sb, "null");
+size_t schema_encode_into(const struct json_schema *s, const void *in,
+                          char *buf, size_t buf_len) {
+    strbuf sb;
+    strbuf_init_fixed(&sb, buf, buf_len);
+    encode_struct(&sb, s, in);
+
+    size_t len = sb.len;
+    if (sb.data && len < buf_len) {
+        buf[len] = '\0';
+    } else if (buf && buf_len > 0) {
+        buf[0] = '\0';
     }
+    return len;
 }
 
-/* Main stringify function */
-char *stringify_value(struct json_val *val, const json_stringify_options *opts) {
+/* Main stringify function. size_hint, when nonzero, is the expected
+ * output length (a previous result), so the buffer is allocated once. */
+char *stringify_value(struct json_val *val, const json_stringify_options *opts,
+                      size_t size_hint, size_t *len) {
+#ifdef JSON_ASM_STATS
+    uint64_t start = stats_now();
+#endif
     strbuf sb;
-    if (!strbuf_init(&sb, 1024)) {
+    if (!strbuf_init(&sb, size_hint ? size_hint + 1 : 1024)) {
         return NULL;
     }
 
-    if (!stringify_value_impl(&sb, val, opts, 0)) {
+    if (!stringify_value_impl(&sb, val, opts)) {
         strbuf_free(&sb);
         return NULL;
     }
@@ -290,6 +638,60 @@ char *stringify_value(struct json_val *val, const json_stringify_options *opts)
         return NULL;
     }
 
+    if (len) *len = sb.len - 1;
+    STATS(stats_stringify_done(sb.len - 1, start, opts ? opts->stats : NULL));
+
     /* Return ownership to caller */
     return sb.data;
 }
+
+size_t stringify_size(struct json_val *val, const json_stringify_options *opts) {
+    strbuf sb;
+    strbuf_init_count(&sb);
+    stringify_value_impl(&sb, val, opts);
+    return sb.len;
+}
+
+size_t stringify_into(struct json_val *val, const json_stringify_options *opts,
+                      char *buf, size_t buf_len) {
+#ifdef JSON_ASM_STATS
+    uint64_t start = stats_now();
+#endif
+    strbuf sb;
+    strbuf_init_fixed(&sb, buf, buf_len);
+    stringify_value_impl(&sb, val, opts);
+
+    size_t len = sb.len;
+    if (sb.data && len < buf_len) {
+        buf[len] = '\0';
+    } else if (buf && buf_len > 0) {
+        /* Did not fit: leave an empty string rather than a truncated one */
+        buf[0] = '\0';
+    }
+    STATS(if (len < buf_len) stats_stringify_done(len, start, opts ? opts->stats : NULL));
+    return len;
+}
+
+bool stringify_write(struct json_val *val, const json_stringify_options *opts,
+                     json_write_fn write, void *user_data, int fd) {
+#ifdef JSON_ASM_STATS
+    uint64_t start = stats_now();
+#endif
+    struct stringify_sink sink = {
+        .write = write,
+        .user_data = user_data,
+        .fd = fd
+    };
+
+    strbuf sb;
+    if (!strbuf_init(&sb, SINK_BUF_SIZE)) {
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+    sb.sink = &sink;
+
+    bool ok = stringify_value_impl(&sb, val, opts) && strbuf_flush(&sb);
+    STATS(if (ok) stats_stringify_done(sink.written, start, opts ? opts->stats : NULL));
+    strbuf_free(&sb);
+    return ok;
+}
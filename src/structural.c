@@ -0,0 +1,273 @@
+/*
+ * json-asm: Structural index (stage 1 of the two-stage parser)
+ *
+ * Runs the find_structural kernels over the input in 64-byte blocks and
+ * records the offset of every structural character that is not inside a
+ * string. Opening quotes are kept so stage 2 knows where strings start;
+ * closing quotes and everything between them are dropped.
+ */
+
+#include "internal.h"
+
+#define STRUCTURAL_BLOCK 64
+
+/* Combine kernel results into one 64-bit mask. The kernels handle 16, 32
+ * or 64 bytes per call depending on the tier. */
+static inline uint64_t block_structural(const char *block, size_t len) {
+    uint64_t result = 0;
+    size_t done = 0;
+    while (done < len) {
+        uint64_t m;
+        size_t n = g_json_ops.find_structural(block + done, len - done, &m);
+        result |= m << done;
+        done += n;
+    }
+    return result;
+}
+
+/* A quote is escaped if it is preceded by an odd number of backslashes */
+static inline bool quote_escaped(const char *json, size_t pos) {
+    size_t n = 0;
+    while (n < pos && json[pos - n - 1] == '\\') {
+        n++;
+    }
+    return (n & 1) != 0;
+}
+
+/* Bit i of the result is the XOR of bits 0..i of x */
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static bool index_reserve(struct structural_index *idx, size_t needed) {
+    if (idx->count + needed <= idx->capacity) return true;
+
+    size_t new_cap = idx->capacity ? idx->capacity * 2 : 256;
+    while (new_cap < idx->count + needed) {
+        new_cap *= 2;
+    }
+
+    uint32_t *new_offsets = realloc(idx->offsets, new_cap * sizeof(uint32_t));
+    if (!new_offsets) return false;
+
+    idx->offsets = new_offsets;
+    idx->capacity = new_cap;
+    return true;
+}
+
+/* The 64-byte block at json + base. The kernels load full vectors, so a
+ * short last block is copied into tail and padded with spaces. */
+static inline const char *load_block(const char *json, size_t len, size_t base,
+                                     char *tail, size_t *n) {
+    *n = len - base;
+    if (*n < STRUCTURAL_BLOCK) {
+        memcpy(tail, json + base, *n);
+        memset(tail + *n, ' ', STRUCTURAL_BLOCK - *n);
+        return tail;
+    }
+    *n = STRUCTURAL_BLOCK;
+    return json + base;
+}
+
+/* Bits of the block at json + base that stage 2 needs: structural
+ * characters outside strings, plus opening quotes. *in_string carries the
+ * string state from one block to the next. */
+static inline uint64_t scan_block(const char *json, size_t len, size_t base,
+                                  uint64_t *in_string) {
+    char tail[STRUCTURAL_BLOCK];
+    size_t n;
+    const char *block = load_block(json, len, base, tail, &n);
+
+    uint64_t structural = block_structural(block, n);
+
+    /* Pick out the unescaped quotes */
+    uint64_t quotes = 0;
+    for (uint64_t m = structural; m; m &= m - 1) {
+        unsigned bit = (unsigned)__builtin_ctzll(m);
+        if (block[bit] == '"' && !quote_escaped(json, base + bit)) {
+            quotes |= 1ULL << bit;
+        }
+    }
+
+    /* Bits from an opening quote up to (not including) its closing quote */
+    uint64_t inside = prefix_xor(quotes) ^ *in_string;
+    *in_string = 0 - (inside >> 63);
+
+    return (structural & ~quotes & ~inside) | (quotes & inside);
+}
+
+uint64_t structural_block(const char *json, size_t len, size_t base,
+                          uint64_t *in_string) {
+    return scan_block(json, len, base, in_string);
+}
+
+uint64_t structural_strings(const char *block, size_t n, uint64_t *in_string,
+                            bool *escaped) {
+    uint64_t structural = block_structural(block, n);
+
+    /* A quote is escaped by an odd run of backslashes before it; a run
+     * that starts the block continues the one that ended the last */
+    uint64_t quotes = 0;
+    for (uint64_t m = structural; m; m &= m - 1) {
+        unsigned bit = (unsigned)__builtin_ctzll(m);
+        if (block[bit] != '"') continue;
+        size_t run = 0;
+        while (run < bit && block[bit - run - 1] == '\\') run++;
+        if ((run & 1) == (run == bit && *escaped)) quotes |= 1ULL << bit;
+    }
+    size_t run = 0;
+    while (run < n && block[n - run - 1] == '\\') run++;
+    *escaped = (run & 1) != (run == n && *escaped);
+
+    uint64_t inside = prefix_xor(quotes) ^ *in_string;
+    *in_string = 0 - (inside >> 63);
+    return inside;
+}
+
+bool structural_index_build(struct structural_index *idx,
+                            const char *json, size_t len) {
+    idx->count = 0;
+
+    /* Typical documents have one structural character per 4-8 bytes */
+    if (!index_reserve(idx, len / 6 + STRUCTURAL_BLOCK + 1)) return false;
+
+    uint64_t in_string = 0;     /* All ones while inside a string */
+
+    for (size_t base = 0; base < len; base += STRUCTURAL_BLOCK) {
+        uint64_t record = scan_block(json, len, base, &in_string);
+
+        if (!index_reserve(idx, STRUCTURAL_BLOCK + 1)) return false;
+        uint32_t *out = idx->offsets + idx->count;
+        while (record) {
+            *out++ = (uint32_t)(base + (size_t)__builtin_ctzll(record));
+            record &= record - 1;
+        }
+        idx->count = (size_t)(out - idx->offsets);
+    }
+
+    /* Sentinel so stage 2 can always read the next offset */
+    idx->offsets[idx->count] = (uint32_t)len;
+    return true;
+}
+
+void structural_index_free(struct structural_index *idx) {
+    free(idx->offsets);
+    idx->offsets = NULL;
+    idx->count = 0;
+    idx->capacity = 0;
+}
+
+void structural_chunk_summary(const char *json, size_t end, size_t start,
+                              struct chunk_summary *out) {
+    /* Track both possible string states at start in one pass: starting
+     * inside a string simply inverts the in-string mask */
+    uint64_t carry = 0;
+    int64_t depth[2] = {0, 0};
+    char tail[STRUCTURAL_BLOCK];
+
+    for (size_t base = start; base < end; base += STRUCTURAL_BLOCK) {
+        size_t n;
+        const char *block = load_block(json, end, base, tail, &n);
+        uint64_t structural = block_structural(block, n);
+
+        uint64_t quotes = 0, open = 0, close = 0;
+        for (uint64_t m = structural; m; m &= m - 1) {
+            unsigned bit = (unsigned)__builtin_ctzll(m);
+            char c = block[bit];
+            if (c == '"') {
+                if (!quote_escaped(json, base + bit)) quotes |= 1ULL << bit;
+            } else if (c == '{' || c == '[') {
+                open |= 1ULL << bit;
+            } else if (c == '}' || c == ']') {
+                close |= 1ULL << bit;
+            }
+        }
+
+        uint64_t inside = prefix_xor(quotes) ^ carry;
+        carry = 0 - (inside >> 63);
+
+        depth[0] += __builtin_popcountll(open & ~inside) - __builtin_popcountll(close & ~inside);
+        depth[1] += __builtin_popcountll(open & inside) - __builtin_popcountll(close & inside);
+    }
+
+    out->depth_delta[0] = depth[0];
+    out->depth_delta[1] = depth[1];
+    out->flips_string = carry != 0;
+}
+
+size_t structural_find_split(const char *json, size_t len, size_t start,
+                             bool in_string, int64_t depth) {
+    uint64_t state = in_string ? ~0ULL : 0;
+    if (depth < 1) return len;
+
+    for (size_t base = start; base < len; base += STRUCTURAL_BLOCK) {
+        uint64_t bits = scan_block(json, len, base, &state);
+        for (; bits; bits &= bits - 1) {
+            size_t pos = base + (size_t)__builtin_ctzll(bits);
+            switch (json[pos]) {
+                case '{': case '[':
+                    depth++;
+                    break;
+                case '}': case ']':
+                    /* The root closed before another top-level separator */
+                    if (--depth == 0) return len;
+                    break;
+                case ',':
+                    if (depth == 1) return pos;
+                    break;
+            }
+        }
+    }
+    return len;
+}
+
+/* Bits of a 64-byte block whose bytes, with bit 5 set, equal c: '{' also
+ * catches '[' and '}' also ']'. Only used on structural bits. */
+static inline uint64_t block_bracket_mask(const char *block, unsigned char c) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < STRUCTURAL_BLOCK; i += 8) {
+        uint64_t w;
+        memcpy(&w, block + i, 8);
+        uint64_t hi = swar_eq(w | (SWAR_ONES * 0x20), c);
+        mask |= swar_movemask(hi) << i;
+    }
+    return mask;
+}
+
+size_t structural_skip(const char *json, size_t len, size_t open) {
+    uint64_t state = 0;
+    uint64_t depth = 1;
+
+    for (size_t base = open + 1; base < len; base += STRUCTURAL_BLOCK) {
+        uint64_t bits = scan_block(json, len, base, &state);
+        if (!bits) continue;
+
+        char tail[STRUCTURAL_BLOCK];
+        size_t n;
+        const char *block = load_block(json, len, base, tail, &n);
+        uint64_t opens = bits & block_bracket_mask(block, '{');
+        uint64_t closes = bits & block_bracket_mask(block, '}');
+
+        /* A block that cannot close the value is skipped whole */
+        uint64_t nclose = (uint64_t)__builtin_popcountll(closes);
+        if (depth > nclose) {
+            depth += (uint64_t)__builtin_popcountll(opens) - nclose;
+            continue;
+        }
+        for (bits = opens | closes; bits; bits &= bits - 1) {
+            unsigned bit = (unsigned)__builtin_ctzll(bits);
+            if (!(closes >> bit & 1)) {
+                depth++;
+            } else if (--depth == 0) {
+                return base + bit;
+            }
+        }
+    }
+    return len;
+}
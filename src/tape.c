@@ -0,0 +1,495 @@
+/*
+ * json-asm: Binary tape of a parsed document
+ *
+ * json_tape_save() lays a value tree out as one file that json_tape_open()
+ * maps back as a read-only document, without parsing:
+ *
+ *   header   64 bytes (struct tape_header)
+ *   nodes    value nodes, breadth first so array elements and object
+ *            members stay contiguous; the root comes first
+ *   index    key indexes of wide objects, slot tables already built
+ *   strings  long string bytes, NUL-terminated
+ *
+ * Sections start on 64-byte boundaries. With compact nodes, sibling links
+ * are already relative to the node and are written as they are; any other
+ * link is stored as the section
+ * offset of its target plus the address the file expects to be mapped at,
+ * header.base, which each file picks from a range that other mappings
+ * rarely use. When the mapping lands there, which is the usual case, the
+ * nodes are used exactly as they are in the file. Otherwise the file is
+ * mapped copy-on-write and one pass moves every link by the difference.
+ */
+
+#define _DEFAULT_SOURCE
+#include "internal.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TAPE_MAGIC          "JSONTAPE"
+#define TAPE_VERSION        2
+#define TAPE_ALIGN          64
+#define TAPE_ARENA_SIZE     4096                /* The document builds nothing */
+
+/* Preferred mapping addresses: 256 slots 64 GB apart from 80 TB up */
+#define TAPE_BASE_LOW       0x500000000000ULL
+#define TAPE_BASE_STEP      (1ULL << 36)
+#define TAPE_BASE_SLOTS     256
+
+struct tape_header {
+    char magic[8];              /* TAPE_MAGIC, not NUL-terminated */
+    uint32_t version;
+    uint32_t node_size;         /* sizeof(struct json_val) */
+    uint64_t base;              /* Address the links assume */
+    uint64_t size;              /* File size */
+    uint64_t root;              /* Offset of the root node */
+    uint64_t index;             /* Offset of the index section */
+    uint64_t strings;           /* Offset of the string section */
+    uint64_t value_count;
+};
+
+/* Start of the index section; the key indexes follow, each one directly
+ * followed by its slot table */
+struct tape_index_header {
+    uint64_t count;
+    uint64_t reserved[7];
+};
+
+#define TAPE_NODES  sizeof(struct tape_header)
+
+static inline size_t tape_align(size_t n) {
+    return (n + TAPE_ALIGN - 1) & ~(size_t)(TAPE_ALIGN - 1);
+}
+
+/* ============================================================================
+ * Relocation
+ * ============================================================================ */
+
+static inline void *moved(const void *p, uint64_t delta) {
+    return (void *)(uintptr_t)((uint64_t)(uintptr_t)p + delta);
+}
+
+/* Move every link by the delta of the section it points into. Turns the
+ * writer's section offsets into addresses, and a file mapped away from its
+ * base into a usable one. strings is where the string section is now and
+ * strings_link the link that points at its start. */
+static void tape_relocate(struct json_val *nodes, size_t count, uint8_t *index,
+                          uint8_t *strings, uint64_t strings_link,
+                          uint64_t node_delta, uint64_t index_delta,
+                          uint64_t string_delta) {
+    for (size_t i = 0; i < count; i++) {
+        struct json_val *v = &nodes[i];
+#ifndef JSON_COMPACT_NODES
+        if (v->next) v->next = moved(v->next, node_delta);
+#endif
+
+        switch ((int)val_get_type(v)) {
+            case JSON_OBJECT:
+#ifdef JSON_COMPACT_NODES
+                if (val_get_payload(v)) {
+                    v->key_index = moved(v->key_index, index_delta);
+                    break;
+                }
+#else
+                if (val_get_payload(v)) {
+                    val_set_payload(v, val_get_payload(v) + index_delta);
+                }
+#endif
+                /* fall through */
+            case JSON_ARRAY:
+                if (v->child) v->child = moved(v->child, node_delta);
+                break;
+            case JSON_STRING_LONG:
+#ifdef JSON_COMPACT_NODES
+                if (val_get_payload(v) == JSON_PAYLOAD_MAX) {
+                    struct json_str_ext *ext = (struct json_str_ext *)
+                        (strings + ((uint64_t)(uintptr_t)v->str_ptr - strings_link));
+                    ext->ptr = moved(ext->ptr, string_delta);
+                }
+#endif
+                v->str_ptr = moved(v->str_ptr, string_delta);
+                break;
+            default:
+                break;
+        }
+    }
+    (void)strings;
+    (void)strings_link;
+
+    const struct tape_index_header *ih = (const struct tape_index_header *)index;
+    uint8_t *p = index + sizeof(*ih);
+    for (uint64_t i = 0; i < ih->count; i++) {
+        struct key_index *ki = (struct key_index *)p;
+        struct key_slot *slots = (struct key_slot *)(p + sizeof(*ki));
+        ki->slots = moved(ki->slots, index_delta);
+#ifdef JSON_COMPACT_NODES
+        ki->child = moved(ki->child, node_delta);
+#endif
+        for (size_t s = 0; s <= ki->mask; s++) {
+            if (slots[s].key) slots[s].key = moved(slots[s].key, node_delta);
+        }
+        p += sizeof(*ki) + (ki->mask + 1) * sizeof(struct key_slot);
+    }
+}
+
+/* ============================================================================
+ * Writer
+ * ============================================================================ */
+
+struct tape_buf {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+};
+
+/* Append n zeroed bytes; returns their offset, or SIZE_MAX */
+static size_t buf_push(struct tape_buf *b, size_t n) {
+    if (b->cap - b->len < n) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap - b->len < n) cap *= 2;
+        uint8_t *data = realloc(b->data, cap);
+        if (!data) return SIZE_MAX;
+        b->data = data;
+        b->cap = cap;
+    }
+    size_t off = b->len;
+    memset(b->data + off, 0, n);
+    b->len += n;
+    return off;
+}
+
+/* A container whose members are still to be written */
+struct tape_pending {
+    size_t out;                 /* Its node index in the tape */
+    const struct json_val *src;
+};
+
+struct tape_writer {
+    struct tape_buf nodes;
+    struct tape_buf index;
+    struct tape_buf strings;
+    struct tape_pending *queue;
+    size_t queue_len;
+    size_t queue_cap;
+    size_t index_count;
+};
+
+static inline struct json_val *out_node(struct tape_writer *w, size_t i) {
+    return (struct json_val *)w->nodes.data + i;
+}
+
+/* Links are node offsets while writing. Offset 0 is the root, which no link
+ * points at, so 0 still means NULL. */
+static inline struct json_val *node_link(size_t i) {
+    return (struct json_val *)(uintptr_t)(i * sizeof(struct json_val));
+}
+
+/* Make node i + 1 the sibling of node i */
+static inline void out_chain(struct tape_writer *w, size_t i) {
+#ifdef JSON_COMPACT_NODES
+    val_set_next(out_node(w, i), out_node(w, i + 1));
+#else
+    out_node(w, i)->next = node_link(i + 1);
+#endif
+}
+
+static bool tape_enqueue(struct tape_writer *w, size_t out, const struct json_val *src) {
+    if (w->queue_len == w->queue_cap) {
+        size_t cap = w->queue_cap ? w->queue_cap * 2 : 64;
+        struct tape_pending *queue = realloc(w->queue, cap * sizeof(*queue));
+        if (!queue) return false;
+        w->queue = queue;
+        w->queue_cap = cap;
+    }
+    w->queue[w->queue_len++] = (struct tape_pending){ out, src };
+    return true;
+}
+
+/* Copy one node; its links are set by the caller */
+static bool tape_emit(struct tape_writer *w, const struct json_val *src) {
+    size_t i = w->nodes.len / sizeof(struct json_val);
+    if (buf_push(&w->nodes, sizeof(struct json_val)) == SIZE_MAX) return false;
+
+    struct json_val *v = out_node(w, i);
+    val_copy_value(v, src);
+    switch ((int)val_get_type(src)) {
+        case JSON_STRING_LONG: {
+            size_t len;
+            const char *str = val_str(src, &len);
+            size_t ext = SIZE_MAX;
+#ifdef JSON_COMPACT_NODES
+            /* Too long for the payload: the string keeps an out-of-line
+             * pointer and length, written just before its bytes */
+            if (val_get_payload(src) == JSON_PAYLOAD_MAX) {
+                size_t pad = (sizeof(struct json_str_ext) - w->strings.len % sizeof(struct json_str_ext)) %
+                             sizeof(struct json_str_ext);
+                if (buf_push(&w->strings, pad) == SIZE_MAX) return false;
+                ext = buf_push(&w->strings, sizeof(struct json_str_ext));
+                if (ext == SIZE_MAX) return false;
+            }
+#endif
+            size_t off = buf_push(&w->strings, len + 1);
+            if (off == SIZE_MAX) return false;
+            memcpy(w->strings.data + off, str, len);
+            if (ext != SIZE_MAX) {
+                struct json_str_ext *e = (struct json_str_ext *)(w->strings.data + ext);
+                e->ptr = (const char *)(uintptr_t)off;
+                e->len = len;
+                off = ext;
+            }
+            out_node(w, i)->str_ptr = (const char *)(uintptr_t)off;
+            return true;
+        }
+        case JSON_OBJECT:
+            /* The payload gets the tape's own key index, if any */
+            val_reset(v, JSON_OBJECT);
+            return tape_enqueue(w, i, src);
+        case JSON_ARRAY:
+            v->child = NULL;
+            return tape_enqueue(w, i, src);
+        default:
+            return true;
+    }
+}
+
+static const char *out_str(struct tape_writer *w, const struct json_val *v, size_t *len) {
+    if (val_is_short_string(v)) return val_str(v, len);
+    *len = (size_t)val_get_payload(v);
+    uintptr_t off = (uintptr_t)v->str_ptr;
+#ifdef JSON_COMPACT_NODES
+    if (*len == JSON_PAYLOAD_MAX) {
+        const struct json_str_ext *ext = (const struct json_str_ext *)(w->strings.data + off);
+        *len = ext->len;
+        off = (uintptr_t)ext->ptr;
+    }
+#endif
+    return (const char *)w->strings.data + off;
+}
+
+/* Key index over the count members written from node first on, laid out
+ * like keyindex.c builds it: first of any duplicate keys wins */
+static bool tape_index(struct tape_writer *w, size_t obj, size_t first, size_t count) {
+    size_t slots = 1;
+    while (slots < count * 2) slots <<= 1;
+
+    size_t off = buf_push(&w->index, sizeof(struct key_index) + slots * sizeof(struct key_slot));
+    if (off == SIZE_MAX) return false;
+
+    struct key_index *ki = (struct key_index *)(w->index.data + off);
+    struct key_slot *table = (struct key_slot *)(ki + 1);
+    ki->count = count;
+    ki->mask = slots - 1;
+    ki->slots = (struct key_slot *)(uintptr_t)(off + sizeof(*ki));
+
+    for (size_t m = 0; m < count; m++) {
+        size_t k = first + 2 * m;
+        size_t len;
+        const char *str = out_str(w, out_node(w, k), &len);
+        uint64_t hash = key_hash(str, len);
+
+        size_t s = (size_t)hash & ki->mask;
+        for (; table[s].key; s = (s + 1) & ki->mask) {
+            size_t slot_len;
+            const char *slot_str = out_str(w, out_node(w, (uintptr_t)table[s].key / sizeof(struct json_val)), &slot_len);
+            if (table[s].hash == hash && slot_len == len && memcmp(slot_str, str, len) == 0) break;
+        }
+        if (!table[s].key) {
+            table[s].key = node_link(k);
+            table[s].hash = hash;
+        }
+    }
+
+#ifdef JSON_COMPACT_NODES
+    /* The object points at its index, which takes over the first key */
+    struct json_val *v = out_node(w, obj);
+    ki->child = v->child;
+    v->key_index = (struct key_index *)(uintptr_t)off;
+    val_set_payload(v, 1);
+#else
+    val_set_payload(out_node(w, obj), off);
+#endif
+    w->index_count++;
+    return true;
+}
+
+/* Write the members of one pending container as a contiguous run */
+static bool tape_members(struct tape_writer *w, const struct tape_pending *p) {
+    size_t first = w->nodes.len / sizeof(struct json_val);
+    size_t count = 0;
+
+    if (val_get_type(p->src) == JSON_ARRAY) {
+        for (const struct json_val *e = p->src->child; e; e = val_next(e), count++) {
+            if (!tape_emit(w, e)) return false;
+        }
+        for (size_t i = 0; i + 1 < count; i++) out_chain(w, first + i);
+        if (count > 0) out_node(w, p->out)->child = node_link(first);
+    } else {
+        for (const struct json_val *k = val_child(p->src); k; k = val_next(val_next(k)), count++) {
+            if (!tape_emit(w, k) || !tape_emit(w, val_next(k))) return false;
+        }
+        for (size_t i = 0; i + 1 < 2 * count; i++) out_chain(w, first + i);
+        if (count > 0) out_node(w, p->out)->child = node_link(first);
+        if (count >= KEY_INDEX_MIN_MEMBERS && !tape_index(w, p->out, first, count)) return false;
+    }
+    return true;
+}
+
+static bool write_padded(FILE *f, const void *data, size_t len) {
+    static const uint8_t zeros[TAPE_ALIGN];
+    size_t pad = tape_align(len) - len;
+    return (len == 0 || fwrite(data, 1, len, f) == len) &&
+           (pad == 0 || fwrite(zeros, 1, pad, f) == pad);
+}
+
+bool tape_save(struct json_val *root, const char *path) {
+    struct tape_writer w = {0};
+    bool ok = buf_push(&w.index, sizeof(struct tape_index_header)) != SIZE_MAX &&
+              tape_emit(&w, root);
+    for (size_t q = 0; ok && q < w.queue_len; q++) {
+        struct tape_pending p = w.queue[q];
+        ok = tape_members(&w, &p);
+    }
+    free(w.queue);
+
+    if (!ok) {
+        free(w.nodes.data);
+        free(w.index.data);
+        free(w.strings.data);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Memory allocation failed");
+        return false;
+    }
+
+    size_t count = w.nodes.len / sizeof(struct json_val);
+    ((struct tape_index_header *)w.index.data)->count = w.index_count;
+
+    struct tape_header h = {0};
+    memcpy(h.magic, TAPE_MAGIC, sizeof(h.magic));
+    h.version = TAPE_VERSION;
+    h.node_size = sizeof(struct json_val);
+    h.root = TAPE_NODES;
+    h.index = TAPE_NODES + tape_align(w.nodes.len);
+    h.strings = h.index + tape_align(w.index.len);
+    h.size = h.strings + tape_align(w.strings.len);
+    h.value_count = count;
+    h.base = TAPE_BASE_LOW + (key_hash((const char *)&h, sizeof(h)) % TAPE_BASE_SLOTS) * TAPE_BASE_STEP;
+
+    tape_relocate((struct json_val *)w.nodes.data, count, w.index.data, w.strings.data, 0,
+                  h.base + TAPE_NODES, h.base + h.index, h.base + h.strings);
+
+    FILE *f = fopen(path, "wb");
+    ok = f && fwrite(&h, sizeof(h), 1, f) == 1 &&
+         write_padded(f, w.nodes.data, w.nodes.len) &&
+         write_padded(f, w.index.data, w.index.len) &&
+         write_padded(f, w.strings.data, w.strings.len);
+    if (f && fclose(f) != 0) ok = false;
+
+    free(w.nodes.data);
+    free(w.index.data);
+    free(w.strings.data);
+    if (!ok) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot write file");
+        remove(path);
+    }
+    return ok;
+}
+
+/* ============================================================================
+ * Loader
+ * ============================================================================ */
+
+static bool tape_header_valid(const struct tape_header *h, uint64_t file_size) {
+    return memcmp(h->magic, TAPE_MAGIC, sizeof(h->magic)) == 0 &&
+           h->version == TAPE_VERSION &&
+           h->node_size == sizeof(struct json_val) &&
+           h->size == file_size &&
+           h->root == TAPE_NODES &&
+           h->root < h->index &&
+           h->index + sizeof(struct tape_index_header) <= h->strings &&
+           h->strings <= h->size &&
+           h->value_count <= (h->index - TAPE_NODES) / sizeof(struct json_val);
+}
+
+/* Make the tape at data usable where it is */
+static void tape_rebase(uint8_t *data, const struct tape_header *h) {
+    uint64_t delta = (uint64_t)(uintptr_t)data - h->base;
+    tape_relocate((struct json_val *)(data + TAPE_NODES), h->value_count,
+                  data + h->index, data + h->strings, h->base + h->strings,
+                  delta, delta, delta);
+}
+
+static struct json_doc *tape_doc(struct owned_input *in, const struct tape_header *h) {
+    struct json_doc *doc = doc_pool_get();
+    if (!doc) doc = arena_create(TAPE_ARENA_SIZE);
+    if (!doc) {
+        input_release(in);
+        set_error(JSON_ERROR_MEMORY, 0, 0, 0, "Failed to allocate document");
+        return NULL;
+    }
+    doc->input = *in;
+    doc->root = (struct json_val *)((uint8_t *)in->data + h->root);
+    doc->value_count = h->value_count;
+    doc->readonly = true;
+    return doc;
+}
+
+#if !defined(_WIN32)
+
+struct json_doc *tape_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot open file");
+        return NULL;
+    }
+
+    struct tape_header h;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+        !tape_header_valid(&h, (uint64_t)st.st_size)) {
+        close(fd);
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Not a json-asm tape");
+        return NULL;
+    }
+
+    /* At its base the tape needs no writes, so it can stay read-only */
+    size_t size = (size_t)h.size;
+    void *map = mmap((void *)(uintptr_t)h.base, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED && (uint64_t)(uintptr_t)map != h.base) {
+        munmap(map, size);
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            tape_rebase(map, &h);
+            mprotect(map, size, PROT_READ);
+        }
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Cannot map file");
+        return NULL;
+    }
+
+    struct owned_input in = { map, size, size, true };
+    return tape_doc(&in, &h);
+}
+
+#else
+
+struct json_doc *tape_open(const char *path) {
+    /* No mapping: read the file and rebase it in memory */
+    struct owned_input in = {0};
+    if (!input_load_file(&in, path, 0)) return NULL;
+
+    struct tape_header h;
+    if (in.len < sizeof(h) || (memcpy(&h, in.data, sizeof(h)), !tape_header_valid(&h, in.len))) {
+        input_release(&in);
+        set_error(JSON_ERROR_IO, 0, 0, 0, "Not a json-asm tape");
+        return NULL;
+    }
+    tape_rebase(in.data, &h);
+    return tape_doc(&in, &h);
+}
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * json-asm: Non-recursive tree walk
+ *
+ * The walker itself is inline in internal.h, as it runs once per node;
+ * only the move of its frames to the heap is here.
+ */
+
+#include "internal.h"
+
+/* Double the frame stack; false (nothing changed) when out of memory */
+bool tree_walk_grow(struct tree_walk *w) {
+    size_t cap = w->cap * 2;
+    bool heap = w->frames != w->inline_frames;
+    struct walk_frame *frames = heap
+        ? realloc(w->frames, cap * sizeof(struct walk_frame))
+        : malloc(cap * sizeof(struct walk_frame));
+    if (!frames) return false;
+    if (!heap) {
+        memcpy(frames, w->inline_frames, w->depth * sizeof(struct walk_frame));
+    }
+    w->frames = frames;
+    w->cap = cap;
+    return true;
+}
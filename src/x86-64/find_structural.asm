@@ -165,18 +165,16 @@ GLOBAL_FUNC find_structural_avx2
     vpcmpeqb ymm9, ymm0, ymm7                 ; '"'
     vpor    ymm8, ymm8, ymm9
 
-    ; Extract mask to ecx
-    vpmovmskb ecx, ymm8
-
     ; Create validity mask based on actual length
-    ; If rax < 32, mask out bits >= rax
-    mov     r8d, -1                           ; All 1s
-    mov     r9, rax                           ; Copy count to r9
-    mov     cl, r9b                           ; Put count in cl for shift
-    shl     r8d, cl                           ; Shift left by count
-    not     r8d                               ; Invert to get mask of valid bits
-
-    ; Re-extract mask (since we clobbered ecx)
+    ; If rax < 32, mask out bits >= rax. The shift is done in 64 bits:
+    ; a 32-bit shift by 32 is masked to a shift by 0 and would clear the
+    ; mask for every full block.
+    mov     r8, -1                            ; All 1s
+    mov     ecx, eax                          ; Count in cl for shift
+    shl     r8, cl                            ; Shift left by count
+    not     r8                                ; Invert to get mask of valid bits
+
+    ; Extract mask
     vpmovmskb ecx, ymm8
     and     ecx, r8d                          ; Mask out invalid positions
 
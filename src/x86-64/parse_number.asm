@@ -97,32 +97,16 @@ GLOBAL_FUNC parse_int_avx2
 
     ; Choose parsing method based on digit count
     cmp     r10d, 8
-    ja      .scalar_parse                      ; > 8 digits: use scalar
+    jne     .scalar_parse                      ; Only a full 8-digit run uses SIMD
 
-    ; =========== SIMD parsing for 1-8 digits ===========
-    ; Load 8 bytes
+    ; =========== SIMD parsing for exactly 8 digits ===========
+    ; Load the 8 digit bytes (never reads past the digit run)
     lea     rax, [rdi + r9]
     vmovq   xmm0, [rax]
 
     ; Convert ASCII to digits (subtract '0')
     vpsubb  xmm0, xmm0, [rel const_ascii_zero_16]
 
-    ; Zero out positions beyond digit count
-    ; Create mask: for n digits, mask has n 0xFF bytes followed by zeros
-    mov     eax, -1
-    mov     ecx, r10d
-    shl     eax, cl
-    not     eax
-    vmovd   xmm1, eax
-    vpbroadcastd xmm1, xmm1                    ; Broadcast to all lanes...
-    ; Actually simpler: just use direct mask
-    mov     rax, -1
-    mov     ecx, r10d
-    shl     rax, cl
-    not     rax
-    vmovq   xmm1, rax
-    vpand   xmm0, xmm0, xmm1
-
     ; Step 1: Combine pairs of digits with PMADDUBSW
     ; [d0,d1,d2,d3,d4,d5,d6,d7] -> [d0*10+d1, d2*10+d3, d4*10+d5, d6*10+d7] (16-bit)
     vpmaddubsw xmm0, xmm0, [rel mul_10_1]
@@ -137,18 +121,9 @@ GLOBAL_FUNC parse_int_avx2
     vpmulld xmm2, xmm0, [rel mul_10000_1]     ; Multiply first by 10000
     vpaddd  xmm0, xmm2, xmm1                   ; Add
 
-    ; Extract result
+    ; Extract result (at most 99999999, zero-extended into rax)
     vmovd   eax, xmm0
 
-    ; Handle different digit counts (need to adjust for actual digit positions)
-    ; The SIMD approach assumes right-aligned digits, but we have left-aligned
-    ; Need to divide by appropriate power of 10 or use different approach
-
-    ; Actually, for simplicity, let's use a lookup table or scalar for small counts
-    ; The SIMD approach works best for exactly 8 digits
-    cmp     r10d, 8
-    jne     .adjust_result
-
 .apply_sign:
     ; Apply sign
     test    r8d, r8d
@@ -159,11 +134,6 @@ GLOBAL_FUNC parse_int_avx2
     vzeroupper
     ret
 
-.adjust_result:
-    ; For non-8 digit counts, the result needs adjustment
-    ; Easier to just do scalar parsing for these cases
-    jmp     .scalar_parse
-
 .scalar_parse:
     ; Scalar parsing for > 8 digits or adjustment cases
     xor     eax, eax
@@ -327,20 +297,13 @@ GLOBAL_FUNC parse_int_avx512
 .avx512_no_store:
 
     cmp     r10d, 8
-    ja      .avx512_scalar_parse
+    jne     .avx512_scalar_parse
 
-    ; SIMD parsing for 1-8 digits
+    ; SIMD parsing for exactly 8 digits
     lea     rax, [rdi + r9]
     vmovq   xmm0, [rax]
     vpsubb  xmm0, xmm0, [rel const_ascii_zero_16]
 
-    mov     rax, -1
-    mov     ecx, r10d
-    shl     rax, cl
-    not     rax
-    vmovq   xmm1, rax
-    vpand   xmm0, xmm0, xmm1
-
     vpmaddubsw xmm0, xmm0, [rel mul_10_1]
     vpmaddwd xmm0, xmm0, [rel mul_100_1]
     vpshufd xmm1, xmm0, 0x01
@@ -349,9 +312,6 @@ GLOBAL_FUNC parse_int_avx512
 
     vmovd   eax, xmm0
 
-    cmp     r10d, 8
-    jne     .avx512_scalar_parse
-
 .avx512_apply_sign:
     test    r8d, r8d
     jz      .avx512_return
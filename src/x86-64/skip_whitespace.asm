@@ -0,0 +1,284 @@
+; json-asm: SIMD whitespace skipping for x86-64
+; Finds the first byte that is not JSON whitespace (space, tab, LF, CR)
+;
+; Used between tokens, where indentation in pretty-printed input produces
+; long whitespace runs
+
+%ifdef MACHO
+    %define FUNC(name) _ %+ name
+%else
+    %define FUNC(name) name
+%endif
+
+%macro GLOBAL_FUNC 1
+    global FUNC(%1):function
+    FUNC(%1):
+%endmacro
+
+; ============================================================================
+; Read-only data section
+; ============================================================================
+section .rodata
+    align 64
+    ; Constants for AVX-512 (64-byte aligned)
+    const_space_64:     times 64 db ' '
+    const_tab_64:       times 64 db 0x09
+    const_lf_64:        times 64 db 0x0A
+    const_cr_64:        times 64 db 0x0D
+
+    align 32
+    ; Constants for AVX2 (32-byte aligned)
+    const_space_32:     times 32 db ' '
+    const_tab_32:       times 32 db 0x09
+    const_lf_32:        times 32 db 0x0A
+    const_cr_32:        times 32 db 0x0D
+
+    align 16
+    ; Constants for SSE (16-byte aligned)
+    const_space_16:     times 16 db ' '
+    const_tab_16:       times 16 db 0x09
+    const_lf_16:        times 16 db 0x0A
+    const_cr_16:        times 16 db 0x0D
+
+section .text
+
+; ============================================================================
+; AVX-512 implementation (64 bytes at a time)
+; ============================================================================
+%ifndef NO_AVX512
+
+GLOBAL_FUNC skip_whitespace_avx512
+    ; Input: rdi = string pointer, rsi = length
+    ; Output: rax = position of first non-whitespace byte, or length if none
+
+    test    rsi, rsi
+    jz      .empty
+
+    ; Load broadcast constants
+    vmovdqa64 zmm1, [rel const_space_64]
+    vmovdqa64 zmm2, [rel const_tab_64]
+    vmovdqa64 zmm3, [rel const_lf_64]
+    vmovdqa64 zmm6, [rel const_cr_64]
+
+    xor     rax, rax                           ; Position counter
+
+.loop64:
+    mov     rcx, rsi
+    sub     rcx, rax
+    cmp     rcx, 64
+    jb      .scalar_loop
+
+    ; Load 64 bytes
+    vmovdqu64 zmm0, [rdi + rax]
+
+    ; Mark whitespace bytes
+    vpcmpeqb k1, zmm0, zmm1                   ; ' '
+    vpcmpeqb k2, zmm0, zmm2                   ; '\t'
+    korq    k1, k1, k2
+    vpcmpeqb k2, zmm0, zmm3                   ; '\n'
+    korq    k1, k1, k2
+    vpcmpeqb k2, zmm0, zmm6                   ; '\r'
+    korq    k1, k1, k2
+
+    ; Invert: set bits are now non-whitespace
+    kmovq   rcx, k1
+    not     rcx
+    test    rcx, rcx
+    jnz     .found64
+
+    add     rax, 64
+    jmp     .loop64
+
+.found64:
+    tzcnt   rcx, rcx                          ; Find first set bit
+    add     rax, rcx
+    vzeroupper
+    ret
+
+.empty:
+    xor     eax, eax
+    ret
+
+.scalar_loop:
+    cmp     rax, rsi
+    jae     .done
+    movzx   ecx, byte [rdi + rax]
+    cmp     cl, ' '
+    je      .scalar_next
+    cmp     cl, 0x09
+    je      .scalar_next
+    cmp     cl, 0x0A
+    je      .scalar_next
+    cmp     cl, 0x0D
+    jne     .done
+.scalar_next:
+    inc     rax
+    jmp     .scalar_loop
+
+.done:
+    vzeroupper
+    ret
+
+%endif ; NO_AVX512
+
+; ============================================================================
+; AVX2 implementation (32 bytes at a time)
+; ============================================================================
+
+GLOBAL_FUNC skip_whitespace_avx2
+    ; Input: rdi = string pointer, rsi = length
+    ; Output: rax = position of first non-whitespace byte, or length if none
+
+    test    rsi, rsi
+    jz      .avx2_empty
+
+    ; Load constants
+    vmovdqa ymm1, [rel const_space_32]
+    vmovdqa ymm2, [rel const_tab_32]
+    vmovdqa ymm3, [rel const_lf_32]
+    vmovdqa ymm6, [rel const_cr_32]
+
+    xor     rax, rax
+
+.avx2_loop:
+    mov     rcx, rsi
+    sub     rcx, rax
+    cmp     rcx, 32
+    jb      .avx2_tail
+
+    ; Load 32 bytes
+    vmovdqu ymm0, [rdi + rax]
+
+    ; Mark whitespace bytes
+    vpcmpeqb ymm4, ymm0, ymm1                 ; ' '
+    vpcmpeqb ymm5, ymm0, ymm2                 ; '\t'
+    vpor    ymm4, ymm4, ymm5
+    vpcmpeqb ymm5, ymm0, ymm3                 ; '\n'
+    vpor    ymm4, ymm4, ymm5
+    vpcmpeqb ymm5, ymm0, ymm6                 ; '\r'
+    vpor    ymm4, ymm4, ymm5
+
+    ; Extract mask and invert: set bits are non-whitespace
+    vpmovmskb ecx, ymm4
+    not     ecx
+    test    ecx, ecx
+    jnz     .avx2_found
+
+    add     rax, 32
+    jmp     .avx2_loop
+
+.avx2_found:
+    tzcnt   ecx, ecx
+    add     rax, rcx
+    vzeroupper
+    ret
+
+.avx2_tail:
+    cmp     rax, rsi
+    jae     .avx2_done
+
+.avx2_scalar:
+    movzx   ecx, byte [rdi + rax]
+    cmp     cl, ' '
+    je      .avx2_next
+    cmp     cl, 0x09
+    je      .avx2_next
+    cmp     cl, 0x0A
+    je      .avx2_next
+    cmp     cl, 0x0D
+    jne     .avx2_done
+.avx2_next:
+    inc     rax
+    cmp     rax, rsi
+    jb      .avx2_scalar
+
+.avx2_done:
+    vzeroupper
+    ret
+
+.avx2_empty:
+    xor     eax, eax
+    ret
+
+; ============================================================================
+; SSE4.2 implementation (16 bytes at a time)
+; ============================================================================
+
+GLOBAL_FUNC skip_whitespace_sse42
+    ; Input: rdi = string pointer, rsi = length
+    ; Output: rax = position of first non-whitespace byte, or length if none
+
+    test    rsi, rsi
+    jz      .sse_empty
+
+    ; Load constants
+    movdqa  xmm1, [rel const_space_16]
+    movdqa  xmm2, [rel const_tab_16]
+    movdqa  xmm3, [rel const_lf_16]
+    movdqa  xmm6, [rel const_cr_16]
+
+    xor     rax, rax
+
+.sse_loop:
+    mov     rcx, rsi
+    sub     rcx, rax
+    cmp     rcx, 16
+    jb      .sse_tail
+
+    ; Load 16 bytes
+    movdqu  xmm0, [rdi + rax]
+
+    ; Mark whitespace bytes
+    movdqa  xmm4, xmm0
+    pcmpeqb xmm4, xmm1              ; ' '
+    movdqa  xmm5, xmm0
+    pcmpeqb xmm5, xmm2              ; '\t'
+    por     xmm4, xmm5
+    movdqa  xmm5, xmm0
+    pcmpeqb xmm5, xmm3              ; '\n'
+    por     xmm4, xmm5
+    movdqa  xmm5, xmm0
+    pcmpeqb xmm5, xmm6              ; '\r'
+    por     xmm4, xmm5
+
+    ; Extract mask and invert the low 16 bits: set bits are non-whitespace
+    pmovmskb ecx, xmm4
+    xor     ecx, 0xFFFF
+    jnz     .sse_found
+
+    add     rax, 16
+    jmp     .sse_loop
+
+.sse_found:
+    tzcnt   ecx, ecx
+    add     rax, rcx
+    ret
+
+.sse_tail:
+    cmp     rax, rsi
+    jae     .sse_done
+
+.sse_scalar:
+    movzx   ecx, byte [rdi + rax]
+    cmp     cl, ' '
+    je      .sse_next
+    cmp     cl, 0x09
+    je      .sse_next
+    cmp     cl, 0x0A
+    je      .sse_next
+    cmp     cl, 0x0D
+    jne     .sse_done
+.sse_next:
+    inc     rax
+    cmp     rax, rsi
+    jb      .sse_scalar
+
+.sse_done:
+    ret
+
+.sse_empty:
+    xor     eax, eax
+    ret
+
+; Mark stack as non-executable (security)
+section .note.GNU-stack noalloc noexec nowrite progbits
@@ -0,0 +1,301 @@
+; json-asm: SIMD UTF-8 validation for x86-64
+; Checks a string for malformed, overlong, surrogate and out-of-range
+; sequences (Unicode table 3-7), 32 or 16 bytes at a time
+;
+; Each byte is classified by three table lookups: the high and low nibbles
+; of the byte before it and its own high nibble. ANDing the three gives the
+; error cases a two-byte window can see (an overlong or too-large lead, a
+; surrogate, a missing or stray continuation). The third and fourth bytes
+; of a sequence are matched against the lead two and three bytes back, and
+; a continuation byte that is neither of those nor after a lead is an error.
+;
+; The kernels only locate the block of the first error; the caller backs
+; up from there to the exact byte with the scalar validator.
+;
+; Used by JSON_PARSE_VALIDATE_UTF8 on each run of string bytes
+
+%ifdef MACHO
+    %define FUNC(name) _ %+ name
+%else
+    %define FUNC(name) name
+%endif
+
+%macro GLOBAL_FUNC 1
+    global FUNC(%1):function
+    FUNC(%1):
+%endmacro
+
+; Lookup tables, indexed by nibble. Each bit is one error case that the
+; nibble allows:
+;   0x01 too short (lead not followed by a continuation)
+;   0x02 too long (continuation after ASCII)
+;   0x04 overlong 3-byte (E0 80..9F)
+;   0x08 too large (past U+10FFFF)
+;   0x10 surrogate (ED A0..BF)
+;   0x20 overlong 2-byte (C0, C1)
+;   0x40 overlong 4-byte (F0 80..8F), or too large with a 80..8F second byte
+;   0x80 two continuations in a row
+%define UTF8_BYTE1_HIGH 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, \
+                        0x80, 0x80, 0x80, 0x80, 0x21, 0x01, 0x15, 0x49
+%define UTF8_BYTE1_LOW  0xE7, 0xA3, 0x83, 0x83, 0x8B, 0xCB, 0xCB, 0xCB, \
+                        0xCB, 0xCB, 0xCB, 0xCB, 0xCB, 0xDB, 0xCB, 0xCB
+%define UTF8_BYTE2_HIGH 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, \
+                        0xE6, 0xAE, 0xBA, 0xBA, 0x01, 0x01, 0x01, 0x01
+
+; ============================================================================
+; Read-only data section
+; ============================================================================
+section .rodata
+    align 32
+    ; Constants for AVX2 (32-byte aligned, tables repeated per lane)
+    utf8_byte1_high_32: db UTF8_BYTE1_HIGH, UTF8_BYTE1_HIGH
+    utf8_byte1_low_32:  db UTF8_BYTE1_LOW, UTF8_BYTE1_LOW
+    utf8_byte2_high_32: db UTF8_BYTE2_HIGH, UTF8_BYTE2_HIGH
+    const_0f_32:        times 32 db 0x0F
+    const_60_32:        times 32 db 0xE0 - 0x80     ; Leads of 3+ byte sequences
+    const_70_32:        times 32 db 0xF0 - 0x80     ; Leads of 4-byte sequences
+    const_80_32:        times 32 db 0x80
+
+    align 16
+    ; Constants for SSE (16-byte aligned)
+    utf8_byte1_high_16: db UTF8_BYTE1_HIGH
+    utf8_byte1_low_16:  db UTF8_BYTE1_LOW
+    utf8_byte2_high_16: db UTF8_BYTE2_HIGH
+    const_0f_16:        times 16 db 0x0F
+    const_60_16:        times 16 db 0xE0 - 0x80
+    const_70_16:        times 16 db 0xF0 - 0x80
+    const_80_16:        times 16 db 0x80
+
+section .text
+
+; ============================================================================
+; AVX2 implementation (32 bytes at a time)
+; ============================================================================
+
+; Errors of block ymm0 following block ymm15 into ymm5 (nonzero if any).
+; Expects the tables in ymm8-ymm10 and the nibble mask in ymm11.
+%macro UTF8_CHECK_AVX2 0
+    ; The input shifted back by 1, 2 and 3 bytes, across the lanes
+    vperm2i128 ymm1, ymm15, ymm0, 0x21        ; Previous high lane, low lane
+    vpalignr ymm2, ymm0, ymm1, 15             ; prev1
+    vpalignr ymm3, ymm0, ymm1, 14             ; prev2
+    vpalignr ymm4, ymm0, ymm1, 13             ; prev3
+
+    ; Two-byte window cases
+    vpsrlw  ymm5, ymm2, 4
+    vpand   ymm5, ymm5, ymm11
+    vpshufb ymm5, ymm8, ymm5                  ; prev1 high nibble
+    vpand   ymm6, ymm2, ymm11
+    vpshufb ymm6, ymm9, ymm6                  ; prev1 low nibble
+    vpand   ymm5, ymm5, ymm6
+    vpsrlw  ymm6, ymm0, 4
+    vpand   ymm6, ymm6, ymm11
+    vpshufb ymm6, ymm10, ymm6                 ; input high nibble
+    vpand   ymm5, ymm5, ymm6
+
+    ; Continuations owed to a 3- or 4-byte lead cancel "two continuations"
+    vpsubusb ymm3, ymm3, [rel const_60_32]
+    vpsubusb ymm4, ymm4, [rel const_70_32]
+    vpor    ymm3, ymm3, ymm4
+    vpand   ymm3, ymm3, [rel const_80_32]
+    vpxor   ymm5, ymm5, ymm3
+%endmacro
+
+GLOBAL_FUNC validate_utf8_avx2
+    ; Input: rdi = string pointer, rsi = length
+    ; Output: rax = length if valid, else the offset of the block where the
+    ;         first error shows, which is below the length
+
+    vmovdqa ymm8, [rel utf8_byte1_high_32]
+    vmovdqa ymm9, [rel utf8_byte1_low_32]
+    vmovdqa ymm10, [rel utf8_byte2_high_32]
+    vmovdqa ymm11, [rel const_0f_32]
+    vpxor   ymm15, ymm15, ymm15               ; Previous block
+    xor     eax, eax                          ; Position counter
+    xor     r8d, r8d                          ; Non-ASCII bytes of previous block
+
+.avx2_loop:
+    mov     rcx, rsi
+    sub     rcx, rax
+    cmp     rcx, 32
+    jb      .avx2_tail
+
+    vmovdqu ymm0, [rdi + rax]
+
+    ; An ASCII block after an ASCII block has nothing to check
+    vpmovmskb edx, ymm0
+    mov     ecx, edx
+    or      ecx, r8d
+    jz      .avx2_next
+
+    UTF8_CHECK_AVX2
+    vptest  ymm5, ymm5
+    jnz     .avx2_error
+
+.avx2_next:
+    mov     r8d, edx
+    vmovdqa ymm15, ymm0
+    add     rax, 32
+    jmp     .avx2_loop
+
+.avx2_tail:
+    ; Check the rest as a zero-padded block. The padding also ends a sequence
+    ; left open by the last full block, which then fails as too short.
+    test    rcx, rcx
+    jnz     .avx2_pad
+    test    r8d, r8d
+    jz      .avx2_done
+
+.avx2_pad:
+    vpxor   ymm0, ymm0, ymm0
+    vmovdqu [rsp - 32], ymm0                  ; Red zone
+    lea     r10, [rdi + rax]
+    xor     edx, edx
+.avx2_copy:
+    cmp     rdx, rcx
+    jae     .avx2_copied
+    movzx   r9d, byte [r10 + rdx]
+    mov     [rsp - 32 + rdx], r9b
+    inc     rdx
+    jmp     .avx2_copy
+.avx2_copied:
+    vmovdqu ymm0, [rsp - 32]
+
+    UTF8_CHECK_AVX2
+    vptest  ymm5, ymm5
+    jnz     .avx2_tail_error
+    mov     rax, rsi
+
+.avx2_done:
+    vzeroupper
+    ret
+
+.avx2_tail_error:
+    ; Only the padding failed: the input ends inside a sequence
+    cmp     rax, rsi
+    jb      .avx2_error
+    dec     rax
+
+.avx2_error:
+    vzeroupper
+    ret
+
+; ============================================================================
+; SSE4.2 implementation (16 bytes at a time)
+; ============================================================================
+
+; Errors of block xmm0 following block xmm15 into xmm6 (nonzero if any).
+; Expects the tables in xmm8-xmm10 and the nibble mask in xmm11.
+%macro UTF8_CHECK_SSE 0
+    ; The input shifted back by 1, 2 and 3 bytes
+    movdqa  xmm2, xmm0
+    palignr xmm2, xmm15, 15                   ; prev1
+    movdqa  xmm3, xmm0
+    palignr xmm3, xmm15, 14                   ; prev2
+    movdqa  xmm4, xmm0
+    palignr xmm4, xmm15, 13                   ; prev3
+
+    ; Two-byte window cases
+    movdqa  xmm5, xmm2
+    psrlw   xmm5, 4
+    pand    xmm5, xmm11
+    movdqa  xmm6, xmm8
+    pshufb  xmm6, xmm5                        ; prev1 high nibble
+    movdqa  xmm5, xmm2
+    pand    xmm5, xmm11
+    movdqa  xmm7, xmm9
+    pshufb  xmm7, xmm5                        ; prev1 low nibble
+    pand    xmm6, xmm7
+    movdqa  xmm5, xmm0
+    psrlw   xmm5, 4
+    pand    xmm5, xmm11
+    movdqa  xmm7, xmm10
+    pshufb  xmm7, xmm5                        ; input high nibble
+    pand    xmm6, xmm7
+
+    ; Continuations owed to a 3- or 4-byte lead cancel "two continuations"
+    psubusb xmm3, [rel const_60_16]
+    psubusb xmm4, [rel const_70_16]
+    por     xmm3, xmm4
+    pand    xmm3, [rel const_80_16]
+    pxor    xmm6, xmm3
+%endmacro
+
+GLOBAL_FUNC validate_utf8_sse42
+    ; Input: rdi = string pointer, rsi = length
+    ; Output: rax = length if valid, else the offset of the block where the
+    ;         first error shows, which is below the length
+
+    movdqa  xmm8, [rel utf8_byte1_high_16]
+    movdqa  xmm9, [rel utf8_byte1_low_16]
+    movdqa  xmm10, [rel utf8_byte2_high_16]
+    movdqa  xmm11, [rel const_0f_16]
+    pxor    xmm15, xmm15                      ; Previous block
+    xor     eax, eax                          ; Position counter
+    xor     r8d, r8d                          ; Non-ASCII bytes of previous block
+
+.sse_loop:
+    mov     rcx, rsi
+    sub     rcx, rax
+    cmp     rcx, 16
+    jb      .sse_tail
+
+    movdqu  xmm0, [rdi + rax]
+
+    ; An ASCII block after an ASCII block has nothing to check
+    pmovmskb edx, xmm0
+    mov     ecx, edx
+    or      ecx, r8d
+    jz      .sse_next
+
+    UTF8_CHECK_SSE
+    ptest   xmm6, xmm6
+    jnz     .sse_error
+
+.sse_next:
+    mov     r8d, edx
+    movdqa  xmm15, xmm0
+    add     rax, 16
+    jmp     .sse_loop
+
+.sse_tail:
+    ; Check the rest as a zero-padded block, as in the AVX2 version
+    test    rcx, rcx
+    jnz     .sse_pad
+    test    r8d, r8d
+    jz      .sse_done
+
+.sse_pad:
+    pxor    xmm0, xmm0
+    movdqu  [rsp - 16], xmm0                  ; Red zone
+    lea     r10, [rdi + rax]
+    xor     edx, edx
+.sse_copy:
+    cmp     rdx, rcx
+    jae     .sse_copied
+    movzx   r9d, byte [r10 + rdx]
+    mov     [rsp - 16 + rdx], r9b
+    inc     rdx
+    jmp     .sse_copy
+.sse_copied:
+    movdqu  xmm0, [rsp - 16]
+
+    UTF8_CHECK_SSE
+    ptest   xmm6, xmm6
+    jnz     .sse_tail_error
+    mov     rax, rsi
+
+.sse_done:
+    ret
+
+.sse_tail_error:
+    ; Only the padding failed: the input ends inside a sequence
+    cmp     rax, rsi
+    jb      .sse_error
+    dec     rax
+
+.sse_error:
+    ret
+
+; Mark stack as non-executable (security)
+section .note.GNU-stack noalloc noexec nowrite progbits
@@ -2,6 +2,7 @@
  * json-asm: API tests
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,6 +34,92 @@ TEST(cpu_features) {
     printf("(features=0x%x) ", features);
 }
 
+TEST(simd_tier) {
+    json_simd_tier tier = json_get_simd_tier();
+    assert(tier != JSON_SIMD_AUTO);
+    assert(json_simd_tier_name(tier) != NULL);
+    printf("(%s) ", json_simd_tier_name(tier));
+
+    /* Scalar is always available */
+    assert(json_set_simd_tier(JSON_SIMD_SCALAR) == true);
+    assert(json_get_simd_tier() == JSON_SIMD_SCALAR);
+
+    const char *json = "{ \"list\" : [ 1 , 22 , 333 ] , \"s\" : \"a\\nb\" }";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *list = json_obj_get(json_doc_root(doc), "list");
+    assert(json_get_int(json_arr_get(list, 2)) == 333);
+    json_doc_free(doc);
+
+    assert(json_set_simd_tier(JSON_SIMD_AUTO) == true);
+    assert(json_get_simd_tier() == tier);
+}
+
+TEST(stats) {
+    json_reset_stats();
+    json_stats total;
+    bool enabled = json_get_stats(&total);
+    printf("(%s) ", enabled ? "enabled" : "disabled");
+    assert(total.parses == 0);
+    assert(total.tier == json_get_simd_tier());
+
+    const char *json = "{\"a\":[1,2.5,\"a long string\"],\"b\":{\"c\":null,\"d\":true}}";
+    json_stats parsed = {0}, written = {0};
+    json_parse_options opts = { .flags = JSON_PARSE_TWO_STAGE, .stats = &parsed };
+    json_doc *doc = json_parse_opts(json, strlen(json), &opts);
+    assert(doc != NULL);
+    json_stringify_options sopts = { .stats = &written };
+    char *str = json_stringify_opts(json_doc_root(doc), &sopts);
+    assert(str != NULL);
+    assert(json_get_stats(&total) == enabled);
+
+    if (enabled) {
+        assert(parsed.parses == 1);
+        assert(parsed.bytes_scanned == strlen(json));
+        assert(parsed.values[JSON_OBJECT] == 2);
+        assert(parsed.values[JSON_ARRAY] == 1);
+        assert(parsed.values[JSON_INT] == 1);
+        assert(parsed.values[JSON_FLOAT] == 1);
+        assert(parsed.values[JSON_STRING] == 1);
+        assert(parsed.values[JSON_NULL] == 1);
+        assert(parsed.values[JSON_TRUE] == 1);
+        assert(parsed.keys == 4);
+        assert(parsed.max_depth == 2);
+        assert(parsed.bytes_copied == strlen("a long string"));
+        assert(parsed.parse_ns >= parsed.scan_ns);
+        assert(written.stringifies == 1);
+        assert(written.bytes_written == strlen(str));
+
+        assert(total.parses == 1 && total.stringifies == 1);
+        assert(total.keys == 4 && total.max_depth == 2);
+        json_reset_stats();
+        json_get_stats(&total);
+        assert(total.parses == 0 && total.values[JSON_OBJECT] == 0);
+    } else {
+        assert(parsed.parses == 0 && written.stringifies == 0);
+        assert(total.parses == 0);
+    }
+
+    free(str);
+    json_doc_free(doc);
+
+    /* The tree is walked without recursion, however deep */
+    size_t depth = 1000000;
+    char *deep = malloc(depth * 2);
+    memset(deep, '[', depth);
+    memset(deep + depth, ']', depth);
+    parsed = (json_stats){0};
+    opts.flags = JSON_PARSE_DEFAULT;
+    doc = json_parse_opts(deep, depth * 2, &opts);
+    assert(doc != NULL);
+    if (enabled) {
+        assert(parsed.values[JSON_ARRAY] == depth);
+        assert(parsed.max_depth == depth);
+    }
+    json_doc_free(doc);
+    free(deep);
+}
+
 /* ============================================================================
  * Type Name Tests
  * ============================================================================ */
@@ -110,6 +197,92 @@ TEST(obj_has) {
     json_doc_free(doc);
 }
 
+/* Object with n members "k0".."k<n-1>" (values 0..n-1) and a repeat of
+ * "k0" with value -1 at the end */
+static size_t wide_object(char *buf, size_t cap, int n) {
+    size_t len = 0;
+    buf[len++] = '{';
+    for (int i = 0; i < n; i++) {
+        len += (size_t)snprintf(buf + len, cap - len, "\"%s%d\":%d,", i % 2 ? "long key number " : "k", i, i);
+    }
+    len += (size_t)snprintf(buf + len, cap - len, "\"k0\":-1}");
+    return len;
+}
+
+static void check_wide_object(json_val *obj, int n) {
+    char key[32];
+    assert(json_obj_size(obj) == (size_t)n + 1);
+    for (int i = n - 1; i >= 0; i--) {
+        sprintf(key, "%s%d", i % 2 ? "long key number " : "k", i);
+        assert(json_get_int(json_obj_get(obj, key)) == i);
+    }
+    /* The first of duplicate keys wins, as with a linear scan */
+    assert(json_get_int(json_obj_get(obj, "k0")) == 0);
+    assert(json_obj_get(obj, "missing") == NULL);
+    assert(json_obj_getn(obj, "k1", 1) == NULL);
+    assert(!json_obj_has(obj, ""));
+}
+
+TEST(obj_key_index) {
+    size_t cap = 256 * 1024;
+    char *buf = malloc(cap);
+    assert(buf != NULL);
+    uint32_t flags[] = {
+        JSON_PARSE_DEFAULT, JSON_PARSE_KEY_INDEX, JSON_PARSE_TWO_STAGE,
+        JSON_PARSE_TWO_STAGE | JSON_PARSE_KEY_INDEX
+    };
+
+    /* Around the size where objects start getting an index */
+    int sizes[] = {1, 30, 31, 32, 33, 1000, 5000};
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            size_t len = wide_object(buf, cap, sizes[i]);
+            json_parse_options opts = {0};
+            opts.flags = flags[f];
+            json_doc *doc = json_parse_opts(buf, len, &opts);
+            assert(doc != NULL);
+            check_wide_object(json_doc_root(doc), sizes[i]);
+            json_doc_free(doc);
+        }
+    }
+
+    /* The table built by the first lookup counts as the document's memory */
+    size_t len = wide_object(buf, cap, 5000);
+    json_doc *lazy = json_parse(buf, len);
+    assert(lazy != NULL);
+    size_t before = json_doc_memory(lazy);
+    assert(json_obj_get(json_doc_root(lazy), "k0") != NULL);
+    assert(json_doc_memory(lazy) >= before + 2 * 5000 * sizeof(void *));
+    json_doc_free(lazy);
+
+    /* Built by the push parser */
+    len = wide_object(buf, cap, 500);
+    json_parser *parser = json_parser_new(NULL);
+    for (size_t i = 0; i < len; i += 100) {
+        size_t n = len - i < 100 ? len - i : 100;
+        json_feed(parser, buf + i, n);
+    }
+    json_doc *fed = json_feed_end(parser);
+    assert(fed != NULL);
+    check_wide_object(json_doc_root(fed), 500);
+
+    json_parser_free(parser);
+
+    /* Equality looks keys up through the index */
+    len = (size_t)snprintf(buf, cap, "[{");
+    for (int i = 0; i < 100; i++) len += (size_t)snprintf(buf + len, cap - len, "%s\"k%d\":%d", i ? "," : "", i, i);
+    len += (size_t)snprintf(buf + len, cap - len, "},{");
+    for (int i = 99; i >= 0; i--) len += (size_t)snprintf(buf + len, cap - len, "\"k%d\":%d%s", i, i, i ? "," : "");
+    len += (size_t)snprintf(buf + len, cap - len, "}]");
+    json_doc *doc = json_parse(buf, len);
+    assert(doc != NULL);
+    json_val *a = json_arr_get(json_doc_root(doc), 0);
+    json_val *b = json_arr_get(json_doc_root(doc), 1);
+    assert(json_equals(a, b));
+    json_doc_free(doc);
+    free(buf);
+}
+
 /* ============================================================================
  * Array Iteration Tests
  * ============================================================================ */
@@ -145,6 +318,69 @@ TEST(arr_get) {
     json_doc_free(doc);
 }
 
+/* Elements sit next to each other in memory whichever parser built them */
+static void check_nested_arrays(json_val *root, int n) {
+    assert(json_arr_size(root) == (size_t)n);
+    const char *first = (const char *)json_arr_get(root, 0);
+    size_t stride = (size_t)((const char *)json_arr_get(root, 1) - first);
+    for (int i = 0; i < n; i++) {
+        json_val *elem = json_arr_get(root, (size_t)i);
+        assert((const char *)elem == first + (size_t)i * stride);
+        assert(i == 0 || json_arr_next(json_arr_get(root, (size_t)i - 1)) == elem);
+        assert(json_arr_size(elem) == (size_t)(i % 3));
+        for (int j = 0; j < i % 3; j++) {
+            assert(json_get_int(json_arr_get(elem, (size_t)j)) == i + j);
+        }
+    }
+    assert(json_arr_next(json_arr_get(root, (size_t)n - 1)) == NULL);
+    assert(json_arr_get(root, (size_t)n) == NULL);
+}
+
+TEST(arr_contiguous) {
+    int n = 2000;
+    char *buf = malloc(64 * 1024);
+    size_t len = 0;
+    buf[len++] = '[';
+    for (int i = 0; i < n; i++) {
+        len += (size_t)sprintf(buf + len, i ? ",[" : "[");
+        for (int j = 0; j < i % 3; j++) {
+            len += (size_t)sprintf(buf + len, j ? ",%d" : "%d", i + j);
+        }
+        buf[len++] = ']';
+    }
+    buf[len++] = ']';
+
+    json_parse_options opts = {0};
+    json_doc *doc = json_parse_opts(buf, len, &opts);
+    assert(doc != NULL);
+    check_nested_arrays(json_doc_root(doc), n);
+    json_doc_free(doc);
+
+    opts.flags = JSON_PARSE_TWO_STAGE;
+    doc = json_parse_opts(buf, len, &opts);
+    assert(doc != NULL);
+    check_nested_arrays(json_doc_root(doc), n);
+    json_doc_free(doc);
+
+    opts.flags = 0;
+    opts.threads = 4;
+    opts.parallel_min_size = 1;
+    doc = json_parse_opts(buf, len, &opts);
+    assert(doc != NULL);
+    check_nested_arrays(json_doc_root(doc), n);
+    json_doc_free(doc);
+
+    json_parser *parser = json_parser_new(NULL);
+    for (size_t i = 0; i < len; i += 7) {
+        json_feed(parser, buf + i, len - i < 7 ? len - i : 7);
+    }
+    doc = json_feed_end(parser);
+    assert(doc != NULL);
+    check_nested_arrays(json_doc_root(doc), n);
+    json_parser_free(parser);
+    free(buf);
+}
+
 /* ============================================================================
  * Equality Tests
  * ============================================================================ */
@@ -207,6 +443,64 @@ TEST(equals_objects) {
     json_doc_free(d4);
 }
 
+TEST(equals_unordered) {
+    const char *a = "{\"a\":1,\"b\":[1,{\"x\":null,\"y\":\"long string value\"}],\"c\":2.5,\"a\":true}";
+    const char *b = "{\"c\":2.5,\"a\":1,\"b\":[1,{\"y\":\"long string value\",\"x\":null}],\"a\":true}";
+    const char *c = "{\"c\":2.5,\"a\":true,\"b\":[1,{\"y\":\"long string value\",\"x\":null}],\"a\":1}";
+    json_doc *d1 = json_parse(a, strlen(a));
+    json_doc *d2 = json_parse(b, strlen(b));
+    json_doc *d3 = json_parse(c, strlen(c));
+    assert(d1 && d2 && d3);
+
+    /* Duplicate keys pair up in order */
+    assert(json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(!json_equals(json_doc_root(d1), json_doc_root(d3)));
+    assert(json_hash(json_doc_root(d1)) == json_hash(json_doc_root(d2)));
+
+    json_doc_free(d1);
+    json_doc_free(d2);
+    json_doc_free(d3);
+
+    /* Wide enough for the member table to be allocated */
+    char wa[2048], wb[2048];
+    size_t la = 0, lb = 0;
+    wa[la++] = wb[lb++] = '{';
+    for (int i = 0; i < 40; i++) {
+        la += (size_t)snprintf(wa + la, sizeof(wa) - la, "%s\"key%d\":%d", i ? "," : "", i, i);
+        lb += (size_t)snprintf(wb + lb, sizeof(wb) - lb, "%s\"key%d\":%d", i ? "," : "", 39 - i, 39 - i);
+    }
+    wa[la++] = wb[lb++] = '}';
+    d1 = json_parse(wa, la);
+    d2 = json_parse(wb, lb);
+    assert(d1 && d2);
+    assert(json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(json_hash(json_doc_root(d1)) == json_hash(json_doc_root(d2)));
+
+    json_obj_set(d2, json_doc_root(d2), "key7", json_new_int(d2, 8));
+    assert(!json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(json_hash(json_doc_root(d1)) != json_hash(json_doc_root(d2)));
+
+    json_doc_free(d1);
+    json_doc_free(d2);
+}
+
+TEST(hash_values) {
+    json_doc *d1 = json_parse("[0.0,1,\"s\"]", 11);
+    json_doc *d2 = json_parse("[-0.0,1,\"s\"]", 12);
+    json_doc *d3 = json_parse("[1,0.0,\"s\"]", 11);
+    assert(d1 && d2 && d3);
+
+    assert(json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(json_hash(json_doc_root(d1)) == json_hash(json_doc_root(d2)));
+    /* Arrays are ordered */
+    assert(json_hash(json_doc_root(d1)) != json_hash(json_doc_root(d3)));
+    assert(json_hash(NULL) == 0);
+
+    json_doc_free(d1);
+    json_doc_free(d2);
+    json_doc_free(d3);
+}
+
 /* ============================================================================
  * Clone Tests
  * ============================================================================ */
@@ -224,6 +518,121 @@ TEST(clone) {
     json_doc_free(copy);
 }
 
+TEST(clone_independent) {
+    /* Borrowed strings point into the input, which the clone must not */
+    char wide[2048];
+    size_t len = (size_t)snprintf(wide, sizeof(wide),
+                                  "{\"list\":[[],{},\"a string of some length\",-0.5,9007199254740993]");
+    for (int i = 0; i < 40; i++) {
+        len += (size_t)snprintf(wide + len, sizeof(wide) - len, ",\"member number %d\":{\"v\":[%d]}", i, i);
+    }
+    wide[len++] = '}';
+    char *input = malloc(len);
+    assert(input != NULL);
+    memcpy(input, wide, len);
+
+    json_parse_options opts = { .flags = JSON_PARSE_BORROW };
+    json_doc *orig = json_parse_opts(input, len, &opts);
+    assert(orig != NULL);
+    json_doc *copy = json_clone(json_doc_root(orig));
+    assert(copy != NULL);
+    assert(json_equals(json_doc_root(orig), json_doc_root(copy)));
+    assert(json_doc_count(copy) == json_doc_count(orig));
+
+    json_doc_free(orig);
+    memset(input, 'x', len);
+    free(input);
+
+    json_val *root = json_doc_root(copy);
+    json_val *list = json_obj_get(root, "list");
+    assert(json_arr_size(list) == 5);
+    assert(strcmp(json_get_str(json_arr_get(list, 2)), "a string of some length") == 0);
+    assert(json_get_int(json_arr_get(list, 4)) == 9007199254740993LL);
+    assert(json_get_int(json_arr_get(json_obj_get(json_obj_get(root, "member number 33"), "v"), 0)) == 33);
+
+    /* The copy can be changed like any document */
+    json_obj_set(copy, root, "member number 5", json_new_str(copy, "replaced"));
+    assert(strcmp(json_get_str(json_obj_get(root, "member number 5")), "replaced") == 0);
+    assert(json_obj_size(root) == 41);
+
+    json_doc_free(copy);
+}
+
+/* levels of nesting around tail, alternately arrays and objects whose
+ * member "a" follows the members in before and precedes those in after */
+static char *nested_json(size_t levels, const char *before, const char *after,
+                         const char *tail, size_t *len) {
+    size_t before_len = strlen(before), after_len = strlen(after), tail_len = strlen(tail);
+    size_t cap = levels * (6 + before_len + after_len) + tail_len + 1;
+    char *json = malloc(cap);
+    assert(json != NULL);
+    size_t n = 0;
+    for (size_t i = 0; i < levels; i++) {
+        if (i % 2) {
+            n += (size_t)snprintf(json + n, cap - n, "{%s\"a\":", before);
+        } else {
+            json[n++] = '[';
+        }
+    }
+    memcpy(json + n, tail, tail_len);
+    n += tail_len;
+    for (size_t i = levels; i-- > 0;) {
+        if (i % 2) {
+            n += (size_t)snprintf(json + n, cap - n, "%s}", after);
+        } else {
+            json[n++] = ']';
+        }
+    }
+    *len = n;
+    return json;
+}
+
+TEST(clone_deep) {
+    /* Cloned, compared and hashed without recursion */
+    size_t levels = 1000000, len;
+    char *json = nested_json(levels, "", "", "1", &len);
+    json_doc *orig = json_parse(json, len);
+    free(json);
+    assert(orig != NULL);
+    json_doc *copy = json_clone(json_doc_root(orig));
+    assert(copy != NULL);
+    assert(json_doc_count(copy) == json_doc_count(orig));
+    assert(json_equals(json_doc_root(orig), json_doc_root(copy)));
+    assert(json_hash(json_doc_root(orig)) == json_hash(json_doc_root(copy)));
+
+    /* Differs only at the bottom */
+    json = nested_json(levels, "", "", "2", &len);
+    json_doc *other = json_parse(json, len);
+    free(json);
+    assert(other != NULL);
+    assert(!json_equals(json_doc_root(orig), json_doc_root(other)));
+    assert(json_hash(json_doc_root(orig)) != json_hash(json_doc_root(other)));
+    json_doc_free(other);
+    json_doc_free(orig);
+    json_doc_free(copy);
+
+    /* Every object's members in the other order */
+    json = nested_json(levels, "\"b\":null,", "", "1", &len);
+    json_doc *d1 = json_parse(json, len);
+    free(json);
+    json = nested_json(levels, "", ",\"b\":null", "1", &len);
+    json_doc *d2 = json_parse(json, len);
+    free(json);
+    assert(d1 && d2);
+    assert(json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(json_hash(json_doc_root(d1)) == json_hash(json_doc_root(d2)));
+    json_doc_free(d2);
+
+    json = nested_json(levels, "", ",\"b\":false", "1", &len);
+    d2 = json_parse(json, len);
+    free(json);
+    assert(d2 != NULL);
+    assert(!json_equals(json_doc_root(d1), json_doc_root(d2)));
+    assert(json_hash(json_doc_root(d1)) != json_hash(json_doc_root(d2)));
+    json_doc_free(d1);
+    json_doc_free(d2);
+}
+
 /* ============================================================================
  * NULL Safety Tests
  * ============================================================================ */
@@ -289,6 +698,785 @@ TEST(is_container) {
     json_doc_free(d3);
 }
 
+/* ============================================================================
+ * Mutation Tests
+ * ============================================================================ */
+
+static void assert_json(json_val *val, const char *expected) {
+    char *str = json_stringify(val);
+    assert(str != NULL);
+    if (strcmp(str, expected) != 0) {
+        printf("\n    got      %s\n    expected %s\n", str, expected);
+        assert(0);
+    }
+    free(str);
+}
+
+TEST(build_document) {
+    json_doc *doc = json_doc_new();
+    assert(doc != NULL);
+    json_val *root = json_new_obj(doc);
+    json_doc_set_root(doc, root);
+
+    assert(json_obj_set(doc, root, "name", json_new_str(doc, "json-asm")) != NULL);
+    assert(json_obj_set(doc, root, "ok", json_new_bool(doc, true)) != NULL);
+    assert(json_obj_set(doc, root, "pi", json_new_real(doc, 3.25)) != NULL);
+    json_val *tags = json_obj_set(doc, root, "tags", json_new_arr(doc));
+    size_t mem = json_doc_memory(doc);
+    for (int i = 0; i < 100; i++) {
+        assert(json_arr_push(doc, tags, json_new_int(doc, i)) != NULL);
+    }
+    /* The table of growing array runs counts as the document's memory */
+    assert(json_doc_memory(doc) > mem);
+    assert(json_obj_set(doc, root, "none", json_new_null(doc)) != NULL);
+
+    assert(json_obj_size(root) == 5);
+    assert(json_arr_size(tags) == 100);
+    assert(json_get_int(json_arr_get(tags, 99)) == 99);
+    assert(json_doc_count(doc) == 1 + 5 * 2 + 100);
+
+    /* Short and long strings both come out as given */
+    assert(json_get_str_len(json_obj_get(root, "name")) == 8);
+    assert(strcmp(json_get_str(json_obj_get(root, "name")), "json-asm") == 0);
+
+    json_val *small = json_new_arr(doc);
+    json_arr_push(doc, small, json_new_str(doc, "a"));
+    json_arr_push(doc, small, json_new_int(doc, -7));
+    json_obj_set(doc, root, "tags", small);
+    assert_json(root, "{\"name\":\"json-asm\",\"ok\":true,\"pi\":3.25,"
+                      "\"tags\":[\"a\",-7],\"none\":null}");
+    assert(json_doc_count(doc) == 1 + 5 * 2 + 2);
+
+    json_doc_free(doc);
+}
+
+TEST(mutate_object) {
+    const char *json = "{\"a\":1,\"b\":[1,2],\"c\":\"x\"}";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    /* Replacing keeps the member's position */
+    json_obj_set(doc, root, "b", json_new_str(doc, "a longer string"));
+    json_val_set_int(doc, json_obj_get(root, "a"), 42);
+    json_val_set_str(doc, json_obj_get(root, "c"), "y");
+    assert_json(root, "{\"a\":42,\"b\":\"a longer string\",\"c\":\"y\"}");
+    assert(json_doc_count(doc) == 7);
+
+    assert(json_obj_remove(doc, root, "a"));
+    assert(!json_obj_remove(doc, root, "a"));
+    assert(json_obj_remove(doc, root, "c"));
+    json_obj_set(doc, root, "d", json_new_bool(doc, false));
+    assert_json(root, "{\"b\":\"a longer string\",\"d\":false}");
+    assert(json_doc_count(doc) == 5);
+
+    assert(json_obj_set(doc, json_obj_get(root, "d"), "x", json_new_null(doc)) == NULL);
+    assert(json_get_error().code == JSON_ERROR_TYPE);
+    json_doc_free(doc);
+
+    /* Wide objects keep their key index in step */
+    doc = json_doc_new();
+    root = json_new_obj(doc);
+    char key[16];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        json_obj_set(doc, root, key, json_new_int(doc, i));
+        assert(json_get_int(json_obj_get(root, "k0")) == 0);
+    }
+    for (int i = 0; i < 200; i += 2) {
+        snprintf(key, sizeof(key), "k%d", i);
+        assert(json_obj_remove(doc, root, key));
+    }
+    json_obj_set(doc, root, "k1", json_new_int(doc, -1));
+    json_obj_set(doc, root, "k0", json_new_int(doc, 1000));
+    assert(json_obj_size(root) == 101);
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        json_val *v = json_obj_get(root, key);
+        if (i == 0) assert(json_get_int(v) == 1000);
+        else if (i == 1) assert(json_get_int(v) == -1);
+        else if (i % 2 == 0) assert(v == NULL);
+        else assert(json_get_int(v) == i);
+    }
+    json_doc_free(doc);
+}
+
+TEST(mutate_array) {
+    json_doc *doc = json_parse("[1,2,3]", 7);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    assert(json_arr_insert(doc, root, 0, json_new_int(doc, 0)) != NULL);
+    assert(json_arr_insert(doc, root, 2, json_new_str(doc, "mid")) != NULL);
+    assert(json_arr_push(doc, root, json_arr_get(root, 0)) != NULL);
+    assert(json_arr_insert(doc, root, 7, json_new_null(doc)) == NULL);
+    assert_json(root, "[0,1,\"mid\",2,3,0]");
+
+    assert(json_arr_remove(doc, root, 2));
+    assert(json_arr_remove(doc, root, 4));
+    assert(json_arr_remove(doc, root, 0));
+    assert(!json_arr_remove(doc, root, 3));
+    assert_json(root, "[1,2,3]");
+
+    /* Iteration and indexing agree after many moves */
+    for (int i = 0; i < 1000; i++) {
+        json_arr_insert(doc, root, (size_t)i % (json_arr_size(root) + 1), json_new_int(doc, i));
+    }
+    size_t n = 0;
+    json_arr_foreach(root, elem) {
+        assert(elem == json_arr_get(root, n));
+        n++;
+    }
+    assert(n == json_arr_size(root) && n == 1003);
+    while (json_arr_size(root) > 0) assert(json_arr_remove(doc, root, 0));
+    assert(json_arr_first(root) == NULL);
+    assert_json(root, "[]");
+    assert(json_doc_count(doc) == 1);
+
+    json_val_set_int(doc, root, (int64_t)1 << 62);
+    assert(json_is_int(root) && json_get_int(root) == (int64_t)1 << 62);
+    json_val_set_int(doc, root, INT64_MIN);
+    assert(json_is_int(root) && json_get_int(root) == INT64_MIN);
+    assert_json(root, "-9223372036854775808");
+    json_doc_free(doc);
+}
+
+TEST(mutate_deep) {
+    /* Counting a mutated tree does not recurse, however deep it is */
+    size_t depth = 1000000;
+    json_doc *doc = json_doc_new();
+    assert(doc != NULL);
+    json_val *arr = json_new_arr(doc);
+    json_doc_set_root(doc, arr);
+    for (size_t i = 1; i < depth; i++) {
+        arr = json_arr_push(doc, arr, json_new_arr(doc));
+        assert(arr != NULL);
+    }
+    assert(json_arr_push(doc, arr, json_new_int(doc, 1)) != NULL);
+    assert(json_doc_count(doc) == depth + 1);
+    json_doc_free(doc);
+}
+
+/* ============================================================================
+ * Reuse Tests
+ * ============================================================================ */
+
+TEST(parser_reuse) {
+    json_parser *parser = json_parser_new(NULL);
+    assert(parser != NULL);
+
+    json_doc *first = json_parser_parse(parser, "{\"a\": [1, 2, 3]}", 16);
+    assert(first != NULL);
+    assert(json_arr_size(json_obj_get(json_doc_root(first), "a")) == 3);
+
+    /* The same document is reused for every parse */
+    for (int i = 0; i < 100; i++) {
+        char json[64];
+        int n = snprintf(json, sizeof(json), "{\"value\": %d, \"name\": \"message %d\"}", i, i);
+        json_doc *doc = json_parser_parse(parser, json, (size_t)n);
+        assert(doc == first);
+        assert(json_get_int(json_obj_get(json_doc_root(doc), "value")) == i);
+        json_doc_free(doc); /* No-op for parser-owned documents */
+    }
+
+    /* Errors leave the parser usable */
+    assert(json_parser_parse(parser, "[1,", 3) == NULL);
+    assert(json_get_error().code == JSON_ERROR_SYNTAX);
+    json_doc *doc = json_parser_parse(parser, "[true]", 6);
+    assert(doc != NULL);
+    assert(json_is_true(json_arr_get(json_doc_root(doc), 0)));
+
+    json_parser_free(parser);
+
+    /* Options are kept */
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_TWO_STAGE | JSON_PARSE_ALLOW_TRAILING;
+    parser = json_parser_new(&opts);
+    doc = json_parser_parse(parser, "[1, 2,]", 7);
+    assert(doc != NULL);
+    assert(json_arr_size(json_doc_root(doc)) == 2);
+    json_parser_free(parser);
+}
+
+TEST(doc_pool) {
+    /* A freed small document is handed back by the next parse */
+    json_pool_clear();
+    json_doc *a = json_parse("[1]", 3);
+    assert(a != NULL);
+    json_doc_free(a);
+    const char *json = "{\"k\": \"a longer string value\"}";
+    json_doc *b = json_parse(json, strlen(json));
+    assert(b == a);
+    assert(strcmp(json_get_str(json_obj_get(json_doc_root(b), "k")), "a longer string value") == 0);
+    json_doc_free(b);
+
+    json_pool_clear();
+    json_doc *c = json_parse("null", 4);
+    assert(c != NULL);
+    json_doc_free(c);
+    json_pool_clear();
+}
+
+TEST(doc_reset) {
+    json_doc *doc = json_parse("[1, 2, 3]", 9);
+    assert(doc != NULL);
+    size_t mem = json_doc_memory(doc);
+    json_doc_reset(doc);
+    assert(json_doc_root(doc) == NULL);
+    assert(json_doc_count(doc) == 0);
+    assert(json_doc_memory(doc) == mem);
+    json_doc_free(doc);
+}
+
+/* ============================================================================
+ * File Tests
+ * ============================================================================ */
+
+#define TEST_FILE "test_parse_file.json"
+
+static void write_test_file(const char *data, size_t len) {
+    FILE *f = fopen(TEST_FILE, "wb");
+    assert(f != NULL);
+    assert(fwrite(data, 1, len, f) == len);
+    fclose(f);
+}
+
+TEST(parse_file) {
+    const char *json = "{\"name\": \"a string long enough to borrow\", \"esc\": \"tab\\there\"}";
+    write_test_file(json, strlen(json));
+
+    json_doc *doc = json_parse_file(TEST_FILE);
+    assert(doc != NULL);
+    assert(strcmp(json_get_str(json_obj_get(json_doc_root(doc), "esc")), "tab\there") == 0);
+    json_doc_free(doc);
+
+    /* Borrowed strings point into the mapping, which the document keeps */
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_BORROW;
+    doc = json_parse_file_opts(TEST_FILE, &opts);
+    assert(doc != NULL);
+    json_val *name = json_obj_get(json_doc_root(doc), "name");
+    assert(json_get_str_len(name) == strlen("a string long enough to borrow"));
+    assert(memcmp(json_get_str(name), "a string long enough to borrow", json_get_str_len(name)) == 0);
+    json_doc_free(doc);
+
+    /* In-situ decoding writes to a private mapping, not the file */
+    opts.flags = JSON_PARSE_INSITU;
+    doc = json_parse_file_opts(TEST_FILE, &opts);
+    assert(doc != NULL);
+    assert(strcmp(json_get_str(json_obj_get(json_doc_root(doc), "esc")), "tab\there") == 0);
+    json_doc_free(doc);
+
+    char buf[128];
+    FILE *f = fopen(TEST_FILE, "rb");
+    assert(f != NULL);
+    assert(fread(buf, 1, sizeof(buf), f) == strlen(json));
+    fclose(f);
+    assert(memcmp(buf, json, strlen(json)) == 0);
+
+    remove(TEST_FILE);
+    assert(json_parse_file(TEST_FILE) == NULL);
+    assert(json_get_error().code == JSON_ERROR_IO);
+}
+
+TEST(parse_file_page_sized) {
+    /* Input ending exactly on a page boundary must not fault */
+    size_t len = 4096;
+    char *json = malloc(len);
+    assert(json != NULL);
+    json[0] = '"';
+    memset(json + 1, 'x', len - 2);
+    json[len - 1] = '"';
+    write_test_file(json, len);
+    free(json);
+
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_BORROW | JSON_PARSE_TWO_STAGE;
+    json_doc *doc = json_parse_file_opts(TEST_FILE, &opts);
+    assert(doc != NULL);
+    assert(json_get_str_len(json_doc_root(doc)) == len - 2);
+    json_doc_free(doc);
+    remove(TEST_FILE);
+}
+
+TEST(stream_file) {
+    const char *json = "{\"n\": 1}\n{\"n\": 2}\n{\"n\": 3}\n";
+    write_test_file(json, strlen(json));
+
+    json_stream *stream = json_stream_open(TEST_FILE, NULL);
+    assert(stream != NULL);
+    int64_t sum = 0;
+    json_doc *doc;
+    while ((doc = json_stream_next(stream)) != NULL) {
+        sum += json_get_int(json_obj_get(json_doc_root(doc), "n"));
+    }
+    assert(json_get_error().code == JSON_OK);
+    assert(sum == 6);
+    json_stream_free(stream);
+    remove(TEST_FILE);
+}
+
+TEST(tape_roundtrip) {
+    /* Long and short strings, numbers, nesting and a wide object */
+    char json[8192];
+    size_t len = (size_t)snprintf(json, sizeof(json),
+        "{\"name\":\"a string longer than seven\",\"n\":-42,\"big\":9223372036854775807,\"pi\":3.14159,"
+        "\"list\":[1,[2,[]],{},{\"x\":null,\"y\":true}],\"wide\":{");
+    for (int i = 0; i < 100; i++) {
+        len += (size_t)snprintf(json + len, sizeof(json) - len, "%s\"key%d\":%d", i ? "," : "", i, i);
+    }
+    len += (size_t)snprintf(json + len, sizeof(json) - len, ",\"key5\":-1}}");
+
+    json_doc *doc = json_parse(json, len);
+    assert(doc != NULL);
+    char *expected = json_stringify(json_doc_root(doc));
+    size_t count = json_doc_count(doc);
+    const char *path = "test_tape.bin";
+    assert(json_tape_save(json_doc_root(doc), path));
+    json_doc_free(doc);
+
+    /* The second mapping cannot use the base the first one took, so it is
+     * the relocated path */
+    json_doc *a = json_tape_open(path);
+    json_doc *b = json_tape_open(path);
+    assert(a != NULL && b != NULL);
+    json_doc *tapes[] = { a, b };
+    for (int t = 0; t < 2; t++) {
+        json_val *root = json_doc_root(tapes[t]);
+        char *str = json_stringify(root);
+        assert(strcmp(str, expected) == 0);
+        free(str);
+
+        assert(json_doc_count(tapes[t]) == count);
+        assert(strcmp(json_get_str(json_obj_get(root, "name")), "a string longer than seven") == 0);
+        assert(json_get_int(json_arr_get(json_obj_get(root, "list"), 0)) == 1);
+        assert(json_get_int(json_obj_get(root, "big")) == INT64_MAX);
+        json_val *wide = json_obj_get(root, "wide");
+        assert(json_obj_size(wide) == 101);
+        assert(json_get_int(json_obj_get(wide, "key99")) == 99);
+        assert(json_get_int(json_obj_get(wide, "key5")) == 5);
+        assert(json_obj_get(wide, "key100") == NULL);
+
+        assert(!json_val_set_int(tapes[t], json_obj_get(root, "n"), 1));
+        assert(json_get_error().code == JSON_ERROR_TYPE);
+    }
+    json_doc_free(a);
+    json_doc_free(b);
+    free(expected);
+
+    /* Anything else is rejected */
+    write_test_file("[1,2,3]", 7);
+    assert(json_tape_open(TEST_FILE) == NULL);
+    remove(TEST_FILE);
+    remove(path);
+    assert(json_tape_open(path) == NULL);
+}
+
+/* ============================================================================
+ * On-Demand Cursor Tests
+ * ============================================================================ */
+
+TEST(cursor_find_field) {
+    /* Skipped values hold brackets in strings, escaped quotes and nesting
+     * that spans several 64-byte blocks */
+    char json[4096];
+    int n = snprintf(json, sizeof(json),
+        "{\"skip\": {\"a\": [1, {\"b\": \"]}\\\"[{\"}], \"pad\": \"%0200d\"},"
+        " \"list\": [[[]], [[[0]]], \"x\"], \"name\": \"ada\\u0021\","
+        " \"n\": -42, \"pi\": 3.5, \"ok\": true, \"nil\": null, \"e\\u0073c\": 7}",
+        0);
+    assert(n > 0 && (size_t)n < sizeof(json));
+
+    json_cursor root, v;
+    assert(json_cursor_init(&root, json, (size_t)n));
+    assert(json_cursor_type(&root) == JSON_OBJECT);
+
+    char buf[16];
+    assert(json_cursor_find_field(&root, "name", &v));
+    assert(json_cursor_type(&v) == JSON_STRING);
+    assert(json_cursor_get_str(&v, buf, sizeof(buf)) == 4);
+    assert(strcmp(buf, "ada!") == 0);
+    assert(json_cursor_get_str(&v, buf, 4) == 4 && buf[0] == '\0');
+
+    int64_t i;
+    double d;
+    bool b;
+    assert(json_cursor_find_field(&root, "n", &v) && json_cursor_get_int(&v, &i) && i == -42);
+    assert(json_cursor_type(&v) == JSON_INT);
+    assert(json_cursor_find_field(&root, "pi", &v) && json_cursor_get_num(&v, &d) && d == 3.5);
+    assert(json_cursor_type(&v) == JSON_FLOAT);
+    assert(json_cursor_find_field(&root, "ok", &v) && json_cursor_get_bool(&v, &b) && b);
+    assert(json_cursor_find_field(&root, "nil", &v) && json_cursor_is_null(&v));
+    assert(json_cursor_find_field(&root, "esc", &v) && json_cursor_get_int(&v, &i) && i == 7);
+
+    /* Raw text of a skipped subtree parses to the same value */
+    size_t len;
+    assert(json_cursor_find_field(&root, "skip", &v));
+    const char *raw = json_cursor_raw(&v, &len);
+    assert(raw[0] == '{' && raw[len - 1] == '}');
+    json_doc *doc = json_parse(raw, len);
+    assert(doc);
+    json_val *pad = json_obj_get(json_doc_root(doc), "pad");
+    assert(json_get_str_len(pad) == 200);
+    json_doc_free(doc);
+
+    json_cursor inner;
+    assert(json_cursor_find_field(&v, "a", &inner));
+    assert(json_cursor_type(&inner) == JSON_ARRAY);
+
+    /* Absent keys and wrong types */
+    assert(!json_cursor_find_field(&root, "missing", &v));
+    assert(json_get_error().code == JSON_OK);
+    assert(json_cursor_find_field(&root, "name", &v));
+    assert(!json_cursor_get_int(&v, &i));
+    assert(json_get_error().code == JSON_ERROR_TYPE);
+    assert(!json_cursor_find_field(&v, "x", &inner));
+    assert(json_get_error().code == JSON_ERROR_TYPE);
+}
+
+TEST(cursor_iterate) {
+    const char *json = " [1, \"two\", {\"k\": [3]}, [4, 5], false] ";
+    json_cursor root, e;
+    assert(json_cursor_init(&root, json, strlen(json)));
+    assert(json_cursor_child(&root, &e));
+
+    json_type types[] = { JSON_INT, JSON_STRING, JSON_OBJECT, JSON_ARRAY, JSON_FALSE };
+    size_t count = 0;
+    do {
+        assert(count < 5 && json_cursor_type(&e) == types[count]);
+        count++;
+    } while (json_cursor_next(&e));
+    assert(count == 5);
+    assert(json_get_error().code == JSON_OK);
+
+    /* Object members, with their keys */
+    const char *obj = "{\"a\": 1, \"b\\n\": {}, \"c\": []}";
+    const char *keys[] = { "a", "b\n", "c" };
+    char key[8];
+    assert(json_cursor_init(&root, obj, strlen(obj)));
+    assert(json_cursor_child(&root, &e));
+    count = 0;
+    do {
+        assert(json_cursor_get_key(&e, key, sizeof(key)) == strlen(keys[count]));
+        assert(strcmp(key, keys[count]) == 0);
+        count++;
+    } while (json_cursor_next(&e));
+    assert(count == 3);
+
+    /* Empty containers have no child */
+    json_cursor c;
+    assert(json_cursor_find_field(&root, "b\n", &c));
+    assert(!json_cursor_child(&c, &e) && json_get_error().code == JSON_OK);
+    assert(json_cursor_init(&c, "[ ]", 3));
+    assert(!json_cursor_child(&c, &e) && json_get_error().code == JSON_OK);
+}
+
+TEST(cursor_errors) {
+    json_cursor root, v;
+    assert(!json_cursor_init(&root, "  ", 2));
+
+    /* Only what is read is validated */
+    const char *json = "{\"bad\": [1, 2, tru], \"n\": 01, \"s\": \"\\q\", \"ok\": 1} trailing";
+    assert(json_cursor_init(&root, json, strlen(json)));
+    int64_t i;
+    assert(json_cursor_find_field(&root, "ok", &v) && json_cursor_get_int(&v, &i) && i == 1);
+    assert(json_cursor_find_field(&root, "n", &v) && !json_cursor_get_int(&v, &i));
+    assert(json_get_error().code == JSON_ERROR_NUMBER);
+    char buf[8];
+    assert(json_cursor_find_field(&root, "s", &v) && json_cursor_get_str(&v, buf, sizeof(buf)) == 0);
+    assert(json_get_error().code == JSON_ERROR_STRING);
+
+    json_cursor e;
+    bool b;
+    assert(json_cursor_find_field(&root, "bad", &v) && json_cursor_child(&v, &e));
+    assert(json_cursor_next(&e) && json_cursor_next(&e));
+    assert(!json_cursor_get_bool(&e, &b));
+    assert(json_get_error().code == JSON_ERROR_SYNTAX);
+
+    /* Broken structure is found on the way */
+    const char *cases[] = { "{\"a\" 1}", "{\"a\": 1 \"b\": 2}", "{\"a\": [1, 2}",
+                            "{\"a\": \"open}", "[1 2]", "[1,]" };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        assert(json_cursor_init(&root, cases[c], strlen(cases[c])));
+        if (cases[c][0] == '{') {
+            assert(!json_cursor_find_field(&root, "b", &v));
+        } else {
+            assert(json_cursor_child(&root, &e));
+            assert(!json_cursor_next(&e));
+        }
+        assert(json_get_error().code != JSON_OK);
+    }
+}
+
+/* ============================================================================
+ * JSON Pointer Query Tests
+ * ============================================================================ */
+
+static const char *path_doc =
+    "{\"user\": {\"id\": 7, \"a/b\": 1, \"m~n\": 2, \"long key name\": 3, \"\": 4,"
+    " \"e\\u0073c\": 5},"
+    " \"events\": [{\"ts\": 10}, {\"x\": 0}, {\"ts\": 30, \"more\": [1, 2]}],"
+    " \"0\": \"zero\"}";
+
+TEST(path_compile) {
+    const char *bad[] = { "user", "/a~", "/a~2b" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        assert(json_path_compile(bad[i]) == NULL);
+        assert(json_get_error().code == JSON_ERROR_SYNTAX);
+    }
+
+    json_doc *doc = json_parse(path_doc, strlen(path_doc));
+    json_val *root = json_doc_root(doc);
+    struct { const char *pointer; int64_t expected; } cases[] = {
+        { "/user/id", 7 }, { "/user/a~1b", 1 }, { "/user/m~0n", 2 },
+        { "/user/long key name", 3 }, { "/user/", 4 }, { "/user/esc", 5 },
+        { "/events/2/ts", 30 }, { "/events/2/more/1", 2 }
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        json_path *path = json_path_compile(cases[i].pointer);
+        assert(path);
+        assert(json_get_int(json_path_get(path, root)) == cases[i].expected);
+        json_path_free(path);
+    }
+
+    /* "" is the root; a numeric segment is a key in an object */
+    json_path *path = json_path_compile("");
+    assert(json_path_get(path, root) == root);
+    json_path_free(path);
+    path = json_path_compile("/0");
+    assert(strcmp(json_get_str(json_path_get(path, root)), "zero") == 0);
+    json_path_free(path);
+
+    const char *missing[] = { "/nope", "/user/id/x", "/events/3", "/events/-", "/events/01" };
+    for (size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+        path = json_path_compile(missing[i]);
+        assert(path && json_path_get(path, root) == NULL);
+        json_path_free(path);
+    }
+    json_doc_free(doc);
+}
+
+TEST(path_eval) {
+    json_doc *doc = json_parse(path_doc, strlen(path_doc));
+    json_val *root = json_doc_root(doc);
+
+    json_path *path = json_path_compile("/events/*/ts");
+    json_val *out[4];
+    assert(json_path_eval(path, root, out, 4) == 2);
+    assert(json_get_int(out[0]) == 10 && json_get_int(out[1]) == 30);
+    assert(json_path_eval(path, root, out, 1) == 2);
+    assert(json_path_eval(path, root, NULL, 0) == 2);
+    assert(json_get_int(json_path_get(path, root)) == 10);
+    json_path_free(path);
+
+    path = json_path_compile("/user/*");
+    assert(json_path_eval(path, root, NULL, 0) == 6);
+    json_path_free(path);
+    json_doc_free(doc);
+
+    /* Wide objects answer from the key index with the compiled hash */
+    char json[4096];
+    size_t len = (size_t)snprintf(json, sizeof(json), "{");
+    for (int i = 0; i < 100; i++) {
+        len += (size_t)snprintf(json + len, sizeof(json) - len, "%s\"key%d\": [%d]",
+                                i ? ", " : "", i, i);
+    }
+    len += (size_t)snprintf(json + len, sizeof(json) - len, "}");
+    doc = json_parse(json, len);
+    path = json_path_compile("/key73/0");
+    assert(json_get_int(json_path_get(path, json_doc_root(doc))) == 73);
+    json_path_free(path);
+    json_doc_free(doc);
+}
+
+TEST(path_parse) {
+    json_path *path = json_path_compile("/events/*/ts");
+    json_doc *doc = json_path_parse(path, path_doc, strlen(path_doc));
+    assert(doc);
+    json_val *root = json_doc_root(doc);
+    assert(json_arr_size(root) == 2);
+    assert(json_get_int(json_arr_get(root, 0)) == 10);
+    assert(json_get_int(json_arr_get(root, 1)) == 30);
+    json_doc_free(doc);
+    json_path_free(path);
+
+    /* Matched containers are parsed whole; no match gives an empty array */
+    path = json_path_compile("/user");
+    doc = json_path_parse(path, path_doc, strlen(path_doc));
+    json_val *user = json_arr_get(json_doc_root(doc), 0);
+    assert(json_obj_size(user) == 6);
+    assert(json_get_int(json_obj_get(user, "esc")) == 5);
+    json_doc_free(doc);
+    json_path_free(path);
+
+    path = json_path_compile("/events/5");
+    doc = json_path_parse(path, path_doc, strlen(path_doc));
+    assert(doc && json_arr_size(json_doc_root(doc)) == 0);
+    json_doc_free(doc);
+    json_path_free(path);
+
+    /* Only matched values are validated */
+    const char *partly_bad = "{\"bad\": [tru, {\"a\" 1}], \"ok\": {\"v\": [1, 2]}, \"worse\": {";
+    path = json_path_compile("/ok/v/1");
+    doc = json_path_parse(path, partly_bad, strlen(partly_bad));
+    assert(doc && json_get_int(json_arr_get(json_doc_root(doc), 0)) == 2);
+    json_doc_free(doc);
+    json_path_free(path);
+
+    path = json_path_compile("/bad/0");
+    assert(json_path_parse(path, partly_bad, strlen(partly_bad)) == NULL);
+    assert(json_get_error().code == JSON_ERROR_SYNTAX);
+    json_path_free(path);
+}
+
+/* ============================================================================
+ * Schema Tests
+ * ============================================================================ */
+
+struct test_point {
+    int32_t x;
+    int32_t y;
+};
+
+struct test_msg {
+    int64_t id;
+    double price;
+    bool active;
+    char name[16];
+    struct test_point at;
+    int32_t qty;
+};
+
+static json_schema *test_msg_schema(json_schema **point) {
+    static const json_field point_fields[] = {
+        { "x", JSON_FIELD_INT32, offsetof(struct test_point, x), 0, NULL },
+        { "y", JSON_FIELD_INT32, offsetof(struct test_point, y), 0, NULL }
+    };
+    *point = json_schema_compile(point_fields, 2);
+    assert(*point);
+    json_field fields[] = {
+        { "id", JSON_FIELD_INT64, offsetof(struct test_msg, id), 0, NULL },
+        { "price", JSON_FIELD_DOUBLE, offsetof(struct test_msg, price), 0, NULL },
+        { "active", JSON_FIELD_BOOL, offsetof(struct test_msg, active), 0, NULL },
+        { "name", JSON_FIELD_STRING, offsetof(struct test_msg, name), sizeof(((struct test_msg *)0)->name), NULL },
+        { "at", JSON_FIELD_OBJECT, offsetof(struct test_msg, at), 0, *point },
+        { "quantity", JSON_FIELD_INT32, offsetof(struct test_msg, qty), 0, NULL }
+    };
+    json_schema *schema = json_schema_compile(fields, sizeof(fields) / sizeof(fields[0]));
+    assert(schema);
+    return schema;
+}
+
+TEST(schema_decode) {
+    json_schema *point;
+    json_schema *schema = test_msg_schema(&point);
+
+    /* Unknown members of any shape are skipped; escaped keys still match */
+    const char *json = "{ \"id\": 9223372036854775807, \"extra\": [1, {\"a\": [true]}, \"s\"],"
+                       " \"pr\\u0069ce\": 12, \"name\": \"caf\\u00e9\", \"active\": true,"
+                       " \"at\": {\"y\": -2, \"z\": null, \"x\": 7}, \"quantity\": null }";
+    struct test_msg msg = { .qty = 42 };
+    assert(json_decode(schema, json, strlen(json), &msg));
+    assert(msg.id == INT64_MAX);
+    assert(msg.price == 12.0);
+    assert(msg.active);
+    assert(strcmp(msg.name, "caf\xc3\xa9") == 0);
+    assert(msg.at.x == 7 && msg.at.y == -2);
+    assert(msg.qty == 42);
+
+    /* Type, range and size errors, and malformed skipped members */
+    const char *bad[] = {
+        "{\"id\": 1.5}",
+        "{\"quantity\": 2147483648}",
+        "{\"active\": 1}",
+        "{\"at\": [1, 2]}",
+        "{\"name\": \"sixteen bytes ok?\"}",
+        "{\"other\": [1, 2}",
+        "{\"id\": 1} x",
+        "{\"id\" 1}",
+        "[1]"
+    };
+    json_error codes[] = {
+        JSON_ERROR_TYPE, JSON_ERROR_TYPE, JSON_ERROR_TYPE, JSON_ERROR_TYPE, JSON_ERROR_STRING,
+        JSON_ERROR_SYNTAX, JSON_ERROR_SYNTAX, JSON_ERROR_SYNTAX, JSON_ERROR_SYNTAX
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        assert(!json_decode(schema, bad[i], strlen(bad[i]), &msg));
+        assert(json_get_error().code == codes[i]);
+    }
+
+    /* Invalid field lists */
+    json_field dup[] = {
+        { "a", JSON_FIELD_BOOL, 0, 0, NULL },
+        { "a", JSON_FIELD_BOOL, 1, 0, NULL }
+    };
+    assert(json_schema_compile(dup, 2) == NULL);
+    json_field no_size[] = { { "s", JSON_FIELD_STRING, 0, 0, NULL } };
+    assert(json_schema_compile(no_size, 1) == NULL);
+    assert(json_get_error().code == JSON_ERROR_SYNTAX);
+
+    /* A wide schema, including keys alike but for their middle bytes */
+    enum { WIDE = 100 };
+    int64_t vals[WIDE];
+    json_field wide[WIDE];
+    char keys[WIDE][32];
+    char input[4096];
+    size_t len = (size_t)snprintf(input, sizeof(input), "{");
+    for (int i = 0; i < WIDE; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "prefix_key_%03d_suffix_key", i);
+        wide[i] = (json_field){ keys[i], JSON_FIELD_INT64, (size_t)i * sizeof(int64_t), 0, NULL };
+        len += (size_t)snprintf(input + len, sizeof(input) - len, "%s\"%s\":%d", i ? "," : "", keys[i], i * 3);
+    }
+    snprintf(input + len, sizeof(input) - len, "}");
+    json_schema *ws = json_schema_compile(wide, WIDE);
+    assert(ws);
+    assert(json_decode(ws, input, strlen(input), vals));
+    for (int i = 0; i < WIDE; i++) assert(vals[i] == i * 3);
+    char *out = json_encode(ws, vals);
+    assert(out && strcmp(out, input) == 0);
+    free(out);
+    json_schema_free(ws);
+
+    json_schema_free(schema);
+    json_schema_free(point);
+}
+
+TEST(schema_encode) {
+    json_schema *point;
+    json_schema *schema = test_msg_schema(&point);
+
+    struct test_msg msg = {
+        .id = -5, .price = 0.1, .active = false, .name = "a\"b",
+        .at = { .x = 1, .y = INT32_MIN }, .qty = 3
+    };
+    const char *expected = "{\"id\":-5,\"price\":0.1,\"active\":false,\"name\":\"a\\\"b\","
+                           "\"at\":{\"x\":1,\"y\":-2147483648},\"quantity\":3}";
+    char *out = json_encode(schema, &msg);
+    assert(out && strcmp(out, expected) == 0);
+
+    /* Decoding the output gives the struct back */
+    struct test_msg back = {0};
+    assert(json_decode(schema, out, strlen(out), &back));
+    assert(back.id == msg.id && back.price == msg.price && back.active == msg.active);
+    assert(strcmp(back.name, msg.name) == 0 && back.at.y == INT32_MIN && back.qty == 3);
+    free(out);
+
+    char buf[256];
+    size_t len = json_encode_buf(schema, &msg, buf, sizeof(buf));
+    assert(len == strlen(expected) && strcmp(buf, expected) == 0);
+    assert(json_encode_buf(schema, &msg, buf, 10) == len && buf[0] == '\0');
+
+    /* A field filled to the last byte has no NUL; NaN has no JSON form */
+    memset(msg.name, 'x', sizeof(msg.name));
+    msg.price = 0.0 / 0.0;
+    out = json_encode(schema, &msg);
+    assert(strstr(out, "\"price\":null") && strstr(out, "\"xxxxxxxxxxxxxxxx\""));
+    free(out);
+
+    json_schema_free(schema);
+    json_schema_free(point);
+}
+
 /* ============================================================================
  * Main
  * ============================================================================ */
@@ -299,6 +1487,8 @@ int main(void) {
     /* Initialization */
     RUN(version);
     RUN(cpu_features);
+    RUN(simd_tier);
+    RUN(stats);
 
     /* Type names */
     RUN(type_names);
@@ -311,19 +1501,56 @@ int main(void) {
     /* Object iteration */
     RUN(obj_iteration);
     RUN(obj_has);
+    RUN(obj_key_index);
 
     /* Array iteration */
     RUN(arr_iteration);
     RUN(arr_get);
+    RUN(arr_contiguous);
 
     /* Equality */
     RUN(equals_primitives);
     RUN(equals_strings);
     RUN(equals_arrays);
     RUN(equals_objects);
+    RUN(equals_unordered);
+    RUN(hash_values);
 
     /* Clone */
     RUN(clone);
+    RUN(clone_independent);
+    RUN(clone_deep);
+
+    /* Mutation */
+    RUN(build_document);
+    RUN(mutate_object);
+    RUN(mutate_array);
+    RUN(mutate_deep);
+
+    /* Reuse */
+    RUN(parser_reuse);
+    RUN(doc_pool);
+    RUN(doc_reset);
+
+    /* Files */
+    RUN(parse_file);
+    RUN(parse_file_page_sized);
+    RUN(stream_file);
+    RUN(tape_roundtrip);
+
+    /* On-demand cursor */
+    RUN(cursor_find_field);
+    RUN(cursor_iterate);
+    RUN(cursor_errors);
+
+    /* JSON Pointer queries */
+    RUN(path_compile);
+    RUN(path_eval);
+    RUN(path_parse);
+
+    /* Schemas */
+    RUN(schema_decode);
+    RUN(schema_encode);
 
     /* NULL safety */
     RUN(null_safety);
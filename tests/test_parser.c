@@ -83,7 +83,34 @@ TEST(parse_large_int) {
     json_doc *doc = json_parse("9223372036854775807", 19); /* INT64_MAX */
     assert(doc != NULL);
     json_val *root = json_doc_root(doc);
-    assert(json_is_number(root));
+    assert(json_is_int(root) && json_get_int(root) == INT64_MAX);
+    json_doc_free(doc);
+
+    /* Past the old 60-bit payload, in both signs */
+    const char *wide = "[576460752303423488,-576460752303423489,1152921504606846975,4611686018427387904]";
+    doc = json_parse(wide, strlen(wide));
+    assert(doc != NULL);
+    root = json_doc_root(doc);
+    assert(json_get_int(json_arr_get(root, 0)) == (int64_t)1 << 59);
+    assert(json_get_int(json_arr_get(root, 1)) == -((int64_t)1 << 59) - 1);
+    assert(json_get_int(json_arr_get(root, 2)) == ((int64_t)1 << 60) - 1);
+    assert(json_get_int(json_arr_get(root, 3)) == (int64_t)1 << 62);
+    char *out = json_stringify(root);
+    assert(out && strcmp(out, wide) == 0);
+    free(out);
+    json_doc_free(doc);
+}
+
+TEST(parse_int_overflow) {
+    /* 19 digits fits, 20 digits falls back to float */
+    json_doc *doc = json_parse("[-1234567890123456789, 12345678901234567890]", 44);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    json_val *a = json_arr_get(root, 0);
+    json_val *b = json_arr_get(root, 1);
+    assert(json_is_int(a));
+    assert(json_is_float(b));
+    assert(json_get_num(b) > 1.2e19 && json_get_num(b) < 1.3e19);
     json_doc_free(doc);
 }
 
@@ -117,6 +144,32 @@ TEST(parse_negative_exponent) {
     json_doc_free(doc);
 }
 
+TEST(parse_float_exact) {
+    /* Correctly rounded, including ties, subnormals and long mantissas */
+    static const struct { const char *json; double expected; } cases[] = {
+        {"0.1", 0.1},
+        {"-12.5e3", -12.5e3},
+        {"2.2250738585072014e-308", 2.2250738585072014e-308},
+        {"4.9e-324", 4.9e-324},
+        {"1.7976931348623157e308", 1.7976931348623157e308},
+        {"9007199254740993.0", 9007199254740992.0},
+        {"4882232426722527.5", 4882232426722528.0},
+        {"0.1000000000000000055511151231257827021181583404541015625", 0.1},
+        {"123456789012345678901234567890", 123456789012345678901234567890.0},
+        {"1e-400", 0.0},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        json_doc *doc = json_parse(cases[i].json, strlen(cases[i].json));
+        assert(doc != NULL);
+        json_val *root = json_doc_root(doc);
+        assert(json_is_float(root));
+        assert(json_get_num(root) == cases[i].expected);
+        json_doc_free(doc);
+    }
+
+    assert(json_parse("1e400", 5) == NULL);
+}
+
 /* ============================================================================
  * String Tests
  * ============================================================================ */
@@ -169,6 +222,16 @@ TEST(parse_escaped_string) {
     json_doc_free(doc);
 }
 
+TEST(parse_long_escaped_string) {
+    const char *json = "\"a fairly long run of plain text before\\tescapes\\u00e9 and after them\"";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    assert(strcmp(json_get_str(root),
+                  "a fairly long run of plain text before\tescapes\xc3\xa9 and after them") == 0);
+    json_doc_free(doc);
+}
+
 TEST(parse_escaped_quote) {
     json_doc *doc = json_parse("\"say \\\"hello\\\"\"", 15);
     assert(doc != NULL);
@@ -187,6 +250,128 @@ TEST(parse_unicode_escape) {
     json_doc_free(doc);
 }
 
+TEST(parse_insitu) {
+    char buf[] = "{\"message\": \"tab\\there \\u00e9\\ud83d\\ude00 done\", \"plain text value\": [\"short\"]}";
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_INSITU;
+    json_doc *doc = json_parse_opts(buf, strlen(buf), &opts);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    /* Long strings and keys are decoded into the caller's buffer */
+    json_val *msg = json_obj_get(root, "message");
+    const char *expect = "tab\there \xc3\xa9\xf0\x9f\x98\x80 done";
+    assert(strcmp(json_get_str(msg), expect) == 0);
+    assert(json_get_str_len(msg) == strlen(expect));
+    assert(json_get_str(msg) > buf && json_get_str(msg) < buf + sizeof(buf));
+
+    json_val *arr = json_obj_get(root, "plain text value");
+    assert(strcmp(json_get_str(json_arr_get(arr, 0)), "short") == 0);
+    json_doc_free(doc);
+}
+
+TEST(parse_borrow) {
+    const char *json = "[\"a long string without escapes\", \"an escaped\\nlong string\", \"tiny\"]";
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_BORROW;
+    json_doc *doc = json_parse_opts(json, strlen(json), &opts);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    /* Escape-free strings reference the input; escaped ones are copied */
+    json_val *plain = json_arr_get(root, 0);
+    assert(json_get_str(plain) == json + 2);
+    assert(json_get_str_len(plain) == strlen("a long string without escapes"));
+    assert(memcmp(json_get_str(plain), "a long string without escapes", json_get_str_len(plain)) == 0);
+
+    json_val *escaped = json_arr_get(root, 1);
+    assert(strcmp(json_get_str(escaped), "an escaped\nlong string") == 0);
+
+    char *out = json_stringify(root);
+    assert(strstr(out, "\"a long string without escapes\"") != NULL);
+    free(out);
+    json_doc_free(doc);
+}
+
+TEST(parse_intern) {
+    /* Repeated keys and values share one copy; escapes decode first */
+    const char *json = "[{\"customer_id\": \"active_user\", \"total\": 1},"
+                       " {\"customer_id\": \"active_\\u0075ser\", \"total\": 2},"
+                       " {\"customer_\\u0069d\": \"cancelled_user\", \"total\": 3}]";
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_INTERN;
+    json_doc *doc = json_parse_opts(json, strlen(json), &opts);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    json_val *a = json_arr_get(root, 0);
+    json_val *b = json_arr_get(root, 1);
+    json_val *c = json_arr_get(root, 2);
+    assert(json_obj_key(json_obj_first(a)) == json_obj_key(json_obj_first(b)));
+    assert(json_obj_key(json_obj_first(a)) == json_obj_key(json_obj_first(c)));
+    assert(json_get_str(json_obj_get(a, "customer_id")) == json_get_str(json_obj_get(b, "customer_id")));
+    assert(strcmp(json_get_str(json_obj_get(c, "customer_id")), "cancelled_user") == 0);
+    assert(json_get_int(json_obj_get(c, "total")) == 3);
+
+    /* Same tree as without interning */
+    json_doc *plain = json_parse(json, strlen(json));
+    assert(json_equals(root, json_doc_root(plain)));
+    json_doc_free(plain);
+    json_doc_free(doc);
+
+    /* A fed document keeps its table, which counts as its memory */
+    json_parser *interning = json_parser_new(&opts);
+    json_parser *parser = json_parser_new(NULL);
+    json_feed(interning, json, strlen(json));
+    json_feed(parser, json, strlen(json));
+    json_doc *fed = json_feed_end(interning);
+    plain = json_feed_end(parser);
+    assert(fed && plain);
+    assert(json_doc_memory(fed) > json_doc_memory(plain));
+    json_parser_free(interning);
+    json_parser_free(parser);
+}
+
+/* Parse with JSON_PARSE_VALIDATE_UTF8; the error position, or SIZE_MAX */
+static size_t utf8_error_at(const char *json) {
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_VALIDATE_UTF8;
+    json_doc *doc = json_parse_opts(json, strlen(json), &opts);
+    if (doc) {
+        json_doc_free(doc);
+        return SIZE_MAX;
+    }
+    json_error_info err = json_get_error();
+    assert(err.code == JSON_ERROR_UTF8);
+    return err.position;
+}
+
+TEST(parse_validate_utf8) {
+    /* Long enough to reach the vector kernels of every tier */
+    const char *valid = "{\"caf\xC3\xA9\": \"\xE2\x82\xAC 12, \xF0\x9F\x98\x80 and \xF4\x8F\xBF\xBF"
+                        " past the first 32 bytes \xED\x9F\xBF\xEF\xBF\xBF\"}";
+    for (int tier = JSON_SIMD_SCALAR; tier <= JSON_SIMD_SVE2; tier++) {
+        if (!json_set_simd_tier((json_simd_tier)tier)) continue;
+
+        assert(utf8_error_at(valid) == SIZE_MAX);
+        assert(utf8_error_at("[\"\xC0\xAF\"]") == 2);                 /* Overlong */
+        assert(utf8_error_at("[\"\xE0\x80\xAF\"]") == 2);
+        assert(utf8_error_at("[\"\xED\xA0\x80\"]") == 2);             /* Surrogate */
+        assert(utf8_error_at("[\"\xF4\x90\x80\x80\"]") == 2);         /* Past U+10FFFF */
+        assert(utf8_error_at("[\"ab\x80\"]") == 4);                   /* Stray continuation */
+        assert(utf8_error_at("[\"ab\xE2\x82\"]") == 4);               /* Truncated */
+        assert(utf8_error_at("{\"\xFF\": 1}") == 2);                   /* In a key */
+        assert(utf8_error_at("[\"the first block is ASCII, then \xE2\x82\xAC\xE2\x28\xA1 x\"]") == 36);
+        assert(utf8_error_at("[\"a sequence cut by an escape \xE2\x82\\n, far in\"]") == 30);
+    }
+    json_set_simd_tier(JSON_SIMD_AUTO);
+
+    /* Without the flag string bytes are not checked */
+    json_doc *doc = json_parse("[\"\xC0\xAF\"]", 6);
+    assert(doc != NULL);
+    json_doc_free(doc);
+}
+
 /* ============================================================================
  * Array Tests
  * ============================================================================ */
@@ -292,6 +477,68 @@ TEST(parse_nested_object) {
     json_doc_free(doc);
 }
 
+TEST(parse_long_keys) {
+    const char *json = "{\"a_long_key_name\": 1, \"another_long_key\": {\"nested_long_key\": 2}}";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    assert(json_obj_size(root) == 2);
+
+    assert(json_get_int(json_obj_get(root, "a_long_key_name")) == 1);
+    json_val *inner = json_obj_get(root, "another_long_key");
+    assert(json_get_int(json_obj_get(inner, "nested_long_key")) == 2);
+
+    json_val *key = json_obj_first(root);
+    assert(strcmp(json_obj_key(key), "a_long_key_name") == 0);
+    assert(json_get_int(json_obj_val(key)) == 1);
+    key = json_obj_next(key);
+    assert(strcmp(json_obj_key(key), "another_long_key") == 0);
+    assert(json_obj_next(key) == NULL);
+
+    json_doc_free(doc);
+}
+
+TEST(parse_arena_growth) {
+    /* Dense arrays outgrow the initial arena estimate; every node and string
+     * allocated before a new block is chained must stay valid */
+    size_t count = 50000;
+    char *json = malloc(count * 24 + 16);
+    assert(json != NULL);
+    size_t n = 0;
+    json[n++] = '[';
+    for (size_t i = 0; i < count; i++) {
+        if (i) json[n++] = ',';
+        if (i % 8 == 1) {
+            n += (size_t)sprintf(json + n, "\"string number %06zu\"", i);
+        } else {
+            n += (size_t)sprintf(json + n, "[[%zu]]", i % 10);
+        }
+    }
+    json[n++] = ']';
+
+    json_doc *doc = json_parse(json, n);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    assert(json_arr_size(root) == count);
+
+    size_t i = 0;
+    char expect[48];
+    json_arr_foreach(root, elem) {
+        if (i % 8 == 1) {
+            snprintf(expect, sizeof(expect), "string number %06zu", i);
+            assert(strcmp(json_get_str(elem), expect) == 0);
+        } else {
+            json_val *inner = json_arr_first(elem);
+            assert(json_get_int(json_arr_first(inner)) == (int64_t)(i % 10));
+        }
+        i++;
+    }
+    assert(i == count);
+
+    json_doc_free(doc);
+    free(json);
+}
+
 /* ============================================================================
  * Whitespace Tests
  * ============================================================================ */
@@ -314,6 +561,22 @@ TEST(parse_with_newlines) {
     json_doc_free(doc);
 }
 
+TEST(parse_indented) {
+    const char *json =
+        "{\n"
+        "                                        \"a\": [\n"
+        "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t1,\r\n"
+        "                                                                    2\n"
+        "                                        ]\n"
+        "}                                                                      ";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *a = json_obj_get(json_doc_root(doc), "a");
+    assert(json_arr_size(a) == 2);
+    assert(json_get_int(json_arr_get(a, 1)) == 2);
+    json_doc_free(doc);
+}
+
 /* ============================================================================
  * Error Tests
  * ============================================================================ */
@@ -353,6 +616,694 @@ TEST(error_trailing_content) {
     assert(err.code == JSON_ERROR_SYNTAX);
 }
 
+/* Alternating arrays and objects, levels deep: [{"a":[{"a":...1...}]}] */
+static char *make_deep(size_t levels, size_t *len) {
+    char *json = malloc(levels * 6 + 2);
+    size_t n = 0;
+    for (size_t i = 0; i < levels / 2; i++) {
+        memcpy(json + n, "[{\"a\":", 6);
+        n += 6;
+    }
+    json[n++] = '1';
+    for (size_t i = 0; i < levels / 2; i++) {
+        json[n++] = '}';
+        json[n++] = ']';
+    }
+    json[n] = '\0';
+    *len = n;
+    return json;
+}
+
+TEST(parse_deep_nesting) {
+    /* Deeper than any recursive parser's C stack would allow */
+    size_t levels = 200000;
+    size_t len;
+    char *json = make_deep(levels, &len);
+
+    uint32_t modes[] = { JSON_PARSE_DEFAULT, JSON_PARSE_TWO_STAGE };
+    for (size_t m = 0; m < 2; m++) {
+        json_parse_options opts = {0};
+        opts.flags = modes[m];
+        json_doc *doc = json_parse_opts(json, len, &opts);
+        assert(doc != NULL);
+
+        json_val *val = json_doc_root(doc);
+        for (size_t i = 0; i < levels / 2; i++) {
+            assert(json_is_array(val));
+            val = json_arr_get(val, 0);
+            assert(json_is_object(val));
+            val = json_obj_get(val, "a");
+        }
+        assert(json_get_int(val) == 1);
+        json_doc_free(doc);
+
+        opts.max_depth = levels;
+        doc = json_parse_opts(json, len, &opts);
+        assert(doc != NULL);
+        json_doc_free(doc);
+
+        opts.max_depth = levels - 1;
+        assert(json_parse_opts(json, len, &opts) == NULL);
+        assert(json_get_error().code == JSON_ERROR_DEPTH);
+    }
+
+    /* Unclosed at full depth */
+    assert(json_parse(json, len - 1) == NULL);
+    assert(json_get_error().code == JSON_ERROR_SYNTAX);
+    free(json);
+}
+
+TEST(stringify_deep_nesting) {
+    size_t levels = 200000;
+    size_t len;
+    char *json = make_deep(levels, &len);
+    json_doc *doc = json_parse(json, len);
+    assert(doc != NULL);
+
+    char *out = json_stringify(json_doc_root(doc));
+    assert(out && strcmp(out, json) == 0);
+    assert(json_stringify_size(json_doc_root(doc), NULL) == len);
+    free(out);
+
+    /* One line per value; any indent would be quadratic in the depth */
+    json_stringify_options opts = {0};
+    opts.flags = JSON_STRINGIFY_PRETTY;
+    out = json_stringify_opts(json_doc_root(doc), &opts);
+    assert(out && strlen(out) == json_stringify_size(json_doc_root(doc), &opts));
+    json_doc_free(doc);
+
+    /* The pretty form parses back to the same document */
+    doc = json_parse(out, strlen(out));
+    assert(doc != NULL);
+    free(out);
+    out = json_stringify(json_doc_root(doc));
+    assert(out && strcmp(out, json) == 0);
+    free(out);
+    json_doc_free(doc);
+    free(json);
+
+    /* Plain arrays: [[[...1...]]] */
+    char *arrays = malloc(2 * levels + 2);
+    memset(arrays, '[', levels);
+    arrays[levels] = '1';
+    memset(arrays + levels + 1, ']', levels);
+    arrays[2 * levels + 1] = '\0';
+    doc = json_parse(arrays, 2 * levels + 1);
+    assert(doc != NULL);
+    out = json_stringify(json_doc_root(doc));
+    assert(out && strcmp(out, arrays) == 0);
+    free(out);
+    json_doc_free(doc);
+    free(arrays);
+}
+
+/* ============================================================================
+ * Two-Stage Parser Tests
+ * ============================================================================ */
+
+static json_doc *parse_two_stage(const char *json, size_t len) {
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_TWO_STAGE;
+    return json_parse_opts(json, len, &opts);
+}
+
+/* Parse with both engines and check the results match */
+static void check_two_stage(const char *json) {
+    json_doc *a = json_parse(json, strlen(json));
+    json_doc *b = parse_two_stage(json, strlen(json));
+    assert(a != NULL);
+    assert(b != NULL);
+    assert(json_equals(json_doc_root(a), json_doc_root(b)));
+    json_doc_free(a);
+    json_doc_free(b);
+}
+
+TEST(two_stage_matches) {
+    check_two_stage("null");
+    check_two_stage("  -12.5e3  ");
+    check_two_stage("\"plain\"");
+    check_two_stage("[]");
+    check_two_stage("{}");
+    check_two_stage("[1,2,[3,[4]],{\"a\":true,\"b\":null}]");
+    check_two_stage("{\n  \"key\" : [ 1 , \"two\" , false ] ,\n  \"nested\": {\"x\": {}}\n}");
+    check_two_stage("{\"has,:{}[]chars\": \"in \\\"quoted\\\" ]} text\"}");
+    check_two_stage("[\"trailing backslash \\\\\", \"next\"]");
+}
+
+TEST(two_stage_block_boundaries) {
+    /* Put quotes, escapes and structurals on and around 64-byte block edges */
+    char buf[512];
+    for (int pad = 0; pad < 70; pad++) {
+        int n = 0;
+        n += snprintf(buf + n, sizeof(buf) - (size_t)n, "[\"");
+        for (int i = 0; i < pad; i++) buf[n++] = 'x';
+        n += snprintf(buf + n, sizeof(buf) - (size_t)n, "\\\"\\\\\", {\"k\": [%d, \"]\"]}, \"", pad);
+        for (int i = 0; i < pad; i++) buf[n++] = ',';
+        n += snprintf(buf + n, sizeof(buf) - (size_t)n, "\"]");
+        buf[n] = '\0';
+
+        json_doc *doc = parse_two_stage(buf, (size_t)n);
+        assert(doc != NULL);
+        json_val *root = json_doc_root(doc);
+        assert(json_arr_size(root) == 3);
+        json_val *first = json_arr_get(root, 0);
+        assert(json_get_str_len(first) == (size_t)pad + 2);
+        json_val *k = json_obj_get(json_arr_get(root, 1), "k");
+        assert(json_get_int(json_arr_get(k, 0)) == pad);
+        assert(strcmp(json_get_str(json_arr_get(k, 1)), "]") == 0);
+        assert(json_get_str_len(json_arr_get(root, 2)) == (size_t)pad);
+        json_doc_free(doc);
+    }
+}
+
+TEST(two_stage_errors) {
+    const char *bad[] = {
+        "", "[1 2]", "[1,]", "{\"a\" 1}", "{\"a\":}", "{1:2}", "[\"open]",
+        "{}[]", "[nul]", "[1}", "]", "[\"a\" \"b\"]", "{\"a\":1 x}"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json_doc *doc = parse_two_stage(bad[i], strlen(bad[i]));
+        assert(doc == NULL);
+        assert(json_get_error().code != JSON_OK);
+    }
+
+    json_parse_options opts = {0};
+    opts.flags = JSON_PARSE_TWO_STAGE | JSON_PARSE_ALLOW_TRAILING;
+    const char *trailing = "[1,{\"a\":2,},]";
+    json_doc *doc = json_parse_opts(trailing, strlen(trailing), &opts);
+    assert(doc != NULL);
+    json_doc_free(doc);
+
+    opts.flags = JSON_PARSE_TWO_STAGE;
+    opts.max_depth = 2;
+    doc = json_parse_opts("[[[1]]]", 7, &opts);
+    assert(doc == NULL);
+    assert(json_get_error().code == JSON_ERROR_DEPTH);
+}
+
+/* ============================================================================
+ * Streaming Tests
+ * ============================================================================ */
+
+TEST(stream_ndjson) {
+    const char *json =
+        "{\"a\": 1}\n"
+        "[1, 2]\n"
+        "\"a top-level string\"\n"
+        "42\n"
+        "true\n"
+        "{\"b\": \"}]\\\"\"}{}[[]]";
+    json_stream *stream = json_stream_new(json, strlen(json), NULL);
+    assert(stream != NULL);
+
+    json_doc *doc = json_stream_next(stream);
+    assert(doc != NULL);
+    assert(json_get_int(json_obj_get(json_doc_root(doc), "a")) == 1);
+    assert(json_arr_size(json_doc_root(json_stream_next(stream))) == 2);
+    assert(strcmp(json_get_str(json_doc_root(json_stream_next(stream))), "a top-level string") == 0);
+    assert(json_get_int(json_doc_root(json_stream_next(stream))) == 42);
+    assert(json_get_bool(json_doc_root(json_stream_next(stream))));
+
+    doc = json_stream_next(stream);
+    assert(doc != NULL);
+    assert(strcmp(json_get_str(json_obj_get(json_doc_root(doc), "b")), "}]\"") == 0);
+    assert(json_obj_size(json_doc_root(json_stream_next(stream))) == 0);
+    assert(json_arr_size(json_doc_root(json_stream_next(stream))) == 1);
+
+    assert(json_stream_next(stream) == NULL);
+    assert(json_get_error().code == JSON_OK);
+    assert(json_stream_position(stream) == strlen(json));
+    json_stream_free(stream);
+}
+
+TEST(stream_bad_record) {
+    const char *json = "{\"a\": 1}\n{\"b\" 2}\n[3]\n";
+    json_stream *stream = json_stream_new(json, strlen(json), NULL);
+
+    assert(json_stream_next(stream) != NULL);
+    assert(json_stream_next(stream) == NULL);
+    json_error_info err = json_get_error();
+    assert(err.code == JSON_ERROR_SYNTAX);
+    assert(err.position > 9 && err.position < 17);
+
+    /* The bad record is skipped */
+    json_doc *doc = json_stream_next(stream);
+    assert(doc != NULL);
+    assert(json_get_int(json_arr_get(json_doc_root(doc), 0)) == 3);
+    assert(json_stream_next(stream) == NULL);
+    json_stream_free(stream);
+}
+
+TEST(stream_truncated) {
+    const char *json = "[1]\n{\"a\": [1, \"2]";
+    json_stream *stream = json_stream_new(json, strlen(json), NULL);
+
+    assert(json_stream_next(stream) != NULL);
+    assert(json_stream_next(stream) == NULL);
+    assert(json_get_error().code == JSON_ERROR_INCOMPLETE);
+    assert(json_stream_position(stream) == 4);
+
+    /* Stays put until the caller resumes with more data */
+    assert(json_stream_next(stream) == NULL);
+    assert(json_get_error().code == JSON_ERROR_INCOMPLETE);
+    assert(json_stream_position(stream) == 4);
+    json_stream_free(stream);
+}
+
+TEST(stream_block_boundaries) {
+    /* Records of every length around the 64-byte scan blocks */
+    size_t cap = 64 * 1024;
+    char *buf = malloc(cap);
+    assert(buf != NULL);
+    size_t n = 0;
+    for (int i = 0; i < 200; i++) {
+        n += (size_t)snprintf(buf + n, cap - n, "{\"id\":%d,\"s\":\"", i);
+        for (int j = 0; j < i % 70; j++) buf[n++] = (j % 7 == 0) ? ']' : 'x';
+        n += (size_t)snprintf(buf + n, cap - n, "\\\"\",\"l\":[[%d]]}%s", i, (i % 3) ? "\n" : "");
+    }
+
+    json_stream *stream = json_stream_new(buf, n, NULL);
+    for (int i = 0; i < 200; i++) {
+        json_doc *doc = json_stream_next(stream);
+        assert(doc != NULL);
+        json_val *root = json_doc_root(doc);
+        assert(json_get_int(json_obj_get(root, "id")) == i);
+        assert(json_get_str_len(json_obj_get(root, "s")) == (size_t)(i % 70) + 1);
+    }
+    assert(json_stream_next(stream) == NULL);
+    assert(json_get_error().code == JSON_OK);
+    json_stream_free(stream);
+    free(buf);
+}
+
+/* ============================================================================
+ * Push Parser Tests
+ * ============================================================================ */
+
+static const char *feed_doc =
+    "{\"name\": \"a long enough string with an \\\"escape\\\" and \\u00e9\",\n"
+    " \"n\": [0, -12, 3.5e2, true, false, null, [], {}],\n"
+    " \"nested\": {\"k\": [{\"deep\": \"ok\"}]}, \"last\": 123456789}";
+
+TEST(feed_every_split) {
+    size_t len = strlen(feed_doc);
+    json_doc *expect = json_parse(feed_doc, len);
+    assert(expect != NULL);
+    json_parser *parser = json_parser_new(NULL);
+
+    /* Two chunks, split at every byte */
+    for (size_t k = 0; k <= len; k++) {
+        assert(json_feed(parser, feed_doc, k) == JSON_ERROR_INCOMPLETE || k == len);
+        assert(json_feed(parser, feed_doc + k, len - k) == JSON_OK);
+        json_doc *doc = json_feed_end(parser);
+        assert(doc != NULL);
+        assert(json_equals(json_doc_root(doc), json_doc_root(expect)));
+    }
+
+    /* One byte at a time */
+    for (size_t i = 0; i < len; i++) {
+        json_error err = json_feed(parser, feed_doc + i, 1);
+        assert(err == (i + 1 == len ? JSON_OK : JSON_ERROR_INCOMPLETE));
+    }
+    json_doc *doc = json_feed_end(parser);
+    assert(doc != NULL);
+    assert(json_equals(json_doc_root(doc), json_doc_root(expect)));
+
+    json_parser_free(parser);
+    json_doc_free(expect);
+}
+
+TEST(feed_root_scalars) {
+    json_parser *parser = json_parser_new(NULL);
+
+    /* A root number is only complete at the end of input */
+    assert(json_feed(parser, "12", 2) == JSON_ERROR_INCOMPLETE);
+    assert(json_feed(parser, "34", 2) == JSON_ERROR_INCOMPLETE);
+    json_doc *doc = json_feed_end(parser);
+    assert(doc != NULL);
+    assert(json_get_int(json_doc_root(doc)) == 1234);
+
+    assert(json_feed(parser, "\"ab", 3) == JSON_ERROR_INCOMPLETE);
+    assert(json_feed(parser, "c\"  ", 4) == JSON_OK);
+    doc = json_feed_end(parser);
+    assert(strcmp(json_get_str(json_doc_root(doc)), "abc") == 0);
+
+    json_parser_free(parser);
+}
+
+TEST(feed_errors) {
+    json_parser *parser = json_parser_new(NULL);
+
+    /* Errors are sticky until json_feed_end() */
+    assert(json_feed(parser, "[1, 2", 5) == JSON_ERROR_INCOMPLETE);
+    assert(json_feed(parser, " 3]", 3) == JSON_ERROR_SYNTAX);
+    assert(json_get_error().position == 6);
+    assert(json_feed(parser, "]", 1) == JSON_ERROR_SYNTAX);
+    assert(json_feed_end(parser) == NULL);
+
+    assert(json_feed(parser, "{\"a\": tru", 9) == JSON_ERROR_INCOMPLETE);
+    assert(json_feed(parser, "x}", 2) == JSON_ERROR_SYNTAX);
+    assert(json_feed_end(parser) == NULL);
+
+    assert(json_feed(parser, "[1] 2", 5) == JSON_ERROR_SYNTAX);
+    assert(json_feed_end(parser) == NULL);
+
+    /* Truncated input */
+    assert(json_feed(parser, "{\"a\": [1", 8) == JSON_ERROR_INCOMPLETE);
+    assert(json_feed_end(parser) == NULL);
+    assert(json_get_error().code == JSON_ERROR_INCOMPLETE);
+
+    /* The parser is usable again afterwards */
+    assert(json_feed(parser, "[true]", 6) == JSON_OK);
+    json_doc *doc = json_feed_end(parser);
+    assert(doc != NULL);
+    assert(json_get_bool(json_arr_get(json_doc_root(doc), 0)));
+
+    json_parser_free(parser);
+}
+
+/* ============================================================================
+ * Parallel Parsing
+ * ============================================================================ */
+
+static json_doc *parse_threads(const char *json, size_t len, uint32_t threads,
+                               uint32_t flags) {
+    json_parse_options opts = {0};
+    opts.flags = flags;
+    opts.threads = threads;
+    opts.parallel_min_size = 1;     /* Split even tiny inputs */
+    return json_parse_opts(json, len, &opts);
+}
+
+/* Parallel and serial parses give the same tree (compared as text, since
+ * json_equals() folds duplicate keys) or the same error */
+static void check_parallel(const char *json, size_t len, uint32_t flags) {
+    json_parse_options opts = {0};
+    opts.flags = flags;
+    json_doc *serial = json_parse_opts(json, len, &opts);
+    json_error_info serial_err = json_get_error();
+
+    for (uint32_t threads = 2; threads <= 8; threads++) {
+        json_doc *doc = parse_threads(json, len, threads, flags);
+        if (!serial) {
+            assert(doc == NULL);
+            assert(json_get_error().code == serial_err.code);
+            assert(json_get_error().position == serial_err.position);
+            continue;
+        }
+        assert(doc != NULL);
+        char *a = json_stringify(json_doc_root(serial));
+        char *b = json_stringify(json_doc_root(doc));
+        assert(strcmp(a, b) == 0);
+        assert(json_doc_count(doc) == json_doc_count(serial));
+        free(a);
+        free(b);
+        json_doc_free(doc);
+    }
+    if (serial) json_doc_free(serial);
+}
+
+TEST(parallel_matches) {
+    const char *docs[] = {
+        "[]", " { } ", "[1]", "[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20]",
+        "{\"a\": [1, {\"b\": \"x,]}\"}], \"c\": {\"d\": [[], {}]}, \"e\": null}",
+        "[\"\\\\\", \"\\\"],\", [\"a\", \"b\"], {\"k\": \",\"}, true, false, -1.5e3]"
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+        check_parallel(docs[i], strlen(docs[i]), 0);
+    }
+    check_parallel("[1, 2, 3,]", 10, JSON_PARSE_ALLOW_TRAILING);
+    check_parallel("{\"a\": 1,}", 9, JSON_PARSE_ALLOW_TRAILING);
+}
+
+TEST(parallel_large) {
+    /* Elements with quotes, escapes and brackets inside strings, so chunk
+     * edges land everywhere: inside strings, escapes and nested values */
+    size_t cap = 64 * 1024;
+    char *buf = malloc(cap);
+    assert(buf != NULL);
+    size_t n = 0;
+    buf[n++] = '[';
+    for (int i = 0; i < 600; i++) {
+        if (i) buf[n++] = ',';
+        n += (size_t)snprintf(buf + n, cap - n, "{\"id\":%d,\"s\":\"%.*s\\\\\\\",[]{}\",\"v\":[%d,[\"]\"]]}",
+                              i, i % 37, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", -i);
+    }
+    buf[n++] = ']';
+
+    check_parallel(buf, n, 0);
+
+    json_doc *doc = parse_threads(buf, n, 4, 0);
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    assert(json_arr_size(root) == 600);
+    json_val *last = json_arr_get(root, 599);
+    assert(json_get_int(json_obj_get(last, "id")) == 599);
+    assert(json_get_int(json_arr_get(json_obj_get(last, "v"), 0)) == -599);
+    json_doc_free(doc);
+
+    /* Break the input in a few places */
+    buf[n / 2] = '}';
+    check_parallel(buf, n, 0);
+    buf[n - 1] = ',';
+    check_parallel(buf, n, 0);
+    free(buf);
+}
+
+TEST(parallel_errors) {
+    const char *bad[] = {
+        "[1,,2]", "[1 2, 3, 4]", "[1, 2, 3, 4,]", "[1, 2] [3, 4]", "[1, 2], 3, 4",
+        "{\"a\": 1, \"b\" 2, \"c\": 3}", "{\"a\": 1, 2: 3}", "[\"open, 1, 2, 3]",
+        "[[1, 2], [3, 4]]]", "[{}, [], {}, []"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        check_parallel(bad[i], strlen(bad[i]), 0);
+        assert(parse_threads(bad[i], strlen(bad[i]), 4, 0) == NULL);
+    }
+}
+
+/* ============================================================================
+ * Batch Parsing
+ * ============================================================================ */
+
+static void check_batch(size_t n) {
+    char **inputs = malloc(n * sizeof(char *));
+    size_t *lens = malloc(n * sizeof(size_t));
+    json_doc **docs = malloc(n * sizeof(json_doc *));
+    json_error_info *errors = malloc(n * sizeof(json_error_info));
+    assert(inputs && lens && docs && errors);
+    size_t bad = 0;
+    for (size_t i = 0; i < n; i++) {
+        inputs[i] = malloc(64);
+        assert(inputs[i] != NULL);
+        if (i % 7 == 3) {
+            lens[i] = (size_t)snprintf(inputs[i], 64, "{\"id\": %zu,, \"x\": 1}", i);
+            bad++;
+        } else if (i % 11 == 5) {
+            lens[i] = 0;
+            bad++;
+        } else {
+            lens[i] = (size_t)snprintf(inputs[i], 64, "{\"id\": %zu, \"tags\": [\"a\", %zu]}", i, i * 2);
+        }
+    }
+
+    size_t failed = json_parse_batch((const char *const *)inputs, lens, n, NULL, docs, errors);
+    assert(failed == bad);
+    for (size_t i = 0; i < n; i++) {
+        json_doc *ref = json_parse(inputs[i], lens[i]);
+        json_error_info ref_err = json_get_error();
+        assert((docs[i] != NULL) == (ref != NULL));
+        if (ref) {
+            assert(errors[i].code == JSON_OK);
+            json_val *root = json_doc_root(docs[i]);
+            assert(json_get_int(json_obj_get(root, "id")) == (int64_t)i);
+            assert(json_get_int(json_arr_get(json_obj_get(root, "tags"), 1)) == (int64_t)(i * 2));
+            json_doc_free(ref);
+            json_doc_free(docs[i]);
+        } else {
+            assert(errors[i].code == ref_err.code);
+            assert(errors[i].position == ref_err.position);
+        }
+        free(inputs[i]);
+    }
+    free(inputs);
+    free(lens);
+    free(docs);
+    free(errors);
+}
+
+TEST(batch_parse) {
+    /* One CPU or many, pinned or not, the results are the same */
+    static const int cpus[] = { 0 };
+    json_batch_options pools[] = {
+        { .threads = 0 },
+        { .threads = 4 },
+        { .threads = 3, .cpus = cpus, .cpu_count = 1 },
+        { .threads = 1 }
+    };
+    for (size_t p = 0; p < sizeof(pools) / sizeof(pools[0]); p++) {
+        json_batch_configure(&pools[p]);
+        check_batch(3);
+        check_batch(5000);
+        check_batch(777);
+    }
+
+    /* Documents freed after their worker has stopped are still released */
+    static const char *const item[] = { "[1, 2]", "[3, 4]" };
+    const char *inputs[64];
+    size_t lens[64];
+    json_doc *docs[64];
+    for (size_t i = 0; i < 64; i++) {
+        inputs[i] = item[i % 2];
+        lens[i] = 6;
+    }
+    json_batch_configure(&(json_batch_options){ .threads = 4 });
+    assert(json_parse_batch(inputs, lens, 64, NULL, docs, NULL) == 0);
+    for (size_t i = 0; i < 32; i++) json_doc_free(docs[i]);
+    json_batch_shutdown();
+    for (size_t i = 32; i < 64; i++) {
+        assert(json_get_int(json_arr_get(json_doc_root(docs[i]), 1)) == (int64_t)(i % 2 ? 4 : 2));
+        json_doc_free(docs[i]);
+    }
+
+    /* Items parsed in parallel find the pool taken by their own batch */
+    json_parse_options opts = { .threads = 4, .parallel_min_size = 1 };
+    json_batch_configure(&(json_batch_options){ .threads = 2 });
+    assert(json_parse_batch(inputs, lens, 64, &opts, docs, NULL) == 0);
+    for (size_t i = 0; i < 64; i++) {
+        assert(json_get_int(json_arr_get(json_doc_root(docs[i]), 0)) == (int64_t)(i % 2 ? 3 : 1));
+        json_doc_free(docs[i]);
+    }
+    json_batch_shutdown();
+    json_batch_configure(NULL);
+
+    assert(json_parse_batch(NULL, NULL, 0, NULL, NULL, NULL) == 0);
+}
+
+/* ============================================================================
+ * Validation and Minification
+ * ============================================================================ */
+
+/* json_validate() must agree with json_parse_opts(), error included */
+static void check_validate(const char *json, uint32_t flags, size_t max_depth) {
+    json_parse_options opts = {0};
+    opts.flags = flags;
+    opts.max_depth = max_depth;
+    size_t len = strlen(json);
+
+    json_doc *doc = json_parse_opts(json, len, &opts);
+    json_error_info parse_err = json_get_error();
+    json_error_info err;
+    bool ok = json_validate(json, len, &opts, &err);
+    assert(ok == (doc != NULL));
+    if (doc) {
+        assert(err.code == JSON_OK);
+        json_doc_free(doc);
+    } else {
+        assert(err.code == parse_err.code);
+        assert(err.position == parse_err.position);
+        assert(strcmp(err.message, parse_err.message) == 0);
+    }
+}
+
+TEST(validate_matches_parse) {
+    static const char *cases[] = {
+        "null", "  -12.5e3 ", "\"str\"", "[]", "{}", "[1,[2,[3,{}]],{\"a\":[]}]",
+        "{\"a\": {\"b\": [true, false, null]}, \"c\": \"\\u00e9\\n\"}",
+        "", "[", "[1,]", "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "{1:2}", "{\"a\":1 \"b\":2}",
+        "[\"unterminated", "[\"bad \\q escape\"]", "[01]", "[1] x", "[tru]", "{\"a\":}",
+        "[1}", "{\"a\":1]", "[\"ctrl \x01\"]", "]", "[[[[[[1]]]]]]"
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        check_validate(cases[i], JSON_PARSE_DEFAULT, 0);
+        check_validate(cases[i], JSON_PARSE_ALLOW_TRAILING, 0);
+        check_validate(cases[i], JSON_PARSE_DEFAULT, 3);
+    }
+    check_validate("{\"k\": [\"\xE2\x82\xAC ok\", \"\xE2\x28\xA1\"]}", JSON_PARSE_VALIDATE_UTF8, 0);
+
+    /* Past the nesting validate tracks on the C stack, with and without
+     * a depth limit */
+    size_t depth = 100000;
+    char *deep = malloc(depth * 2 + 1);
+    memset(deep, '[', depth);
+    memset(deep + depth, ']', depth);
+    deep[depth * 2] = '\0';
+    check_validate(deep, JSON_PARSE_DEFAULT, 0);
+    check_validate(deep, JSON_PARSE_DEFAULT, 70000);
+    check_validate(deep, JSON_PARSE_DEFAULT, depth);
+    json_error_info err;
+    assert(json_validate(deep, depth * 2, NULL, &err));
+    assert(!json_validate(deep, depth * 2 - 1, NULL, &err));
+    assert(err.code == JSON_ERROR_SYNTAX);
+    deep[depth + 1] = '}';
+    check_validate(deep, JSON_PARSE_DEFAULT, 0);
+    free(deep);
+    size_t mixed_len;
+    char *mixed = make_deep(200000, &mixed_len);
+    check_validate(mixed, JSON_PARSE_DEFAULT, 0);
+    check_validate(mixed, JSON_PARSE_DEFAULT, 150000);
+    free(mixed);
+
+    assert(!json_validate(NULL, 0, NULL, &err));
+    assert(err.code == JSON_ERROR_SYNTAX);
+}
+
+static void check_minify(const char *json, uint32_t flags, const char *expected) {
+    size_t len = strlen(json);
+    char *out = malloc(len + 1);
+    size_t n = json_minify(json, len, out, flags);
+    assert(n == strlen(expected));
+    assert(memcmp(out, expected, n) == 0);
+
+    /* In place */
+    memcpy(out, json, len);
+    assert(json_minify(out, len, out, flags) == n);
+    assert(memcmp(out, expected, n) == 0);
+    free(out);
+}
+
+TEST(minify) {
+    for (int tier = JSON_SIMD_SCALAR; tier <= JSON_SIMD_SVE2; tier++) {
+        if (!json_set_simd_tier((json_simd_tier)tier)) continue;
+
+        check_minify("", 0, "");
+        check_minify(" { \"a\" : [ 1 , 2 ] ,\n\t\"b\" : \"x y\" }\r\n", 0,
+                     "{\"a\":[1,2],\"b\":\"x y\"}");
+        check_minify("[\"a \\\" b\", \"c \\\\\", \"d  e\" ]", 0,
+                     "[\"a \\\" b\",\"c \\\\\",\"d  e\"]");
+
+        /* Strings, escapes and backslash runs across block boundaries */
+        check_minify("[   \"the string starts in the first block and ends in the second   \" ,  3 ]",
+                     0, "[\"the string starts in the first block and ends in the second   \",3]");
+        check_minify("[ \"string text running up to the block end, then backslashes \\\\\\\\\\\\\\\" spanning\" , 1 ]",
+                     0, "[\"string text running up to the block end, then backslashes \\\\\\\\\\\\\\\" spanning\",1]");
+
+        /* Comments only with the flag, never inside strings */
+        const char *commented = "{ // line\n  \"a\": 1, /* block */ \"b\": \"// kept /* too */\" /* open";
+        check_minify(commented, JSON_PARSE_ALLOW_COMMENTS,
+                     "{\"a\":1,\"b\":\"// kept /* too */\"");
+        check_minify("[1 / 2, 3]", JSON_PARSE_ALLOW_COMMENTS, "[1/2,3]");
+        check_minify("[1, // trailing", JSON_PARSE_ALLOW_COMMENTS, "[1,");
+        check_minify("[1 /* x */ ]", 0, "[1/*x*/]");
+    }
+    json_set_simd_tier(JSON_SIMD_AUTO);
+
+    /* A pretty-printed document minifies to what stringify writes */
+    const char *src = "{\"k\": [1, 2.5, \"s p a c e\", {\"n\": null}]}";
+    json_doc *doc = json_parse(src, strlen(src));
+    assert(doc != NULL);
+    json_stringify_options pretty = { .flags = JSON_STRINGIFY_PRETTY, .indent = 2 };
+    char *text = json_stringify_opts(json_doc_root(doc), &pretty);
+    char *compact = json_stringify(json_doc_root(doc));
+    assert(text && compact);
+    size_t n = json_minify(text, strlen(text), text, 0);
+    assert(n == strlen(compact));
+    assert(memcmp(text, compact, n) == 0);
+    free(text);
+    free(compact);
+    json_doc_free(doc);
+}
+
 /* ============================================================================
  * Main
  * ============================================================================ */
@@ -370,9 +1321,11 @@ int main(void) {
     RUN(parse_positive_int);
     RUN(parse_negative_int);
     RUN(parse_large_int);
+    RUN(parse_int_overflow);
     RUN(parse_float);
     RUN(parse_float_exponent);
     RUN(parse_negative_exponent);
+    RUN(parse_float_exact);
 
     /* Strings */
     RUN(parse_empty_string);
@@ -380,8 +1333,13 @@ int main(void) {
     RUN(parse_short_string);
     RUN(parse_long_string);
     RUN(parse_escaped_string);
+    RUN(parse_long_escaped_string);
     RUN(parse_escaped_quote);
     RUN(parse_unicode_escape);
+    RUN(parse_insitu);
+    RUN(parse_borrow);
+    RUN(parse_intern);
+    RUN(parse_validate_utf8);
 
     /* Arrays */
     RUN(parse_empty_array);
@@ -393,10 +1351,13 @@ int main(void) {
     RUN(parse_empty_object);
     RUN(parse_simple_object);
     RUN(parse_nested_object);
+    RUN(parse_long_keys);
+    RUN(parse_arena_growth);
 
     /* Whitespace */
     RUN(parse_with_whitespace);
     RUN(parse_with_newlines);
+    RUN(parse_indented);
 
     /* Errors */
     RUN(error_empty_input);
@@ -404,6 +1365,36 @@ int main(void) {
     RUN(error_unclosed_string);
     RUN(error_unclosed_array);
     RUN(error_trailing_content);
+    RUN(parse_deep_nesting);
+    RUN(stringify_deep_nesting);
+
+    /* Two-stage parser */
+    RUN(two_stage_matches);
+    RUN(two_stage_block_boundaries);
+    RUN(two_stage_errors);
+
+    /* Streaming */
+    RUN(stream_ndjson);
+    RUN(stream_bad_record);
+    RUN(stream_truncated);
+    RUN(stream_block_boundaries);
+
+    /* Push parser */
+    RUN(feed_every_split);
+    RUN(feed_root_scalars);
+    RUN(feed_errors);
+
+    /* Parallel parsing */
+    RUN(parallel_matches);
+    RUN(parallel_large);
+    RUN(parallel_errors);
+
+    /* Batch parsing */
+    RUN(batch_parse);
+
+    /* Validation and minification */
+    RUN(validate_matches_parse);
+    RUN(minify);
 
     printf("\nAll parser tests passed!\n");
     return 0;
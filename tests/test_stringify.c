@@ -2,12 +2,18 @@
  * json-asm: Stringify tests
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "json_asm.h"
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define TEST(name) static void test_##name(void)
 #define RUN(name) do { \
     printf("  " #name "... "); \
@@ -85,6 +91,15 @@ TEST(stringify_float) {
     json_doc_free(doc);
 }
 
+TEST(stringify_float_shortest) {
+    char *s = roundtrip("[0.1, 1.5e300, 1e-7, 123456.789, -0.0, 100.0, 5e-324, "
+                        "1.7976931348623157e308, 0.30000000000000004]");
+    assert(s != NULL);
+    assert(strcmp(s, "[0.1,1.5e+300,1e-07,123456.789,-0,100,5e-324,"
+                     "1.7976931348623157e+308,0.30000000000000004]") == 0);
+    free(s);
+}
+
 /* ============================================================================
  * String Tests
  * ============================================================================ */
@@ -124,6 +139,41 @@ TEST(stringify_string_with_quote) {
     json_doc_free(doc);
 }
 
+TEST(stringify_string_long_runs) {
+    /* Escapes on both sides of 8-byte boundaries in a longer string */
+    const char *json = "\"abcdefg\\\"hijklmnopqrstuvw\\u0001xyz0123456789\\n\"";
+    char *s = roundtrip(json);
+    assert(s != NULL);
+    assert(strcmp(s, json) == 0);
+    free(s);
+}
+
+TEST(stringify_escape_flags) {
+    const char *json = "\"a/b \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xff\"";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+
+    char *s = json_stringify(json_doc_root(doc));
+    assert(s != NULL);
+    assert(strcmp(s, json) == 0);
+    free(s);
+
+    json_stringify_options opts = { .flags = JSON_STRINGIFY_ESCAPE_SLASH };
+    s = json_stringify_opts(json_doc_root(doc), &opts);
+    assert(s != NULL);
+    assert(strcmp(s, "\"a\\/b \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xff\"") == 0);
+    free(s);
+
+    /* Surrogate pairs above the BMP, U+FFFD for malformed bytes */
+    opts.flags = JSON_STRINGIFY_ESCAPE_UNI;
+    s = json_stringify_opts(json_doc_root(doc), &opts);
+    assert(s != NULL);
+    assert(strcmp(s, "\"a/b \\u00e9 \\u20ac \\ud83d\\ude00 \\ufffd\"") == 0);
+    free(s);
+
+    json_doc_free(doc);
+}
+
 /* ============================================================================
  * Array Tests
  * ============================================================================ */
@@ -258,6 +308,150 @@ TEST(stringify_buffer_too_small) {
     json_doc_free(doc);
 }
 
+TEST(stringify_exact_size) {
+    const char *json = "{\"a\":[1,-2.5,1e300,\"x/\\u00e9\\n\"],\"b\":{\"c\":null,\"d\":[]}}";
+    json_doc *doc = json_parse(json, strlen(json));
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    json_stringify_options variants[] = {
+        { .flags = JSON_STRINGIFY_DEFAULT },
+        { .flags = JSON_STRINGIFY_PRETTY, .indent = 2 },
+        { .flags = JSON_STRINGIFY_PRETTY, .indent = 4, .newline = "\r\n" },
+        { .flags = JSON_STRINGIFY_ESCAPE_SLASH | JSON_STRINGIFY_ESCAPE_UNI },
+    };
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        char *s = json_stringify_opts(root, &variants[i]);
+        assert(s != NULL);
+        size_t size = json_stringify_size(root, &variants[i]);
+        assert(size == strlen(s));
+
+        /* Exactly enough room, and one byte short */
+        char *buf = malloc(size + 1);
+        assert(json_stringify_buf_opts(root, &variants[i], buf, size + 1) == size);
+        assert(strcmp(buf, s) == 0);
+        assert(json_stringify_buf_opts(root, &variants[i], buf, size) == size);
+        assert(buf[0] == '\0');
+        assert(json_stringify_buf_opts(root, &variants[i], NULL, 0) == size);
+
+        free(buf);
+        free(s);
+    }
+
+    /* The document remembers its length; repeats give the same output */
+    char *first = json_doc_stringify(doc);
+    char *second = json_doc_stringify(doc);
+    assert(first != NULL && second != NULL);
+    assert(strcmp(first, second) == 0);
+    assert(strlen(first) == json_stringify_size(root, NULL));
+    free(first);
+    free(second);
+
+    json_doc_free(doc);
+}
+
+/* ============================================================================
+ * Streaming Tests
+ * ============================================================================ */
+
+struct collected {
+    char *data;
+    size_t len;
+    size_t calls;
+    size_t fail_after;          /* Return false on this call (0 = never) */
+};
+
+static bool collect(void *user_data, const char *data, size_t len) {
+    struct collected *c = user_data;
+    if (++c->calls == c->fail_after) return false;
+    c->data = realloc(c->data, c->len + len + 1);
+    assert(c->data != NULL);
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    c->data[c->len] = '\0';
+    return true;
+}
+
+/* A document larger than the 64 KB sink buffer, with strings long enough to
+ * be passed through uncopied on either side of short ones */
+static json_doc *large_doc(void) {
+    size_t cap = 512 * 1024;
+    char *json = malloc(cap);
+    assert(json != NULL);
+    size_t len = 0;
+    json[len++] = '[';
+    for (int i = 0; i < 200; i++) {
+        len += (size_t)snprintf(json + len, cap - len, "%s{\"id\":%d,\"s\":\"", i ? "," : "", i);
+        size_t run = (size_t)(i % 7) * 700;
+        memset(json + len, 'a' + i % 26, run);
+        len += run;
+        len += (size_t)snprintf(json + len, cap - len, "\\n/end\"}");
+    }
+    json[len++] = ']';
+
+    json_doc *doc = json_parse(json, len);
+    free(json);
+    return doc;
+}
+
+TEST(stringify_write_callback) {
+    json_doc *doc = large_doc();
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+
+    json_stringify_options opts = { .flags = JSON_STRINGIFY_ESCAPE_SLASH };
+    char *expected = json_stringify_opts(root, &opts);
+    assert(expected != NULL);
+
+    struct collected c = {0};
+    assert(json_stringify_write(root, &opts, collect, &c));
+    assert(c.len == strlen(expected));
+    assert(memcmp(c.data, expected, c.len) == 0);
+    assert(c.calls > 1);
+    free(c.data);
+
+    /* A callback that gives up stops the output */
+    struct collected failing = { .fail_after = 2 };
+    assert(!json_stringify_write(root, &opts, collect, &failing));
+    assert(json_get_error().code == JSON_ERROR_IO);
+    assert(failing.calls == 2);
+    free(failing.data);
+
+    free(expected);
+    json_doc_free(doc);
+}
+
+#if !defined(_WIN32)
+TEST(stringify_write_fd) {
+    json_doc *doc = large_doc();
+    assert(doc != NULL);
+    json_val *root = json_doc_root(doc);
+    char *expected = json_stringify(root);
+    assert(expected != NULL);
+    size_t len = strlen(expected);
+
+    const char *path = "test_stringify_fd.json";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    assert(json_stringify_fd(root, NULL, fd));
+    close(fd);
+
+    char *written = malloc(len + 1);
+    FILE *f = fopen(path, "rb");
+    assert(f != NULL);
+    assert(fread(written, 1, len + 1, f) == len);
+    fclose(f);
+    remove(path);
+    assert(memcmp(written, expected, len) == 0);
+
+    assert(!json_stringify_fd(root, NULL, -1));
+
+    free(written);
+    free(expected);
+    json_doc_free(doc);
+}
+#endif
+
 /* ============================================================================
  * Roundtrip Tests
  * ============================================================================ */
@@ -298,12 +492,15 @@ int main(void) {
     RUN(stringify_positive_int);
     RUN(stringify_negative_int);
     RUN(stringify_float);
+    RUN(stringify_float_shortest);
 
     /* Strings */
     RUN(stringify_empty_string);
     RUN(stringify_simple_string);
     RUN(stringify_string_with_escapes);
     RUN(stringify_string_with_quote);
+    RUN(stringify_string_long_runs);
+    RUN(stringify_escape_flags);
 
     /* Arrays */
     RUN(stringify_empty_array);
@@ -323,6 +520,13 @@ int main(void) {
     /* Buffer */
     RUN(stringify_to_buffer);
     RUN(stringify_buffer_too_small);
+    RUN(stringify_exact_size);
+
+    /* Streaming */
+    RUN(stringify_write_callback);
+#if !defined(_WIN32)
+    RUN(stringify_write_fd);
+#endif
 
     /* Roundtrip */
     RUN(roundtrip_complex);